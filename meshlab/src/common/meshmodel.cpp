@@ -192,6 +192,7 @@ bool MeshDocument::delMesh(MeshModel *mmToDel)
 {
 	if(!meshList.removeOne(mmToDel)) 
 		return false;
+	undoStack.remove(mmToDel);
 	if((currentMesh == mmToDel) && (meshList.size() != 0))
 		setCurrentMesh(this->meshList.at(0)->id());
 	else if (meshList.size() == 0)
@@ -458,63 +459,34 @@ MeshLabRenderRaster::~MeshLabRenderRaster()
 		delete planeList[ii];
 }
 
-void MeshModelState::create(int _mask, MeshModel* _m)
+void MeshModelState::create(int _mask, MeshModel* _m, const MeshModelState *base)
 {
+    if(base && base->m != _m) base = 0;
     m=_m;
     changeMask=_mask;
     if(changeMask & MeshModel::MM_VERTCOLOR)
-    {
-        vertColor.resize(m->cm.vert.size());
-        std::vector<Color4b>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci = vertColor.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-            if(!(*vi).IsD()) (*ci)=(*vi).C();
-    }
+        vertColor.create(m->cm.vert, base ? &base->vertColor : 0);
+    else vertColor.clear();
 
     if(changeMask & MeshModel::MM_VERTQUALITY)
-    {
-        vertQuality.resize(m->cm.vert.size());
-        std::vector<float>::iterator qi;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), qi = vertQuality.begin(); vi != m->cm.vert.end(); ++vi, ++qi)
-            if(!(*vi).IsD()) (*qi)=(*vi).Q();
-    }
+        vertQuality.create(m->cm.vert, base ? &base->vertQuality : 0);
+    else vertQuality.clear();
 
     if(changeMask & MeshModel::MM_VERTCOORD)
-    {
-        vertCoord.resize(m->cm.vert.size());
-        std::vector<Point3f>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci = vertCoord.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-             if(!(*vi).IsD()) (*ci)=(*vi).P();
-    }
+        vertCoord.create(m->cm.vert, base ? &base->vertCoord : 0);
+    else vertCoord.clear();
 
     if(changeMask & MeshModel::MM_VERTNORMAL)
-    {
-        vertNormal.resize(m->cm.vert.size());
-        std::vector<Point3f>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci = vertNormal.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-             if(!(*vi).IsD()) (*ci)=(*vi).N();
-    }
+        vertNormal.create(m->cm.vert, base ? &base->vertNormal : 0);
+    else vertNormal.clear();
 
     if(changeMask & MeshModel::MM_FACEFLAGSELECT)
-    {
-        faceSelection.resize(m->cm.face.size());
-        std::vector<bool>::iterator ci;
-        CMeshO::FaceIterator fi;
-        for(fi = m->cm.face.begin(), ci = faceSelection.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-         if(!(*fi).IsD()) (*ci) = (*fi).IsS();
-    }
+        faceSelection.create(m->cm.face, base ? &base->faceSelection : 0);
+    else faceSelection.clear();
 
-	if(changeMask & MeshModel::MM_VERTFLAGSELECT)
-	{
-		vertSelection.resize(m->cm.vert.size());
-		std::vector<bool>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertSelection.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-			if(!(*vi).IsD()) (*ci) = (*vi).IsS();
-	}
+    if(changeMask & MeshModel::MM_VERTFLAGSELECT)
+        vertSelection.create(m->cm.vert, base ? &base->vertSelection : 0);
+    else vertSelection.clear();
 
   if(changeMask & MeshModel::MM_TRANSFMATRIX)
       Tr = m->cm.Tr;
@@ -522,75 +494,42 @@ void MeshModelState::create(int _mask, MeshModel* _m)
       this->shot = m->cm.shot;
 }
 
+bool MeshModelState::isValid(MeshModel *_m)
+{
+  if(_m != m || m == 0)
+	  return false;
+  const int vn = int(m->cm.vert.size());
+  if((changeMask & MeshModel::MM_VERTCOLOR) && vertColor.size() != vn) return false;
+  if((changeMask & MeshModel::MM_VERTQUALITY) && vertQuality.size() != vn) return false;
+  if((changeMask & MeshModel::MM_VERTCOORD) && vertCoord.size() != vn) return false;
+  if((changeMask & MeshModel::MM_VERTNORMAL) && vertNormal.size() != vn) return false;
+  if((changeMask & MeshModel::MM_VERTFLAGSELECT) && vertSelection.size() != vn) return false;
+  if((changeMask & MeshModel::MM_FACEFLAGSELECT) && faceSelection.size() != int(m->cm.face.size())) return false;
+  return true;
+}
+
 bool MeshModelState::apply(MeshModel *_m)
 {
-  if(_m != m) 
+  if(!isValid(_m))
 	  return false;
     if(changeMask & MeshModel::MM_VERTCOLOR)
-    {
-        if(vertColor.size() != m->cm.vert.size()) return false;
-        std::vector<Color4b>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci = vertColor.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-            if(!(*vi).IsD()) (*vi).C()=(*ci);
-    }
+        vertColor.apply(m->cm.vert);
     if(changeMask & MeshModel::MM_VERTQUALITY)
-    {
-        if(vertQuality.size() != m->cm.vert.size()) return false;
-        std::vector<float>::iterator qi;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), qi = vertQuality.begin(); vi != m->cm.vert.end(); ++vi, ++qi)
-            if(!(*vi).IsD()) (*vi).Q()=(*qi);
-    }
-
+        vertQuality.apply(m->cm.vert);
     if(changeMask & MeshModel::MM_VERTCOORD)
-    {
-        if(vertCoord.size() != m->cm.vert.size()) return false;
-        std::vector<Point3f>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci = vertCoord.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-            if(!(*vi).IsD()) (*vi).P()=(*ci);
-    }
+        vertCoord.apply(m->cm.vert);
 
     if(changeMask & MeshModel::MM_VERTNORMAL)
     {
-        if(vertNormal.size() != m->cm.vert.size()) return false;
-        std::vector<Point3f>::iterator ci;
-        CMeshO::VertexIterator vi;
-        for(vi = m->cm.vert.begin(), ci=vertNormal.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-            if(!(*vi).IsD()) (*vi).N()=(*ci);
-
+        vertNormal.apply(m->cm.vert);
         //now reset the face normals
         tri::UpdateNormal<CMeshO>::PerFaceNormalized(m->cm);
     }
 
     if(changeMask & MeshModel::MM_FACEFLAGSELECT)
-    {
-        if(faceSelection.size() != m->cm.face.size()) return false;
-        std::vector<bool>::iterator ci;
-        CMeshO::FaceIterator fi;
-        for(fi = m->cm.face.begin(), ci = faceSelection.begin(); fi != m->cm.face.end(); ++fi, ++ci)
-        {
-            if((*ci))
-                (*fi).SetS();
-            else
-                (*fi).ClearS();
-        }
-    }
-
+        faceSelection.apply(m->cm.face);
 	if(changeMask & MeshModel::MM_VERTFLAGSELECT)
-	{
-		if(vertSelection.size() != m->cm.vert.size()) return false;
-		std::vector<bool>::iterator ci;
-		CMeshO::VertexIterator vi;
-		for(vi = m->cm.vert.begin(), ci = vertSelection.begin(); vi != m->cm.vert.end(); ++vi, ++ci)
-		{
-			if((*ci))
-				(*vi).SetS();
-			else
-				(*vi).ClearS();
-		}
-	}
+		vertSelection.apply(m->cm.vert);
 
     if(changeMask & MeshModel::MM_TRANSFMATRIX)
         m->cm.Tr=Tr;
@@ -600,6 +539,53 @@ bool MeshModelState::apply(MeshModel *_m)
     return true;
 }
 
+void MeshModelStateStack::setMaxLevels(int levels)
+{
+  maxLevels = std::max(levels,0);
+  while(states.size() > maxLevels)
+    states.removeFirst();
+}
+
+bool MeshModelStateStack::push(int mask, MeshModel *m)
+{
+  if(!MeshModelState::isSupported(mask))
+  {
+    remove(m);
+    return false;
+  }
+  // the most recent state of the same mesh, whose unchanged data is shared
+  const MeshModelState *base = 0;
+  for(int i=states.size()-1; i>=0 && base==0; --i)
+    if(states[i].mesh() == m) base = &states[i];
+
+  MeshModelState state;
+  state.create(mask,m,base);
+  states.append(state);
+  while(states.size() > maxLevels)
+    states.removeFirst();
+  return true;
+}
+
+MeshModel *MeshModelStateStack::undo()
+{
+  if(states.isEmpty()) return 0;
+  MeshModelState state = states.takeLast();
+  MeshModel *m = state.mesh();
+  if(!state.apply(m))
+  {
+    // the mesh has changed in a way that prevents restoring its older states too
+    remove(m);
+    return 0;
+  }
+  return m;
+}
+
+void MeshModelStateStack::remove(MeshModel *m)
+{
+  for(int i=states.size()-1; i>=0; --i)
+    if(states[i].mesh() == m) states.removeAt(i);
+}
+
 /**** DATAMASK STUFF ****/
 
 bool MeshModel::hasDataMask(const int maskToBeTested) const
@@ -696,17 +682,6 @@ MeshLabRenderMesh::MeshLabRenderMesh()
 {
 }
 
-MeshLabRenderMesh::MeshLabRenderMesh(CMeshO& mesh )
-:glw(),cm()
-{
-	vcg::tri::Append<CMeshO,CMeshO>::MeshCopy(cm,mesh);
-	//cm.Tr = mesh.Tr;
-	cm.Tr.SetIdentity();
-	cm.sfn = mesh.sfn;
-	cm.svn = mesh.svn;
-	glw.m = &cm; 
-}
-
 bool MeshLabRenderMesh::render(vcg::GLW::DrawMode dm,vcg::GLW::ColorMode colm,vcg::GLW::TextureMode tm )
 {
 	if (glw.m != NULL)
@@ -806,154 +781,190 @@ MeshLabRenderMesh::~MeshLabRenderMesh()
 	cm.face.swap(tempFace);
 }
 
-MeshLabRenderState::MeshLabRenderState()
-:_meshmap(),_meshmut(QReadWriteLock::Recursive),_rastermut(QReadWriteLock::Recursive)
+MeshLabRenderMeshBuffers::MeshLabRenderMeshBuffers(CMeshO& mesh )
 {
-
+	set(mesh);
+	//Tr = mesh.Tr;
+	Tr.SetIdentity();
 }
 
-MeshLabRenderState::~MeshLabRenderState()
+void MeshLabRenderMeshBuffers::set(CMeshO& mesh )
 {
-	clearState();
+	CVertexO *vbase = mesh.vert.empty() ? 0 : &mesh.vert[0];
+	vertCoord.create(mesh.vert,&vertCoord);
+	vertNormal.create(mesh.vert,&vertNormal);
+	vertColor.create(mesh.vert,&vertColor);
+	vertDeleted.create(mesh.vert,&vertDeleted);
+	faceVert.create(mesh.face,&faceVert,MeshStateAccessor::FaceVert(vbase));
+	if (vcg::tri::HasPerFaceColor(mesh))
+		faceColor.create(mesh.face,&faceColor);
+	else
+		faceColor.clear();
+	bbox = mesh.bbox;
+	meshColor = mesh.C();
 }
 
-bool MeshLabRenderState::update(const int id,CMeshO& mm,const int updateattributesmask)
+bool MeshLabRenderMeshBuffers::update(CMeshO& mm,const int updateattributesmask)
 {
-	if (updateattributesmask == MeshModel::MM_NONE)
+	if (!(updateattributesmask & MeshModel::MM_VERTCOLOR) &
+		!(updateattributesmask & MeshModel::MM_VERTCOORD) &
+		!(updateattributesmask & MeshModel::MM_VERTQUALITY) &
+		!(updateattributesmask & MeshModel::MM_VERTNORMAL) &
+		!(updateattributesmask & MeshModel::MM_FACEFLAGSELECT) &
+		!(updateattributesmask & MeshModel::MM_VERTFLAGSELECT) &
+		!(updateattributesmask & MeshModel::MM_TRANSFMATRIX) &
+		!(updateattributesmask & MeshModel::MM_CAMERA))
+	{
+		// something else (e.g. the topology) has changed: take everything again
+		set(mm);
+		return true;
+	}
+
+	// the selection, the quality and the camera are not drawn from here
+	if (int(mm.vert.size()) != vertCoord.size())
 		return false;
-	lockRenderState(MESH,WRITE);
-	QMap<int,MeshLabRenderMesh*>::iterator it = _meshmap.find(id);
-	if (it != _meshmap.end())
+	if (updateattributesmask & MeshModel::MM_VERTCOLOR)
+		vertColor.create(mm.vert,&vertColor);
+	if (updateattributesmask & MeshModel::MM_VERTCOORD)
 	{
-		MeshLabRenderMesh* rm = *it;
-
-		if (!(updateattributesmask & MeshModel::MM_VERTCOLOR) &
-			!(updateattributesmask & MeshModel::MM_VERTCOORD) &
-			!(updateattributesmask & MeshModel::MM_VERTQUALITY) &
-			!(updateattributesmask & MeshModel::MM_VERTNORMAL) &
-			!(updateattributesmask & MeshModel::MM_FACEFLAGSELECT) &
-			!(updateattributesmask & MeshModel::MM_VERTFLAGSELECT) &
-			!(updateattributesmask & MeshModel::MM_TRANSFMATRIX) &
-			!(updateattributesmask & MeshModel::MM_CAMERA))
-		{
-			remove(it);
-			_meshmap[id] = new MeshLabRenderMesh(mm);
-			unlockRenderState(MESH);
-			return true;
-		}
+		vertCoord.create(mm.vert,&vertCoord);
+		bbox = mm.bbox;
+	}
+	if (updateattributesmask & MeshModel::MM_VERTNORMAL)
+		vertNormal.create(mm.vert,&vertNormal);
+	if (updateattributesmask & MeshModel::MM_TRANSFMATRIX)
+		Tr = mm.Tr;
+	return true;
+}
 
-		if (updateattributesmask & MeshModel::MM_VERTCOLOR)
-		{		
-			if(mm.vert.size() != (rm->cm.vert.size())) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			else
-			{
-				CMeshO::VertexIterator rmvi = rm->cm.vert.begin();
-				for(CMeshO::ConstVertexIterator mmvi = mm.vert.begin(); mmvi != mm.vert.end(); ++mmvi, ++rmvi)
-					if(!(*mmvi).IsD()) 
-						(*rmvi).C()=(*mmvi).cC();
-			}
-		}
+void MeshLabRenderMeshBuffers::render(vcg::GLW::DrawMode dm,vcg::GLW::ColorMode colm,vcg::GLW::TextureMode /*tm*/ )
+{
+	// the textures are not kept: the mesh is drawn untextured until the end of the filter
+	if( (colm == vcg::GLW::CMPerFace)  && (faceColor.size() == 0) ) 
+		colm=vcg::GLW::CMNone;
+	glPushMatrix();
+	glMultMatrix(Tr);
+	if (colm == vcg::GLW::CMPerMesh)
+		glColor(meshColor);
+	switch(dm)
+	{
+		case vcg::GLW::DMBox:
+			glBoxWire(bbox);
+			break;
+		case vcg::GLW::DMPoints:
+			drawPoints(colm);
+			break;
+		case vcg::GLW::DMWire:
+			drawWire(colm);
+			break;
+		case vcg::GLW::DMHidden:
+			glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LIGHTING_BIT );
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(1.0, 1);
+			glDisable(GL_LIGHTING);
+			glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+			drawFill(false,vcg::GLW::CMNone);
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glEnable(GL_LIGHTING);
+			glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+			drawWire(vcg::GLW::CMNone);
+			glPopAttrib();
+			break;
+		case vcg::GLW::DMFlat:
+			drawFill(true,colm);
+			break;
+		case vcg::GLW::DMFlatWire:
+			glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LIGHTING_BIT );
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(1.0, 1);
+			drawFill(true,colm);
+			glDisable(GL_POLYGON_OFFSET_FILL);
+			glEnable(GL_COLOR_MATERIAL);
+			glColorMaterial(GL_FRONT_AND_BACK,GL_AMBIENT_AND_DIFFUSE);
+			glColor3f(.3f,.3f,.3f);
+			drawWire(vcg::GLW::CMNone);
+			glPopAttrib();
+			break;
+		case vcg::GLW::DMSmooth:
+		case vcg::GLW::DMRadar:
+			drawFill(false,colm);
+			break;
+		default: 
+			break;
+	}
+	glPopMatrix();
+}
 
-		if (updateattributesmask & MeshModel::MM_VERTCOORD)
+void MeshLabRenderMeshBuffers::drawFill(bool perFaceNormal,vcg::GLW::ColorMode colm)
+{
+	glBegin(GL_TRIANGLES);
+	for(int i=0;i<faceVert.size();++i)
+	{
+		const vcg::Point3i fv = faceVert[i];
+		if (fv[0] < 0)
+			continue;
+		const vcg::Point3f p0 = vertCoord[fv[0]], p1 = vertCoord[fv[1]], p2 = vertCoord[fv[2]];
+		if (perFaceNormal)
+			glNormal(vcg::NormalizedNormal(p0,p1,p2));
+		if (colm == vcg::GLW::CMPerFace)
+			glColor(faceColor[i]);
+		for(int j=0;j<3;++j)
 		{
-			if(mm.vert.size() != (rm->cm.vert.size())) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			else
-			{
-				CMeshO::VertexIterator rmvi = rm->cm.vert.begin();
-				for(CMeshO::ConstVertexIterator mmvi = mm.vert.begin(); mmvi != mm.vert.end(); ++mmvi, ++rmvi)
-					if(!(*mmvi).IsD()) 
-						(*rmvi).P()=(*mmvi).cP();
-			}
+			if (!perFaceNormal)
+				glNormal(vertNormal[fv[j]]);
+			if (colm == vcg::GLW::CMPerVert)
+				glColor(vertColor[fv[j]]);
+			glVertex(j==0 ? p0 : (j==1 ? p1 : p2));
 		}
+	}
+	glEnd();
+}
 
-		if (updateattributesmask & MeshModel::MM_VERTQUALITY)
-		{
-			if(mm.vert.size() != (rm->cm.vert.size())) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			else
-			{
-				CMeshO::VertexIterator rmvi = rm->cm.vert.begin();
-				for(CMeshO::ConstVertexIterator mmvi = mm.vert.begin(); mmvi != mm.vert.end(); ++mmvi, ++rmvi)
-					if(!(*mmvi).IsD()) 
-						(*rmvi).Q()=(*mmvi).cQ();
-			}
-		}
+void MeshLabRenderMeshBuffers::drawWire(vcg::GLW::ColorMode colm)
+{
+	glPushAttrib(GL_POLYGON_BIT);
+	glPolygonMode(GL_FRONT_AND_BACK,GL_LINE);
+	drawFill(false,colm);
+	glPopAttrib();
+}
 
-		if	(updateattributesmask & MeshModel::MM_VERTNORMAL)
-		{
-			if(mm.vert.size() != (rm->cm.vert.size())) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			else
-			{
-				CMeshO::VertexIterator rmvi = rm->cm.vert.begin();
-				for(CMeshO::ConstVertexIterator mmvi = mm.vert.begin(); mmvi != mm.vert.end(); ++mmvi, ++rmvi)
-					if(!(*mmvi).IsD()) 
-						(*rmvi).N()=(*mmvi).cN();
-			}
-		}
-		
-		if(updateattributesmask & MeshModel::MM_FACEFLAGSELECT)
-		{
-			if(mm.face.size() != rm->cm.face.size()) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			CMeshO::FaceIterator rmfi = rm->cm.face.begin();
-			for(CMeshO::ConstFaceIterator mmfi = mm.face.begin(); mmfi != mm.face.end(); ++mmfi, ++rmfi)
-			{
-				if ((!(*mmfi).IsD()) && ((*mmfi).IsS()))
-					(*rmfi).SetS();
-				else
-					if (!(*mmfi).IsS())
-						(*rmfi).ClearS();
-			}
-		}
+void MeshLabRenderMeshBuffers::drawPoints(vcg::GLW::ColorMode colm)
+{
+	glBegin(GL_POINTS);
+	for(int i=0;i<vertCoord.size();++i)
+	{
+		if (vertDeleted[i])
+			continue;
+		glNormal(vertNormal[i]);
+		if (colm == vcg::GLW::CMPerVert)
+			glColor(vertColor[i]);
+		glVertex(vertCoord[i]);
+	}
+	glEnd();
+}
 
-		if(updateattributesmask & MeshModel::MM_VERTFLAGSELECT)
-		{
-			if(mm.vert.size() != (rm->cm.vert.size())) 
-			{
-				unlockRenderState(MESH);
-				return false;
-			}
-			else
-			{
-				CMeshO::VertexIterator rmvi = rm->cm.vert.begin();
-				for(CMeshO::ConstVertexIterator mmvi = mm.vert.begin(); mmvi != mm.vert.end(); ++mmvi, ++rmvi)
-				{
-					if ((!(*mmvi).IsD()) && ((*mmvi).IsS()))
-						(*rmvi).SetS();
-					else
-						if (!(*mmvi).IsS())
-							(*rmvi).ClearS();
-				}
-			}
-		}
+MeshLabRenderState::MeshLabRenderState()
+:_meshmap(),_meshmut(QReadWriteLock::Recursive),_rastermut(QReadWriteLock::Recursive)
+{
 
-		if(updateattributesmask & MeshModel::MM_TRANSFMATRIX)
-			rm->cm.Tr = mm.Tr;
-		if(updateattributesmask & MeshModel::MM_CAMERA)
-			rm->cm.shot = mm.shot;
-		unlockRenderState(MESH);
-		return true;
-	}
+}
+
+MeshLabRenderState::~MeshLabRenderState()
+{
+	clearState();
+}
+
+bool MeshLabRenderState::update(const int id,CMeshO& mm,const int updateattributesmask)
+{
+	if (updateattributesmask == MeshModel::MM_NONE)
+		return false;
+	lockRenderState(MESH,WRITE);
+	QMap<int,MeshLabRenderMeshBuffers*>::iterator it = _meshmap.find(id);
+	bool res = false;
+	if (it != _meshmap.end())
+		res = (*it)->update(mm,updateattributesmask);
 	unlockRenderState(MESH);
-	return false;
+	return res;
 }
 
 void MeshLabRenderState::add(const int id,CMeshO& mm )
@@ -961,19 +972,19 @@ void MeshLabRenderState::add(const int id,CMeshO& mm )
 	lockRenderState(MESH,WRITE);
 	if (!_meshmap.contains(id))
 	{
-		_meshmap[id] = new MeshLabRenderMesh(mm);
+		_meshmap[id] = new MeshLabRenderMeshBuffers(mm);
 	}
 	unlockRenderState(MESH);
 }
 
-QMap<int,MeshLabRenderMesh*>::iterator MeshLabRenderState::remove(QMap<int,MeshLabRenderMesh*>::iterator it )
+QMap<int,MeshLabRenderMeshBuffers*>::iterator MeshLabRenderState::remove(QMap<int,MeshLabRenderMeshBuffers*>::iterator it )
 {	
 	lockRenderState(MESH,WRITE);
 	if (it != _meshmap.end())
 	{
-		MeshLabRenderMesh* tmp = it.value();
+		MeshLabRenderMeshBuffers* tmp = it.value();
 		delete tmp;
-		QMap<int,MeshLabRenderMesh*>::iterator tmpit = _meshmap.erase(it);
+		QMap<int,MeshLabRenderMeshBuffers*>::iterator tmpit = _meshmap.erase(it);
 		unlockRenderState(MESH);
 		return tmpit;
 	}
@@ -984,7 +995,7 @@ QMap<int,MeshLabRenderMesh*>::iterator MeshLabRenderState::remove(QMap<int,MeshL
 void MeshLabRenderState::clearState()
 {
 	lockRenderState(MESH,WRITE);
-	QMap<int,MeshLabRenderMesh*>::iterator it = _meshmap.begin();
+	QMap<int,MeshLabRenderMeshBuffers*>::iterator it = _meshmap.begin();
 	while(it != _meshmap.end())
 		it = remove(it);
 	unlockRenderState(MESH);
@@ -1013,7 +1024,7 @@ void MeshLabRenderState::render( const int id,vcg::GLW::DrawMode dm,vcg::GLW::Co
 void MeshLabRenderState::render(vcg::GLW::DrawMode dm,vcg::GLW::ColorMode cm,vcg::GLW::TextureMode tm  )
 {
 	lockRenderState(MESH,READ);
-	for(QMap<int,MeshLabRenderMesh*>::iterator it = _meshmap.begin();it != _meshmap.end();++it)
+	for(QMap<int,MeshLabRenderMeshBuffers*>::iterator it = _meshmap.begin();it != _meshmap.end();++it)
 		(*it)->render(dm,cm,tm);
 	unlockRenderState(MESH);
 }
@@ -50,6 +50,7 @@
 #include <QString>
 #include <QStringList>
 #include <QFileInfo>
+#include <QSharedPointer>
 #include "GLLogStream.h"
 #include "filterscript.h"
 
@@ -124,7 +125,7 @@ public :
 	}
 };
 
-/*An ack in order to avoid to duplicate code. Should be used as MeshLabRenderMesh class itself ONLY inside MeshLabRenderState and as DERIVED class in MeshModel*/
+/*An ack in order to avoid to duplicate code. Should be used ONLY as BASE class of MeshModel (MeshLabRenderState keeps a MeshLabRenderMeshBuffers instead)*/
 
 class MeshLabRenderMesh
 {
@@ -132,10 +133,6 @@ public:
 	MeshLabRenderMesh();
 	~MeshLabRenderMesh();
 
-	//WARNING!!!!!: the constructor create a copy of the mesh passed as parameter. 
-	//The parameter should be const but this is impossible cause of vcg::tri::Append::MeshCopy implementation in the vcglib
-	MeshLabRenderMesh(CMeshO& mesh);
-
 	bool render(vcg::GLW::DrawMode dm,vcg::GLW::ColorMode cm,vcg::GLW::TextureMode tm );
 	bool renderSelectedFace();
 	bool renderSelectedVert();
@@ -426,6 +423,170 @@ public:
 
 }; // end class RenderMode
 
+/*
+An array of per element attributes of a mesh (e.g. the vertex colors), split in chunks of ChunkSize elements.
+The chunks are never modified once created and are shared, by reference counting, among the arrays having
+the same values in them: an array created with respect to a previous one (e.g. the state of the same mesh
+before a filter) copies only the chunks that have changed since then.
+The Accessor tells the container of the elements and how to get and set the attribute of an element.
+*/
+template <class Accessor>
+class MeshStateArray
+{
+public:
+	typedef typename Accessor::ContainerType ContainerType;
+	typedef typename Accessor::ValueType ValueType;
+	enum { ChunkSize = 1<<14 };
+
+	MeshStateArray() : n(0) {}
+
+	int size() const { return n; }
+	void clear() { chunks.clear(); n=0; }
+
+	ValueType operator[](int i) const { return (*(chunks[i/ChunkSize]))[i%ChunkSize]; }
+
+	// Save the attributes of the elements of c; the chunks equal to the ones of base (if any) are shared with it.
+	// base can be this array itself.
+	void create(ContainerType &c, const MeshStateArray *base, const Accessor &acc = Accessor())
+	{
+		const int newN = int(c.size());
+		const int chunkNum = (newN+ChunkSize-1)/ChunkSize;
+		std::vector<ChunkPointer> newChunks(chunkNum);
+		for(int k=0;k<chunkNum;++k)
+		{
+			const int start = k*ChunkSize;
+			const int end = std::min(newN,start+ChunkSize);
+			if(base && k<int(base->chunks.size()) && equal(c,start,end,*(base->chunks[k]),acc))
+				newChunks[k] = base->chunks[k];
+			else
+			{
+				std::vector<ValueType> *chunk = new std::vector<ValueType>(end-start);
+				for(int i=start;i<end;++i)
+					(*chunk)[i-start] = acc.get(c[i]);
+				newChunks[k] = ChunkPointer(chunk);
+			}
+		}
+		chunks.swap(newChunks);
+		n = newN;
+	}
+
+	// Restore the saved attributes into c, writing only the chunks that differ.
+	bool apply(ContainerType &c, const Accessor &acc = Accessor()) const
+	{
+		if(int(c.size()) != n) return false;
+		for(int k=0;k<int(chunks.size());++k)
+		{
+			const int start = k*ChunkSize;
+			const int end = std::min(n,start+ChunkSize);
+			const std::vector<ValueType> &chunk = *(chunks[k]);
+			if(!equal(c,start,end,chunk,acc))
+				for(int i=start;i<end;++i)
+					acc.set(c[i],chunk[i-start]);
+		}
+		return true;
+	}
+
+private:
+	typedef QSharedPointer<const std::vector<ValueType> > ChunkPointer;
+
+	static bool equal(ContainerType &c, int start, int end, const std::vector<ValueType> &chunk, const Accessor &acc)
+	{
+		if(int(chunk.size()) != end-start) return false;
+		for(int i=start;i<end;++i)
+			if(!(acc.get(c[i]) == chunk[i-start])) return false;
+		return true;
+	}
+
+	std::vector<ChunkPointer> chunks;
+	int n;
+};
+
+namespace MeshStateAccessor
+{
+	struct VertQuality {
+		typedef CMeshO::VertContainer ContainerType; typedef float ValueType;
+		ValueType get(CVertexO &v) const { return v.Q(); }
+		void set(CVertexO &v, const ValueType &val) const { v.Q()=val; }
+	};
+	struct VertColor {
+		typedef CMeshO::VertContainer ContainerType; typedef vcg::Color4b ValueType;
+		ValueType get(CVertexO &v) const { return v.C(); }
+		void set(CVertexO &v, const ValueType &val) const { v.C()=val; }
+	};
+	struct VertCoord {
+		typedef CMeshO::VertContainer ContainerType; typedef vcg::Point3f ValueType;
+		ValueType get(CVertexO &v) const { return v.P(); }
+		void set(CVertexO &v, const ValueType &val) const { v.P()=val; }
+	};
+	struct VertNormal {
+		typedef CMeshO::VertContainer ContainerType; typedef vcg::Point3f ValueType;
+		ValueType get(CVertexO &v) const { return v.N(); }
+		void set(CVertexO &v, const ValueType &val) const { v.N()=val; }
+	};
+	struct VertSelection {
+		typedef CMeshO::VertContainer ContainerType; typedef bool ValueType;
+		ValueType get(CVertexO &v) const { return v.IsS(); }
+		void set(CVertexO &v, const ValueType &val) const { if(val) v.SetS(); else v.ClearS(); }
+	};
+	struct VertDeleted {
+		typedef CMeshO::VertContainer ContainerType; typedef bool ValueType;
+		ValueType get(CVertexO &v) const { return v.IsD(); }
+	};
+	struct FaceSelection {
+		typedef CMeshO::FaceContainer ContainerType; typedef bool ValueType;
+		ValueType get(CFaceO &f) const { return f.IsS(); }
+		void set(CFaceO &f, const ValueType &val) const { if(val) f.SetS(); else f.ClearS(); }
+	};
+	struct FaceColor {
+		typedef CMeshO::FaceContainer ContainerType; typedef vcg::Color4b ValueType;
+		ValueType get(CFaceO &f) const { return f.C(); }
+		void set(CFaceO &f, const ValueType &val) const { f.C()=val; }
+	};
+	// the indexes of the vertices of the faces, (-1,-1,-1) for the deleted faces
+	struct FaceVert {
+		typedef CMeshO::FaceContainer ContainerType; typedef vcg::Point3i ValueType;
+		FaceVert(CVertexO *_vbase = 0) : vbase(_vbase) {}
+		ValueType get(CFaceO &f) const
+		{
+			if(f.IsD()) return ValueType(-1,-1,-1);
+			return ValueType(int(f.V(0)-vbase),int(f.V(1)-vbase),int(f.V(2)-vbase));
+		}
+		CVertexO *vbase;
+	};
+}
+
+/*
+The data drawn by MeshLabRenderState for a mesh while a filter is modifying it (e.g. a filter running in another thread).
+Rather than a full copy of the CMeshO, it keeps only the attributes needed to draw the mesh, in MeshStateArray:
+the update of an attribute re-reads only that attribute, and reallocates only the chunks of it that have changed.
+*/
+class MeshLabRenderMeshBuffers
+{
+public:
+	MeshLabRenderMeshBuffers(CMeshO& mesh);
+
+	// Update the attributes in the mask; false if the mesh has a different number of elements.
+	bool update(CMeshO& mesh,const int updateattributesmask);
+	void render(vcg::GLW::DrawMode dm,vcg::GLW::ColorMode cm,vcg::GLW::TextureMode tm );
+
+private:
+	void set(CMeshO& mesh);
+	void drawFill(bool perFaceNormal,vcg::GLW::ColorMode cm);
+	void drawWire(vcg::GLW::ColorMode cm);
+	void drawPoints(vcg::GLW::ColorMode cm);
+
+	MeshStateArray<MeshStateAccessor::VertCoord> vertCoord;
+	MeshStateArray<MeshStateAccessor::VertNormal> vertNormal;
+	MeshStateArray<MeshStateAccessor::VertColor> vertColor;
+	MeshStateArray<MeshStateAccessor::VertDeleted> vertDeleted;
+	MeshStateArray<MeshStateAccessor::FaceVert> faceVert;
+	MeshStateArray<MeshStateAccessor::FaceColor> faceColor;
+	vcg::Box3f bbox;
+	vcg::Color4b meshColor;
+public:
+	vcg::Matrix44f Tr;
+};
+
 class MeshLabRenderState //: public QObject
 {
 	//Q_OBJECT
@@ -438,10 +599,10 @@ public:
 	//copy the _rendermap[id] model in the mm model
 	void copyBack(const int id,CMeshO& mm) const;
 
-	//the add/update functions should have const parameters. This could NOT be possible cause of the implementation of vcg::tri::Append::MeshCopy function in the vcglib
+	//the add/update functions take only the data needed for the rendering (see MeshLabRenderMeshBuffers)
 	void add(const int id,CMeshO& mm);
 	bool update(const int id,CMeshO& mm,const int updateattributesmask);
-	QMap<int,MeshLabRenderMesh*>::iterator remove(QMap<int,MeshLabRenderMesh*>::iterator it );
+	QMap<int,MeshLabRenderMeshBuffers*>::iterator remove(QMap<int,MeshLabRenderMeshBuffers*>::iterator it );
 
 	void add( const int id,const MeshLabRenderRaster& rm );
 	bool update(const int id,const MeshLabRenderRaster& rm,const int updateattributesmask);
@@ -459,7 +620,7 @@ public:
 private:
 
 	void lockReadOrWrite(QReadWriteLock& mutex,const MESHLAB_RENDER_STATE_ACTION act);
-	QMap<int,MeshLabRenderMesh*> _meshmap;
+	QMap<int,MeshLabRenderMeshBuffers*> _meshmap;
 	QMap<int,MeshLabRenderRaster*> _rastermap;
 
 	QReadWriteLock _meshmut;
@@ -480,6 +641,87 @@ private:
 //	QReadWriteLock _mutdoc;
 //};
 
+/*
+A class designed to save partial aspects of the state of a mesh, such as vertex colors, current selections, vertex positions
+and then be able to restore them later.
+This is a fundamental part for the dynamic filters framework and for the undo of the filters.
+
+The attributes are saved in MeshStateArray: a state created with respect to a previous state of the same mesh
+stores only the chunks of data that have changed in between, and restoring a state writes only the chunks
+that differ from the current ones. So saving the state again after each preview of a dynamic filter,
+or keeping many undo levels, costs only the portion of the mesh that the filter actually touched.
+
+Note: not all the MeshElements are supported!!
+*/
+class MeshModelState
+{
+private:
+	int changeMask; // a bit mask indicating what have been changed. Composed of MeshModel::MeshElement (e.g. stuff like MeshModel::MM_VERTCOLOR)
+	MeshModel *m; // the mesh which the changes refers to.
+	MeshStateArray<MeshStateAccessor::VertQuality> vertQuality;
+	MeshStateArray<MeshStateAccessor::VertColor> vertColor;
+	MeshStateArray<MeshStateAccessor::VertCoord> vertCoord;
+	MeshStateArray<MeshStateAccessor::VertNormal> vertNormal;
+	MeshStateArray<MeshStateAccessor::FaceSelection> faceSelection;
+	MeshStateArray<MeshStateAccessor::VertSelection> vertSelection;
+	vcg::Matrix44f Tr;
+	vcg::Shotf shot;
+public:
+	MeshModelState() : changeMask(MeshModel::MM_NONE), m(0) {}
+
+	// This function save the <mask> portion of a mesh into the private members of the MeshModelState class;
+	// if base is a state of the same mesh (possibly this one) the data that has not changed since then is shared with it.
+	void create(int _mask, MeshModel* _m, const MeshModelState *base=0);
+	bool apply(MeshModel *_m);
+	bool isValid(MeshModel *m);
+
+	MeshModel *mesh() const { return m; }
+	int mask() const { return changeMask; }
+
+	// The portions of the mesh that are saved and restored by create and apply.
+	static int savedBits()
+	{
+		return MeshModel::MM_VERTCOLOR | MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTCOORD | MeshModel::MM_VERTNORMAL |
+		       MeshModel::MM_VERTFLAGSELECT | MeshModel::MM_FACEFLAGSELECT | MeshModel::MM_TRANSFMATRIX | MeshModel::MM_CAMERA;
+	}
+
+	// Whether the changes described by the mask can be saved and restored: everything in the mask must be saved
+	// (e.g. the face colors or the wedge texture coords cannot be restored, nor the number of elements).
+	static bool isSupported(int mask)
+	{
+		return (mask != MeshModel::MM_NONE) && ((mask & ~savedBits()) == 0);
+	}
+};
+
+/*
+A bounded stack of states of the meshes of a document, used to undo the filters.
+Before a filter the portion of the mesh that it changes is pushed; as each state shares the unchanged data
+with the previous state of the same mesh, a level costs only the data changed by the filter.
+*/
+class MeshModelStateStack
+{
+public:
+	MeshModelStateStack(int _maxLevels=10) : maxLevels(_maxLevels) {}
+
+	void setMaxLevels(int levels);
+	bool canUndo() const { return !states.isEmpty(); }
+	void clear() { states.clear(); }
+
+	// Save the <mask> portion of the mesh before it is changed; returns false if the mask is not supported,
+	// in that case the saved states of the mesh are discarded, since they could not be restored anymore.
+	bool push(int mask, MeshModel *m);
+
+	// Restore the last saved state; returns the restored mesh, or 0 if it could not be restored.
+	MeshModel *undo();
+
+	// Discard the saved states of a mesh (e.g. when the mesh is deleted).
+	void remove(MeshModel *m);
+
+private:
+	QList<MeshModelState> states;
+	int maxLevels;
+};
+
 class MeshDocument : public QObject
 {
 	Q_OBJECT
@@ -575,6 +817,7 @@ public:
 	void setFileName(const QString& newFileName) {fullPathFilename = newFileName;}
 	GLLogStream Log;
 	FilterScript filterHistory;
+	MeshModelStateStack undoStack;
 	QStringList xmlhistory;
 
 	int size() const {return meshList.size();}
@@ -651,32 +894,4 @@ signals:
 
 };// end class MeshDocument
 
-/*
-A class designed to save partial aspects of the state of a mesh, such as vertex colors, current selections, vertex positions
-and then be able to restore them later.
-This is a fundamental part for the dynamic filters framework.
-
-Note: not all the MeshElements are supported!!
-*/
-class MeshModelState
-{
-private:
-	int changeMask; // a bit mask indicating what have been changed. Composed of MeshModel::MeshElement (e.g. stuff like MeshModel::MM_VERTCOLOR)
-	MeshModel *m; // the mesh which the changes refers to.
-	std::vector<float> vertQuality;
-	std::vector<vcg::Color4b> vertColor;
-	std::vector<vcg::Point3f> vertCoord;
-	std::vector<vcg::Point3f> vertNormal;
-	std::vector<bool> faceSelection;
-	std::vector<bool> vertSelection;
-	vcg::Matrix44f Tr;
-	vcg::Shotf shot;
-public:
-	// This function save the <mask> portion of a mesh into the private members of the MeshModelState class;
-	void create(int _mask, MeshModel* _m);
-	bool apply(MeshModel *_m);
-	bool isValid(MeshModel *m);
-};
-
-
 #endif
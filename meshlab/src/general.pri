@@ -24,3 +24,17 @@ macx: {
 # the following line is needed to avoid mismatch between
 # the awful min/max macros of windows and the limits max
 win32:DEFINES += NOMINMAX
+
+# OpenMP is used by the parallel loops of vcglib and of the plugins;
+# without it the loops are compiled as plain sequential code.
+win32-msvc2008:QMAKE_CXXFLAGS += /openmp
+win32-msvc2010:QMAKE_CXXFLAGS += /openmp
+win32-g++:QMAKE_CXXFLAGS += -fopenmp
+win32-g++:QMAKE_LFLAGS += -fopenmp
+linux-g++*:QMAKE_CXXFLAGS += -fopenmp
+linux-g++*:QMAKE_LFLAGS += -fopenmp
+
+# The per element updates of vcglib (e.g. UpdateNormal) run on the thread pool of
+# wrap/system/multithreading, that needs pthreads.
+unix:DEFINES += VCG_USE_THREAD_POOL
+unix:LIBS += -lpthread
@@ -114,6 +114,7 @@ private slots:
 	///////////Slot Menu Edit ////////////////////////
 	void applyEditMode();
 	void suspendEditMode();
+	void undo();
 	///////////Slot Menu Filter ////////////////////////
 	void startFilter();
 	void applyLastFilter();
@@ -208,6 +209,8 @@ private:
 	void fillEditMenu();
 	void createToolBars();
 	void loadMeshLabSettings();
+	// number of threads of the parallel algorithms (0 means all the processors)
+	inline static QString threadCountParam() {return "MeshLab::System::threadCount";}
   // void loadPlugins();
 	void keyPressEvent(QKeyEvent *);
 	void updateRecentFileActions();
@@ -389,6 +392,7 @@ private:
   QAction* showFilterEditAct;
   /////////// Actions Menu Edit  /////////////////////
   QAction *suspendEditModeAct;
+  QAction *undoAct;
 	/////////// Actions Menu Render /////////////////////
 	QActionGroup *renderModeGroupAct;
 	QAction *renderBboxAct;
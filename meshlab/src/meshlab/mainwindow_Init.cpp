@@ -44,6 +44,7 @@
 #include "customDialog.h"
 #include "saveSnapshotDialog.h"
 #include "ui_congratsDialog.h"
+#include <wrap/system/multithreading/util.h>
 
 
 
@@ -333,6 +334,11 @@ void MainWindow::createActions()
 	suspendEditModeAct->setChecked(true);
 	connect(suspendEditModeAct, SIGNAL(triggered()), this, SLOT(suspendEditMode()));
 
+	undoAct = new QAction (tr("&Undo last filter"), this);
+	undoAct->setShortcut(QKeySequence::Undo);
+	undoAct->setEnabled(false);
+	connect(undoAct, SIGNAL(triggered()), this, SLOT(undo()));
+
 	//////////////Action Menu WINDOWS /////////////////////////////////////////////////////////////////////////
 	windowsTileAct = new QAction(tr("&Tile"), this);
 	connect(windowsTileAct, SIGNAL(triggered()), mdiarea, SLOT(tileSubWindows()));
@@ -546,6 +552,7 @@ void MainWindow::createMenus()
 	//////////////////// Menu Edit //////////////////////////////////////////////////////////////////////////
 	editMenu = menuBar()->addMenu(tr("&Edit"));
 	editMenu->addAction(suspendEditModeAct);
+	editMenu->addAction(undoAct);
 
 	//////////////////// Menu Filter //////////////////////////////////////////////////////////////////////////
 	filterMenu = menuBar()->addMenu(tr("Fi&lters"));
@@ -981,6 +988,7 @@ void MainWindow::loadMeshLabSettings()
 	// of the plugins are already in the <defaultGlobalParams> .
 	// we just miss the globals default of meshlab itself
 	GLArea::initGlobalParameterSet(& defaultGlobalParams);
+	defaultGlobalParams.addParam(new RichInt(threadCountParam(), 0, "Number of Threads","The number of threads used by the parallel filters (0 means one for each processor)"));
 
 	QSettings settings;
 	QStringList klist = settings.allKeys();
@@ -1033,6 +1041,7 @@ void MainWindow::loadMeshLabSettings()
 		}
 	}
 
+	mt::set_thread_count(currentGlobalParams.getInt(threadCountParam()));
 	emit dispatchCustomSettings(currentGlobalParams);
 }
 
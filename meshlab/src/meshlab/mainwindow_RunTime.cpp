@@ -34,6 +34,7 @@
 #include <exception>
 #include "xmlgeneratorgui.h"
 #include "filterthread.h"
+#include <wrap/system/multithreading/util.h>
 
 
 #include <QtGui>
@@ -163,6 +164,7 @@ void MainWindow::updateXMLStdDialog()
 
 void MainWindow::updateCustomSettings()
 {
+	mt::set_thread_count(currentGlobalParams.getInt(threadCountParam()));
 	emit dispatchCustomSettings(currentGlobalParams);
 }
 
@@ -327,6 +329,7 @@ void MainWindow::updateMenus()
 	lastFilterAct->setText(QString("Apply filter"));
 	editMenu->setEnabled(!editMenu->actions().isEmpty());
 	updateMenuItems(editMenu,activeDoc);
+	undoAct->setEnabled(activeDoc && meshDoc()->undoStack.canUndo());
 	renderMenu->setEnabled(!editMenu->actions().isEmpty());
 	updateMenuItems(renderMenu,activeDoc);
 	fullScreenAct->setEnabled(activeDoc);
@@ -1009,6 +1012,10 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
   QGLFormat defForm = QGLFormat::defaultFormat();
   iFilter->glContext = new QGLContext(defForm,filterWidget->context()->device());
   iFilter->glContext->create(filterWidget->context());
+  // save the portion of the current mesh changed by the filter, to undo it
+  bool undoSaved = false;
+  if(!isPreview && meshDoc()->mm() != NULL)
+      undoSaved = meshDoc()->undoStack.push(iFilter->postCondition(action), meshDoc()->mm());
   try
   {
       ret=iFilter->applyFilter(action, *(meshDoc()), MergedEnvironment, QCallBack);
@@ -1033,8 +1040,10 @@ void MainWindow::executeFilter(QAction *action, RichParameterSet &params, bool i
             lastFilterAct->setText(QString("Apply filter ") + action->text());
             lastFilterAct->setEnabled(true);
         }
-      else // filter has failed. show the message error.
+      else // filter has failed. restore the mesh and show the message error.
         {
+            if(undoSaved)
+                meshDoc()->undoStack.undo();
             QMessageBox::warning(this, tr("Filter Failure"), QString("Failure of filter <font color=red>: '%1'</font><br><br>").arg(action->text())+iFilter->errorMsg()); // text
         MainWindow::globalStatusBar()->showMessage("Filter failed...",2000);
         }
@@ -1404,6 +1413,22 @@ void MainWindow::suspendEditMode()
 	updateMenus();
 	GLA()->update();
 }
+
+// Restore the mesh as it was before the last filter (see MeshModelStateStack).
+void MainWindow::undo()
+{
+	if(!GLA() || meshDoc()->isBusy()) return;
+	MeshModel *mm = meshDoc()->undoStack.undo();
+	if(mm)
+	{
+		meshDoc()->Log.Logf(GLLogStream::SYSTEM,"Undo of the last filter on %s",qPrintable(mm->shortName()));
+		mm->meshModified() = true;
+	}
+	else
+		MainWindow::globalStatusBar()->showMessage("The mesh has changed, the filter cannot be undone",2000);
+	updateMenus();
+	GLA()->update();
+}
 void MainWindow::applyEditMode()
 {
 	if(!GLA()) { //prevents crash without mesh
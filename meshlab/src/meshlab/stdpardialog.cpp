@@ -280,12 +280,15 @@ void MeshlabStdDialog::applyClick()
 	//we don't need to reapply the filter to the mesh
 	bool isEqual = (curParSet == prevParSet);
 	if (curModel && (isEqual) && (validcache))
+	{
+		curMeshDoc->undoStack.push(curmask, curModel);
 		meshCacheState.apply(curModel);
+	}
 	else
 		curmwi->executeFilter(q, curParSet, false);
 
 	if(curmask && curModel)
-		meshState.create(curmask, curModel);
+		meshState.create(curmask, curModel, &meshState);
 	if(this->curgla) 
 		this->curgla->update();
 
@@ -305,7 +308,7 @@ void MeshlabStdDialog::applyDynamic()
 	// Restore the
 	meshState.apply(curModel);
 	curmwi->executeFilter(q, curParSet, true);
-	meshCacheState.create(curmask,curModel);
+	meshCacheState.create(curmask,curModel,&meshState);
 	validcache = true;
 
 
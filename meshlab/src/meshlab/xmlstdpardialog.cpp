@@ -201,7 +201,7 @@ void MeshLabXMLStdDialog::applyClick()
 	//env.popContext();
 
 	if(curmask)	
-		meshState.create(curmask, curModel);
+		meshState.create(curmask, curModel, &meshState);
 	if(this->curgla) 
 		this->curgla->update();
 }
@@ -269,7 +269,7 @@ void MeshLabXMLStdDialog::applyDynamic()
 	EnvWrap envir(env);
 	curmwi->executeFilter(this->curmfc, envir, true);
 	env.pushContext();
-	meshCacheState.create(curmask,curModel);
+	meshCacheState.create(curmask,curModel,&meshState);
 	validcache = true;
 
 	if(this->curgla) 
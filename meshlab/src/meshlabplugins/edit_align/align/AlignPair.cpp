@@ -634,15 +634,6 @@ bool AlignPair::SampleMovVert(vector<A2Vertex> &vert, int SampleNum, AlignPair::
 }
 
 
-// Function to retrieve a static random number generator object.
-static math::SubtractiveRingRNG &LocRnd(){
-    static math::SubtractiveRingRNG myrnd(time(NULL));
-    return myrnd;
-}
-// Gets a random number in the interval [0..n].
-static int LocRnd(int n){
-    return LocRnd().generate(n);
-}
 // Scelta a caso semplice
 bool AlignPair::SampleMovVertRandom(vector<A2Vertex> &vert, int SampleNum)
 {
@@ -650,7 +641,7 @@ bool AlignPair::SampleMovVertRandom(vector<A2Vertex> &vert, int SampleNum)
 	int i;
 	for(i=0;i<SampleNum;++i)
 	{
-		int pos=LocRnd(vert.size());
+		int pos=rnd.generate(vert.size());
     assert(pos>=0 && pos < int(vert.size()));
 		swap(vert[i],vert[pos]);
 	}
@@ -676,6 +667,7 @@ bool AlignPair::SampleMovVertNormalEqualized(vector<A2Vertex> &vert, int SampleN
 
 //	int t0=clock();
 	static vector<Point3d> NV;
+#pragma omp critical(AlignPairNormals)
 	if(NV.size()==0)
 		{
 			GenNormal<double>::Uniform(30,NV);
@@ -698,13 +690,13 @@ bool AlignPair::SampleMovVertNormalEqualized(vector<A2Vertex> &vert, int SampleN
 
   for(int i=0;i<SampleNum;)
 		{
-      int ind=LocRnd(BKT.size()); // Scelgo un Bucket
+      int ind=rnd.generate(BKT.size()); // Scelgo un Bucket
  			int &CURpos = BKTpos[ind];
 			vector<int> &CUR = BKT[ind];
 
       if(CURpos<int(CUR.size()))
 			{
-				swap(CUR[CURpos], CUR[ CURpos + LocRnd(BKT[ind].size()-CURpos)]);
+				swap(CUR[CURpos], CUR[ CURpos + rnd.generate(BKT[ind].size()-CURpos)]);
 				swap(vert[i],vert[CUR[CURpos]]);
 				++BKTpos[ind];
 		    ++i;
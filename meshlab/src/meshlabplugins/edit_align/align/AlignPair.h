@@ -33,6 +33,7 @@
 #include <vcg/complex/algorithms/update/normal.h>
 #include <vcg/complex/algorithms/update/bounding.h>
 #include <vcg/complex/algorithms/update/component_ep.h>
+#include <vcg/math/random_generator.h>
 
 
 namespace vcg
@@ -256,6 +257,10 @@ public:
   void Clear(){status=SUCCESS;}
   AlignPair() {Clear();}
 
+  // The random choices of the sampling of the mov vertices start from this seed,
+  // so that an alignment can be repeated (e.g. when many of them run in parallel).
+  void SetRandomSeed(unsigned int seed) {rnd.initialize(seed);}
+
 /******* Data Members *********/
 
   std::vector<A2Vertex> *mov;
@@ -263,6 +268,7 @@ public:
 
   ErrorCode status;
   AlignPair::Param ap;
+  math::SubtractiveRingRNG rnd;
 
 /**** End Data Members *********/
 
@@ -40,15 +40,39 @@ using namespace vcg;
 
 
 // Nota che il bbox viene automaticamento inflatato dalla G.SetBBox();
+// The current grid (with the cells of the meshes already rasterized on it) is kept only when the grid
+// that would be created for the new bbox has exactly the same cell size and fits in it, so that the result
+// is the same of a new grid. In practice it happens when the overall bbox has not changed (e.g. only some
+// inner meshes have been moved); otherwise a new empty grid is created.
 bool OccupancyGrid::Init(int _mn, Box3d bb, int size)
 {
-  mn=_mn; // the number of meshes (including all the unused ones; eg it is the range of the possible id)
-  if(mn>MeshCounter::MaxVal()) return false;
-  MeshCounter MC;
-  MC.Clear();
-  G.Create(bb,size,MC);
-  VM.clear();
-  VM.resize(mn);
+  if(_mn>MeshCounter::MaxVal()) return false;
+  // the same bbox and cell size computed by G.Create()
+  Box3f fbb;
+  fbb.Import(bb);
+  fbb.Offset(0.01*fbb.Diag());
+  Point3f dim = fbb.max - fbb.min;
+  Point3i siz;
+  BestDim( size, dim, siz );
+  Point3f voxel(dim[0]/siz[0], dim[1]/siz[1], dim[2]/siz[2]);
+  const bool keep = gridReusable && _mn==mn && size==gridSize && voxel==G.voxel &&
+                    G.bbox.IsIn(fbb.min) && G.bbox.IsIn(fbb.max);
+  if(!keep)
+  {
+    mn=_mn; // the number of meshes (including all the unused ones; eg it is the range of the possible id)
+    gridSize=size;
+    MeshCounter MC;
+    MC.Clear();
+    G.Create(bb,size,MC);
+    VM.clear();
+    VM.resize(mn);
+    VA.clear();
+    VA.resize(mn*mn,0);
+    gridReusable=true;
+  }
+  // the meshes of the computation are the ones added (again) after the Init
+  for(int i=0;i<mn;++i)
+    VM[i].used=false;
   return true;
 }
 
@@ -91,30 +115,31 @@ void OccupancyGrid::Compute()
   // Si deve trovare l'insieme degli archi piu'plausibili
   // un arco ha "senso" in una cella se entrambe le mesh compaiono in quell'arco
   // Si considera tutti gli archi possibili e si conta in quante celle ha senso un arco
-  VA.clear();
-  VA.resize(mn*mn,0);
 
-  // scan the grid and update possible arc count
-  for(int i=0;i<G.siz[0];++i)
-    for(int j=0;j<G.siz[1];++j)
-      for(int k=0;k<G.siz[2];++k)
-      {
-        vector<int > vv;
-        G.Grid(i,j,k).Pack(vv);
-        size_t meshInCell = vv.size();
-        for( size_t ii=0; ii< vv.size(); ++ii)
-        {
-          int meshId = vv[ii];
-          ++VM[meshId].area; // compute mesh area
-          if(meshInCell>VM[meshId].unicityDistribution.size())
-            VM[meshId].unicityDistribution.resize(meshInCell);
-          ++(VM[meshId].unicityDistribution[meshInCell-1]);
-        }
-
-        for(size_t ii=0;ii<vv.size();++ii)
-          for(size_t jj=ii+1;jj<vv.size();++jj)
-              ++VA[vv[ii]+vv[jj]*mn]; // count intersections of all mesh pairs
-      }
+  // the meshes that have not been added since the Init are removed from the grid
+  int usedNum=0, pendingNum=0;
+  for(int i=0;i<mn;++i)
+  {
+    OGMeshInfo &mi=VM[i];
+    if(!mi.used && (mi.pending || !mi.cells.empty()))
+    {
+      mi.newCells.clear();
+      mi.pending=true;
+      mi.rasterized=false;
+    }
+    if(mi.used) ++usedNum;
+    if(mi.pending) ++pendingNum;
+  }
+
+  // When only a few meshes have changed only their cells are updated,
+  // otherwise (e.g. on a new grid) all the cells are counted again.
+  if(2*pendingNum > usedNum)
+    ComputeCellCounts();
+  else
+  {
+    for(int i=0;i<mn;++i)
+      if(VM[i].pending) UpdateMeshCells(i);
+  }
 
   // Find all the arcs
   SVA.clear();
@@ -125,6 +150,8 @@ void OccupancyGrid::Compute()
           SVA.push_back( OGArcInfo(i,j, VA[i+j*mn], VA[i+j*mn]/float( min(VM[i].area,VM[j].area)) ));
 
   // Compute Mesh Coverage
+  for(int i=0;i<mn;++i)
+    VM[i].coverage=0;
   for(size_t i=0;i<SVA.size();++i)
   {
     VM[SVA[i].s].coverage += SVA[i].area;
@@ -135,6 +162,135 @@ void OccupancyGrid::Compute()
   reverse(SVA.begin(),SVA.end());
 }
 
+// Count from scratch the cells of all the meshes: the grid is filled with the cells of every mesh,
+// then it is scanned in parallel; each thread accumulates the arc counts and the mesh statistics
+// of its cells on its own, and they are summed at the end.
+void OccupancyGrid::ComputeCellCounts()
+{
+  MeshCounter MC;
+  MC.Clear();
+  std::fill(G.grid,G.grid+G.size(),MC);
+  for(int i=0;i<mn;++i)
+  {
+    OGMeshInfo &mi=VM[i];
+    if(mi.pending)
+    {
+      mi.cells.swap(mi.newCells);
+      mi.newCells.clear();
+      mi.pending=false;
+    }
+    mi.Init();
+    for(size_t k=0;k<mi.cells.size();++k)
+      G.grid[mi.cells[k]].Set(i);
+  }
+
+  VA.clear();
+  VA.resize(mn*mn,0);
+  const int sz=G.size();
+#pragma omp parallel
+  {
+    vector<int> threadVA(mn*mn,0);
+    vector<int> threadArea(mn,0);
+    vector<vector<int> > threadUnicity(mn);
+    vector<int> vv;
+
+    // scan the grid and update possible arc count
+#pragma omp for schedule(dynamic,1024)
+    for(int c=0;c<sz;++c)
+    {
+      G.grid[c].Pack(vv);
+      size_t meshInCell = vv.size();
+      for( size_t ii=0; ii< vv.size(); ++ii)
+      {
+        int meshId = vv[ii];
+        ++threadArea[meshId]; // compute mesh area
+        if(meshInCell>threadUnicity[meshId].size())
+          threadUnicity[meshId].resize(meshInCell);
+        ++(threadUnicity[meshId][meshInCell-1]);
+      }
+
+      for(size_t ii=0;ii<vv.size();++ii)
+        for(size_t jj=ii+1;jj<vv.size();++jj)
+            ++threadVA[vv[ii]+vv[jj]*mn]; // count intersections of all mesh pairs
+    }
+
+#pragma omp critical (ogCellCounts)
+    {
+      for(int i=0;i<mn*mn;++i)
+        VA[i]+=threadVA[i];
+      for(int m=0;m<mn;++m)
+      {
+        VM[m].area+=threadArea[m];
+        if(threadUnicity[m].size()>VM[m].unicityDistribution.size())
+          VM[m].unicityDistribution.resize(threadUnicity[m].size());
+        for(size_t k=0;k<threadUnicity[m].size();++k)
+          VM[m].unicityDistribution[k]+=threadUnicity[m][k];
+      }
+    }
+  }
+}
+
+// Replace the cells counted in the grid for the mesh <id> with the ones of its last rasterization:
+// only the cells that the mesh has left or entered are updated.
+void OccupancyGrid::UpdateMeshCells(int id)
+{
+  OGMeshInfo &mi=VM[id];
+  const vector<int> &oc=mi.cells;
+  const vector<int> &nc=mi.newCells;
+  size_t a=0,b=0;
+  while(a<oc.size() || b<nc.size())
+  {
+    if(b==nc.size() || (a<oc.size() && oc[a]<nc[b]))
+      UpdateCellCount(oc[a++],id,false);
+    else if(a==oc.size() || nc[b]<oc[a])
+      UpdateCellCount(nc[b++],id,true);
+    else
+    {
+      ++a;
+      ++b;
+    }
+  }
+  mi.cells.swap(mi.newCells);
+  mi.newCells.clear();
+  mi.pending=false;
+}
+
+// Add (or remove) the mesh <id> to a cell, updating the arc counts
+// and the statistics of all the meshes passing through that cell.
+void OccupancyGrid::UpdateCellCount(int cell, int id, bool add)
+{
+  MeshCounter &mc=G.grid[cell];
+  if(mc.IsSet(id)==add) return;
+  vector<int> vv;
+  mc.Pack(vv);
+  const size_t oldCnt=vv.size();
+  const size_t newCnt=add ? oldCnt+1 : oldCnt-1;
+  for(size_t ii=0;ii<vv.size();++ii)
+  {
+    const int j=vv[ii];
+    if(j==id) continue;
+    VA[min(id,j)+max(id,j)*mn] += add ? 1 : -1;
+    vector<int> &ud=VM[j].unicityDistribution;
+    --ud[oldCnt-1];
+    if(newCnt>ud.size()) ud.resize(newCnt);
+    ++ud[newCnt-1];
+  }
+  OGMeshInfo &mi=VM[id];
+  if(add)
+  {
+    ++mi.area;
+    if(newCnt>mi.unicityDistribution.size()) mi.unicityDistribution.resize(newCnt);
+    ++mi.unicityDistribution[newCnt-1];
+    mc.Set(id);
+  }
+  else
+  {
+    --mi.area;
+    --mi.unicityDistribution[oldCnt-1];
+    mc.UnSet(id);
+  }
+}
+
 
 void OccupancyGrid::ComputeTotalArea()
 {
@@ -214,6 +370,8 @@ void OccupancyGrid::ComputeUsefulMesh(FILE *elfp)
 			  }
 			}
 		}
+	// the cells have been cleared: the next Init has to build a new grid
+	gridReusable=false;
 }
 
 void OccupancyGrid::Dump(FILE *fp)
@@ -281,8 +439,10 @@ void OccupancyGrid::ChooseArcs(vector<pair<int,int> > &AV, vector<int> &BNV, vec
 
 void OccupancyGrid::RemoveMesh(int id)
 {
-	MeshCounter *GridEnd=G.grid+G.size();
-	MeshCounter *ig;
-	for(ig=G.grid;ig!=GridEnd;++ig)
-		ig->UnSet(id);
+	OGMeshInfo &mi=VM[id];
+	mi.newCells.clear();
+	mi.pending=true;
+	mi.rasterized=false;
+	mi.used=false;
+	UpdateMeshCells(id);
 }
@@ -26,6 +26,9 @@
 #include "AlignPair.h"
 #include <bitset>
 #include <vcg/space/index/grid_static_obj.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace vcg
 {
@@ -33,6 +36,10 @@ namespace vcg
  * Used to find the mesh pairs (arcs) to be used for ICP
  * It build a grid and for each cell count how many meshes passes through that cell
  * It compute the overlaps and returns a set of arcs with overlap greater than a given threshold.
+ *
+ * The grid is incremental: Init keeps the grid (and all the counts computed on it) when the new bbox still fits it,
+ * AddMesh does not rasterize again a mesh that has not moved, and Compute updates the cells and the arc counts
+ * only for the meshes that have changed (or that have not been added again after the Init).
  */
 class OccupancyGrid{
 public:
@@ -165,9 +172,10 @@ public:
   {
   public:
     enum {maxcnt =3};
-    OGMeshInfo() {Init(); used=false;}
+    OGMeshInfo() {Init(); used=false; rasterized=false; pending=false; vn=0;}
     void Init() {
       coverage=0;area=0;
+      unicityDistribution.clear();
     }
 
     std::vector<int> unicityDistribution; // Distribution of the occupancy ratios:
@@ -178,6 +186,14 @@ public:
     bool operator < (OGMeshInfo &o) const { return area<o.area;}
     static int MaxStat() { return 64;}
     bool used;
+
+    std::vector<int> cells;     // sorted indexes of the cells of the grid touched by the mesh (the ones counted in the grid)
+    std::vector<int> newCells;  // the cells of the last rasterization, when not yet counted in the grid (pending==true)
+    bool pending;
+    bool rasterized;            // the mesh was rasterized on the current grid with the following placement
+    Matrix44d tr;
+    int vn;
+    Box3d bbox;
   };
   /* Classe con informazioni su un arco plausibile
 */
@@ -197,6 +213,8 @@ public:
 
 
 
+  OccupancyGrid() : mn(0), gridSize(0), gridReusable(false) {}
+
   void Clear();
   bool Init(int _mn, Box3d bb, int size);
 
@@ -214,6 +232,10 @@ public:
   void ComputeUsefulMesh(FILE *elfp=0);
   void Dump(FILE *fp);
   void ComputeTotalArea();
+  void ComputeCellCounts();
+  void UpdateMeshCells(int id);
+  void UpdateCellCount(int cell, int id, bool add);
+
   GridStaticObj<MeshCounter, float> G;
   std::vector<int> VA; // virtual arcs
   int mn;
@@ -222,24 +244,67 @@ public:
   std::vector<OGArcInfo>  SVA; // SortedVirtual Arcs;
   std::vector<OGMeshInfo> VM;  // vettore delle informazioni raccolte sulle mesh.
   std::vector<OGUseInfo>  Use; // vettore con gli indici delle piu'utili mesh
+  int gridSize;       // the size asked to the last Init that created the grid
+  bool gridReusable;  // false when the grid has to be created again by the next Init (e.g. ComputeUsefulMesh destroys it)
 };
 
 // Implementation of the templated AddMesh
+// The vertices are rasterized in parallel, each thread on its own bit grid, then the bit grids are merged
+// in the sorted list of the cells touched by the mesh. The cells are counted in the grid by Compute().
+// A mesh that has not changed its placement since it was rasterized on the current grid is not rasterized again.
 template <class MESH>
 void OccupancyGrid::AddMesh(MESH &M, const Matrix44d &Tr, int ind)
 {
+	OGMeshInfo &mi=VM[ind];
+	mi.used=true;
+	Box3d mbb;
+	mbb.Import(M.bbox);
+	if(mi.rasterized && mi.tr==Tr && mi.vn==M.vn && mi.bbox==mbb)
+		return;
+
 	Matrix44f Trf;
 	Trf.Import(Tr);
-	typename MESH::VertexIterator vi;
-	for(vi=M.vert.begin();vi!=M.vert.end();++vi)
+	const int vertNum=int(M.vert.size());
+	const int cellNum=G.size();
+	int threadNum=1;
+#ifdef _OPENMP
+	threadNum=omp_get_max_threads();
+#endif
+	std::vector<std::vector<bool> > threadGrid(threadNum);
+#pragma omp parallel
 	{
-	  if(!(*vi).IsD())
-		G.Grid( Trf * Point3f::Construct((*vi).P()) ).Set(ind);
+		int t=0;
+#ifdef _OPENMP
+		t=omp_get_thread_num();
+#endif
+		std::vector<bool> &tg=threadGrid[t];
+		tg.resize(cellNum,false);
+#pragma omp for schedule(static)
+		for(int i=0;i<vertNum;++i)
+		{
+			if(M.vert[i].IsD()) continue;
+			Point3i pi;
+			G.PToIP(Trf * Point3f::Construct(M.vert[i].P()),pi);
+			if(pi[0]<0 || pi[0]>=G.siz[0] || pi[1]<0 || pi[1]>=G.siz[1] || pi[2]<0 || pi[2]>=G.siz[2])
+				continue; // outside the grid (a grid kept by Init is larger than the bbox of the meshes)
+			tg[G.GridIndI(pi)]=true;
+		}
 	}
-	VM[ind].Init();
-	VM[ind].used=true;
-}
 
+	mi.newCells.clear();
+	for(int c=0;c<cellNum;++c)
+		for(int t=0;t<threadNum;++t)
+			if(threadGrid[t][c])
+			{
+				mi.newCells.push_back(c);
+				break;
+			}
+	mi.pending=true;
+	mi.rasterized=true;
+	mi.tr=Tr;
+	mi.vn=M.vn;
+	mi.bbox=mbb;
+}
 
 }
 
@@ -25,6 +25,9 @@
 #include <QStringList>
 #include <QList>
 
+#include <map>
+#include <algorithm>
+
 #include "meshtree.h"
 #include "align/AlignGlobal.h"
 using namespace vcg;
@@ -70,46 +73,58 @@ void MeshTree::ProcessArc(int fixId, int movId, vcg::AlignPair::Result &result,
   */
 void MeshTree::ProcessArc(int fixId, int movId, vcg::Matrix44d &MovM, vcg::AlignPair::Result &result, vcg::AlignPair::Param ap)
 {
-  vcg::AlignPair::A2Mesh Fix;
-  vcg::AlignPair aa;
-
-  // 1) Convert fixed mesh and put it into the grid.
   MM(fixId)->updateDataMask(MeshModel::MM_FACEMARK);
-  aa.ConvertMesh<CMeshO>(MM(fixId)->cm,Fix);
+  MM(movId)->updateDataMask(MeshModel::MM_FACEMARK);
 
-  vcg::AlignPair::A2Grid UG;
-  vcg::AlignPair::A2GridVert VG;
+  FixMesh fix;
+  InitFixMesh(fixId,ap,fix);
+  ProcessArc(fix,fixId,movId,MovM,result,ap);
+  result.as.Dump(stdout);
+}
+
+// Convert the fixed mesh and put it into the grid.
+// The MM_FACEMARK of the mesh must be already enabled, as this can run in parallel for different meshes.
+void MeshTree::InitFixMesh(int fixId, vcg::AlignPair::Param &ap, FixMesh &fix)
+{
+  vcg::AlignPair aa;
+  aa.ConvertMesh<CMeshO>(MM(fixId)->cm,fix.mesh);
 
   if(MM(fixId)->cm.fn==0 || ap.UseVertexOnly)
   {
-    Fix.InitVert(vcg::Matrix44d::Identity());
-    vcg::AlignPair::InitFixVert(&Fix,ap,VG);
+    fix.mesh.InitVert(vcg::Matrix44d::Identity());
+    vcg::AlignPair::InitFixVert(&fix.mesh,ap,fix.VG);
   }
   else
   {
-    Fix.Init(vcg::Matrix44d::Identity());
-    vcg::AlignPair::InitFix(&Fix, ap, UG);
+    fix.mesh.Init(vcg::Matrix44d::Identity());
+    vcg::AlignPair::InitFix(&fix.mesh, ap, fix.UG);
   }
-  // 2) Convert the second mesh and sample a <ap.SampleNum> points on it.
+}
 
-  MM(movId)->updateDataMask(MeshModel::MM_FACEMARK);
-//  aa.ConvertMesh<CMeshO>(MM(movId)->cm,Mov);
+// Align the mov mesh over an already initialized fix mesh.
+// The result depends only on the two meshes and on the parameters (the random sampling
+// is seeded with the two ids), so the arcs can be computed in any order and in parallel,
+// provided that each FixMesh is used by one thread at a time (the face marks are in its faces).
+void MeshTree::ProcessArc(FixMesh &fix, int fixId, int movId, const vcg::Matrix44d &MovM, vcg::AlignPair::Result &result, vcg::AlignPair::Param ap)
+{
+  vcg::AlignPair aa;
+  aa.SetRandomSeed(unsigned(fixId)*7919u+unsigned(movId));
+
+  // Convert the second mesh and sample a <ap.SampleNum> points on it.
   std::vector<vcg::AlignPair::A2Vertex> tmpmv;
-//  aa.ConvertVertex(Mov.vert,tmpmv);
   aa.ConvertVertex(MM(movId)->cm.vert,tmpmv);
   aa.SampleMovVert(tmpmv, ap.SampleNum, ap.SampleMode);
 
   aa.mov=&tmpmv;
-  aa.fix=&Fix;
+  aa.fix=&fix.mesh;
   aa.ap = ap;
 
   vcg::Matrix44d In=MovM;
   // Perform the ICP algorithm
-  aa.Align(In,UG,VG,result);
+  aa.Align(In,fix.UG,fix.VG,result);
 
   result.FixName=fixId;
   result.MovName=movId;
-  result.as.Dump(stdout);
 }
 // The main processing function
 // 1) determine what AlignmentPair must be computed
@@ -160,29 +175,83 @@ void MeshTree::Process(vcg::AlignPair::Param &ap, MeshTree::Param &mtp)
 
   cb(0,qPrintable(buf.sprintf("Arc with good overlap %6i (on  %6lu)\n",totalArcNum,OG.SVA.size())));
   cb(0,qPrintable(buf.sprintf(" %6i preserved %i Recalc \n",preservedArcNum,recalcArcNum))) ;
+
+  // Collect the arcs to be computed: missing arcs and arcs with great error must be recomputed.
+  std::vector<size_t> arcSVA;
+  std::vector<AlignPair::Result *> arcResult;
+  std::vector<vcg::Matrix44d> arcMovToFix;
+  std::map<int, std::vector<int> > fixArcs;
   for(size_t i=0;i<OG.SVA.size() && OG.SVA[i].norm_area > mtp.arcThreshold; ++i)
   {
     fprintf(stdout,"%4i -> %4i Area:%5i NormArea:%5.3f\n",OG.SVA[i].s,OG.SVA[i].t,OG.SVA[i].area,OG.SVA[i].norm_area);
     AlignPair::Result *curResult=findResult(OG.SVA[i].s,OG.SVA[i].t);
-    if(curResult==0 || curResult->err >= percentileThr) // missing arc and arc with great error must be recomputed.
+    if(curResult==0 || curResult->err >= percentileThr)
     {
       if(curResult==0) {
         resultList.push_back(AlignPair::Result());
         curResult= &resultList.back();
+        curResult->FixName=OG.SVA[i].s;
+        curResult->MovName=OG.SVA[i].t;
       }
-      ProcessArc(OG.SVA[i].s, OG.SVA[i].t, *curResult, ap);
-      curResult->area= OG.SVA[i].norm_area;
-      if( curResult->IsValid() )
-      {
-        std::pair<double,double> dd=curResult->ComputeAvgErr();
-        cb(0,qPrintable(buf.sprintf("(%3i/%3i) %2i -> %2i Aligned AvgErr dd=%f -> dd=%f \n",int(i+1),totalArcNum,OG.SVA[i].s,OG.SVA[i].t,dd.first,dd.second)));
-      }
-      else
-      {
-        cb(0,qPrintable(buf.sprintf( "(%3i/%3i) %2i -> %2i Failed Alignment of one arc %s\n",int(i+1),totalArcNum,OG.SVA[i].s,OG.SVA[i].t,vcg::AlignPair::ErrorMsg(curResult->status))));
-        resultList.pop_back();
-      }
+      vcg::Matrix44d FixM=vcg::Matrix44d::Construct(find(OG.SVA[i].s)->tr());
+      vcg::Matrix44d MovM=vcg::Matrix44d::Construct(find(OG.SVA[i].t)->tr());
+      fixArcs[OG.SVA[i].s].push_back(int(arcSVA.size()));
+      arcSVA.push_back(i);
+      arcResult.push_back(curResult);
+      arcMovToFix.push_back(Inverse(FixM) * MovM);
+      MM(OG.SVA[i].s)->updateDataMask(MeshModel::MM_FACEMARK);
+      MM(OG.SVA[i].t)->updateDataMask(MeshModel::MM_FACEMARK);
+    }
+  }
+
+  // The arcs are computed in parallel, grouped by fix mesh: each fix mesh is converted
+  // and put in the grid once, by the thread computing all its arcs.
+  // The largest groups are started first, to balance the load of the threads.
+  std::vector<std::pair<int,int> > groupOrder; // (-arc number, fix id)
+  for(std::map<int, std::vector<int> >::iterator gi=fixArcs.begin();gi!=fixArcs.end();++gi)
+    groupOrder.push_back(std::make_pair(-int(gi->second.size()),gi->first));
+  std::sort(groupOrder.begin(),groupOrder.end());
+
+  cb(0,qPrintable(buf.sprintf("Aligning %i arcs...\n",int(arcSVA.size()))));
+#pragma omp parallel for schedule(dynamic,1)
+  for(int g=0;g<int(groupOrder.size());++g)
+  {
+    const int fixId=groupOrder[g].second;
+    const std::vector<int> &arcs=fixArcs.find(fixId)->second;
+    FixMesh fix;
+    InitFixMesh(fixId,ap,fix);
+    for(size_t k=0;k<arcs.size();++k)
+    {
+      const int a=arcs[k];
+      ProcessArc(fix,fixId,OG.SVA[arcSVA[a]].t,arcMovToFix[a],*arcResult[a],ap);
+      arcResult[a]->area= OG.SVA[arcSVA[a]].norm_area;
+    }
+  }
+
+  // Report the results in the order of the arcs and drop the failed ones.
+  std::vector<AlignPair::Result *> failed;
+  for(size_t a=0;a<arcSVA.size();++a)
+  {
+    const size_t i=arcSVA[a];
+    AlignPair::Result *curResult=arcResult[a];
+    curResult->as.Dump(stdout);
+    if( curResult->IsValid() )
+    {
+      std::pair<double,double> dd=curResult->ComputeAvgErr();
+      cb(0,qPrintable(buf.sprintf("(%3i/%3i) %2i -> %2i Aligned AvgErr dd=%f -> dd=%f \n",int(i+1),totalArcNum,OG.SVA[i].s,OG.SVA[i].t,dd.first,dd.second)));
     }
+    else
+    {
+      cb(0,qPrintable(buf.sprintf( "(%3i/%3i) %2i -> %2i Failed Alignment of one arc %s\n",int(i+1),totalArcNum,OG.SVA[i].s,OG.SVA[i].t,vcg::AlignPair::ErrorMsg(curResult->status))));
+      failed.push_back(curResult);
+    }
+  }
+  QList<vcg::AlignPair::Result>::iterator ri=resultList.begin();
+  while(ri!=resultList.end())
+  {
+    if(std::find(failed.begin(),failed.end(),&*ri)!=failed.end())
+      ri=resultList.erase(ri);
+    else ++ri;
   }
 
   vcg::Distribution<float> H; // stat for printing
@@ -125,10 +125,22 @@ public:
   int gluedNum();
 
 
+  // The fix mesh of an arc converted and indexed for the alignment.
+  // It depends only on the mesh, so it is built once for all the arcs sharing the same fix mesh.
+  class FixMesh
+  {
+  public:
+    vcg::AlignPair::A2Mesh mesh;
+    vcg::AlignPair::A2Grid UG;
+    vcg::AlignPair::A2GridVert VG;
+  };
+
   void Process(vcg::AlignPair::Param &ap, Param &mtp);
   void ProcessGlobal(vcg::AlignPair::Param &ap);
   void ProcessArc(int fixId, int movId, vcg::AlignPair::Result &result, vcg::AlignPair::Param ap);
   void ProcessArc(int fixId, int movId, vcg::Matrix44d &MovToFix, vcg::AlignPair::Result &result, vcg::AlignPair::Param ap);
+  void InitFixMesh(int fixId, vcg::AlignPair::Param &ap, FixMesh &fix);
+  void ProcessArc(FixMesh &fix, int fixId, int movId, const vcg::Matrix44d &MovToFix, vcg::AlignPair::Result &result, vcg::AlignPair::Param ap);
 
   inline vcg::Box3f bbox() {
     vcg::Box3f FullBBox;
@@ -25,6 +25,7 @@
 #include "filter_ao.h"
 #include <QGLFramebufferObject>
 #include <vcg/math/gen_normal.h>
+#include <vcg/space/index/ray_bvh.h>
 
 #include <wrap/qt/checkGLError.h>
 
@@ -108,7 +109,7 @@ void AmbientOcclusionPlugin::initParameterSet(QAction *action, MeshModel &m, Ric
 			parlst.addParam(new RichInt ("reqViews",AMBOCC_DEFAULT_NUM_VIEWS,"Requested views", "Number of different views uniformly placed around the mesh. More views means better accuracy at the cost of increased calculation time"));
 			parlst.addParam(new RichPoint3f("coneDir",Point3f(0,1,0),"Lighting Direction", "Number of different views placed around the mesh. More views means better accuracy at the cost of increased calculation time"));
 			parlst.addParam(new RichFloat("coneAngle",30,"Cone amplitude", "Number of different views uniformly placed around the mesh. More views means better accuracy at the cost of increased calculation time"));
-			parlst.addParam(new RichBool("useGPU",AMBOCC_USEGPU_BY_DEFAULT,"Use GPU acceleration","In order to use GPU-Mode, your hardware must support FBOs, FP32 Textures and Shaders. Normally increases the performance by a factor of 4x-5x"));
+			parlst.addParam(new RichBool("useGPU",AMBOCC_USEGPU_BY_DEFAULT,"Use GPU acceleration","In order to use GPU-Mode, your hardware must support FBOs, FP32 Textures and Shaders. Otherwise the occlusion is computed on the CPU by casting rays toward each view direction"));
 			parlst.addParam(new RichBool("useVBO",AMBOCC_USEVBO_BY_DEFAULT,"Use VBO if supported","By using VBO, Meshlab loads all the vertex structure in the VRam, greatly increasing rendering speed (for both CPU and GPU mode). Disable it if problem occurs"));
 			parlst.addParam(new RichInt ("depthTexSize",AMBOCC_DEFAULT_TEXTURE_SIZE,"Depth texture size(should be 2^n)", "Defines the depth texture size used to compute occlusion from each point of view. Higher values means better accuracy usually with low impact on performance"));
 			break;
@@ -156,6 +157,9 @@ bool AmbientOcclusionPlugin::applyFilter(QAction *filter, MeshDocument &md, Rich
 	
 	numViews = viewDirVec.size();
 
+	// the CPU mode does not need any OpenGL context
+	if(!useGPU)
+		return processRayCast(m,viewDirVec,cb);
 
 	this->glContext->makeCurrent();
 	this->initGL(cb,m.cm.vn);
@@ -221,10 +225,6 @@ bool AmbientOcclusionPlugin::processGL(MeshModel &m, vector<Point3f> &posVect)
 	}
 	
 	tInitElapsed = tInit.elapsed();
-	vector<Point3f> faceCenterVec;
-	
-	for(int i=0;i<m.cm.fn;i++)
-		faceCenterVec.push_back(Barycenter(m.cm.face[i]));
 	
 	for (vi = posVect.begin(); vi != posVect.end(); vi++)
 	{
@@ -253,21 +253,6 @@ bool AmbientOcclusionPlugin::processGL(MeshModel &m, vector<Point3f> &posVect)
 			glViewport(0,0,maxTexSize,maxTexSize);
 			generateOcclusionHW();
 		}
-		else
-		{
-			glDisable(GL_BLEND);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			// FIRST PASS - fill depth buffer
-			glColorMask(0, 0, 0, 0);
-			m.glw.DrawFill<GLW::NMNone, GLW::CMNone, GLW::TMNone>();
-			glColorMask(1, 1, 1, 1);
-
-			glDisable(GL_POLYGON_OFFSET_FILL);
-
-			// SECOND PASS - use depth buffer to check occlusion
-			if(perFace) generateFaceOcclusionSW(m,faceCenterVec);
-			else generateOcclusionSW(m);
-		}
 		checkGLError::debugInfo("Debug");
 	}
 
@@ -328,6 +313,88 @@ bool AmbientOcclusionPlugin::processGL(MeshModel &m, vector<Point3f> &posVect)
 	return true;
 } 
 
+// CPU version: a point is visible from a view direction if the ray leaving it
+// along that direction does not hit the mesh. The rays of each view are cast in parallel.
+bool AmbientOcclusionPlugin::processRayCast(MeshModel &m, vector<Point3f> &posVect, vcg::CallBackPos *cb)
+{
+	QTime tInit, tAll;
+	tInit.start();
+	tAll.start();
+
+	vcg::tri::Allocator<CMeshO>::CompactVertexVector(m.cm);
+	vcg::tri::Allocator<CMeshO>::CompactFaceVector(m.cm);
+	vcg::tri::UpdateNormal<CMeshO>::PerVertexNormalizedPerFaceNormalized(m.cm);
+	vcg::tri::UpdateBounding<CMeshO>::Box(m.cm);
+
+	CMeshO::PerVertexAttributeHandle<Point3f> BN = tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3f>(m.cm, "BentNormal");
+
+	if(perFace) tri::UpdateQuality<CMeshO>::FaceConstant(m.cm,0);
+	else
+	{
+		tri::UpdateQuality<CMeshO>::VertexConstant(m.cm,0);
+		for(int i=0;i<m.cm.vn;++i) BN[i]=Point3f(0,0,0);
+	}
+
+	cb(0, "Initializing: ray casting acceleration structure");
+	RayBVH<CMeshO> bvh;
+	bvh.Set(m.cm);
+
+	// the ray origins are moved a bit along the ray, to skip the faces they lie on
+	const float maxDist = m.cm.bbox.Diag();
+	const float epsilon = maxDist * 1e-4f;
+
+	vector<Point3f> samplePos;
+	if(perFace)
+		for(int i=0;i<m.cm.fn;i++) samplePos.push_back(Barycenter(m.cm.face[i]));
+	else
+		for(int i=0;i<m.cm.vn;i++) samplePos.push_back(m.cm.vert[i].P());
+
+	int tInitElapsed = tInit.elapsed();
+
+	vector<Ray3f> rays(samplePos.size());
+	vector<char> occluded;
+	for (size_t k=0; k<posVect.size(); ++k)
+	{
+		cb(100*k/posVect.size(), "Casting occlusion rays...");
+		Point3f dir = posVect[k];
+		dir.Normalize();
+		for(size_t i=0;i<samplePos.size();++i)
+			rays[i].Set(samplePos[i]+dir*epsilon, dir);
+		bvh.AnyHit(rays, maxDist, occluded);
+
+		if(perFace)
+		{
+			for(int i=0;i<m.cm.fn;++i) if(!occluded[i])
+				m.cm.face[i].Q() += max(m.cm.face[i].cN().dot(dir), 0.0f);
+		}
+		else
+		{
+			for(int i=0;i<m.cm.vn;++i) if(!occluded[i])
+			{
+				m.cm.vert[i].Q() += max(m.cm.vert[i].cN().dot(dir), 0.0f);
+				BN[i] += dir;
+			}
+		}
+	}
+
+	if(perFace)
+	{
+		tri::UpdateColor<CMeshO>::PerFaceQualityGray(m.cm);
+		for(int i=0;i<m.cm.fn;++i)
+			m.cm.face[i].Q()=m.cm.face[i].Q()/numViews;
+	} else {
+		tri::UpdateColor<CMeshO>::PerVertexQualityGray(m.cm,0.0f,0.0f);
+		for(int i=0;i<m.cm.vn;++i)
+		{
+			m.cm.vert[i].Q()=m.cm.vert[i].Q()/numViews;
+			BN[i].Normalize();
+		}
+	}
+
+	Log(0,"Successfully calculated A.O. after %3.2f sec, %3.2f of which is due to initialization", ((float)tAll.elapsed()/1000.0f), ((float)tInitElapsed/1000.0f) );
+	return true;
+}
+
 void AmbientOcclusionPlugin::initGL(vcg::CallBackPos *cb, unsigned int numVertices)
 {
 	//******* INIT GLEW ********/
@@ -725,76 +792,6 @@ void AmbientOcclusionPlugin::generateOcclusionHW()
 	glUseProgram(0);
 }
 
-void AmbientOcclusionPlugin::generateOcclusionSW(MeshModel &m)
-{
-	GLdouble resCoords[3];
-	GLdouble mvMatrix_f[16];
-	GLdouble prMatrix_f[16];
-	GLint viewpSize[4];
-	GLfloat *dFloat = new GLfloat[depthTexArea];
-
-	glGetDoublev(GL_MODELVIEW_MATRIX, mvMatrix_f);
-	glGetDoublev(GL_PROJECTION_MATRIX, prMatrix_f);
-	glGetIntegerv(GL_VIEWPORT, viewpSize);
-
-	glReadPixels(0, 0, depthTexSize, depthTexSize, GL_DEPTH_COMPONENT, GL_FLOAT, dFloat);
-
-	cameraDir.Normalize();
-  CMeshO::PerVertexAttributeHandle<Point3f> BN = tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3f>(m.cm, "BentNormal");
-
-	for (int i=0; i<m.cm.vn; ++i)
-	{
-		Point3<CMeshO::ScalarType> &vp = m.cm.vert[i].P();
-		gluProject(vp.X(), vp.Y(), vp.Z(),
-				   (const GLdouble *) mvMatrix_f, (const GLdouble *) prMatrix_f, (const GLint *) viewpSize,
-				   &resCoords[0], &resCoords[1], &resCoords[2] );
-
-		int x = floor(resCoords[0]);
-		int y = floor(resCoords[1]);
-		
-		if (resCoords[2] <= (GLdouble)dFloat[depthTexSize*y+x])
-		{
-			 m.cm.vert[i].Q() += max(m.cm.vert[i].cN().dot(cameraDir), 0.0f);
-       BN[ m.cm.vert[i] ] += cameraDir;
-		}
-	}
-
-	delete [] dFloat;
-}
-
-void AmbientOcclusionPlugin::generateFaceOcclusionSW(MeshModel &m, vector<Point3f> & faceCenterVec)
-{
-	GLdouble resCoords[3];
-	GLdouble mvMatrix_f[16];
-	GLdouble prMatrix_f[16];
-	GLint viewpSize[4];
-	GLfloat *dFloat = new GLfloat[depthTexArea];
-	glGetDoublev(GL_MODELVIEW_MATRIX, mvMatrix_f);
-	glGetDoublev(GL_PROJECTION_MATRIX, prMatrix_f);
-	glGetIntegerv(GL_VIEWPORT, viewpSize);
-
-	glReadPixels(0, 0, depthTexSize, depthTexSize, GL_DEPTH_COMPONENT, GL_FLOAT, dFloat);
-
-	cameraDir.Normalize();
-	for (uint i=0; i<faceCenterVec.size(); ++i)
-	{
-		Point3<CMeshO::ScalarType> &vp = faceCenterVec[i];
-		gluProject(vp.X(), vp.Y(), vp.Z(),
-							 (const GLdouble *) mvMatrix_f, (const GLdouble *) prMatrix_f, (const GLint *) viewpSize,
-							 &resCoords[0], &resCoords[1], &resCoords[2] );
-		
-		int x = floor(resCoords[0]);
-		int y = floor(resCoords[1]);
-		
-		if (resCoords[2] <= (GLdouble)dFloat[depthTexSize*y+x])
-		{
-			m.cm.face[i].Q() += max(m.cm.face[i].cN().dot(cameraDir), 0.0f);
-		}
-	}
-
-delete [] dFloat;
-}
-
 void AmbientOcclusionPlugin::applyOcclusionHW(MeshModel &m)
 {
 	const unsigned int texelNum = maxTexSize*maxTexSize;
@@ -91,6 +91,8 @@ public:
 	void  initGL                (vcg::CallBackPos *cb,
 	                             unsigned int numVertices);
 	bool  processGL             (MeshModel &m, std::vector<vcg::Point3f> &posVect);
+	bool  processRayCast        (MeshModel &m, std::vector<vcg::Point3f> &posVect,
+	                             vcg::CallBackPos *cb);
 	bool  checkFramebuffer();
 
 	void  vertexCoordsToTexture (MeshModel &m);
@@ -99,8 +101,6 @@ public:
 	                             vcg::Box3f &meshBBox);
 
 	void  generateOcclusionHW   ();
-	void  generateOcclusionSW   (MeshModel &m);
-	void  generateFaceOcclusionSW(MeshModel &m, std::vector<vcg::Point3f> & faceCenterVec);
 
 
 	void  applyOcclusionHW      (MeshModel &m);
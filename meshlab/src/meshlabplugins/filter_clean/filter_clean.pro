@@ -5,4 +5,3 @@ HEADERS       += cleanfilter.h
 SOURCES       += cleanfilter.cpp	
 
 TARGET        = filter_clean
-
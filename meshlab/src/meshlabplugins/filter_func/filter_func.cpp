@@ -29,9 +29,16 @@
 
 #include "muParser.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace mu;
 using namespace vcg;
 
+// number of elements evaluated between two updates of the progress bar
+static const int FUNC_BATCH_SIZE = 1<<16;
+
 // Constructor
 FilterFunctionPlugin::FilterFunctionPlugin() 
 { 
@@ -362,40 +369,35 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
   switch(ID(filter)) {
   case FF_VERT_SELECTION :
   {
-    std::string expr = par.getString("condSelect").toStdString();
-
-    // muparser initialization and explicitely define parser variables
-    Parser p;
-    setPerVertexVariables(p,m.cm);
+    std::vector<std::string> exprs(1,par.getString("condSelect").toStdString());
 
-    // set expression inserted by user as string (required by muparser)
-    p.SetExpr(expr);
+    // muparser initialization: a parser for every thread, bound to its own variables
+    if(!initFunctions(m.cm,false,exprs,QStringList() << ""))
+      return false;
 
     int numvert = 0;
-    time_t start = clock();
+    QTime t; t.start();
 
     // every parser variables is related to vertex coord and attributes.
-    CMeshO::VertexIterator vi;
-    for(vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)if(!(*vi).IsD())
+    const int vertNum = int(m.cm.vert.size());
+    for(int bStart = 0; bStart < vertNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(vi,m.cm);
-
-      bool selected = false;
+      const int bEnd = std::min(vertNum, bStart + FUNC_BATCH_SIZE);
 
       // use parser to evaluate boolean function specified above
       // in case of fail, error dialog contains details of parser's error
-      try {
-        selected = p.Eval();
-      } catch(Parser::exception_type &e) {
-        errorMessage = e.GetMsg().c_str();
+      if(!evalFunctions(m.cm,bStart,bEnd))
         return false;
-      }
 
       // set vertex as selected or clear selection
-      if(selected) {
-        (*vi).SetS();
-        numvert++;
-      } else (*vi).ClearS();
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.vert[i].IsD())
+      {
+        if(funcValue[0][i-bStart]) {
+          m.cm.vert[i].SetS();
+          numvert++;
+        } else m.cm.vert[i].ClearS();
+      }
+      if(cb) cb(int(100.0*bEnd/vertNum),"Selecting vertices");
     }
 
     // strict face selection
@@ -405,7 +407,7 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
       tri::UpdateSelection<CMeshO>::FaceFromVertexLoose(m.cm);
 
     // if succeded log stream contains number of vertices and time elapsed
-    Log( "selected %d vertices in %.2f sec.", numvert, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "selected %d vertices in %.2f sec.", numvert, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -413,44 +415,39 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
 
   case FF_FACE_SELECTION :
   {
-    QString select = par.getString("condSelect");
+    std::vector<std::string> exprs(1,par.getString("condSelect").toStdString());
 
-    // muparser initialization and explicitely define parser variables
-    Parser p;
-    setPerFaceVariables(p,m.cm);
-
-    // set expression inserted by user as string (required by muparser)
-    p.SetExpr(select.toStdString());
+    // muparser initialization: a parser for every thread, bound to its own variables
+    if(!initFunctions(m.cm,true,exprs,QStringList() << ""))
+      return false;
 
     int numface = 0;
-    time_t start = clock();
+    QTime t; t.start();
 
     // every parser variables is related to face attributes.
-    CMeshO::FaceIterator fi;
-    for(fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)if(!(*fi).IsD())
+    const int faceNum = int(m.cm.face.size());
+    for(int bStart = 0; bStart < faceNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(fi,m.cm);
-
-      bool selected = false;
+      const int bEnd = std::min(faceNum, bStart + FUNC_BATCH_SIZE);
 
       // use parser to evaluate boolean function specified above
       // in case of fail, error dialog contains details of parser's error
-      try {
-        selected = p.Eval();
-      } catch(Parser::exception_type &e) {
-        errorMessage = e.GetMsg().c_str();
+      if(!evalFunctions(m.cm,bStart,bEnd))
         return false;
-      }
 
       // set face as selected or clear selection
-      if(selected) {
-        (*fi).SetS();
-        numface++;
-      } else (*fi).ClearS();
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.face[i].IsD())
+      {
+        if(funcValue[0][i-bStart]) {
+          m.cm.face[i].SetS();
+          numface++;
+        } else m.cm.face[i].ClearS();
+      }
+      if(cb) cb(int(100.0*bEnd/faceNum),"Selecting faces");
     }
 
     // if succeded log stream contains number of vertices and time elapsed
-    Log( "selected %d faces in %.2f sec.", numface, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "selected %d faces in %.2f sec.", numface, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -460,56 +457,47 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
   case FF_VERT_COLOR:
   case FF_VERT_NORMAL:
   {
-    std::string func_x,func_y,func_z,func_a;
     // FF_VERT_COLOR : x = r, y = g, z = b
     // FF_VERT_NORMAL : x = r, y = g, z = b
-    func_x = par.getString("x").toStdString();
-    func_y = par.getString("y").toStdString();
-    func_z = par.getString("z").toStdString();
-    if(ID(filter) == FF_VERT_COLOR) func_a = par.getString("a").toStdString();
-
-    // muparser initialization and explicitely define parser variables
-    // function for x,y and z must use different parser and variables
-    Parser p1,p2,p3,p4;
-
-    setPerVertexVariables(p1,m.cm);
-    setPerVertexVariables(p2,m.cm);
-    setPerVertexVariables(p3,m.cm);
-    setPerVertexVariables(p4,m.cm);
-
-    p1.SetExpr(func_x);
-    p2.SetExpr(func_y);
-    p3.SetExpr(func_z);
-    p4.SetExpr(func_a);
+    std::vector<std::string> exprs;
+    QStringList labels;
+    exprs.push_back(par.getString("x").toStdString()); labels << "1st func : ";
+    exprs.push_back(par.getString("y").toStdString()); labels << "2nd func : ";
+    exprs.push_back(par.getString("z").toStdString()); labels << "3rd func : ";
+    if(ID(filter) == FF_VERT_COLOR)
+    {
+      exprs.push_back(par.getString("a").toStdString()); labels << "4th func : ";
+    }
 
-    double newx=0,newy=0,newz=0,newa=255;
-    errorMessage = "";
+    // muparser initialization: every function is evaluated by a different parser,
+    // and every thread has its own parsers bound to its own variables.
+    // errorMessage dialog contains errors for func x, func y and func z
+    if(!initFunctions(m.cm,false,exprs,labels))
+      return false;
 
-    time_t start = clock();
+    QTime t; t.start();
 
     // every parser variables is related to vertex coord and attributes.
-    CMeshO::VertexIterator vi;
-    for(vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)if(!(*vi).IsD())
+    const int vertNum = int(m.cm.vert.size());
+    for(int bStart = 0; bStart < vertNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(vi,m.cm);
-
-      // every function is evaluated by different parser.
-      // errorMessage dialog contains errors for func x, func y and func z
-      try { newx = p1.Eval(); }  catch(Parser::exception_type &e) { showParserError("1st func : ",e); }
-      try { newy = p2.Eval(); }  catch(Parser::exception_type &e) { showParserError("2nd func : ",e); }
-      try { newz = p3.Eval(); }  catch(Parser::exception_type &e) { showParserError("3rd func : ",e); }
-      if(ID(filter) == FF_VERT_COLOR)
+      const int bEnd = std::min(vertNum, bStart + FUNC_BATCH_SIZE);
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
+
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.vert[i].IsD())
       {
-        try { newa = p4.Eval(); } catch(Parser::exception_type &e) { showParserError("4th func : ",e); }
+        const double newx = funcValue[0][i-bStart];
+        const double newy = funcValue[1][i-bStart];
+        const double newz = funcValue[2][i-bStart];
+        if(ID(filter) == FF_GEOM_FUNC)  // set new vertex coord for this iteration
+          m.cm.vert[i].P() = Point3f(newx,newy,newz);
+        if(ID(filter) == FF_VERT_COLOR) // set new color for this iteration
+          m.cm.vert[i].C() = Color4b(newx,newy,newz,funcValue[3][i-bStart]);
+        if(ID(filter) == FF_VERT_NORMAL) // set new color for this iteration
+          m.cm.vert[i].N() = Point3f(newx,newy,newz);
       }
-      if(errorMessage != "") return false;
-
-      if(ID(filter) == FF_GEOM_FUNC)  // set new vertex coord for this iteration
-        (*vi).P() = Point3f(newx,newy,newz);
-      if(ID(filter) == FF_VERT_COLOR) // set new color for this iteration
-        (*vi).C() = Color4b(newx,newy,newz,newa);
-      if(ID(filter) == FF_VERT_NORMAL) // set new color for this iteration
-        (*vi).N() = Point3f(newx,newy,newz);
+      if(cb) cb(int(100.0*bEnd/vertNum),"Evaluating functions");
     }
 
     if(ID(filter) == FF_GEOM_FUNC) {
@@ -520,7 +508,7 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
     }
 
     // if succeded log stream contains number of vertices processed and time elapsed
-    Log( "%d vertices processed in %.2f sec.", m.cm.vn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d vertices processed in %.2f sec.", m.cm.vn, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -528,33 +516,29 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
 
   case FF_VERT_QUALITY:
   {
-    std::string func_q = par.getString("q").toStdString();
+    std::vector<std::string> exprs(1,par.getString("q").toStdString());
     m.updateDataMask(MeshModel::MM_VERTQUALITY);
 
     // muparser initialization and define custom variables
-    Parser p;
-    setPerVertexVariables(p,m.cm);
-
-    // set expression to calc with parser
-    p.SetExpr(func_q);
+    if(!initFunctions(m.cm,false,exprs,QStringList() << ""))
+      return false;
 
     // every parser variables is related to vertex coord and attributes.
-    time_t start = clock();
-    CMeshO::VertexIterator vi;
-    for(vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-      if(!(*vi).IsD())
-      {
-        setAttributes(vi,m.cm);
-
-        // use parser to evaluate function specified above
-        // in case of fail, errorMessage dialog contains details of parser's error
-        try {
-          (*vi).Q() = p.Eval();
-        } catch(Parser::exception_type &e) {
-          errorMessage = e.GetMsg().c_str();
-          return false;
-        }
-      }
+    QTime t; t.start();
+    const int vertNum = int(m.cm.vert.size());
+    for(int bStart = 0; bStart < vertNum; bStart += FUNC_BATCH_SIZE)
+    {
+      const int bEnd = std::min(vertNum, bStart + FUNC_BATCH_SIZE);
+
+      // use parser to evaluate function specified above
+      // in case of fail, errorMessage dialog contains details of parser's error
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
+
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.vert[i].IsD())
+        m.cm.vert[i].Q() = funcValue[0][i-bStart];
+      if(cb) cb(int(100.0*bEnd/vertNum),"Evaluating quality");
+    }
 
     // normalize quality with values in [0..1]
     if(par.getBool("normalize")) tri::UpdateQuality<CMeshO>::VertexNormalize(m.cm);
@@ -563,141 +547,120 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
     if(par.getBool("map")) tri::UpdateColor<CMeshO>::PerVertexQualityRamp(m.cm);
 
     // if succeded log stream contains number of vertices and time elapsed
-    Log( "%d vertices processed in %.2f sec.", m.cm.vn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d vertices processed in %.2f sec.", m.cm.vn, t.elapsed() / 1000.0f);
 
     return true;
   }
     break;
   case FF_VERT_TEXTURE_FUNC:
   {
-    std::string func_u = par.getString("u").toStdString();
-    std::string func_v = par.getString("v").toStdString();
+    std::vector<std::string> exprs;
+    exprs.push_back(par.getString("u").toStdString());
+    exprs.push_back(par.getString("v").toStdString());
     m.updateDataMask(MeshModel::MM_VERTTEXCOORD);
 
     // muparser initialization and define custom variables
-    Parser pu,pv;
-    setPerVertexVariables(pu,m.cm);
-    setPerVertexVariables(pv,m.cm);
-
-    // set expression to calc with parser
-    pu.SetExpr(func_u);
-    pv.SetExpr(func_v);
+    if(!initFunctions(m.cm,false,exprs,QStringList() << "func u: " << "func v: "))
+      return false;
 
     // every parser variables is related to vertex coord and attributes.
-    time_t start = clock();
-    CMeshO::VertexIterator vi;
-    for(vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)
-      if(!(*vi).IsD())
+    QTime t; t.start();
+    const int vertNum = int(m.cm.vert.size());
+    for(int bStart = 0; bStart < vertNum; bStart += FUNC_BATCH_SIZE)
+    {
+      const int bEnd = std::min(vertNum, bStart + FUNC_BATCH_SIZE);
+
+      // use parser to evaluate function specified above
+      // in case of fail, errorMessage dialog contains details of parser's error
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
+
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.vert[i].IsD())
       {
-        setAttributes(vi,m.cm);
-
-        // use parser to evaluate function specified above
-        // in case of fail, errorMessage dialog contains details of parser's error
-        try {
-          (*vi).T().U() = pu.Eval();
-          (*vi).T().V() = pv.Eval();
-        } catch(Parser::exception_type &e) {
-          errorMessage = e.GetMsg().c_str();
-          return false;
-        }
+        m.cm.vert[i].T().U() = funcValue[0][i-bStart];
+        m.cm.vert[i].T().V() = funcValue[1][i-bStart];
       }
-    Log( "%d vertices processed in %.2f sec.", m.cm.vn, (clock() - start) / (float) CLOCKS_PER_SEC);
+      if(cb) cb(int(100.0*bEnd/vertNum),"Evaluating texture coords");
+    }
+    Log( "%d vertices processed in %.2f sec.", m.cm.vn, t.elapsed() / 1000.0f);
     return true;
   }
     break;
   case FF_WEDGE_TEXTURE_FUNC:
   {
-    std::string func_u0 = par.getString("u0").toStdString();
-    std::string func_v0 = par.getString("v0").toStdString();
-    std::string func_u1 = par.getString("u1").toStdString();
-    std::string func_v1 = par.getString("v1").toStdString();
-    std::string func_u2 = par.getString("u2").toStdString();
-    std::string func_v2 = par.getString("v2").toStdString();
+    std::vector<std::string> exprs;
+    exprs.push_back(par.getString("u0").toStdString());
+    exprs.push_back(par.getString("v0").toStdString());
+    exprs.push_back(par.getString("u1").toStdString());
+    exprs.push_back(par.getString("v1").toStdString());
+    exprs.push_back(par.getString("u2").toStdString());
+    exprs.push_back(par.getString("v2").toStdString());
     m.updateDataMask(MeshModel::MM_VERTTEXCOORD);
 
     // muparser initialization and define custom variables
-    Parser pu0,pv0,pu1,pv1,pu2,pv2;
-    setPerFaceVariables(pu0,m.cm); setPerFaceVariables(pv0,m.cm);
-    setPerFaceVariables(pu1,m.cm); setPerFaceVariables(pv1,m.cm);
-    setPerFaceVariables(pu2,m.cm); setPerFaceVariables(pv2,m.cm);
-
-    // set expression to calc with parser
-    pu0.SetExpr(func_u0); pv0.SetExpr(func_v0);
-    pu1.SetExpr(func_u1); pv1.SetExpr(func_v1);
-    pu2.SetExpr(func_u2); pv2.SetExpr(func_v2);
+    if(!initFunctions(m.cm,true,exprs,QStringList() << "func u0: " << "func v0: " << "func u1: " << "func v1: " << "func u2: " << "func v2: "))
+      return false;
 
     // every parser variables is related to vertex coord and attributes.
-    time_t start = clock();
-    CMeshO::VertexIterator vi;
-    for(CMeshO::FaceIterator fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-      if(!(*fi).IsD())
+    QTime t; t.start();
+    const int faceNum = int(m.cm.face.size());
+    for(int bStart = 0; bStart < faceNum; bStart += FUNC_BATCH_SIZE)
+    {
+      const int bEnd = std::min(faceNum, bStart + FUNC_BATCH_SIZE);
+
+      // use parser to evaluate function specified above
+      // in case of fail, errorMessage dialog contains details of parser's error
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
+
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.face[i].IsD())
       {
-        setAttributes(fi,m.cm);
-
-        // use parser to evaluate function specified above
-        // in case of fail, errorMessage dialog contains details of parser's error
-        try {
-          (*fi).WT(0).U() = pu0.Eval(); (*fi).WT(0).V() = pv0.Eval();
-          (*fi).WT(1).U() = pu1.Eval(); (*fi).WT(1).V() = pv1.Eval();
-          (*fi).WT(2).U() = pu2.Eval(); (*fi).WT(2).V() = pv2.Eval();
-        } catch(Parser::exception_type &e) {
-          errorMessage = e.GetMsg().c_str();
-          return false;
-        }
+        CFaceO &f = m.cm.face[i];
+        f.WT(0).U() = funcValue[0][i-bStart]; f.WT(0).V() = funcValue[1][i-bStart];
+        f.WT(1).U() = funcValue[2][i-bStart]; f.WT(1).V() = funcValue[3][i-bStart];
+        f.WT(2).U() = funcValue[4][i-bStart]; f.WT(2).V() = funcValue[5][i-bStart];
       }
+      if(cb) cb(int(100.0*bEnd/faceNum),"Evaluating texture coords");
+    }
 
-    Log( "%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d faces processed in %.2f sec.", m.cm.fn, t.elapsed() / 1000.0f);
     return true;
   }
     break;
   case FF_FACE_COLOR:
   {
-    std::string func_r = par.getString("r").toStdString();
-    std::string func_g = par.getString("g").toStdString();
-    std::string func_b = par.getString("b").toStdString();
-    std::string func_a = par.getString("a").toStdString();
+    std::vector<std::string> exprs;
+    exprs.push_back(par.getString("r").toStdString());
+    exprs.push_back(par.getString("g").toStdString());
+    exprs.push_back(par.getString("b").toStdString());
+    exprs.push_back(par.getString("a").toStdString());
 
     // muparser initialization and explicitely define parser variables
     // every function must uses own parser and variables
-    Parser p1,p2,p3,p4;
-
-    setPerFaceVariables(p1,m.cm);
-    setPerFaceVariables(p2,m.cm);
-    setPerFaceVariables(p3,m.cm);
-    setPerFaceVariables(p4,m.cm);
-
-    p1.SetExpr(func_r);
-    p2.SetExpr(func_g);
-    p3.SetExpr(func_b);
-    p4.SetExpr(func_a);
-
-    // RGB is related to every face
-    CMeshO::FaceIterator fi;
-    double newr=0,newg=0,newb=0,newa=255;
-    errorMessage = "";
+    // in case of fail, error dialog contains details of parser's error
+    if(!initFunctions(m.cm,true,exprs,QStringList() << "func r: " << "func g: " << "func b: " << "func a: "))
+      return false;
 
-    time_t start = clock();
+    QTime t; t.start();
 
     // every parser variables is related to face attributes.
-    for(fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)if(!(*fi).IsD())
+    const int faceNum = int(m.cm.face.size());
+    for(int bStart = 0; bStart < faceNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(fi,m.cm);
+      const int bEnd = std::min(faceNum, bStart + FUNC_BATCH_SIZE);
 
       // evaluate functions to generate new color
-      // in case of fail, error dialog contains details of parser's error
-      try { newr = p1.Eval(); } catch(Parser::exception_type &e) { showParserError("func r: ",e); }
-      try { newg = p2.Eval(); } catch(Parser::exception_type &e) { showParserError("func g: ",e); }
-      try { newb = p3.Eval(); } catch(Parser::exception_type &e) { showParserError("func b: ",e); 	}
-      try { newa = p4.Eval(); } catch(Parser::exception_type &e) { showParserError("func a: ",e); 	}
-
-      if(errorMessage != "") return false;
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
 
       // set new color for this iteration
-      (*fi).C() = Color4b(newr,newg,newb,newa);
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.face[i].IsD())
+        m.cm.face[i].C() = Color4b(funcValue[0][i-bStart],funcValue[1][i-bStart],funcValue[2][i-bStart],funcValue[3][i-bStart]);
+      if(cb) cb(int(100.0*bEnd/faceNum),"Evaluating face colors");
     }
 
     // if succeded log stream contains number of vertices processed and time elapsed
-    Log( "%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d faces processed in %.2f sec.", m.cm.fn, t.elapsed() / 1000.0f);
 
     return true;
 
@@ -706,32 +669,29 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
 
   case FF_FACE_QUALITY:
   {
-    std::string func_q = par.getString("q").toStdString();
+    std::vector<std::string> exprs(1,par.getString("q").toStdString());
     m.updateDataMask(MeshModel::MM_FACEQUALITY);
 
     // muparser initialization and define custom variables
-    Parser pf;
-    setPerFaceVariables(pf,m.cm);
-
-    // set expression to calc with parser
-    pf.SetExpr(func_q);
+    if(!initFunctions(m.cm,true,exprs,QStringList() << "func q: "))
+      return false;
 
-    time_t start = clock();
-    errorMessage = "";
+    QTime t; t.start();
 
     // every parser variables is related to face attributes.
-    CMeshO::FaceIterator fi;
-    for(fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)if(!(*fi).IsD())
+    const int faceNum = int(m.cm.face.size());
+    for(int bStart = 0; bStart < faceNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(fi,m.cm);
+      const int bEnd = std::min(faceNum, bStart + FUNC_BATCH_SIZE);
 
       // evaluate functions to generate new quality
       // in case of fail, error dialog contains details of parser's error
-      try { (*fi).Q() = pf.Eval(); }
-      catch(Parser::exception_type &e) {
-        showParserError("func q: ",e);
-      }
-      if(errorMessage != "") return false;
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
+
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.face[i].IsD())
+        m.cm.face[i].Q() = funcValue[0][i-bStart];
+      if(cb) cb(int(100.0*bEnd/faceNum),"Evaluating face quality");
     }
 
     // normalize quality with values in [0..1]
@@ -741,7 +701,7 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
     if(par.getBool("map")) tri::UpdateColor<CMeshO>::PerFaceQualityRamp(m.cm);
 
     // if succeded log stream contains number of faces processed and time elapsed
-    Log( "%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d faces processed in %.2f sec.", m.cm.fn, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -750,7 +710,7 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
   case FF_DEF_VERT_ATTRIB :
   {
     std::string name = par.getString("name").toStdString();
-    std::string expr = par.getString("expr").toStdString();
+    std::vector<std::string> exprs(1,par.getString("expr").toStdString());
 
     // add per-vertex attribute with type float and name specified by user
     CMeshO::PerVertexAttributeHandle<float> h;
@@ -769,36 +729,29 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
     std::vector<std::string> AllVertexAttribName;
     tri::Allocator<CMeshO>::GetAllPerVertexAttribute< float >(m.cm,AllVertexAttribName);
     qDebug("Now mesh has %i vertex float attribute",AllVertexAttribName.size());
-    Parser p;
-    setPerVertexVariables(p,m.cm);
-    p.SetExpr(expr);
 
-    time_t start = clock();
+    // the new attribute is a variable too: it is accessible in the other filters through its name
+    if(!initFunctions(m.cm,false,exprs,QStringList() << ""))
+      return false;
+
+    QTime t; t.start();
 
     // perform calculation of attribute's value with function specified by user
-    CMeshO::VertexIterator vi;
-    for(vi = m.cm.vert.begin(); vi != m.cm.vert.end(); ++vi)if(!(*vi).IsD())
+    const int vertNum = int(m.cm.vert.size());
+    for(int bStart = 0; bStart < vertNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(vi,m.cm);
+      const int bEnd = std::min(vertNum, bStart + FUNC_BATCH_SIZE);
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
 
       // add new user-defined attribute
-      try {
-        h[vi] = p.Eval();
-      } catch(Parser::exception_type &e) {
-        errorMessage = e.GetMsg().c_str();
-        return false;
-      }
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.vert[i].IsD())
+        h[i] = funcValue[0][i-bStart];
+      if(cb) cb(int(100.0*bEnd/vertNum),"Evaluating attribute");
     }
 
-    // add string, double and handler to vector.
-    // vectors keep tracks of new attributes and let muparser use explicit variables
-    // it's possibile to use custom attributes in other filters
-    v_attrNames.push_back(name);
-    v_attrValue.push_back(0);
-    v_handlers.push_back(h);
-
     // if succeded log stream contains number of vertices processed and time elapsed
-    Log( "%d vertices processed in %.2f sec.", m.cm.vn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d vertices processed in %.2f sec.", m.cm.vn, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -807,7 +760,7 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
   case FF_DEF_FACE_ATTRIB :
   {
     std::string name = par.getString("name").toStdString();
-    std::string expr = par.getString("expr").toStdString();
+    std::vector<std::string> exprs(1,par.getString("expr").toStdString());
 
     // add per-face attribute with type float and name specified by user
     // add per-vertex attribute with type float and name specified by user
@@ -823,36 +776,27 @@ bool FilterFunctionPlugin::applyFilter(QAction *filter, MeshDocument &md, RichPa
     }
     else
       h = tri::Allocator<CMeshO>::AddPerFaceAttribute<float> (m.cm,name);
-    Parser p;
-    setPerFaceVariables(p,m.cm);
-    p.SetExpr(expr);
+    if(!initFunctions(m.cm,true,exprs,QStringList() << ""))
+      return false;
 
-    time_t start = clock();
+    QTime t; t.start();
 
     // every parser variables is related to face attributes.
-    CMeshO::FaceIterator fi;
-    for(fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)if(!(*fi).IsD())
+    const int faceNum = int(m.cm.face.size());
+    for(int bStart = 0; bStart < faceNum; bStart += FUNC_BATCH_SIZE)
     {
-      setAttributes(fi,m.cm);
+      const int bEnd = std::min(faceNum, bStart + FUNC_BATCH_SIZE);
+      if(!evalFunctions(m.cm,bStart,bEnd))
+        return false;
 
       // add new user-defined attribute
-      try {
-        h[fi] = p.Eval();
-      } catch(Parser::exception_type &e) {
-        errorMessage = e.GetMsg().c_str();
-        return false;
-      }
+      for(int i = bStart; i < bEnd; ++i) if(!m.cm.face[i].IsD())
+        h[i] = funcValue[0][i-bStart];
+      if(cb) cb(int(100.0*bEnd/faceNum),"Evaluating attribute");
     }
 
-    //				// add string, double and handler to vector.
-    //				// vectors keep tracks of new attributes and let muparser use explicit variables
-    //				// it's possibile to use custom attributes in other filters
-    //				f_attrNames.push_back(name);
-    //				f_attrValue.push_back(0);
-    //				fhandlers.push_back(h);
-
     // if succeded log stream contains number of vertices processed and time elapsed
-    Log( "%d faces processed in %.2f sec.", m.cm.fn, (clock() - start) / (float) CLOCKS_PER_SEC);
+    Log( "%d faces processed in %.2f sec.", m.cm.fn, t.elapsed() / 1000.0f);
 
     return true;
   }
@@ -1008,163 +952,142 @@ void FilterFunctionPlugin::showParserError(const QString &s, Parser::exception_t
 }
 
 // set per-vertex attributes associated to parser variables
-void FilterFunctionPlugin::setAttributes(CMeshO::VertexIterator &vi, CMeshO &m)
+void FilterFunctionPlugin::setAttributes(CMeshO::VertexIterator &vi, CMeshO &m, FuncVariables &var)
 {
-  x = (*vi).P()[0]; // coord x
-  y = (*vi).P()[1]; // coord y
-  z = (*vi).P()[2]; // coord z
+  var.x = (*vi).P()[0]; // coord x
+  var.y = (*vi).P()[1]; // coord y
+  var.z = (*vi).P()[2]; // coord z
 
-  nx = (*vi).N()[0]; // normal coord x
-  ny = (*vi).N()[1]; // normal coord y
-  nz = (*vi).N()[2]; // normal coord z
+  var.nx = (*vi).N()[0]; // normal coord x
+  var.ny = (*vi).N()[1]; // normal coord y
+  var.nz = (*vi).N()[2]; // normal coord z
 
-  r = (*vi).C()[0];  // color R
-  g = (*vi).C()[1];  // color G
-  b = (*vi).C()[2];  // color B
+  var.r = (*vi).C()[0];  // color R
+  var.g = (*vi).C()[1];  // color G
+  var.b = (*vi).C()[2];  // color B
 
-  q = (*vi).Q();     // quality
+  var.q = (*vi).Q();     // quality
 
-  if(tri::HasPerVertexRadius(m)) rad = (*vi).R();
-  else rad=0;
+  if(tri::HasPerVertexRadius(m)) var.rad = (*vi).R();
+  else var.rad=0;
 
-  v = vi - m.vert.begin(); // zero based index of current vertex
+  var.v = vi - m.vert.begin(); // zero based index of current vertex
 
   if(tri::HasPerVertexTexCoord(m))
   {
-    vtu=(*vi).T().U();
-    vtv=(*vi).T().V();
+    var.vtu=(*vi).T().U();
+    var.vtv=(*vi).T().V();
   }
-  else { vtu=vtv=0; }
+  else { var.vtu=var.vtv=0; }
 
   // if user-defined attributes exist (vector is not empty)
   //  set variables to explicit value obtained through attribute's handler
-  for(int i = 0; i < (int) v_attrValue.size(); i++)
-    v_attrValue[i] = v_handlers[i][vi];
+  for(int i = 0; i < (int) var.v_attrValue.size(); i++)
+    var.v_attrValue[i] = v_handlers[i][vi];
 
-  for(int i = 0; i < (int) v3_handlers.size(); i++)
+  for(int i = 0; i < (int) (var.v3_attrValue.size()/3); i++)
   {
-    v3_attrValue[i*3+0] = v3_handlers[i][vi].X();
-    v3_attrValue[i*3+1] = v3_handlers[i][vi].Y();
-    v3_attrValue[i*3+2] = v3_handlers[i][vi].Z();
+    var.v3_attrValue[i*3+0] = v3_handlers[i][vi].X();
+    var.v3_attrValue[i*3+1] = v3_handlers[i][vi].Y();
+    var.v3_attrValue[i*3+2] = v3_handlers[i][vi].Z();
   }
 }
 
 // set per-face attributes associated to parser variables
-void FilterFunctionPlugin::setAttributes(CMeshO::FaceIterator &fi, CMeshO &m)
+void FilterFunctionPlugin::setAttributes(CMeshO::FaceIterator &fi, CMeshO &m, FuncVariables &var)
 {
 	// set attributes for First vertex
 	// coords, normal coords, quality
-	x0 = (*fi).V(0)->P()[0];
-	y0 = (*fi).V(0)->P()[1];
-	z0 = (*fi).V(0)->P()[2];
+	var.x0 = (*fi).V(0)->P()[0];
+	var.y0 = (*fi).V(0)->P()[1];
+	var.z0 = (*fi).V(0)->P()[2];
 
-	nx0 = (*fi).V(0)->N()[0];
-	ny0 = (*fi).V(0)->N()[1];
-	nz0 = (*fi).V(0)->N()[2];
+	var.nx0 = (*fi).V(0)->N()[0];
+	var.ny0 = (*fi).V(0)->N()[1];
+	var.nz0 = (*fi).V(0)->N()[2];
 
-	r0 = (*fi).V(0)->C()[0];
-	g0 = (*fi).V(0)->C()[1];
-	b0 = (*fi).V(0)->C()[2];
+	var.r0 = (*fi).V(0)->C()[0];
+	var.g0 = (*fi).V(0)->C()[1];
+	var.b0 = (*fi).V(0)->C()[2];
 
-	q0 = (*fi).V(0)->Q();
-	q1 = (*fi).V(1)->Q();
-	q2 = (*fi).V(2)->Q();
+	var.q0 = (*fi).V(0)->Q();
+	var.q1 = (*fi).V(1)->Q();
+	var.q2 = (*fi).V(2)->Q();
 
 	// set attributes for Second vertex
 	// coords, normal coords, quality
-	x1 = (*fi).V(1)->P()[0];
-	y1 = (*fi).V(1)->P()[1];
-	z1 = (*fi).V(1)->P()[2];
+	var.x1 = (*fi).V(1)->P()[0];
+	var.y1 = (*fi).V(1)->P()[1];
+	var.z1 = (*fi).V(1)->P()[2];
 
-	nx1 = (*fi).V(1)->N()[0];
-	ny1 = (*fi).V(1)->N()[1];
-	nz1 = (*fi).V(1)->N()[2];
+	var.nx1 = (*fi).V(1)->N()[0];
+	var.ny1 = (*fi).V(1)->N()[1];
+	var.nz1 = (*fi).V(1)->N()[2];
 
-	r1 = (*fi).V(1)->C()[0];
-	g1 = (*fi).V(1)->C()[1];
-	b1 = (*fi).V(1)->C()[2];
+	var.r1 = (*fi).V(1)->C()[0];
+	var.g1 = (*fi).V(1)->C()[1];
+	var.b1 = (*fi).V(1)->C()[2];
 
 	// set attributes for Third vertex
 	// coords, normal coords, quality
-	x2 = (*fi).V(2)->P()[0];
-	y2 = (*fi).V(2)->P()[1];
-	z2 = (*fi).V(2)->P()[2];
+	var.x2 = (*fi).V(2)->P()[0];
+	var.y2 = (*fi).V(2)->P()[1];
+	var.z2 = (*fi).V(2)->P()[2];
 
-	nx2 = (*fi).V(2)->N()[0];
-	ny2 = (*fi).V(2)->N()[1];
-	nz2 = (*fi).V(2)->N()[2];
+	var.nx2 = (*fi).V(2)->N()[0];
+	var.ny2 = (*fi).V(2)->N()[1];
+	var.nz2 = (*fi).V(2)->N()[2];
 
-	r2 = (*fi).V(2)->C()[0];
-	g2 = (*fi).V(2)->C()[1];
-	b2 = (*fi).V(2)->C()[2];
+	var.r2 = (*fi).V(2)->C()[0];
+	var.g2 = (*fi).V(2)->C()[1];
+	var.b2 = (*fi).V(2)->C()[2];
 	
   if(HasPerFaceQuality(m))
-         fq=(*fi).Q();
-    else fq=0;
+         var.fq=(*fi).Q();
+    else var.fq=0;
 
 	// set face color attributes
 	if(HasPerFaceColor(m)){
-		r = (*fi).C()[0];
-		g = (*fi).C()[1];
-		b = (*fi).C()[2];
+		var.r = (*fi).C()[0];
+		var.g = (*fi).C()[1];
+		var.b = (*fi).C()[2];
 	} else {
-		r=g=b=255;
+		var.r=var.g=var.b=255;
 	}
 	
 	// zero based index of face
-	f = fi - m.face.begin();
+	var.f = fi - m.face.begin();
 
 	// zero based index of its vertices
-	v0i = ((*fi).V(0) - &m.vert[0]);
-	v1i = ((*fi).V(1) - &m.vert[0]);
-	v2i = ((*fi).V(2) - &m.vert[0]);
+	var.v0i = ((*fi).V(0) - &m.vert[0]);
+	var.v1i = ((*fi).V(1) - &m.vert[0]);
+	var.v2i = ((*fi).V(2) - &m.vert[0]);
 	
   if(tri::HasPerWedgeTexCoord(m))
   {
-    wtu0=(*fi).WT(0).U();
-    wtv0=(*fi).WT(0).V();
-    wtu1=(*fi).WT(1).U();
-    wtv1=(*fi).WT(1).V();
-    wtu2=(*fi).WT(2).U();
-    wtv2=(*fi).WT(2).V();
+    var.wtu0=(*fi).WT(0).U();
+    var.wtv0=(*fi).WT(0).V();
+    var.wtu1=(*fi).WT(1).U();
+    var.wtv1=(*fi).WT(1).V();
+    var.wtu2=(*fi).WT(2).U();
+    var.wtv2=(*fi).WT(2).V();
   }
-  else { wtu0=wtv0=wtu1=wtv1=wtu2=wtv2=0; }
+  else { var.wtu0=var.wtv0=var.wtu1=var.wtv1=var.wtu2=var.wtv2=0; }
 
 
 	// if user-defined attributes exist (vector is not empty) 
 	//  set variables to explicit value obtained through attribute's handler
-	for(int i = 0; i < (int) f_attrValue.size(); i++)
-    f_attrValue[i] = f_handlers[i][fi];
+	for(int i = 0; i < (int) var.f_attrValue.size(); i++)
+    var.f_attrValue[i] = f_handlers[i][fi];
 }
 
-// Function explicitely define parser variables to perform per-vertex filter action
-// x, y, z for vertex coord, nx, ny, nz for normal coord, r, g ,b for color
-// and q for quality 
-void FilterFunctionPlugin::setPerVertexVariables(Parser &p, CMeshO &m)
+// Collect the user-defined per-vertex attributes (if any exists): they are exposed as parser variables too.
+void FilterFunctionPlugin::initPerVertexVariables(CMeshO &m)
 {
-	p.DefineVar("x", &x);
-	p.DefineVar("y", &y);
-	p.DefineVar("z", &z);
-	p.DefineVar("nx", &nx);
-	p.DefineVar("ny", &ny);
-	p.DefineVar("nz", &nz);
-	p.DefineVar("r", &r);
-	p.DefineVar("g", &g);
-	p.DefineVar("b", &b);
-	p.DefineVar("q", &q);
-	p.DefineVar("vi",&v);
-	p.DefineVar("rad",&rad);
-  p.DefineVar("vtu",&vtu);
-  p.DefineVar("vtv",&vtv);
-
-	// define var for user-defined attributes (if any exists)
-	// if vector is empty, code won't be executed
   v_handlers.clear();
   v_attrNames.clear();
-  v_attrValue.clear();
   v3_handlers.clear();
   v3_attrNames.clear();
-  v3_attrValue.clear();
   std::vector<std::string> AllVertexAttribName;
   tri::Allocator<CMeshO>::GetAllPerVertexAttribute< float >(m,AllVertexAttribName);
   for(int i = 0; i < (int) AllVertexAttribName.size(); i++)
@@ -1172,8 +1095,6 @@ void FilterFunctionPlugin::setPerVertexVariables(Parser &p, CMeshO &m)
     CMeshO::PerVertexAttributeHandle<float> hh = tri::Allocator<CMeshO>::GetPerVertexAttribute<float>(m, AllVertexAttribName[i]);
     v_handlers.push_back(hh);
     v_attrNames.push_back(AllVertexAttribName[i]);
-    v_attrValue.push_back(0);
-    p.DefineVar(v_attrNames.back(), &v_attrValue.back());
     qDebug("Adding custom per vertex float variable %s",v_attrNames.back().c_str());
   }
   AllVertexAttribName.clear();
@@ -1183,106 +1104,245 @@ void FilterFunctionPlugin::setPerVertexVariables(Parser &p, CMeshO &m)
     CMeshO::PerVertexAttributeHandle<Point3f> hh3 = tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3f>(m, AllVertexAttribName[i]);
 
     v3_handlers.push_back(hh3);
-
-    v3_attrValue.push_back(0);
     v3_attrNames.push_back(AllVertexAttribName[i]+"_x");
-    p.DefineVar(v3_attrNames.back(), &v3_attrValue.back());
-
-    v3_attrValue.push_back(0);
     v3_attrNames.push_back(AllVertexAttribName[i]+"_y");
-    p.DefineVar(v3_attrNames.back(), &v3_attrValue.back());
-
-    v3_attrValue.push_back(0);
     v3_attrNames.push_back(AllVertexAttribName[i]+"_z");
-    p.DefineVar(v3_attrNames.back(), &v3_attrValue.back());
-    qDebug("Adding custom per vertex Point3f variable %s",v3_attrNames.back().c_str());
-   }
+    qDebug("Adding custom per vertex Point3f variable %s",AllVertexAttribName[i].c_str());
+  }
+}
+
+// Collect the user-defined per-face attributes (if any exists): they are exposed as parser variables too.
+void FilterFunctionPlugin::initPerFaceVariables(CMeshO &m)
+{
+  std::vector<std::string> AllFaceAttribName;
+  tri::Allocator<CMeshO>::GetAllPerFaceAttribute< float >(m,AllFaceAttribName);
+  f_handlers.clear();
+  f_attrNames.clear();
+  for(int i = 0; i < (int) AllFaceAttribName.size(); i++)
+  {
+    CMeshO::PerFaceAttributeHandle<float> hh = tri::Allocator<CMeshO>::GetPerFaceAttribute<float>(m, AllFaceAttribName[i]);
+    f_handlers.push_back(hh);
+    f_attrNames.push_back(AllFaceAttribName[i]);
+  }
+}
+
+// Function explicitely define parser variables to perform per-vertex filter action
+// x, y, z for vertex coord, nx, ny, nz for normal coord, r, g ,b for color
+// and q for quality. The variables are the ones of var; the user-defined attributes
+// are the ones collected by initPerVertexVariables.
+void FilterFunctionPlugin::setPerVertexVariables(Parser &p, FuncVariables &var)
+{
+	p.DefineVar("x", &var.x);
+	p.DefineVar("y", &var.y);
+	p.DefineVar("z", &var.z);
+	p.DefineVar("nx", &var.nx);
+	p.DefineVar("ny", &var.ny);
+	p.DefineVar("nz", &var.nz);
+	p.DefineVar("r", &var.r);
+	p.DefineVar("g", &var.g);
+	p.DefineVar("b", &var.b);
+	p.DefineVar("q", &var.q);
+	p.DefineVar("vi",&var.v);
+	p.DefineVar("rad",&var.rad);
+  p.DefineVar("vtu",&var.vtu);
+  p.DefineVar("vtv",&var.vtv);
+
+	// define var for user-defined attributes (if any exists)
+	// if vector is empty, code won't be executed
+  var.v_attrValue.resize(v_attrNames.size(),0);
+  var.v3_attrValue.resize(v3_attrNames.size(),0);
+  for(int i = 0; i < (int) v_attrNames.size(); i++)
+    p.DefineVar(v_attrNames[i], &var.v_attrValue[i]);
+  for(int i = 0; i < (int) v3_attrNames.size(); i++)
+    p.DefineVar(v3_attrNames[i], &var.v3_attrValue[i]);
 }
 
 
 // Function explicitely define parser variables to perform Per-Face filter action
-void FilterFunctionPlugin::setPerFaceVariables(Parser &p, CMeshO &m)
+void FilterFunctionPlugin::setPerFaceVariables(Parser &p, FuncVariables &var)
 {
 	// coord of the three vertices within a face
-	p.DefineVar("x0", &x0);
-	p.DefineVar("y0", &y0);
-	p.DefineVar("z0", &z0);
-	p.DefineVar("x1", &x1);
-	p.DefineVar("y1", &y1);
-	p.DefineVar("z1", &z1);
-	p.DefineVar("x2", &x2);
-	p.DefineVar("y2", &y2);
-	p.DefineVar("z2", &z2);
+	p.DefineVar("x0", &var.x0);
+	p.DefineVar("y0", &var.y0);
+	p.DefineVar("z0", &var.z0);
+	p.DefineVar("x1", &var.x1);
+	p.DefineVar("y1", &var.y1);
+	p.DefineVar("z1", &var.z1);
+	p.DefineVar("x2", &var.x2);
+	p.DefineVar("y2", &var.y2);
+	p.DefineVar("z2", &var.z2);
 
 	// attributes of the vertices
 	// normals:
-	p.DefineVar("nx0", &nx0);
-	p.DefineVar("ny0", &ny0);
-	p.DefineVar("nz0", &nz0);
+	p.DefineVar("nx0", &var.nx0);
+	p.DefineVar("ny0", &var.ny0);
+	p.DefineVar("nz0", &var.nz0);
 		
-	p.DefineVar("nx1", &nx1);
-	p.DefineVar("ny1", &ny1);
-	p.DefineVar("nz1", &nz1);
+	p.DefineVar("nx1", &var.nx1);
+	p.DefineVar("ny1", &var.ny1);
+	p.DefineVar("nz1", &var.nz1);
 
-	p.DefineVar("nx2", &nx2);
-	p.DefineVar("ny2", &ny2);
-	p.DefineVar("nz2", &nz2);
+	p.DefineVar("nx2", &var.nx2);
+	p.DefineVar("ny2", &var.ny2);
+	p.DefineVar("nz2", &var.nz2);
 
 	// colors:
-	p.DefineVar("r0", &r0);
-	p.DefineVar("g0", &g0);
-	p.DefineVar("b0", &b0);
+	p.DefineVar("r0", &var.r0);
+	p.DefineVar("g0", &var.g0);
+	p.DefineVar("b0", &var.b0);
 
-	p.DefineVar("r1", &r1);
-	p.DefineVar("g1", &g1);
-	p.DefineVar("b1", &b1);
+	p.DefineVar("r1", &var.r1);
+	p.DefineVar("g1", &var.g1);
+	p.DefineVar("b1", &var.b1);
 	
-	p.DefineVar("r2", &r2);
-	p.DefineVar("g2", &g2);
-	p.DefineVar("b2", &b2);
+	p.DefineVar("r2", &var.r2);
+	p.DefineVar("g2", &var.g2);
+	p.DefineVar("b2", &var.b2);
 
 	// quality
-	p.DefineVar("q0", &q0);
-	p.DefineVar("q1", &q1);
-	p.DefineVar("q2", &q2);
+	p.DefineVar("q0", &var.q0);
+	p.DefineVar("q1", &var.q1);
+	p.DefineVar("q2", &var.q2);
 
 	// face color
-	p.DefineVar("r", &r);
-	p.DefineVar("g", &g);
-	p.DefineVar("b", &b);
+	p.DefineVar("r", &var.r);
+	p.DefineVar("g", &var.g);
+	p.DefineVar("b", &var.b);
 
   // face quality
-  p.DefineVar("q", &fq);
+  p.DefineVar("q", &var.fq);
 
 	// index
-	p.DefineVar("fi",&f);
-	p.DefineVar("vi0",&v0i);
-	p.DefineVar("vi1",&v1i);
-	p.DefineVar("vi2",&v2i);
-
-  p.DefineVar("wtu0",&wtu0);
-  p.DefineVar("wtv0",&wtv0);
-  p.DefineVar("wtu1",&wtu1);
-  p.DefineVar("wtv1",&wtv1);
-  p.DefineVar("wtu2",&wtu2);
-  p.DefineVar("wtv2",&wtv2);
+	p.DefineVar("fi",&var.f);
+	p.DefineVar("vi0",&var.v0i);
+	p.DefineVar("vi1",&var.v1i);
+	p.DefineVar("vi2",&var.v2i);
+
+  p.DefineVar("wtu0",&var.wtu0);
+  p.DefineVar("wtv0",&var.wtv0);
+  p.DefineVar("wtu1",&var.wtu1);
+  p.DefineVar("wtv1",&var.wtv1);
+  p.DefineVar("wtu2",&var.wtu2);
+  p.DefineVar("wtv2",&var.wtv2);
 
 	// define var for user-defined attributes (if any exists)
 	// if vector is empty, code won't be executed
-  std::vector<std::string> AllFaceAttribName;
-  tri::Allocator<CMeshO>::GetAllPerFaceAttribute< float >(m,AllFaceAttribName);
-  f_handlers.clear();
-  f_attrNames.clear();
-  f_attrValue.clear();
-  for(int i = 0; i < (int) AllFaceAttribName.size(); i++)
+  var.f_attrValue.resize(f_attrNames.size(),0);
+  for(int i = 0; i < (int) f_attrNames.size(); i++)
+    p.DefineVar(f_attrNames[i], &var.f_attrValue[i]);
+}
+
+// Prepare the evaluation of the functions exprs over the vertices (or the faces) of m.
+// A parser is built and compiled for every function, then every thread gets a clone of it
+// rebound to the variables of the thread, so that evalFunctions can split the elements
+// among the threads without rebinding anything per element.
+// The syntax of the functions is checked here, on the first element: the errors of each
+// function are reported in errorMessage prefixed by its label.
+bool FilterFunctionPlugin::initFunctions(CMeshO &m, bool perFace, const std::vector<std::string> &exprs, const QStringList &labels)
+{
+  assert(int(exprs.size()) == labels.size());
+  funcPerFace = perFace;
+  if(perFace) initPerFaceVariables(m);
+  else initPerVertexVariables(m);
+
+  int threadNum = 1;
+#ifdef _OPENMP
+  threadNum = omp_get_max_threads();
+#endif
+  threadVar.clear();
+  threadVar.resize(threadNum);
+  // the user-defined attribute values are filled by setAttributes before the variables are bound
+  for(int t = 0; t < threadNum; ++t)
   {
-    CMeshO::PerFaceAttributeHandle<float> hh = tri::Allocator<CMeshO>::GetPerFaceAttribute<float>(m, AllFaceAttribName[i]);
-    f_handlers.push_back(hh);
-    f_attrNames.push_back(AllFaceAttribName[i]);
-    f_attrValue.push_back(0);
-    p.DefineVar(f_attrNames.back(), &f_attrValue.back());
+    threadVar[t].v_attrValue.resize(v_attrNames.size(),0);
+    threadVar[t].v3_attrValue.resize(v3_attrNames.size(),0);
+    threadVar[t].f_attrValue.resize(f_attrNames.size(),0);
+  }
+  threadParser.clear();
+  threadParser.resize(threadNum, std::vector<Parser>(exprs.size()));
+  funcValue.clear();
+  funcValue.resize(exprs.size());
+
+  // the first element (if any) the functions are checked on
+  int first = 0;
+  const int elemNum = perFace ? int(m.face.size()) : int(m.vert.size());
+  while(first < elemNum && (perFace ? m.face[first].IsD() : m.vert[first].IsD()))
+    ++first;
+  if(first < elemNum)
+  {
+    if(perFace) { CMeshO::FaceIterator fi = m.face.begin() + first; setAttributes(fi,m,threadVar[0]); }
+    else { CMeshO::VertexIterator vi = m.vert.begin() + first; setAttributes(vi,m,threadVar[0]); }
+  }
+
+  errorMessage = "";
+  for(size_t k = 0; k < exprs.size(); ++k)
+  {
+    Parser &p = threadParser[0][k];
+    if(perFace) setPerFaceVariables(p,threadVar[0]);
+    else setPerVertexVariables(p,threadVar[0]);
+    try {
+      p.SetExpr(exprs[k]);
+      if(first < elemNum) p.Eval();
+    } catch(Parser::exception_type &e) {
+      showParserError(labels[k],e);
+    }
   }
+  if(errorMessage != "") return false;
 
+  for(int t = 1; t < threadNum; ++t)
+    for(size_t k = 0; k < exprs.size(); ++k)
+    {
+      threadParser[t][k] = threadParser[0][k];
+      if(perFace) setPerFaceVariables(threadParser[t][k],threadVar[t]);
+      else setPerVertexVariables(threadParser[t][k],threadVar[t]);
+    }
+  return true;
+}
+
+// Evaluate the functions prepared by initFunctions over the elements [start,end) of the
+// vertex (or face) vector; the deleted elements are skipped. The elements are split among
+// the threads and funcValue[k][i-start] gets the value of the k-th function on the i-th element.
+bool FilterFunctionPlugin::evalFunctions(CMeshO &m, int start, int end)
+{
+  const int funcNum = int(funcValue.size());
+  for(int k = 0; k < funcNum; ++k)
+    funcValue[k].resize(end-start);
+
+  std::string msg;
+  #pragma omp parallel for schedule(dynamic,1024)
+  for(int i = start; i < end; ++i)
+  {
+    int t = 0;
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    FuncVariables &var = threadVar[t];
+    if(funcPerFace)
+    {
+      CMeshO::FaceIterator fi = m.face.begin() + i;
+      if((*fi).IsD()) continue;
+      setAttributes(fi,m,var);
+    }
+    else
+    {
+      CMeshO::VertexIterator vi = m.vert.begin() + i;
+      if((*vi).IsD()) continue;
+      setAttributes(vi,m,var);
+    }
+    try {
+      for(int k = 0; k < funcNum; ++k)
+        funcValue[k][i-start] = threadParser[t][k].Eval();
+    } catch(Parser::exception_type &e) {
+      #pragma omp critical (funcError)
+      msg = e.GetMsg();
+    }
+  }
+  if(!msg.empty())
+  {
+    errorMessage = msg.c_str();
+    return false;
+  }
+  return true;
 }
 
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterFunctionPlugin)
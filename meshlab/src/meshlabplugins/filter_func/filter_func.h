@@ -31,6 +31,18 @@
 #include "muParser.h"
 #include "filter_refine.h"
 
+// The values of the parser variables for the element being evaluated.
+// Every thread evaluating the functions has its own set, and its own parsers bound to it.
+struct FuncVariables
+{
+  double x,y,z,nx,ny,nz,r,g,b,q,fq,rad,vtu,vtv;
+  double x0,y0,z0,x1,y1,z1,x2,y2,z2,nx0,ny0,nz0,nx1,ny1,nz1,nx2,ny2,nz2,r0,g0,b0,r1,g1,b1,r2,g2,b2,q0,q1,q2,wtu0,wtv0,wtu1,wtv1,wtu2,wtv2;
+  double v,f,v0i,v1i,v2i;
+  std::vector<double> v_attrValue;   // values of the <float> per vertex attributes
+  std::vector<double> v3_attrValue;  // values of the <Point3f> per vertex attributes. There are 3x (one foreach coord _x, _y, _z)
+  std::vector<double> f_attrValue;
+};
+
 class FilterFunctionPlugin : public QObject, public MeshFilterInterface
 {
 	Q_OBJECT
@@ -38,19 +50,21 @@ class FilterFunctionPlugin : public QObject, public MeshFilterInterface
 	Q_INTERFACES(MeshFilterInterface)
 
 protected:
-  double x,y,z,nx,ny,nz,r,g,b,q,fq,rad,vtu,vtv;
-  double x0,y0,z0,x1,y1,z1,x2,y2,z2,nx0,ny0,nz0,nx1,ny1,nz1,nx2,ny2,nz2,r0,g0,b0,r1,g1,b1,r2,g2,b2,q0,q1,q2,wtu0,wtv0,wtu1,wtv1,wtu2,wtv2;
-	double v,f,v0i,v1i,v2i;
   std::vector<std::string> v_attrNames;  // names of the <float> per vertex attributes
-  std::vector<double>      v_attrValue;  // values of the <float> per vertex attributes
   std::vector<std::string> v3_attrNames;  // names of the <Point3f> per vertex attributes There are 3x (one foreach coord _x, _y, _z)
-  std::vector<double>      v3_attrValue;  // values of the <Point3f> per vertex attributes. There are 3x (one foreach coord _x, _y, _z)
   std::vector<std::string> f_attrNames;
-	std::vector<double> f_attrValue;
   std::vector<CMeshO::PerVertexAttributeHandle<float> > v_handlers;
   std::vector<CMeshO::PerVertexAttributeHandle<Point3f> > v3_handlers;
   std::vector<CMeshO::PerFaceAttributeHandle<float> > f_handlers;
 
+  // The functions evaluated by evalFunctions (see initFunctions): one parser per function and per thread,
+  // each one bound to the variables of its thread. funcValue[k][i] is the value of the k-th function
+  // on the i-th element of the last evaluated batch.
+  bool funcPerFace;
+  std::vector<FuncVariables> threadVar;
+  std::vector<std::vector<mu::Parser> > threadParser;
+  std::vector<std::vector<double> > funcValue;
+
 public:
 	enum {
 	  FF_VERT_SELECTION,
@@ -82,10 +96,15 @@ public:
   virtual bool applyFilter(QAction *filter, MeshDocument &md, RichParameterSet & /*parent*/, vcg::CallBackPos * cb) ;
 
 	void showParserError(const QString &s, mu::Parser::exception_type &e);
-  void setAttributes(CMeshO::VertexIterator &vi,CMeshO &m);
-	void setAttributes(CMeshO::FaceIterator &fi,CMeshO &m);
-  void setPerVertexVariables(mu::Parser &p, CMeshO &m);
-  void setPerFaceVariables(mu::Parser &p, CMeshO &m);
+  void setAttributes(CMeshO::VertexIterator &vi,CMeshO &m,FuncVariables &var);
+	void setAttributes(CMeshO::FaceIterator &fi,CMeshO &m,FuncVariables &var);
+  void initPerVertexVariables(CMeshO &m);
+  void initPerFaceVariables(CMeshO &m);
+  void setPerVertexVariables(mu::Parser &p, FuncVariables &var);
+  void setPerFaceVariables(mu::Parser &p, FuncVariables &var);
+
+  bool initFunctions(CMeshO &m, bool perFace, const std::vector<std::string> &exprs, const QStringList &labels);
+  bool evalFunctions(CMeshO &m, int start, int end);
 
 };
 
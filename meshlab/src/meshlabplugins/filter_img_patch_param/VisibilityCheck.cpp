@@ -39,6 +39,8 @@ VisibilityCheck* VisibilityCheck::GetInstance( glw::Context &ctx )
             s_Instance = new VisibilityCheck_ShadowMap( ctx );
         else if( VisibilityCheck_VMV2002::isSupported() )
             s_Instance = new VisibilityCheck_VMV2002( ctx );
+        else
+            s_Instance = new VisibilityCheck_RayCast( ctx );
     }
 
     return s_Instance;
@@ -573,3 +575,58 @@ void VisibilityCheck_ShadowMap::checkVisibility()
 
     m_Context.unbindReadDrawFramebuffer();
 }
+
+
+
+
+void VisibilityCheck_RayCast::setMesh( CMeshO *mesh )
+{
+    if( mesh && mesh!=m_Mesh )
+    {
+        m_Mesh = mesh;
+        m_BVH.Set( *m_Mesh );
+    }
+}
+
+
+void VisibilityCheck_RayCast::checkVisibility()
+{
+    const vcg::Point3f viewPoint = m_Raster->shot.GetViewPoint();
+    const vcg::Point2i &vp = m_Raster->shot.Intrinsics.ViewportPx;
+
+    // The ray origins are moved a bit toward the viewpoint, to skip the faces incident to the vertex.
+    const float epsilon = m_Mesh->bbox.Diag() * 1e-4f;
+
+    std::vector<int> candidates;
+    std::vector<vcg::Ray3f> rays;
+    std::vector<float> maxDist;
+
+    m_VertFlag.resize( m_Mesh->vn );
+    for( int v=0; v<m_Mesh->vn; ++v )
+    {
+        const CVertexO &vert = m_Mesh->vert[v];
+        m_VertFlag[v] = (viewPoint-vert.P()) * vert.N() > 0.0f? V_UNDEFINED : V_BACKFACE;
+        if( m_VertFlag[v] == V_BACKFACE )
+            continue;
+
+        // Only the vertices projecting inside the raster can be visible.
+        vcg::Point2f pp = m_Raster->shot.Project( vert.P() );
+        if( m_Raster->shot.Depth(vert.P()) <= 0.0f ||
+            pp.X() < 0.0f || pp.Y() < 0.0f || pp.X() >= vp.X() || pp.Y() >= vp.Y() )
+            continue;
+
+        vcg::Point3f dir = viewPoint - vert.P();
+        float dist = dir.Norm();
+        dir /= dist;
+        candidates.push_back( v );
+        rays.push_back( vcg::Ray3f(vert.P()+dir*epsilon,dir) );
+        maxDist.push_back( std::max(dist-2.0f*epsilon,0.0f) );
+    }
+
+    std::vector<char> occluded;
+    m_BVH.AnyHit( rays, maxDist, occluded );
+
+    for( size_t i=0; i<candidates.size(); ++i )
+        if( !occluded[i] )
+            m_VertFlag[candidates[i]] = V_VISIBLE;
+}
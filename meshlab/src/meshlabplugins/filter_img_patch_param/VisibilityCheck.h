@@ -29,6 +29,7 @@
 
 #include <common/meshmodel.h>
 #include <wrap/glw/glw.h>
+#include <vcg/space/index/ray_bvh.h>
 
 #define USE_VBO
 
@@ -140,6 +141,25 @@ public:
 };
 
 
+// Fallback used when the OpenGL methods are not supported: a vertex is visible if the
+// segment joining it to the raster viewpoint does not hit the mesh (rays cast on the CPU).
+class VisibilityCheck_RayCast : public VisibilityCheck
+{
+    friend class VisibilityCheck;
+
+private:
+    vcg::RayBVH<CMeshO>     m_BVH;
+
+    inline      VisibilityCheck_RayCast( glw::Context &ctx ) : VisibilityCheck(ctx) {}
+    inline      ~VisibilityCheck_RayCast()                                          {}
+
+public:
+    void        setMesh( CMeshO *mesh );
+    void        setRaster( RasterModel *rm )                                        { m_Raster = rm; }
+    void        checkVisibility();
+};
+
+
 
 
 #endif // FILTER_IMG_PATCH_PARAM_PLUGIN__VISIBILITYCHECK_H
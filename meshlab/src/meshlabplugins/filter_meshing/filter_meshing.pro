@@ -7,7 +7,7 @@ HEADERS       += $$VCGDIR/vcg/complex/algorithms/clean.h\
 
 SOURCES       += meshfilter.cpp \
 		quadric_simp.cpp \ 
-        quadric_tex_simp.cpp
+        quadric_tex_simp.cpp \
+		$$VCGDIR/wrap/ply/plylib.cpp
 
 TARGET        = filter_meshing
-
@@ -29,6 +29,8 @@
 #include <vcg/complex/algorithms/bitquad_support.h>
 #include <vcg/complex/algorithms/bitquad_creation.h>
 #include <vcg/complex/algorithms/clustering.h>
+#include <wrap/io_trimesh/ply_block_source.h>
+#include <wrap/io_trimesh/import_stl.h>
 #include <vcg/complex/algorithms/attribute_seam.h>
 #include <vcg/complex/algorithms/update/curvature.h>
 #include <vcg/complex/algorithms/update/curvature_fitting.h>
@@ -53,6 +55,7 @@ ExtraMeshFilterPlugin::ExtraMeshFilterPlugin(void)
 		<< FP_SELECT_FACES_BY_AREA
 		<< FP_SELECT_FACES_BY_EDGE
 		<< FP_CLUSTERING
+		<< FP_CLUSTERING_FILE
 		<< FP_QUADRIC_SIMPLIFICATION
 		<< FP_QUADRIC_TEXCOORD_SIMPLIFICATION
 		<< FP_MIDPOINT
@@ -144,6 +147,7 @@ ExtraMeshFilterPlugin::FilterClass ExtraMeshFilterPlugin::getClass(QAction * a)
 	case FP_SLICE_WITH_A_PLANE                  : return  MeshFilterInterface::Measure;
 
 	case FP_CYLINDER_UNWRAP                  : return MeshFilterInterface::Smoothing;
+	case FP_CLUSTERING_FILE                  : return MeshFilterInterface::MeshCreation;
 
 	default                                  : assert(0); return MeshFilterInterface::Generic;
 	}
@@ -181,6 +185,7 @@ int ExtraMeshFilterPlugin::getPreCondition(QAction *filter) const
 
 	case FP_NORMAL_SMOOTH_POINTCLOUD         : return MeshModel::MM_VERTNORMAL;
 	case FP_CLUSTERING                       :
+	case FP_CLUSTERING_FILE                  :
 	case FP_SCALE                            :
 	case FP_CENTER                           :
 	case FP_ROTATE                           :
@@ -209,6 +214,7 @@ QString ExtraMeshFilterPlugin::filterName(FilterIDType filter) const
 	case FP_QUADRIC_SIMPLIFICATION           : return tr("Quadric Edge Collapse Decimation");
 	case FP_QUADRIC_TEXCOORD_SIMPLIFICATION  : return tr("Quadric Edge Collapse Decimation (with texture)");
 	case FP_CLUSTERING                       : return tr("Clustering decimation");
+	case FP_CLUSTERING_FILE                  : return tr("Clustering decimation of a file (out of core)");
 	case FP_REORIENT                         : return tr("Re-Orient all faces coherentely");
 	case FP_INVERT_FACES                     : return tr("Invert Faces Orientation");
 	case FP_SCALE                            : return tr("Transform: Scale");
@@ -269,6 +275,12 @@ QString ExtraMeshFilterPlugin::filterInfo(FilterIDType filterID) const
 	case FP_SELECT_FACES_BY_AREA             : return tr("Remove null faces (the one with area equal to zero)");
 	case FP_SELECT_FACES_BY_EDGE             : return tr("Select all triangles having an edge with lenght greater or equal than a given threshold");
 	case FP_CLUSTERING                       : return tr("Collapse vertices by creating a three dimensional grid enveloping the mesh and discretizes them based on the cells of this grid");
+	case FP_CLUSTERING_FILE                  : return tr("Create a new layer with the clustering decimation of a ply or stl file, without loading the file in memory: "
+												   "its triangles are read in chunks and only the occupied cells of the grid and the resulting triangles are kept, "
+												   "so the memory needed depends on the size of the result and not on the size of the file. "
+												   "Useful (e.g. in a meshlabserver script) to build quick previews of scans too large to be loaded.<br>"
+												   "Binary ply files with only triangles are memory mapped and binary stl files are streamed; "
+												   "any other ply or stl file is loaded and then clustered.");
 	case FP_QUADRIC_SIMPLIFICATION           : return tr("Simplify a mesh using a Quadric based Edge Collapse Strategy, better than clustering but slower");
 	case FP_QUADRIC_TEXCOORD_SIMPLIFICATION  : return tr("Simplify a textured mesh using a Quadric based Edge Collapse Strategy, better than clustering but slower");
 	case FP_REORIENT                         : return tr("Re-orient in a consistent way all the faces of the mesh. <br>"
@@ -348,6 +360,8 @@ void ExtraMeshFilterPlugin::initParameterSet(QAction * action, MeshModel & m, Ri
 		parlst.addParam(new RichBool ("QualityWeight",lastq_QualityWeight,"Weighted Simplification","Use the Per-Vertex quality as a weighting factor for the simplification. The weight is used as a error amplification value, so a vertex with a high quality value will not be simplified and a portion of the mesh with low quality values will be aggressively simplified."));
 		parlst.addParam(new RichBool ("AutoClean",true,"Post-simplification cleaning","After the simplification an additional set of steps is performed to clean the mesh (unreferenced vertices, bad faces, etc)"));
 		parlst.addParam(new RichBool ("Selected",m.cm.sfn>0,"Simplify only selected faces","The simplification is applied only to the selected set of faces.\n Take care of the target number of faces!"));
+		parlst.addParam(new RichInt  ("BlockFaceNum",0,"Block size (faces)","If greater than zero the mesh is split in blocks of about this number of faces that are simplified independently (and in parallel) keeping their seams, then a second pass on shifted blocks simplifies the seams.<br>It bounds the memory needed by the simplification of huge meshes, at the cost of a slightly less uniform result. Zero means that the whole mesh is simplified at once. It is ignored when simplifying only the selected faces."));
+		parlst.addParam(new RichBool ("Parallel",false,"Parallel simplification","If true at each step many edges with the lowest costs and far enough from each other are collapsed in parallel. It pays off on large meshes with many cores; the result does not depend on the number of cores, but it is slightly different from the one of the standard sequential simplification."));
 		break;
 
 	case FP_QUADRIC_TEXCOORD_SIMPLIFICATION:
@@ -393,6 +407,13 @@ void ExtraMeshFilterPlugin::initParameterSet(QAction * action, MeshModel & m, Ri
 		parlst.addParam(new RichBool ("Selected",m.cm.sfn>0,"Affect only selected faces","If selected the filter affect only the selected faces"));
 		break;
 
+	case FP_CLUSTERING_FILE:
+		parlst.addParam(new RichOpenFile("FileName","",QStringList()<<"*.ply"<<"*.stl","Input File","The ply or stl file to be simplified. It is never entirely loaded when it is a binary stl or a binary ply with only triangles."));
+		parlst.addParam(new RichInt  ("CellNum",1000000,"Approximate number of cells", "The approximate number of cells of the clustering grid enveloping the whole mesh (e.g. 1000000 means a grid of about 100x100x100 cells). It is used only when the cell size is zero."));
+		parlst.addParam(new RichFloat("CellSize",0,"Cell Size", "The absolute size of the cells of the clustering grid; if zero the size is given by the number of cells. Smaller the cell finer the resulting mesh."));
+		parlst.addParam(new RichBool ("DuplicateFace",false,"Keep opposite faces","If true, where two opposite surfaces (e.g. a thin shell) are clustered into the same cells two faces with opposite orientation are kept (the result looks right with backface culling); otherwise a single face, oriented according to the averaged normals, is kept."));
+		break;
+
 	case FP_CYLINDER_UNWRAP:
 		parlst.addParam(new RichFloat("startAngle", 0,"Start angle (deg)", "The starting angle of the unrolling process."));
 		parlst.addParam(new RichFloat("endAngle",360,"End angle (deg)","The ending angle of the unrolling process. Quality threshold for penalizing bad shaped faces.<br>The value is in the range [0..1]\n 0 accept any kind of face (no penalties),\n 0.5  penalize faces with quality < 0.5, proportionally to their shape\n"));
@@ -554,6 +575,72 @@ void ExtraMeshFilterPlugin::initParameterSet(QAction * action, MeshModel & m, Ri
 	}
 }
 
+// Accumulates the bounding box of the triangles read by ImporterSTL::ReadBinaryTriangles
+struct TriangleBoxSink
+{
+	Box3f bbox;
+	void AddTriangles(const Point3f *p, int triNum) { for(int i=0;i<3*triNum;++i) bbox.Add(p[i]); }
+};
+
+// Cluster the triangles of a ply or stl file: the bounding box of the grid is computed with a first pass on the file.
+// Binary ply files with only triangles are memory mapped and binary stl files are streamed,
+// the other ones are loaded in a temporary mesh. On failure the reason is returned in errorMsg.
+static bool ClusteringFile(tri::ClusteringStream<CMeshO> &ClusteringGrid, QString fileName, int cellNum, float cellSize, vcg::CallBackPos *cb, QString &errorMsg)
+{
+	QString ext = QFileInfo(fileName).suffix().toLower();
+	if(ext=="ply")
+	{
+		tri::io::PlyBlockSource<CMeshO> plySrc;
+		if(plySrc.Open(qPrintable(fileName)))
+		{
+			ClusteringGrid.Init(tri::ClusteringStream<CMeshO>::SourceBox(plySrc),cellNum,cellSize);
+			ClusteringGrid.AddSource(plySrc,cb);
+			return true;
+		}
+	}
+	if(ext=="stl" && tri::io::ImporterSTL<CMeshO>::IsSTLBinary(qPrintable(fileName)))
+	{
+		TriangleBoxSink boxSink;
+		int err=tri::io::ImporterSTL<CMeshO>::ReadBinaryTriangles(qPrintable(fileName),boxSink);
+		if(err==0)
+		{
+			ClusteringGrid.Init(boxSink.bbox,cellNum,cellSize);
+			err=tri::io::ImporterSTL<CMeshO>::ReadBinaryTriangles(qPrintable(fileName),ClusteringGrid,cb);
+		}
+		if(err!=0) errorMsg=tri::io::ImporterSTL<CMeshO>::ErrorMsg(err);
+		return err==0;
+	}
+
+	if(ext!="ply" && ext!="stl")
+	{
+		errorMsg="only ply and stl files are supported";
+		return false;
+	}
+	CMeshO tmp;
+	if(ext=="ply")
+	{
+		int err=tri::io::ImporterPLY<CMeshO>::Open(tmp,qPrintable(fileName),cb);
+		if(tri::io::ImporterPLY<CMeshO>::ErrorCritical(err))
+		{
+			errorMsg=tri::io::ImporterPLY<CMeshO>::ErrorMsg(err);
+			return false;
+		}
+	}
+	if(ext=="stl")
+	{
+		int err=tri::io::ImporterSTL<CMeshO>::OpenAscii(tmp,qPrintable(fileName),cb);
+		if(err!=0)
+		{
+			errorMsg=tri::io::ImporterSTL<CMeshO>::ErrorMsg(err);
+			return false;
+		}
+	}
+	tri::UpdateBounding<CMeshO>::Box(tmp);
+	ClusteringGrid.Init(tmp.bbox,cellNum,cellSize);
+	ClusteringGrid.AddMesh(tmp);
+	return true;
+}
+
 bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, RichParameterSet & par, vcg::CallBackPos * cb)
 {
   MeshModel & m = *md.mm();
@@ -694,6 +781,23 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
 			m.clearDataMask(MeshModel::MM_FACEFACETOPO);
 		} break;
 
+	case FP_CLUSTERING_FILE:
+		{
+			QString fileName = par.getOpenFileName("FileName");
+			tri::ClusteringStream<CMeshO> ClusteringGrid;
+			ClusteringGrid.DuplicateFaceParam = par.getBool("DuplicateFace");
+			QString readError;
+			if(!ClusteringFile(ClusteringGrid,fileName,par.getInt("CellNum"),par.getFloat("CellSize"),cb,readError))
+			{
+				errorMessage = QString("Cannot read the triangles of %1: %2").arg(fileName).arg(readError);
+				return false;
+			}
+			MeshModel *mm=md.addNewMesh("",QFileInfo(fileName).completeBaseName()+" (clustered)");
+			ClusteringGrid.ExtractMesh(mm->cm);
+			mm->UpdateBoxAndNormals();
+			Log("Clustered %s in %i vertices and %i faces",qPrintable(QFileInfo(fileName).fileName()),mm->cm.vn,mm->cm.fn);
+		} break;
+
 	case FP_INVERT_FACES:
 		{
 			bool flipped=par.getBool("forceFlip");
@@ -745,7 +849,11 @@ bool ExtraMeshFilterPlugin::applyFilter(QAction * filter, MeshDocument & md, Ric
 			pp.QualityQuadric=lastq_PlanarQuadric = par.getBool("PlanarQuadric");
 			lastq_Selected = par.getBool("Selected");
 
-			QuadricSimplification(m.cm,TargetFaceNum,lastq_Selected,pp,  cb);
+			int BlockFaceNum = par.getInt("BlockFaceNum");
+			if(BlockFaceNum>0 && !lastq_Selected)
+				BlockQuadricSimplification(m.cm,TargetFaceNum,BlockFaceNum,pp,  cb);
+			else
+				QuadricSimplification(m.cm,TargetFaceNum,lastq_Selected,pp,  cb, par.getBool("Parallel"));
 
 			if(par.getBool("AutoClean"))
 			{
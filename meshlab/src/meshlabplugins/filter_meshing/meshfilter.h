@@ -47,6 +47,7 @@ public:
      FP_SELECT_FACES_BY_AREA,
      FP_SELECT_FACES_BY_EDGE,
      FP_CLUSTERING,
+     FP_CLUSTERING_FILE,
      FP_QUADRIC_SIMPLIFICATION,
      FP_QUADRIC_TEXCOORD_SIMPLIFICATION,
      FP_NORMAL_EXTRAPOLATION,
@@ -21,11 +21,12 @@
  ****************************************************************************/
 #include "meshfilter.h"
 #include "quadric_simp.h"
+#include <vcg/complex/algorithms/local_optimization/tri_edge_collapse_quadric_block.h>
 
 using namespace vcg;
 using namespace std;
 
-void QuadricSimplification(CMeshO &m,int  TargetFaceNum, bool Selected, tri::TriEdgeCollapseQuadricParameter &pp, CallBackPos *cb)
+void QuadricSimplification(CMeshO &m,int  TargetFaceNum, bool Selected, tri::TriEdgeCollapseQuadricParameter &pp, CallBackPos *cb, bool Parallel)
 {
   math::Quadric<double> QZero;
   QZero.SetZero();
@@ -66,7 +67,7 @@ void QuadricSimplification(CMeshO &m,int  TargetFaceNum, bool Selected, tri::Tri
 //  if(TargetError< numeric_limits<double>::max() ) DeciSession.SetTargetMetric(TargetError);
   //int startFn=m.fn;
   int faceToDel=m.fn-TargetFaceNum;
- while( DeciSession.DoOptimization() && m.fn>TargetFaceNum )
+ while( (Parallel ? DeciSession.DoOptimizationParallel<tri::MyTriEdgeCollapse>() : DeciSession.DoOptimization()) && m.fn>TargetFaceNum )
  {
    cb(100-100*(m.fn-TargetFaceNum)/(faceToDel), "Simplifying...");
  };
@@ -80,3 +81,39 @@ void QuadricSimplification(CMeshO &m,int  TargetFaceNum, bool Selected, tri::Tri
       if(!(*vi).IsD()) (*vi).SetW();
   }
 }
+
+// The result must have the same optional components of the simplified mesh.
+class CMeshOBlockSource : public tri::MeshBlockSource<CMeshO>
+{
+public:
+  CMeshOBlockSource(CMeshO &_m):tri::MeshBlockSource<CMeshO>(_m){}
+  template <class BlockMeshType> void InitBlock(BlockMeshType &bm) const
+  {
+    if(m.vert.IsTexCoordEnabled())     bm.vert.EnableTexCoord();
+    if(m.vert.IsCurvatureEnabled())    bm.vert.EnableCurvature();
+    if(m.vert.IsCurvatureDirEnabled()) bm.vert.EnableCurvatureDir();
+    if(m.vert.IsRadiusEnabled())       bm.vert.EnableRadius();
+    if(m.face.IsQualityEnabled())      bm.face.EnableQuality();
+    if(m.face.IsColorEnabled())        bm.face.EnableColor();
+    if(m.face.IsWedgeTexCoordEnabled()) bm.face.EnableWedgeTexCoord();
+  }
+};
+
+void BlockQuadricSimplification(CMeshO &m,int  TargetFaceNum, int BlockFaceNum, tri::TriEdgeCollapseQuadricParameter &pp, CallBackPos *cb)
+{
+  typedef tri::QuadricBlockSimplification<CMeshO> QBS;
+  QBS::Param bp;
+  bp.BlockFaceNum=BlockFaceNum;
+  bp.QParam=pp;
+  if(bp.QParam.NormalCheck) bp.QParam.NormalThrRad = M_PI/4.0;
+
+  CMeshO res;
+  CMeshOBlockSource src(m);
+  QBS::Do(src,res,TargetFaceNum,bp,cb);
+
+  // move the result in m, keeping its textures
+  m.Clear();
+  res.textures.swap(m.textures);
+  tri::Append<CMeshO,CMeshO>::Mesh(m,res);
+  tri::UpdateTopology<CMeshO>::VertexFace(m);
+}
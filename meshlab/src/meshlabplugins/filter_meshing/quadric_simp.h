@@ -90,5 +90,6 @@ class MyTriEdgeCollapse: public vcg::tri::TriEdgeCollapseQuadric< CMeshO, Vertex
 };
 } // end namespace tri
 } // end namepsace vcg
-void QuadricSimplification(CMeshO &m,int  TargetFaceNum,    bool Selected, vcg::tri::TriEdgeCollapseQuadricParameter &pp, vcg::CallBackPos *cb);
+void QuadricSimplification(CMeshO &m,int  TargetFaceNum,    bool Selected, vcg::tri::TriEdgeCollapseQuadricParameter &pp, vcg::CallBackPos *cb, bool Parallel=false);
+void BlockQuadricSimplification(CMeshO &m,int  TargetFaceNum, int BlockFaceNum, vcg::tri::TriEdgeCollapseQuadricParameter &pp, vcg::CallBackPos *cb);
 
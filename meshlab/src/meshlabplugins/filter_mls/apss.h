@@ -37,13 +37,7 @@ class APSS : public MlsSurface<_MeshType>
 		typedef typename Base::VectorType VectorType;
 		typedef typename Base::MatrixType MatrixType;
 		typedef _MeshType MeshType;
-		using Base::mCachedQueryPointIsOK;
-		using Base::mCachedQueryPoint;
-		using Base::mNeighborhood;
-		using Base::mCachedWeights;
-		using Base::mCachedWeightDerivatives;
-		using Base::mCachedWeightGradients;
-		using Base::mCachedWeightSecondDerivatives;
+		typedef typename Base::Context BaseContext;
 		using Base::mBallTree;
 		using Base::mPoints;
 		using Base::mFilterScale;
@@ -54,63 +48,77 @@ class APSS : public MlsSurface<_MeshType>
 
 		enum Status {ASS_SPHERE, ASS_PLANE, ASS_UNDETERMINED};
 
+		// use double precision anyway
+		typedef double LScalar;
+		typedef vcg::Point3<LScalar> LVector;
+
 	public:
 
+		/** the query state of APSS: the algebraic sphere fitted at the last query point */
+		class Context : public BaseContext
+		{
+			public:
+				// cached algebraic sphere coefficients
+				LScalar uConstant;
+				LVector uLinear;
+				LScalar uQuad;
+
+				LVector mCenter;
+				LScalar mRadius;
+				Status mStatus;
+
+				LVector mCachedSumP;
+				LVector mCachedSumN;
+				LScalar mCachedSumDotPP;
+				LScalar mCachedSumDotPN;
+				LScalar mCachedSumW;
+
+				LVector mCachedGradSumP[3];
+				LVector mCachedGradSumN[3];
+				LScalar mCachedGradSumDotPN[3];
+				LScalar mCachedGradSumDotPP[3];
+				LScalar mCachedGradSumW[3];
+
+				LScalar mCachedGradNume[3];
+				LScalar mCachedGradDeno[3];
+
+				LScalar mCachedGradUConstant[3];
+				LVector mCachedGradULinear[3];
+				LScalar mCachedGradUQuad[3];
+		};
+
 		APSS(const MeshType& m)
 			: Base(m)
 		{
 			mSphericalParameter = 1;
 		}
 
-		virtual Scalar potential(const VectorType& x, int* errorMask = 0) const;
-		virtual VectorType gradient(const VectorType& x, int* errorMask = 0) const;
-		virtual MatrixType hessian(const VectorType& x, int* errorMask) const;
-		virtual VectorType project(const VectorType& x, VectorType* pNormal = 0, int* errorMask = 0) const;
+		virtual Context* createContext() const { return new Context(); }
+
+		using Base::potential;
+		using Base::gradient;
+		using Base::hessian;
+		using Base::project;
+
+		virtual Scalar potential(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual VectorType gradient(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual MatrixType hessian(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual VectorType project(const VectorType& x, BaseContext& ctx, VectorType* pNormal = 0, int* errorMask = 0) const;
 
 		/** \returns the approximation of the mean curvature obtained from the radius of the fitted sphere */
-		virtual Scalar approxMeanCurvature(const VectorType& x, int* errorMask = 0) const;
+		virtual Scalar approxMeanCurvature(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		Scalar approxMeanCurvature(const VectorType& x, int* errorMask = 0) const
+		{ return approxMeanCurvature(x, Base::defaultContext(), errorMask); }
 
 		void setSphericalParameter(Scalar v);
 
 	protected:
-		bool fit(const VectorType& x) const;
-		bool mlsGradient(const VectorType& x, VectorType& grad) const;
-		bool mlsHessian(const VectorType& x, MatrixType& hessian) const;
+		bool fit(const VectorType& x, Context& ctx) const;
+		bool mlsGradient(const VectorType& x, VectorType& grad, Context& ctx) const;
+		bool mlsHessian(const VectorType& x, MatrixType& hessian, Context& ctx) const;
 
 	protected:
 		Scalar mSphericalParameter;
-
-		// use double precision anyway
-		typedef double LScalar;
-		typedef vcg::Point3<LScalar> LVector;
-
-		// cached algebraic sphere coefficients
-		mutable LScalar uConstant;
-		mutable LVector uLinear;
-		mutable LScalar uQuad;
-
-		mutable LVector mCenter;
-		mutable LScalar mRadius;
-		mutable Status mStatus;
-
-		mutable LVector mCachedSumP;
-		mutable LVector mCachedSumN;
-		mutable LScalar mCachedSumDotPP;
-		mutable LScalar mCachedSumDotPN;
-		mutable LScalar mCachedSumW;
-
-		mutable LVector mCachedGradSumP[3];
-		mutable LVector mCachedGradSumN[3];
-		mutable LScalar mCachedGradSumDotPN[3];
-		mutable LScalar mCachedGradSumDotPP[3];
-		mutable LScalar mCachedGradSumW[3];
-
-		mutable LScalar mCachedGradNume[3];
-		mutable LScalar mCachedGradDeno[3];
-
-		mutable LScalar mCachedGradUConstant[3];
-		mutable LVector mCachedGradULinear[3];
-		mutable LScalar mCachedGradUQuad[3];
 };
 
 }
@@ -31,15 +31,16 @@ template<typename _MeshType>
 void APSS<_MeshType>::setSphericalParameter(Scalar v)
 {
 	mSphericalParameter = v;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
-typename APSS<_MeshType>::Scalar APSS<_MeshType>::potential(const VectorType& x, int* errorMask) const
+typename APSS<_MeshType>::Scalar APSS<_MeshType>::potential(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!fit(x))
+		if (!fit(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -49,27 +50,28 @@ typename APSS<_MeshType>::Scalar APSS<_MeshType>::potential(const VectorType& x,
 
 	LVector lx(x.X(), x.Y(), x.Z());
 
-	if (mStatus==ASS_SPHERE)
+	if (ctx.mStatus==ASS_SPHERE)
 	{
-		Scalar aux = vcg::Norm(lx - mCenter) - mRadius;
-		if (uQuad<0.)
+		Scalar aux = vcg::Norm(lx - ctx.mCenter) - ctx.mRadius;
+		if (ctx.uQuad<0.)
 			aux = -aux;
 		return aux;
 	}
-	else if (mStatus==ASS_PLANE)
-		return vcg::Dot(lx,uLinear) + uConstant;
+	else if (ctx.mStatus==ASS_PLANE)
+		return vcg::Dot(lx,ctx.uLinear) + ctx.uConstant;
 	else
 	{
-		return uConstant + vcg::Dot(lx,uLinear) + uQuad * vcg::SquaredNorm(lx);
+		return ctx.uConstant + vcg::Dot(lx,ctx.uLinear) + ctx.uQuad * vcg::SquaredNorm(lx);
 	}
 }
 
 template<typename _MeshType>
-typename APSS<_MeshType>::Scalar APSS<_MeshType>::approxMeanCurvature(const VectorType& x, int* errorMask) const
+typename APSS<_MeshType>::Scalar APSS<_MeshType>::approxMeanCurvature(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!fit(x))
+		if (!fit(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -77,20 +79,21 @@ typename APSS<_MeshType>::Scalar APSS<_MeshType>::approxMeanCurvature(const Vect
 		}
 	}
 
-	if (mStatus==ASS_SPHERE)
-		return (uQuad>0.?1.0:-1.0)/mRadius;
+	if (ctx.mStatus==ASS_SPHERE)
+		return (ctx.uQuad>0.?1.0:-1.0)/ctx.mRadius;
 	else
 		return 0.;
 }
 
 template<typename _MeshType>
-typename APSS<_MeshType>::VectorType APSS<_MeshType>::gradient(const VectorType& x, int* errorMask) const
+typename APSS<_MeshType>::VectorType APSS<_MeshType>::gradient(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
+	Context& ctx = static_cast<Context&>(bctx);
 	if (errorMask)
 	   *errorMask = MLS_OK;
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!fit(x))
+		if (!fit(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -101,28 +104,29 @@ typename APSS<_MeshType>::VectorType APSS<_MeshType>::gradient(const VectorType&
 	if (mGradientHint==MLS_DERIVATIVE_ACCURATE)
 	{
 		VectorType grad;
-		mlsGradient(x,grad);
+		mlsGradient(x,grad,ctx);
 		return grad;
 	}
 	else
 	{
 		LVector lx(x.X(), x.Y(), x.Z());
-		if (mStatus==ASS_PLANE)
-			return VectorType(uLinear.X(), uLinear.Y(), uLinear.Z());
+		if (ctx.mStatus==ASS_PLANE)
+			return VectorType(ctx.uLinear.X(), ctx.uLinear.Y(), ctx.uLinear.Z());
 		else
 		{
-			LVector g = uLinear + lx * (Scalar(2) * uQuad);
+			LVector g = ctx.uLinear + lx * (Scalar(2) * ctx.uQuad);
 			return VectorType(g.X(), g.Y(), g.Z());
 		}
 	}
 }
 
 template<typename _MeshType>
-typename APSS<_MeshType>::MatrixType APSS<_MeshType>::hessian(const VectorType& x, int* errorMask) const
+typename APSS<_MeshType>::MatrixType APSS<_MeshType>::hessian(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!fit(x))
+		if (!fit(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -133,12 +137,12 @@ typename APSS<_MeshType>::MatrixType APSS<_MeshType>::hessian(const VectorType&
 	MatrixType hessian;
 	if (Base::mHessianHint==MLS_DERIVATIVE_ACCURATE)
 	{
-		mlsHessian(x, hessian);
+		mlsHessian(x, hessian, ctx);
 	}
 	else
 	{
 		// this is very approximate !!
-		Scalar c = Scalar(2) * uQuad;
+		Scalar c = Scalar(2) * ctx.uQuad;
 		for (int i=0; i<3; ++i)
 		for (int j=0; j<3; ++j)
 		{
@@ -152,8 +156,9 @@ typename APSS<_MeshType>::MatrixType APSS<_MeshType>::hessian(const VectorType&
 }
 
 template<typename _MeshType>
-typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType& x, VectorType* pNormal, int* errorMask) const
+typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType& x, BaseContext& bctx, VectorType* pNormal, int* errorMask) const
 {
+	Context& ctx = static_cast<Context&>(bctx);
 	int iterationCount = 0;
 	LVector lx(x.X(), x.Y(), x.Z());
 	LVector position = lx;
@@ -163,7 +168,7 @@ typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType&
 	LScalar epsilon2 = mAveragePointSpacing * mProjectionAccuracy;
 	epsilon2 = epsilon2 * epsilon2;
 	do {
-		if (!fit(VectorType(position.X(), position.Y(), position.Z())))
+		if (!fit(VectorType(position.X(), position.Y(), position.Z()), ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -173,40 +178,40 @@ typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType&
 
 		previousPosition = position;
 		// local projection
-		if (mStatus==ASS_SPHERE)
+		if (ctx.mStatus==ASS_SPHERE)
 		{
-			normal = lx - mCenter;
+			normal = lx - ctx.mCenter;
 			normal.Normalize();
-			position = mCenter + normal * mRadius;
+			position = ctx.mCenter + normal * ctx.mRadius;
 
-			normal = uLinear + position * (LScalar(2) * uQuad);
+			normal = ctx.uLinear + position * (LScalar(2) * ctx.uQuad);
 			normal.Normalize();
 		}
-		else if (mStatus==ASS_PLANE)
+		else if (ctx.mStatus==ASS_PLANE)
 		{
-			normal = uLinear;
-			position = lx - uLinear * (vcg::Dot(lx,uLinear) + uConstant);
+			normal = ctx.uLinear;
+			position = lx - ctx.uLinear * (vcg::Dot(lx,ctx.uLinear) + ctx.uConstant);
 		}
 		else
 		{
 			// Newton iterations
 			LVector grad;
-			LVector dir = uLinear+lx*(2.*uQuad);
+			LVector dir = ctx.uLinear+lx*(2.*ctx.uQuad);
 			LScalar ilg = 1./vcg::Norm(dir);
 			dir *= ilg;
-			LScalar ad = uConstant + vcg::Dot(uLinear,lx) + uQuad * vcg::SquaredNorm(lx);
+			LScalar ad = ctx.uConstant + vcg::Dot(ctx.uLinear,lx) + ctx.uQuad * vcg::SquaredNorm(lx);
 			LScalar delta = -ad*std::min<Scalar>(ilg,1.);
 			LVector p = lx + dir*delta;
 			for (int i=0 ; i<2 ; ++i)
 			{
-				grad = uLinear+p*(2.*uQuad);
+				grad = ctx.uLinear+p*(2.*ctx.uQuad);
 				ilg = 1./vcg::Norm(grad);
-				delta = -(uConstant + vcg::Dot(uLinear,p) + uQuad * vcg::SquaredNorm(p))*std::min<Scalar>(ilg,1.);
+				delta = -(ctx.uConstant + vcg::Dot(ctx.uLinear,p) + ctx.uQuad * vcg::SquaredNorm(p))*std::min<Scalar>(ilg,1.);
 				p += dir*delta;
 			}
 			position = p;
 
-			normal = uLinear + position * (Scalar(2) * uQuad);
+			normal = ctx.uLinear + position * (Scalar(2) * ctx.uQuad);
 			normal.Normalize();
 		}
 
@@ -218,7 +223,7 @@ typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType&
 		if (mGradientHint==MLS_DERIVATIVE_ACCURATE)
 		{
 			VectorType grad;
-			mlsGradient(vcg::Point3<Scalar>::Construct(position), grad);
+			mlsGradient(vcg::Point3<Scalar>::Construct(position), grad, ctx);
 			grad.Normalize();
 			*pNormal = grad;
 		}
@@ -236,26 +241,26 @@ typename APSS<_MeshType>::VectorType APSS<_MeshType>::project(const VectorType&
 }
 
 template<typename _MeshType>
-bool APSS<_MeshType>::fit(const VectorType& x) const
+bool APSS<_MeshType>::fit(const VectorType& x, Context& ctx) const
 {
-	Base::computeNeighborhood(x, true);
-	unsigned int nofSamples = mNeighborhood.size();
+	Base::computeNeighborhood(x, true, ctx);
+	unsigned int nofSamples = ctx.mNeighborhood.size();
 
 	if (nofSamples==0)
 	{
-		mCachedQueryPointIsOK = false;
+		ctx.mCachedQueryPointIsOK = false;
 		return false;
 	}
 	else if (nofSamples==1)
 	{
-		int id = mNeighborhood.index(0);
+		int id = ctx.mNeighborhood.index(0);
 		LVector p = vcg::Point3<LScalar>::Construct(mPoints[id].cP());
 		LVector n = vcg::Point3<LScalar>::Construct(mPoints[id].cN());
 
-		uLinear = n;
-		uConstant = -vcg::Dot(p, uLinear);
-		uQuad = 0;
-		mStatus = ASS_PLANE;
+		ctx.uLinear = n;
+		ctx.uConstant = -vcg::Dot(p, ctx.uLinear);
+		ctx.uQuad = 0;
+		ctx.mStatus = ASS_PLANE;
 		return true;
 	}
 
@@ -266,10 +271,10 @@ bool APSS<_MeshType>::fit(const VectorType& x) const
 	LScalar sumW = 0.;
 	for (unsigned int i=0; i<nofSamples; i++)
 	{
-		int id = mNeighborhood.index(i);
+		int id = ctx.mNeighborhood.index(i);
 		LVector p = vcg::Point3<LScalar>::Construct(mPoints[id].cP());
 		LVector n = vcg::Point3<LScalar>::Construct(mPoints[id].cN());
-		LScalar w = mCachedWeights.at(i);
+		LScalar w = ctx.mCachedWeights.at(i);
 
 		sumP += p * w;
 		sumN += n * w;
@@ -282,58 +287,58 @@ bool APSS<_MeshType>::fit(const VectorType& x) const
 	LScalar aux4 = mSphericalParameter * LScalar(0.5) *
 								(sumDotPN - invSumW*vcg::Dot(sumP,sumN))
 								/(sumDotPP - invSumW*vcg::SquaredNorm(sumP));
-	uLinear = (sumN-sumP*(Scalar(2)*aux4))*invSumW;
-	uConstant = -invSumW*(Dot(uLinear,sumP) + sumDotPP*aux4);
-	uQuad = aux4;
+	ctx.uLinear = (sumN-sumP*(Scalar(2)*aux4))*invSumW;
+	ctx.uConstant = -invSumW*(Dot(ctx.uLinear,sumP) + sumDotPP*aux4);
+	ctx.uQuad = aux4;
 
 	// finalize
-	if (fabs(uQuad)>1e-7)
+	if (fabs(ctx.uQuad)>1e-7)
 	{
-		mStatus = ASS_SPHERE;
-		LScalar b = 1./uQuad;
-		mCenter = uLinear*(-0.5*b);
-		mRadius = sqrt( vcg::SquaredNorm(mCenter) - b*uConstant );
+		ctx.mStatus = ASS_SPHERE;
+		LScalar b = 1./ctx.uQuad;
+		ctx.mCenter = ctx.uLinear*(-0.5*b);
+		ctx.mRadius = sqrt( vcg::SquaredNorm(ctx.mCenter) - b*ctx.uConstant );
 	}
-	else if (uQuad==0.)
+	else if (ctx.uQuad==0.)
 	{
-		mStatus = ASS_PLANE;
-		LScalar s = LScalar(1)/vcg::Norm(uLinear);
+		ctx.mStatus = ASS_PLANE;
+		LScalar s = LScalar(1)/vcg::Norm(ctx.uLinear);
 		assert(!vcg::math::IsNAN(s) && "normal should not have zero len!");
-		uLinear *= s;
-		uConstant *= s;
+		ctx.uLinear *= s;
+		ctx.uConstant *= s;
 	}
 	else
 	{
-		mStatus = ASS_UNDETERMINED;
+		ctx.mStatus = ASS_UNDETERMINED;
 		// normalize the gradient
-		LScalar f = 1./sqrt(vcg::SquaredNorm(uLinear) - Scalar(4)*uConstant*uQuad);
-		uConstant *= f;
-		uLinear *= f;
-		uQuad *= f;
+		LScalar f = 1./sqrt(vcg::SquaredNorm(ctx.uLinear) - Scalar(4)*ctx.uConstant*ctx.uQuad);
+		ctx.uConstant *= f;
+		ctx.uLinear *= f;
+		ctx.uQuad *= f;
 	}
 
 	// cache some values to be used by the mls gradient
-	mCachedSumP = sumP;
-	mCachedSumN = sumN;
-	mCachedSumW = sumW;
-	mCachedSumDotPP = sumDotPP;
-	mCachedSumDotPN = sumDotPN;
-
-	mCachedQueryPoint = x;
-	mCachedQueryPointIsOK = true;
+	ctx.mCachedSumP = sumP;
+	ctx.mCachedSumN = sumN;
+	ctx.mCachedSumW = sumW;
+	ctx.mCachedSumDotPP = sumDotPP;
+	ctx.mCachedSumDotPN = sumDotPN;
+
+	ctx.mCachedQueryPoint = x;
+	ctx.mCachedQueryPointIsOK = true;
 	return true;
 	}
 
 	template<typename _MeshType>
-	bool APSS<_MeshType>::mlsGradient(const VectorType& x, VectorType& grad) const
+	bool APSS<_MeshType>::mlsGradient(const VectorType& x, VectorType& grad, Context& ctx) const
 	{
-	unsigned int nofSamples = mNeighborhood.size();
+	unsigned int nofSamples = ctx.mNeighborhood.size();
 
-	const LVector& sumP = mCachedSumP;
-	const LVector& sumN = mCachedSumN;
-	const LScalar& sumDotPN = mCachedSumDotPN;
-	const LScalar& sumDotPP = mCachedSumDotPP;
-	const LScalar& sumW = mCachedSumW;
+	const LVector& sumP = ctx.mCachedSumP;
+	const LVector& sumN = ctx.mCachedSumN;
+	const LScalar& sumDotPN = ctx.mCachedSumDotPN;
+	const LScalar& sumDotPP = ctx.mCachedSumDotPP;
+	const LScalar& sumW = ctx.mCachedSumW;
 	const LScalar invSumW = 1.f/sumW;
 
 	const LScalar nume = sumDotPN - invSumW * vcg::Dot(sumP, sumN);
@@ -348,10 +353,10 @@ bool APSS<_MeshType>::fit(const VectorType& x) const
 		LScalar dSumW = 0.;
 		for (unsigned int i=0; i<nofSamples; i++)
 		{
-			int id = mNeighborhood.index(i);
+			int id = ctx.mNeighborhood.index(i);
 			LVector p = vcg::Point3<LScalar>::Construct(mPoints[id].cP());
 			LVector n = vcg::Point3<LScalar>::Construct(mPoints[id].cN());
-			LScalar dw = mCachedWeightGradients.at(i)[k];
+			LScalar dw = ctx.mCachedWeightGradients.at(i)[k];
 
 			dSumW += dw;
 			dSumP += p*dw;
@@ -360,11 +365,11 @@ bool APSS<_MeshType>::fit(const VectorType& x) const
 			dSumDotPP += dw * vcg::SquaredNorm(p);
 		}
 
-		mCachedGradSumP[k] = dSumP;
-		mCachedGradSumN[k] = dSumN;
-		mCachedGradSumDotPN[k] = dSumDotPN;
-		mCachedGradSumDotPP[k] = dSumDotPP;
-		mCachedGradSumW[k] = dSumW;
+		ctx.mCachedGradSumP[k] = dSumP;
+		ctx.mCachedGradSumN[k] = dSumN;
+		ctx.mCachedGradSumDotPN[k] = dSumDotPN;
+		ctx.mCachedGradSumDotPP[k] = dSumDotPP;
+		ctx.mCachedGradSumW[k] = dSumW;
 
 		LScalar dVecU0;
 		LVector dVecU13;
@@ -376,37 +381,37 @@ bool APSS<_MeshType>::fit(const VectorType& x) const
 																								- dSumW*vcg::Dot(sumP,sumP));
 
 		dVecU4 = mSphericalParameter * 0.5 * (deno * dNume - dDeno * nume)/(deno*deno);
-		dVecU13 = ((dSumN - (dSumP*uQuad + sumP*dVecU4)*2.0) - uLinear * dSumW) * invSumW;
-		dVecU0 = -invSumW*( vcg::Dot(dVecU13,sumP) + dVecU4*sumDotPP + vcg::Dot(uLinear,dSumP) + uQuad*dSumDotPP + dSumW*uConstant);
+		dVecU13 = ((dSumN - (dSumP*ctx.uQuad + sumP*dVecU4)*2.0) - ctx.uLinear * dSumW) * invSumW;
+		dVecU0 = -invSumW*( vcg::Dot(dVecU13,sumP) + dVecU4*sumDotPP + vcg::Dot(ctx.uLinear,dSumP) + ctx.uQuad*dSumDotPP + dSumW*ctx.uConstant);
 
-		grad[k] = dVecU0 + vcg::Dot(dVecU13,vcg::Point3<LScalar>::Construct(x)) + dVecU4*vcg::SquaredNorm(x) + uLinear[k] + 2.*x[k]*uQuad;
+		grad[k] = dVecU0 + vcg::Dot(dVecU13,vcg::Point3<LScalar>::Construct(x)) + dVecU4*vcg::SquaredNorm(x) + ctx.uLinear[k] + 2.*x[k]*ctx.uQuad;
 
-		mCachedGradDeno[k] = dDeno;
-		mCachedGradNume[k] = dNume;
-		mCachedGradUConstant[k] = dVecU0;
-		mCachedGradULinear[k] = dVecU13;
-		mCachedGradUQuad[k] = dVecU4;
+		ctx.mCachedGradDeno[k] = dDeno;
+		ctx.mCachedGradNume[k] = dNume;
+		ctx.mCachedGradUConstant[k] = dVecU0;
+		ctx.mCachedGradULinear[k] = dVecU13;
+		ctx.mCachedGradUQuad[k] = dVecU4;
 	}
 
 	return true;
 }
 
 template<typename _MeshType>
-bool APSS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) const
+bool APSS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian, Context& ctx) const
 {
-	this->requestSecondDerivatives();
+	this->requestSecondDerivatives(ctx);
 
 	// TODO call mlsGradient first
 	VectorType grad;
-	mlsGradient(x,grad);
+	mlsGradient(x,grad,ctx);
 
-	uint nofSamples = mNeighborhood.size();
+	uint nofSamples = ctx.mNeighborhood.size();
 
-	const LVector& sumP = mCachedSumP;
-	const LVector& sumN = mCachedSumN;
-	const LScalar& sumDotPN = mCachedSumDotPN;
-	const LScalar& sumDotPP = mCachedSumDotPP;
-	const LScalar& sumW = mCachedSumW;
+	const LVector& sumP = ctx.mCachedSumP;
+	const LVector& sumN = ctx.mCachedSumN;
+	const LScalar& sumDotPN = ctx.mCachedSumDotPN;
+	const LScalar& sumDotPP = ctx.mCachedSumDotPP;
+	const LScalar& sumW = ctx.mCachedSumW;
 	const LScalar invSumW = 1.f/sumW;
 
 	const LScalar nume = sumDotPN - invSumW * vcg::Dot(sumP, sumN);
@@ -414,18 +419,18 @@ bool APSS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) const
 
 	for (uint k=0 ; k<3 ; ++k)
 	{
-		const LVector& dSumP = mCachedGradSumP[k];
-		const LVector& dSumN = mCachedGradSumN[k];
-		const LScalar& dSumDotPN = mCachedGradSumDotPN[k];
-		const LScalar& dSumDotPP = mCachedGradSumDotPP[k];
-		const LScalar& dSumW = mCachedGradSumW[k];
+		const LVector& dSumP = ctx.mCachedGradSumP[k];
+		const LVector& dSumN = ctx.mCachedGradSumN[k];
+		const LScalar& dSumDotPN = ctx.mCachedGradSumDotPN[k];
+		const LScalar& dSumDotPP = ctx.mCachedGradSumDotPP[k];
+		const LScalar& dSumW = ctx.mCachedGradSumW[k];
 
-		LScalar dVecU0 = mCachedGradUConstant[k];
-		LVector dVecU13 = mCachedGradULinear[k];
-		LScalar dVecU4 = mCachedGradUQuad[k];
+		LScalar dVecU0 = ctx.mCachedGradUConstant[k];
+		LVector dVecU13 = ctx.mCachedGradULinear[k];
+		LScalar dVecU4 = ctx.mCachedGradUQuad[k];
 
-		LScalar dNume = mCachedGradNume[k];
-		LScalar dDeno = mCachedGradDeno[k];
+		LScalar dNume = ctx.mCachedGradNume[k];
+		LScalar dDeno = ctx.mCachedGradDeno[k];
 
 		// second order derivatives
 		for (uint j=0 ; j<3 ; ++j)
@@ -437,14 +442,14 @@ bool APSS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) const
 			LScalar d2SumW = 0.;
 			for (unsigned int i=0; i<nofSamples; i++)
 			{
-				int id = mNeighborhood.index(i);
+				int id = ctx.mNeighborhood.index(i);
 				LVector p = vcg::Point3<LScalar>::Construct(mPoints[id].cP());
 				LVector n = vcg::Point3<LScalar>::Construct(mPoints[id].cN());
-				LScalar dw = mCachedWeightGradients.at(i)[j];
-				LScalar d2w = ((x[k]-p[k]))*((x[j]-p[j])) * mCachedWeightSecondDerivatives.at(i);
+				LScalar dw = ctx.mCachedWeightGradients.at(i)[j];
+				LScalar d2w = ((x[k]-p[k]))*((x[j]-p[j])) * ctx.mCachedWeightSecondDerivatives.at(i);
 
 				if (j==k)
-					d2w += mCachedWeightDerivatives.at(i);
+					d2w += ctx.mCachedWeightDerivatives.at(i);
 
 				d2SumW += d2w;
 				d2SumP += p*d2w;
@@ -458,39 +463,39 @@ bool APSS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) const
 			LScalar d2u4;
 
 			LScalar d2Nume = d2SumDotPN - invSumW*invSumW*invSumW*invSumW*(
-					- 2.*sumW*mCachedGradSumW[j]*( sumW*(vcg::Dot(dSumP,sumN)+vcg::Dot(sumP,dSumN)) - dSumW* vcg::Dot(sumP,sumN))
-					+ sumW*sumW*( mCachedGradSumW[j]*(vcg::Dot(dSumP,sumN)+vcg::Dot(sumP,dSumN))
+					- 2.*sumW*ctx.mCachedGradSumW[j]*( sumW*(vcg::Dot(dSumP,sumN)+vcg::Dot(sumP,dSumN)) - dSumW* vcg::Dot(sumP,sumN))
+					+ sumW*sumW*( ctx.mCachedGradSumW[j]*(vcg::Dot(dSumP,sumN)+vcg::Dot(sumP,dSumN))
 											+ sumW*(vcg::Dot(d2SumP,sumN)	+ vcg::Dot(sumP,d2SumN)
-															+ vcg::Dot(mCachedGradSumP[j],dSumN) + vcg::Dot(dSumP,mCachedGradSumN[j]))
+															+ vcg::Dot(ctx.mCachedGradSumP[j],dSumN) + vcg::Dot(dSumP,ctx.mCachedGradSumN[j]))
 											- d2SumW*vcg::Dot(sumP,sumN)
-											- dSumW*(vcg::Dot(mCachedGradSumP[j],sumN)+vcg::Dot(sumP,mCachedGradSumN[j])) ));
+											- dSumW*(vcg::Dot(ctx.mCachedGradSumP[j],sumN)+vcg::Dot(sumP,ctx.mCachedGradSumN[j])) ));
 
 			LScalar d2Deno = d2SumDotPP - invSumW*invSumW*invSumW*invSumW*(
-					- 2.*sumW*mCachedGradSumW[j] * ( 2.*sumW*vcg::Dot(dSumP,sumP) - dSumW*vcg::Dot(sumP,sumP))
-					+ sumW*sumW*( 2.*mCachedGradSumW[j]*(vcg::Dot(dSumP,sumP))
-											+ 2.*sumW*(vcg::Dot(mCachedGradSumP[j],dSumP)+vcg::Dot(d2SumP,sumP))
-											- d2SumW*vcg::Dot(sumP,sumP) - dSumW*(2.*vcg::Dot(mCachedGradSumP[j],sumP))) );
+					- 2.*sumW*ctx.mCachedGradSumW[j] * ( 2.*sumW*vcg::Dot(dSumP,sumP) - dSumW*vcg::Dot(sumP,sumP))
+					+ sumW*sumW*( 2.*ctx.mCachedGradSumW[j]*(vcg::Dot(dSumP,sumP))
+											+ 2.*sumW*(vcg::Dot(ctx.mCachedGradSumP[j],dSumP)+vcg::Dot(d2SumP,sumP))
+											- d2SumW*vcg::Dot(sumP,sumP) - dSumW*(2.*vcg::Dot(ctx.mCachedGradSumP[j],sumP))) );
 
 			LScalar deno2 = deno*deno;
-			d2u4 = mSphericalParameter * 0.5 * (deno2*(d2Nume*deno + mCachedGradDeno[j] * dNume
-																									- d2Deno*nume - dDeno * mCachedGradNume[j])
-																					- 2.*deno*mCachedGradDeno[j]*(deno * dNume - dDeno * nume))/(deno2*deno2);
+			d2u4 = mSphericalParameter * 0.5 * (deno2*(d2Nume*deno + ctx.mCachedGradDeno[j] * dNume
+																									- d2Deno*nume - dDeno * ctx.mCachedGradNume[j])
+																					- 2.*deno*ctx.mCachedGradDeno[j]*(deno * dNume - dDeno * nume))/(deno2*deno2);
 
-			d2u13 = ( -dVecU13 * mCachedGradSumW[j]
-								+ (d2SumN - (dSumP*mCachedGradUQuad[j] + d2SumP*uQuad + sumP*d2u4 + mCachedGradSumP[j]*dVecU4)*2.0 )
-								- uLinear*d2SumW - mCachedGradULinear[j]*dSumW ) * invSumW;
+			d2u13 = ( -dVecU13 * ctx.mCachedGradSumW[j]
+								+ (d2SumN - (dSumP*ctx.mCachedGradUQuad[j] + d2SumP*ctx.uQuad + sumP*d2u4 + ctx.mCachedGradSumP[j]*dVecU4)*2.0 )
+								- ctx.uLinear*d2SumW - ctx.mCachedGradULinear[j]*dSumW ) * invSumW;
 
-			d2u0 =  ( -dVecU0 * mCachedGradSumW[j]
-								- ( vcg::Dot(dVecU13,mCachedGradSumP[j]) + vcg::Dot(d2u13,sumP)
-									+ d2u4*sumDotPP + dVecU4*mCachedGradSumDotPP[j]
-									+ vcg::Dot(uLinear,d2SumP) + vcg::Dot(mCachedGradULinear[j],dSumP)
-									+ dSumDotPP*mCachedGradUQuad[j] + d2SumDotPP*uQuad
-									+ d2SumW*uConstant + dSumW*mCachedGradUConstant[j]) ) * invSumW;
+			d2u0 =  ( -dVecU0 * ctx.mCachedGradSumW[j]
+								- ( vcg::Dot(dVecU13,ctx.mCachedGradSumP[j]) + vcg::Dot(d2u13,sumP)
+									+ d2u4*sumDotPP + dVecU4*ctx.mCachedGradSumDotPP[j]
+									+ vcg::Dot(ctx.uLinear,d2SumP) + vcg::Dot(ctx.mCachedGradULinear[j],dSumP)
+									+ dSumDotPP*ctx.mCachedGradUQuad[j] + d2SumDotPP*ctx.uQuad
+									+ d2SumW*ctx.uConstant + dSumW*ctx.mCachedGradUConstant[j]) ) * invSumW;
 
 			hessian[j][k] =
 							dVecU13[j] + 2.*dVecU4*x[j]
 						+ d2u0 + vcg::Dot(d2u13,vcg::Point3<LScalar>::Construct(x)) + d2u4*vcg::Dot(x,x)
-						+ mCachedGradULinear[j][k] + (j==k ? 2.*uQuad : 0.) + 2.*x[k]*mCachedGradUQuad[j];
+						+ ctx.mCachedGradULinear[j][k] + (j==k ? 2.*ctx.uQuad : 0.) + 2.*x[k]*ctx.mCachedGradUQuad[j];
 
 		}
 	}
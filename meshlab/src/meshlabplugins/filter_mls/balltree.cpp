@@ -41,19 +41,18 @@ void BallTree<_Scalar>::computeNeighbors(const VectorType& x, Neighborhood<Scala
 		const_cast<BallTree*>(this)->rebuild();
 
 	pNei->clear();
-	mQueryPosition = x;
-	queryNode(*mRootNode, pNei);
+	queryNode(*mRootNode, x, pNei);
 }
 
 template<typename _Scalar>
-void BallTree<_Scalar>::queryNode(Node& node, Neighborhood<Scalar>* pNei) const
+void BallTree<_Scalar>::queryNode(const Node& node, const VectorType& x, Neighborhood<Scalar>* pNei) const
 {
 	if (node.leaf)
 	{
 		for (unsigned int i=0 ; i<node.size ; ++i)
 		{
 			int id = node.indices[i];
-			Scalar d2 = vcg::SquaredNorm(mQueryPosition - mPoints[id]);
+			Scalar d2 = vcg::SquaredNorm(x - mPoints[id]);
 			Scalar r = mRadiusScale * mRadii[id];
 			if (d2<r*r)
 				pNei->insert(id, d2);
@@ -61,10 +60,10 @@ void BallTree<_Scalar>::queryNode(Node& node, Neighborhood<Scalar>* pNei) const
 	}
 	else
 	{
-		if (mQueryPosition[node.dim] - node.splitValue < 0)
-			queryNode(*node.children[0], pNei);
+		if (x[node.dim] - node.splitValue < 0)
+			queryNode(*node.children[0], x, pNei);
 		else
-			queryNode(*node.children[1], pNei);
+			queryNode(*node.children[1], x, pNei);
 	}
 }
 
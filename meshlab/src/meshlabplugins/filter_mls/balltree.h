@@ -42,7 +42,7 @@ class Neighborhood
 		void clear() { mIndices.clear(); mSqDists.clear(); }
 		void resize(int size) { mIndices.resize(size); mSqDists.resize(size); }
 		void reserve(int size) { mIndices.reserve(size); mSqDists.reserve(size); }
-		int size() { return mIndices.size(); }
+		int size() const { return mIndices.size(); }
 
 		void insert(int id, Scalar d2) { mIndices.push_back(id); mSqDists.push_back(d2); }
 
@@ -59,11 +59,18 @@ class BallTree
 		typedef vcg::Point3<Scalar> VectorType;
 
 		BallTree(const ConstDataWrapper<VectorType>& points, const ConstDataWrapper<Scalar>& radii);
+		~BallTree() { delete mRootNode; }
 
+		/** Computes the neighbors of \a x. Once the tree is up to date (see update())
+			* the queries do not modify it, so they can be done from several threads at once.
+			*/
 		void computeNeighbors(const VectorType& x, Neighborhood<Scalar>* pNei) const;
 
 		void setRadiusScale(Scalar v) { mRadiusScale = v; mTreeIsUptodate = false; }
 
+		/** rebuilds the tree if it is out of date */
+		void update() { if (!mTreeIsUptodate) rebuild(); }
+
 	protected:
 
 		struct Node
@@ -99,7 +106,7 @@ class BallTree
 		void split(const IndexArray& indices, const AxisAlignedBoxType& aabbLeft, const AxisAlignedBoxType& aabbRight,
 							IndexArray& iLeft, IndexArray& iRight);
 		void buildNode(Node& node, std::vector<int>& indices, AxisAlignedBoxType aabb, int level);
-		void queryNode(Node& node, Neighborhood<Scalar>* pNei) const;
+		void queryNode(const Node& node, const VectorType& x, Neighborhood<Scalar>* pNei) const;
 
 	protected:
 		ConstDataWrapper<VectorType> mPoints;
@@ -108,8 +115,7 @@ class BallTree
 
 		int mMaxTreeDepth;
 		int mTargetCellSize;
-		mutable bool mTreeIsUptodate;
-		mutable VectorType mQueryPosition;
+		bool mTreeIsUptodate;
 
 		Node* mRootNode;
 };
@@ -24,4 +24,3 @@ TARGET = filter_mls
 
 CONFIG       += opengl
 CONFIG       += warn_off
-
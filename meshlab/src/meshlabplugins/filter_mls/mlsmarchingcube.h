@@ -134,24 +134,34 @@ public:
 			VectorType origin = mAABB.min + VectorType(bi[0],bi[1],bi[2]) * (step * (mMaxBlockSize-1));
 
 			// fill the grid
-			vcg::Point3i ci; // local cell id
+			if (cb)
+				cb((100*countSubSlice)/totalSubSlices, "Marching cube...");
+			countSubSlice += mGridSize[0];
 
-			// for each corners...
-			for (ci[0]=0 ; ci[0]<mGridSize[0] ; ++ci[0])
+			// for each corners... the slices are evaluated in parallel, each thread with its own query context
+			mpSurface->updateBallTree();
+			#pragma omp parallel
 			{
-				if (cb)
-					cb((100*(++countSubSlice))/totalSubSlices, "Marching cube...");
-				for (ci[1]=0 ; ci[1]<mGridSize[1] ; ++ci[1])
-				for (ci[2]=0 ; ci[2]<mGridSize[2] ; ++ci[2])
+				typename SurfaceType::Context* ctx = mpSurface->createContext();
+				#pragma omp for schedule(dynamic)
+				for (int i=0 ; i<mGridSize[0] ; ++i)
 				{
-					GridElement& el = mCache[(ci[2]*mMaxBlockSize + ci[1])*mMaxBlockSize + ci[0]];
-					el.position = origin + VectorType(ci[0],ci[1],ci[2]) * step;
-					el.value = mpSurface->potential(el.position);
-					if (!mpSurface->isInDomain(el.position))
-						el.value = invalidValue;
+					vcg::Point3i ci(i,0,0); // local cell id
+					for (ci[1]=0 ; ci[1]<mGridSize[1] ; ++ci[1])
+					for (ci[2]=0 ; ci[2]<mGridSize[2] ; ++ci[2])
+					{
+						GridElement& el = mCache[(ci[2]*mMaxBlockSize + ci[1])*mMaxBlockSize + ci[0]];
+						el.position = origin + VectorType(ci[0],ci[1],ci[2]) * step;
+						el.value = mpSurface->potential(el.position, *ctx);
+						if (!mpSurface->isInDomain(el.position, *ctx))
+							el.value = invalidValue;
+					}
 				}
+				delete ctx;
 			}
 
+			vcg::Point3i ci; // local cell id
+
 			// polygonize the grid (marching cube)
 			// for each cell...
 			for (ci[0]=0 ; ci[0]<mGridSize[0]-1 ; ++ci[0])
@@ -352,6 +352,36 @@ void UpdateFaceNormalFromVertex(MeshType& m)
 	}
 }
 
+/** the number of vertices processed between two progress updates by the parallel MLS loops */
+static const int MLS_CHUNK_SIZE = 1<<16;
+
+/** project the vertices of m (only the selected ones if selectionOnly) onto the MLS surface, together with their normals.
+	* The vertices of a chunk are projected in parallel, each thread with its own query context.
+	*/
+template<typename MeshType>
+void ProjectVertices(const MlsSurface<MeshType>& mls, MeshType& m, bool selectionOnly, vcg::CallBackPos* cb)
+{
+	typedef typename MlsSurface<MeshType>::Context Context;
+	const int size = int(m.vert.size());
+	mls.updateBallTree();
+	for (int start = 0; start < size; start += MLS_CHUNK_SIZE)
+	{
+		cb(1+int(98.0*start/size), "MLS projection...");
+		const int end = std::min(size, start+MLS_CHUNK_SIZE);
+		#pragma omp parallel
+		{
+			Context* ctx = mls.createContext();
+			#pragma omp for schedule(dynamic,256)
+			for (int i = start; i < end; i++)
+			{
+				if ( (!selectionOnly) || (m.vert[i].IsS()) )
+					m.vert[i].P() = mls.project(m.vert[i].P(), *ctx, &m.vert[i].N());
+			}
+			delete ctx;
+		}
+	}
+}
+
 bool MlsPlugin::applyFilter(QAction* filter, MeshDocument& md, RichParameterSet& par, vcg::CallBackPos* cb)
 {
 	int id = ID(filter);
@@ -472,13 +502,7 @@ bool MlsPlugin::applyFilter(QAction* filter, MeshDocument& md, RichParameterSet&
 							(mesh->cm, tri::OddPointLoop<CMeshO>(mesh->cm), tri::EvenPointLoop<CMeshO>(), edgePred, selectionOnly, cb);
 				}
 				// project all vertices onto the MLS surface
-				for (unsigned int i = 0; i< mesh->cm.vert.size(); i++)
-				{
-					cb(1+98*i/mesh->cm.vert.size(), "MLS projection...");
-
-					if ( (!selectionOnly) || (mesh->cm.vert[i].IsS()) )
-						mesh->cm.vert[i].P() = mls->project(mesh->cm.vert[i].P(), &mesh->cm.vert[i].N());
-				}
+				ProjectVertices(*mls, mesh->cm, selectionOnly, cb);
 			}
 
 			Log( "Successfully projected %i vertices", mesh->cm.vn);
@@ -494,60 +518,60 @@ bool MlsPlugin::applyFilter(QAction* filter, MeshDocument& md, RichParameterSet&
 			//bool approx = apss && par.getBool("ApproxCurvature");
 			int ct = par.getEnum("CurvatureType");
 
-			uint size = mesh->cm.vert.size();
-			//std::vector<float> curvatures(size);
-			float minc=1e9, maxc=-1e9, minabsc=1e9;
-			vcg::Point3f grad;
-			vcg::Matrix33f hess;
+			int size = int(mesh->cm.vert.size());
 
-			// pass 1: computes curvatures and statistics
-			for (unsigned int i = 0; i< size; i++)
+			// pass 1: computes curvatures, in parallel with a query context per thread
+			mls->updateBallTree();
+			for (int start = 0; start < size; start += MLS_CHUNK_SIZE)
 			{
-				cb(1+98*i/pPoints->cm.vert.size(), "MLS colorization...");
-
-				if ( (!selectionOnly) || (pPoints->cm.vert[i].IsS()) )
+				cb(1+int(98.0*start/size), "MLS colorization...");
+				const int end = std::min(size, start+MLS_CHUNK_SIZE);
+				#pragma omp parallel
 				{
-					Point3f p = mls->project(mesh->cm.vert[i].P());
-					float c = 0;
-
-					if (ct==CT_APSS)
-						c = apss->approxMeanCurvature(p);
-					else
+					MlsSurface<CMeshO>::Context* ctx = mls->createContext();
+					#pragma omp for schedule(dynamic,256)
+					for (int i = start; i < end; i++)
 					{
-						int errorMask;
-						grad = mls->gradient(p, &errorMask);
-						if (errorMask == MLS_OK && grad.Norm() > 1e-8)
+						if ( (!selectionOnly) || (pPoints->cm.vert[i].IsS()) )
 						{
-						  hess = mls->hessian(p);
-						  implicits::WeingartenMap<float> W(grad,hess);
-
-						  mesh->cm.vert[i].PD1() = W.K1Dir();
-						  mesh->cm.vert[i].PD2() = W.K2Dir();
-						  mesh->cm.vert[i].K1() =  W.K1();
-						  mesh->cm.vert[i].K2() =  W.K2();
-
-						  switch(ct)
-						  {
-							  case CT_MEAN: c = W.MeanCurvature(); break;
-							  case CT_GAUSS: c = W.GaussCurvature(); break;
-							  case CT_K1: c = W.K1(); break;
-							  case CT_K2: c = W.K2(); break;
-							  default: assert(0 && "invalid curvature type");
-						  }
+							Point3f p = mls->project(mesh->cm.vert[i].P(), *ctx);
+							float c = 0;
+
+							if (ct==CT_APSS)
+								c = apss->approxMeanCurvature(p, *ctx);
+							else
+							{
+								int errorMask;
+								vcg::Point3f grad = mls->gradient(p, *ctx, &errorMask);
+								if (errorMask == MLS_OK && grad.Norm() > 1e-8)
+								{
+								  vcg::Matrix33f hess = mls->hessian(p, *ctx);
+								  implicits::WeingartenMap<float> W(grad,hess);
+
+								  mesh->cm.vert[i].PD1() = W.K1Dir();
+								  mesh->cm.vert[i].PD2() = W.K2Dir();
+								  mesh->cm.vert[i].K1() =  W.K1();
+								  mesh->cm.vert[i].K2() =  W.K2();
+
+								  switch(ct)
+								  {
+									  case CT_MEAN: c = W.MeanCurvature(); break;
+									  case CT_GAUSS: c = W.GaussCurvature(); break;
+									  case CT_K1: c = W.K1(); break;
+									  case CT_K2: c = W.K2(); break;
+									  default: assert(0 && "invalid curvature type");
+								  }
+								}
+								assert(!math::IsNAN(c) && "You should never try to compute Histogram with Invalid Floating points numbers (NaN)");
+							}
+							mesh->cm.vert[i].Q() = c;
 						}
-						assert(!math::IsNAN(c) && "You should never try to compute Histogram with Invalid Floating points numbers (NaN)");
 					}
-					mesh->cm.vert[i].Q() = c;
-					minc = std::min(c,minc);
-					maxc = std::max(c,maxc);
-					minabsc = std::min(fabsf(c),minabsc);
+					delete ctx;
 				}
 			}
 			// pass 2: convert the curvature to color
 			cb(99, "Curvature to color...");
-			float d = maxc-minc;
-			minc += 0.05*d;
-			maxc -= 0.05*d;
 
 			vcg::Histogramf H;
       vcg::tri::Stat<CMeshO>::ComputePerVertexQualityHistogram(mesh->cm,H);
@@ -579,11 +603,7 @@ bool MlsPlugin::applyFilter(QAction* filter, MeshDocument& md, RichParameterSet&
 			walker.BuildMesh<MlsMarchingCubes>(mesh->cm, *mls, mc, cb);
 
 			// accurate projection
-			for (unsigned int i = 0; i< mesh->cm.vert.size(); i++)
-			{
-				cb(1+98*i/mesh->cm.vert.size(), "MLS projection...");
-				mesh->cm.vert[i].P() = mls->project(mesh->cm.vert[i].P(), &mesh->cm.vert[i].N());
-			}
+			ProjectVertices(*mls, mesh->cm, false, cb);
 
 			// extra zero detection and removal
 			{
@@ -52,10 +52,35 @@ class MlsSurface
 		typedef vcg::Matrix33<Scalar> MatrixType;
 		typedef typename MeshType::VertContainer PointsType;
 
+		/** The state of the queries of one thread: the neighborhood of the last query point
+			* and the weights computed on it, that are reused by the queries at the same point
+			* (e.g., potential() followed by isInDomain(), or gradient() followed by hessian()).
+			*
+			* The surface itself is not modified by the queries taking a context, so many threads
+			* can query the same surface at once, each one with its own context (see createContext()).
+			* The queries without a context use a default one owned by the surface,
+			* therefore they must be done by one thread at a time.
+			* A context must not be used anymore after a change of the parameters of the surface.
+			*/
+		class Context
+		{
+			public:
+				Context() : mCachedQueryPointIsOK(false) {}
+				virtual ~Context() {}
+
+				bool mCachedQueryPointIsOK;
+				VectorType mCachedQueryPoint;
+				Neighborhood<Scalar> mNeighborhood;
+				std::vector<Scalar> mCachedWeights;
+				std::vector<Scalar> mCachedWeightDerivatives;
+				std::vector<VectorType> mCachedWeightGradients;
+				std::vector<Scalar> mCachedWeightSecondDerivatives;
+		};
+
 		MlsSurface(const MeshType& mesh)
 			: mMesh(mesh), mPoints(mesh.vert)
 		{
-			mCachedQueryPointIsOK = false;
+			mDefaultContext = 0;
 
 			mAABB = mesh.bbox;
 
@@ -78,27 +103,56 @@ class MlsSurface
 			mDomainNormalScale = 1.;
 		}
 
+		virtual ~MlsSurface()
+		{
+			delete mDefaultContext;
+			delete mBallTree;
+		}
+
+		/** \returns a new context for the queries of one thread, to be deleted by the caller
+			*
+			* Before querying the surface from several threads, call updateBallTree() once.
+			*/
+		virtual Context* createContext() const { return new Context(); }
+
+		/** builds the spatial index of the points, if it is not up to date
+			*
+			* The queries build it on demand, so this has to be called explicitly only
+			* before querying the surface from several threads.
+			*/
+		void updateBallTree() const;
+
 		/** \returns the value of the reconstructed scalar field at point \a x */
-		virtual Scalar potential(const VectorType& x, int* errorMask = 0) const = 0;
+		virtual Scalar potential(const VectorType& x, Context& ctx, int* errorMask = 0) const = 0;
+		Scalar potential(const VectorType& x, int* errorMask = 0) const
+		{ return potential(x, defaultContext(), errorMask); }
 
 		/** \returns the gradient of the reconstructed scalar field at point \a x
 			*
 			* The method used to compute the gradient can be controlled with setGradientHint().
 			*/
-		virtual VectorType gradient(const VectorType& x, int* errorMask = 0) const = 0;
+		virtual VectorType gradient(const VectorType& x, Context& ctx, int* errorMask = 0) const = 0;
+		VectorType gradient(const VectorType& x, int* errorMask = 0) const
+		{ return gradient(x, defaultContext(), errorMask); }
 
 		/** \returns the hessian matrix of the reconstructed scalar field at point \a x
 			*
 			* The method used to compute the hessian matrix can be controlled with setHessianHint().
 			*/
-		virtual MatrixType hessian(const VectorType& x, int* errorMask = 0) const
+		virtual MatrixType hessian(const VectorType& x, Context& /*ctx*/, int* errorMask = 0) const
 		{ if (errorMask) *errorMask = MLS_NOT_SUPPORTED; return MatrixType(); }
+		MatrixType hessian(const VectorType& x, int* errorMask = 0) const
+		{ return hessian(x, defaultContext(), errorMask); }
 
 		/** \returns the projection of point x onto the MLS surface, and optionnaly returns the normal in \a pNormal */
-		virtual VectorType project(const VectorType& x, VectorType* pNormal = 0, int* errorMask = 0) const = 0;
+		virtual VectorType project(const VectorType& x, Context& ctx, VectorType* pNormal = 0, int* errorMask = 0) const = 0;
+		VectorType project(const VectorType& x, VectorType* pNormal = 0, int* errorMask = 0) const
+		{ return project(x, defaultContext(), pNormal, errorMask); }
 
 		/** \returns whether \a x is inside the restricted surface definition domain */
-		virtual bool isInDomain(const VectorType& x) const;
+		virtual bool isInDomain(const VectorType& x, Context& ctx) const;
+		bool isInDomain(const VectorType& x) const
+		{ return isInDomain(x, defaultContext()); }
 
 		/** \returns the mean curvature from the gradient vector and Hessian matrix.
 			*/
@@ -148,8 +202,22 @@ class MlsSurface
 
 		void computeVertexRaddi(const int nbNeighbors = 16);
 	protected:
-		void computeNeighborhood(const VectorType& x, bool computeDerivatives) const;
-		void requestSecondDerivatives() const;
+		void computeNeighborhood(const VectorType& x, bool computeDerivatives, Context& ctx) const;
+		void requestSecondDerivatives(Context& ctx) const;
+
+		/** the context of the queries without a context, created at the first use */
+		Context& defaultContext() const
+		{
+			if (!mDefaultContext)
+				mDefaultContext = createContext();
+			return *mDefaultContext;
+		}
+		/** the parameters changed: the cached values of the default context are not valid anymore */
+		void invalidateDefaultContext()
+		{
+			delete mDefaultContext;
+			mDefaultContext = 0;
+		}
 
 		struct PointToPointSqDist
 		{
@@ -187,14 +255,7 @@ class MlsSurface
 		float mDomainRadiusScale;
 		float mDomainNormalScale;
 
-		// cached values:
-		mutable bool mCachedQueryPointIsOK;
-		mutable VectorType mCachedQueryPoint;
-		mutable Neighborhood<Scalar> mNeighborhood;
-		mutable std::vector<Scalar> mCachedWeights;
-		mutable std::vector<Scalar> mCachedWeightDerivatives;
-		mutable std::vector<VectorType> mCachedWeightGradients;
-		mutable std::vector<Scalar> mCachedWeightSecondDerivatives;
+		mutable Context* mDefaultContext;
 };
 
 } // namespace
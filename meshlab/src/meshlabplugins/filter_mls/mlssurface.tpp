@@ -33,7 +33,7 @@ namespace GaelMls {
 // MlsSurface<_Scalar>::MlsSurface(const MeshModel& m)
 // 	: mMesh(m)
 // {
-// 	mCachedQueryPointIsOK = false;
+// 	invalidateDefaultContext();
 //
 // 	mPoints.resize(m.cm.vert.size());
 // 	mNormals.resize(m.cm.vert.size());
@@ -59,7 +59,7 @@ template<typename _MeshType>
 void MlsSurface<_MeshType>::setFilterScale(Scalar v)
 {
 	mFilterScale = v;
-	mCachedQueryPointIsOK = false;
+	invalidateDefaultContext();
 	if (mBallTree)
 		mBallTree->setRadiusScale(mFilterScale);
 }
@@ -68,28 +68,28 @@ template<typename _MeshType>
 void MlsSurface<_MeshType>::setMaxProjectionIters(int n)
 {
 	mMaxNofProjectionIterations = n;
-	mCachedQueryPointIsOK = false;
+	invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void MlsSurface<_MeshType>::setProjectionAccuracy(Scalar v)
 {
 	mProjectionAccuracy = v;
-	mCachedQueryPointIsOK = false;
+	invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void MlsSurface<_MeshType>::setGradientHint(int h)
 {
 	mGradientHint = h;
-	mCachedQueryPointIsOK = false;
+	invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void MlsSurface<_MeshType>::setHessianHint(int h)
 {
 	mHessianHint = h;
-	mCachedQueryPointIsOK = false;
+	invalidateDefaultContext();
 }
 
 template<typename _MeshType>
@@ -139,67 +139,74 @@ void MlsSurface<_MeshType>::computeVertexRaddi(const int nbNeighbors)
 }
 
 template<typename _MeshType>
-void MlsSurface<_MeshType>::computeNeighborhood(const VectorType& x, bool computeDerivatives) const
+void MlsSurface<_MeshType>::updateBallTree() const
 {
 	if (!mBallTree)
 	{
 		const_cast<BallTree<Scalar>*&>(mBallTree) = new BallTree<Scalar>(positions(), radii());
-		const_cast<BallTree<Scalar>*>(mBallTree)->setRadiusScale(mFilterScale);
+		mBallTree->setRadiusScale(mFilterScale);
 	}
-	mBallTree->computeNeighbors(x, &mNeighborhood);
-	size_t nofSamples = mNeighborhood.size();
+	mBallTree->update();
+}
+
+template<typename _MeshType>
+void MlsSurface<_MeshType>::computeNeighborhood(const VectorType& x, bool computeDerivatives, Context& ctx) const
+{
+	updateBallTree();
+	mBallTree->computeNeighbors(x, &ctx.mNeighborhood);
+	size_t nofSamples = ctx.mNeighborhood.size();
 
 	// compute spatial weights and partial derivatives
-	mCachedWeights.resize(nofSamples);
+	ctx.mCachedWeights.resize(nofSamples);
 	if (computeDerivatives)
 	{
-		mCachedWeightDerivatives.resize(nofSamples);
-		mCachedWeightGradients.resize(nofSamples);
+		ctx.mCachedWeightDerivatives.resize(nofSamples);
+		ctx.mCachedWeightGradients.resize(nofSamples);
 	}
 	else
-		mCachedWeightGradients.clear();
+		ctx.mCachedWeightGradients.clear();
 
 	for (size_t i=0; i<nofSamples; i++)
 	{
-		int id = mNeighborhood.index(i);
+		int id = ctx.mNeighborhood.index(i);
 		Scalar s = 1./(mPoints[id].cR()*mFilterScale);
 		s = s*s;
-		Scalar w = Scalar(1) - mNeighborhood.squaredDistance(i) * s;
+		Scalar w = Scalar(1) - ctx.mNeighborhood.squaredDistance(i) * s;
 		if (w<0)
 			w = 0;
 		Scalar aux = w;
 		w = w * w;
 		w = w * w;
-		mCachedWeights[i] = w;
+		ctx.mCachedWeights[i] = w;
 
 		if (computeDerivatives)
 		{
-			mCachedWeightDerivatives[i] = (-2. * s) * (4. * aux * aux * aux);
-			mCachedWeightGradients[i]  = (x - mPoints[id].cP()) * mCachedWeightDerivatives[i];
+			ctx.mCachedWeightDerivatives[i] = (-2. * s) * (4. * aux * aux * aux);
+			ctx.mCachedWeightGradients[i]  = (x - mPoints[id].cP()) * ctx.mCachedWeightDerivatives[i];
 		}
 	}
 }
 
 template<typename _MeshType>
-void MlsSurface<_MeshType>::requestSecondDerivatives() const
+void MlsSurface<_MeshType>::requestSecondDerivatives(Context& ctx) const
 {
 	//if (!mSecondDerivativeUptodate)
 	{
-		size_t nofSamples = mNeighborhood.size();
-		if (nofSamples>mCachedWeightSecondDerivatives.size())
-			mCachedWeightSecondDerivatives.resize(nofSamples+10);
+		size_t nofSamples = ctx.mNeighborhood.size();
+		if (nofSamples>ctx.mCachedWeightSecondDerivatives.size())
+			ctx.mCachedWeightSecondDerivatives.resize(nofSamples+10);
 
 		{
 			for (size_t i=0 ; i<nofSamples ; ++i)
 			{
-				int id = mNeighborhood.index(i);
+				int id = ctx.mNeighborhood.index(i);
 				Scalar s = 1./(mPoints[id].cR()*mFilterScale);
 				s = s*s;
-				Scalar x2 = s * mNeighborhood.squaredDistance(i);
+				Scalar x2 = s * ctx.mNeighborhood.squaredDistance(i);
 				x2 = 1.0 - x2;
 				if (x2<0)
 					x2 = 0.;
-				mCachedWeightSecondDerivatives[i] = (4.0*s*s) * (12.0 * x2 * x2);
+				ctx.mCachedWeightSecondDerivatives[i] = (4.0*s*s) * (12.0 * x2 * x2);
 			}
 		}
 		//mSecondDerivativeUptodate = true;
@@ -215,13 +222,13 @@ MlsSurface<_MeshType>::meanCurvature(const VectorType& gradient, const MatrixTyp
 }
 
 template<typename _MeshType>
-bool MlsSurface<_MeshType>::isInDomain(const VectorType& x) const
+bool MlsSurface<_MeshType>::isInDomain(const VectorType& x, Context& ctx) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		computeNeighborhood(x, false);
+		computeNeighborhood(x, false, ctx);
 	}
-	int nb = mNeighborhood.size();
+	int nb = ctx.mNeighborhood.size();
 	if (nb<mDomainMinNofNeighbors)
 		return false;
 
@@ -232,10 +239,10 @@ bool MlsSurface<_MeshType>::isInDomain(const VectorType& x) const
 	{
 		while (out && i<nb)
 		{
-			int id = mNeighborhood.index(i);
+			int id = ctx.mNeighborhood.index(i);
 			Scalar rs2 = mPoints[id].cR() * mDomainRadiusScale;
 			rs2 = rs2*rs2;
-			out = mNeighborhood.squaredDistance(i) > rs2;
+			out = ctx.mNeighborhood.squaredDistance(i) > rs2;
 			++i;
 		}
 	}
@@ -244,11 +251,11 @@ bool MlsSurface<_MeshType>::isInDomain(const VectorType& x) const
 		Scalar s = 1./(mDomainNormalScale*mDomainNormalScale) - 1.f;
 		while (out && i<nb)
 		{
-			int id = mNeighborhood.index(i);
+			int id = ctx.mNeighborhood.index(i);
 			Scalar rs2 = mPoints[id].cR() * mDomainRadiusScale;
 			rs2 = rs2*rs2;
 			Scalar dn = mPoints[id].cN().dot(x-mPoints[id].cP());
-			out = (mNeighborhood.squaredDistance(i) + s*dn*dn) > rs2;
+			out = (ctx.mNeighborhood.squaredDistance(i) + s*dn*dn) > rs2;
 			++i;
 		}
 	}
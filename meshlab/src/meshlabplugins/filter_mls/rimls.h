@@ -37,13 +37,7 @@ class RIMLS : public MlsSurface<_MeshType>
 		typedef typename Base::Scalar Scalar;
 		typedef typename Base::VectorType VectorType;
 		typedef typename Base::MatrixType MatrixType;
-		using Base::mCachedQueryPointIsOK;
-		using Base::mCachedQueryPoint;
-		using Base::mNeighborhood;
-		using Base::mCachedWeights;
-		using Base::mCachedWeightDerivatives;
-		using Base::mCachedWeightGradients;
-		using Base::mCachedWeightSecondDerivatives;
+		typedef typename Base::Context BaseContext;
 		using Base::mBallTree;
 		using Base::mPoints;
 		using Base::mFilterScale;
@@ -53,6 +47,20 @@ class RIMLS : public MlsSurface<_MeshType>
 
 	public:
 
+		/** the query state of RIMLS: the potential, the gradient and the refitting weights at the last query point */
+		class Context : public BaseContext
+		{
+			public:
+				VectorType mCachedGradient;
+				Scalar mCachedPotential;
+
+				Scalar mCachedSumW;
+				std::vector<Scalar> mCachedRefittingWeights;
+				VectorType mCachedSumN;
+				VectorType mCachedSumGradWeight;
+				VectorType mCachedSumGradPotential;
+		};
+
 		RIMLS(const MeshType& points)
 			: Base(points)
 		{
@@ -63,10 +71,17 @@ class RIMLS : public MlsSurface<_MeshType>
 			mMaxRefittingIters = 3;
 		}
 
-		virtual Scalar potential(const VectorType& x, int* errorMask = 0) const;
-		virtual VectorType gradient(const VectorType& x, int* errorMask = 0) const;
-		virtual MatrixType hessian(const VectorType& x, int* errorMask = 0) const;
-		virtual VectorType project(const VectorType& x, VectorType* pNormal = 0, int* errorMask = 0) const;
+		virtual Context* createContext() const { return new Context(); }
+
+		using Base::potential;
+		using Base::gradient;
+		using Base::hessian;
+		using Base::project;
+
+		virtual Scalar potential(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual VectorType gradient(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual MatrixType hessian(const VectorType& x, BaseContext& ctx, int* errorMask = 0) const;
+		virtual VectorType project(const VectorType& x, BaseContext& ctx, VectorType* pNormal = 0, int* errorMask = 0) const;
 
 		void setSigmaR(Scalar v);
 		void setSigmaN(Scalar v);
@@ -75,8 +90,8 @@ class RIMLS : public MlsSurface<_MeshType>
 		void setMaxRefittingIters(int n);
 
 	protected:
-		bool computePotentialAndGradient(const VectorType& x) const;
-		bool mlsHessian(const VectorType& x, MatrixType& hessian) const;
+		bool computePotentialAndGradient(const VectorType& x, Context& ctx) const;
+		bool mlsHessian(const VectorType& x, MatrixType& hessian, Context& ctx) const;
 
 	protected:
 
@@ -85,16 +100,6 @@ class RIMLS : public MlsSurface<_MeshType>
 		Scalar mRefittingThreshold;
 		Scalar mSigmaN;
 		Scalar mSigmaR;
-
-		// cached values:
-		mutable VectorType mCachedGradient;
-		mutable Scalar mCachedPotential;
-		
-		mutable Scalar mCachedSumW;
-		mutable std::vector<Scalar> mCachedRefittingWeights;;
-		mutable VectorType mCachedSumN;
-		mutable VectorType mCachedSumGradWeight;
-		mutable VectorType mCachedSumGradPotential;
 };
 
 }
@@ -44,43 +44,44 @@ template<typename _MeshType>
 void RIMLS<_MeshType>::setSigmaR(Scalar v)
 {
 	mSigmaR = v;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void RIMLS<_MeshType>::setSigmaN(Scalar v)
 {
 	mSigmaN = v;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void RIMLS<_MeshType>::setRefittingThreshold(Scalar v)
 {
 	mRefittingThreshold = v;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void RIMLS<_MeshType>::setMinRefittingIters(int n)
 {
 	mMinRefittingIters = n;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
 void RIMLS<_MeshType>::setMaxRefittingIters(int n)
 {
 	mMaxRefittingIters = n;
-	mCachedQueryPointIsOK = false;
+	Base::invalidateDefaultContext();
 }
 
 template<typename _MeshType>
-typename RIMLS<_MeshType>::Scalar RIMLS<_MeshType>::potential(const VectorType& x, int* errorMask) const
+typename RIMLS<_MeshType>::Scalar RIMLS<_MeshType>::potential(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!computePotentialAndGradient(x))
+		if (!computePotentialAndGradient(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -88,15 +89,16 @@ typename RIMLS<_MeshType>::Scalar RIMLS<_MeshType>::potential(const VectorType&
 		}
 	}
 
-	return mCachedPotential;
+	return ctx.mCachedPotential;
 }
 
 template<typename _MeshType>
-typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::gradient(const VectorType& x, int* errorMask) const
+typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::gradient(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!computePotentialAndGradient(x))
+		if (!computePotentialAndGradient(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -104,15 +106,16 @@ typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::gradient(const VectorTyp
 		}
 	}
 
-	return mCachedGradient;
+	return ctx.mCachedGradient;
 }
 
 template<typename _MeshType>
-typename RIMLS<_MeshType>::MatrixType RIMLS<_MeshType>::hessian(const VectorType& x, int* errorMask) const
+typename RIMLS<_MeshType>::MatrixType RIMLS<_MeshType>::hessian(const VectorType& x, BaseContext& bctx, int* errorMask) const
 {
-	if ((!mCachedQueryPointIsOK) || mCachedQueryPoint!=x)
+	Context& ctx = static_cast<Context&>(bctx);
+	if ((!ctx.mCachedQueryPointIsOK) || ctx.mCachedQueryPoint!=x)
 	{
-		if (!computePotentialAndGradient(x))
+		if (!computePotentialAndGradient(x, ctx))
 		{
 			if (errorMask)
 				*errorMask = MLS_TOO_FAR;
@@ -121,20 +124,21 @@ typename RIMLS<_MeshType>::MatrixType RIMLS<_MeshType>::hessian(const VectorType
 	}
 
 	MatrixType hessian;
-	mlsHessian(x, hessian);
+	mlsHessian(x, hessian, ctx);
 	return hessian;
 }
 
 template<typename _MeshType>
-typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::project(const VectorType& x, VectorType* pNormal, int* errorMask) const
+typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::project(const VectorType& x, BaseContext& bctx, VectorType* pNormal, int* errorMask) const
 {
+	Context& ctx = static_cast<Context&>(bctx);
 	int iterationCount = 0;
 	VectorType position = x;
 	VectorType normal;
 	Scalar delta;
 	Scalar epsilon = mAveragePointSpacing * mProjectionAccuracy;
 	do {
-			if (!computePotentialAndGradient(position))
+			if (!computePotentialAndGradient(position, ctx))
 			{
 				if (errorMask)
 					*errorMask = MLS_TOO_FAR;
@@ -142,9 +146,9 @@ typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::project(const VectorType
 				return x;
 			}
 
-			normal = mCachedGradient;
+			normal = ctx.mCachedGradient;
 			normal.Normalize();
-			delta = mCachedPotential;
+			delta = ctx.mCachedPotential;
 			position = position - normal*delta;
 	} while ( fabs(delta)>epsilon && ++iterationCount<mMaxNofProjectionIterations);
 
@@ -158,22 +162,22 @@ typename RIMLS<_MeshType>::VectorType RIMLS<_MeshType>::project(const VectorType
 }
 
 template<typename _MeshType>
-bool RIMLS<_MeshType>::computePotentialAndGradient(const VectorType& x) const
+bool RIMLS<_MeshType>::computePotentialAndGradient(const VectorType& x, Context& ctx) const
 {
-		Base::computeNeighborhood(x, true);
-		unsigned int nofSamples = mNeighborhood.size();
+		Base::computeNeighborhood(x, true, ctx);
+		unsigned int nofSamples = ctx.mNeighborhood.size();
 
 		if (nofSamples<1)
 		{
-				mCachedGradient.SetZero();
-				mCachedQueryPoint = x;
-				mCachedPotential  = 1e9;
-				mCachedQueryPointIsOK = false;
+				ctx.mCachedGradient.SetZero();
+				ctx.mCachedQueryPoint = x;
+				ctx.mCachedPotential  = 1e9;
+				ctx.mCachedQueryPointIsOK = false;
 				return false;
 		}
 
-		if (mCachedRefittingWeights.size()<nofSamples)
-			mCachedRefittingWeights.resize(nofSamples+5);
+		if (ctx.mCachedRefittingWeights.size()<nofSamples)
+			ctx.mCachedRefittingWeights.resize(nofSamples+5);
 
 		VectorType source     = x;
 		VectorType grad; grad.SetZero();
@@ -200,7 +204,7 @@ bool RIMLS<_MeshType>::computePotentialAndGradient(const VectorType& x) const
 
 				for (unsigned int i=0; i<nofSamples; i++)
 				{
-						int id = mNeighborhood.index(i);
+						int id = ctx.mNeighborhood.index(i);
 						VectorType diff = source - mPoints[id].cP();
 						VectorType normal = mPoints[id].cN();
 						Scalar f = Dot(diff, normal);
@@ -215,9 +219,9 @@ bool RIMLS<_MeshType>::computePotentialAndGradient(const VectorType& x) const
 //                     refittingWeight *= exp(-residual*residual * invSigmaR2);
 //                 }
 						}
-						mCachedRefittingWeights.at(i) = refittingWeight;
-						Scalar w = mCachedWeights.at(i) * refittingWeight;
-						VectorType gw = mCachedWeightGradients.at(i) * refittingWeight;
+						ctx.mCachedRefittingWeights.at(i) = refittingWeight;
+						Scalar w = ctx.mCachedWeights.at(i) * refittingWeight;
+						VectorType gw = ctx.mCachedWeightGradients.at(i) * refittingWeight;
 
 						sumGradWeight += gw;
 						sumGradWeightPotential += gw * f;
@@ -239,31 +243,31 @@ bool RIMLS<_MeshType>::computePotentialAndGradient(const VectorType& x) const
 		} while ( (iterationCount < mMinRefittingIters)
 				|| ( vcg::SquaredNorm(grad - previousGrad) > mRefittingThreshold && iterationCount < mMaxRefittingIters) );
 
-		mCachedGradient   = grad;
-		mCachedPotential  = potential;
-		mCachedQueryPoint = x;
-		mCachedQueryPointIsOK = true;
+		ctx.mCachedGradient   = grad;
+		ctx.mCachedPotential  = potential;
+		ctx.mCachedQueryPoint = x;
+		ctx.mCachedQueryPointIsOK = true;
 
-		mCachedSumGradWeight = sumGradWeight;
-		mCachedSumN = sumN;
-		mCachedSumW = sumW;
-		mCachedSumGradPotential = sumGradWeightPotential;
+		ctx.mCachedSumGradWeight = sumGradWeight;
+		ctx.mCachedSumN = sumN;
+		ctx.mCachedSumW = sumW;
+		ctx.mCachedSumGradPotential = sumGradWeightPotential;
 
 		return true;
 }
 
 template<typename _MeshType>
-bool RIMLS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) const
+bool RIMLS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian, Context& ctx) const
 {
-	this->requestSecondDerivatives();
+	this->requestSecondDerivatives(ctx);
 	// at this point we assume computePotentialAndGradient has been called first
 
-	uint nofSamples = mNeighborhood.size();
+	uint nofSamples = ctx.mNeighborhood.size();
 
-	const VectorType& sumGradWeight = mCachedSumGradWeight;
-	const VectorType& sumGradWeightPotential = mCachedSumGradPotential ;
-	const VectorType& sumN = mCachedSumN;
-	const Scalar& sumW = mCachedSumW;
+	const VectorType& sumGradWeight = ctx.mCachedSumGradWeight;
+	const VectorType& sumGradWeightPotential = ctx.mCachedSumGradPotential ;
+	const VectorType& sumN = ctx.mCachedSumN;
+	const Scalar& sumW = ctx.mCachedSumW;
 	const Scalar invW = 1.f/sumW;
 
 	for (uint k=0 ; k<3 ; ++k)
@@ -275,14 +279,14 @@ bool RIMLS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) cons
 
 		for (unsigned int i=0; i<nofSamples; i++)
 		{
-			int id = mNeighborhood.index(i);
+			int id = ctx.mNeighborhood.index(i);
 			VectorType p = mPoints[id].cP();
 			VectorType diff = x - p;
 			Scalar f = Dot(diff, mPoints[id].cN());
 
-			VectorType gradW = mCachedWeightGradients.at(i) * mCachedRefittingWeights.at(i);
-			VectorType dGradW = (x-p) * ( mCachedWeightSecondDerivatives.at(i) * (x[k]-p[k]) * mCachedRefittingWeights.at(i));
-			dGradW[k] += mCachedWeightDerivatives.at(i);
+			VectorType gradW = ctx.mCachedWeightGradients.at(i) * ctx.mCachedRefittingWeights.at(i);
+			VectorType dGradW = (x-p) * ( ctx.mCachedWeightSecondDerivatives.at(i) * (x[k]-p[k]) * ctx.mCachedRefittingWeights.at(i));
+			dGradW[k] += ctx.mCachedWeightDerivatives.at(i);
 
 			sumDGradWeight += dGradW;
 			sumDWeightNormal += mPoints[id].cN() * gradW[k];
@@ -292,9 +296,9 @@ bool RIMLS<_MeshType>::mlsHessian(const VectorType& x, MatrixType& hessian) cons
 
 		VectorType dGrad = (
 						sumDWeightNormal + sumGradWeightNk + sumDGradWeightPotential
-					- sumDGradWeight * mCachedPotential
-					- sumGradWeight * mCachedGradient[k]
-					- mCachedGradient * sumGradWeight[k] ) * invW;
+					- sumDGradWeight * ctx.mCachedPotential
+					- sumGradWeight * ctx.mCachedGradient[k]
+					- ctx.mCachedGradient * sumGradWeight[k] ) * invW;
 
 		hessian.SetColumn(k,dGrad);
 	}
@@ -12,4 +12,4 @@ HEADERS       += filter_plymc.h \
 SOURCES       += filter_plymc.cpp \
                  $$VCGDIR/wrap/ply/plylib.cpp
 
-TARGET        = filter_plymc
\ No newline at end of file
+TARGET        = filter_plymc
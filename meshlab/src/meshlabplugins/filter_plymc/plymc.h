@@ -49,6 +49,9 @@
 
 #include <vcg/simplex/edge/base.h>
 #include <stdarg.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "volume.h"
 #include "tri_edge_collapse_mc.h"
 namespace vcg {
@@ -125,6 +128,8 @@ namespace vcg {
             SimplificationFlag=false;
             VertSplatFlag=false;
             MergeColor=false;
+            ThreadNum=0;
+            MemoryMB=0;
             basename = "plymcout";
 		}
 
@@ -156,6 +161,8 @@ namespace vcg {
 		bool SimplificationFlag;
 		bool VertSplatFlag;
 		bool MergeColor;
+		int ThreadNum;  // number of sub blocks processed in parallel (0 means one for each processor)
+		int MemoryMB;   // memory for the volumes of all the sub blocks processed at once (0 means no limit)
 		std::string basename;
     std::vector<std::string> OutNameVec;
     std::vector<std::string> OutNameSimpVec;
@@ -165,7 +172,7 @@ namespace vcg {
 
     MeshProvider MP;
     Parameter p;
-    Volume<Voxelf> VV;
+    Volume<Voxelf> VV; // the whole volume, used to interize the meshes (the sub blocks have their own volumes)
 
 /// PLYMC Methods
 
@@ -215,6 +222,9 @@ bool InitMesh(SMesh &m, const char *filename, Matrix44f Tr)
           tri::UpdateFlags<SMesh>::FaceBorderFromVF(m);
           tri::UpdateQuality<SMesh>::VertexGeodesicFromBorder(m);
         }
+      // Calcolo qualita geodesica PER FACCIA come media di quelle per vertice
+      for(typename SMesh::FaceIterator fi=m.face.begin(); fi!=m.face.end();++fi)
+          (*fi).Q()=((*fi).V(0)->Q()+(*fi).V(1)->Q()+(*fi).V(2)->Q())/3.0f;
     }
 
     tri::UpdatePosition<SMesh>::Matrix(m,Tr,true);
@@ -228,8 +238,9 @@ bool InitMesh(SMesh &m, const char *filename, Matrix44f Tr)
 
 // This function add a mesh (or a point cloud to the volume)
 // the point cloud MUST have normalized vertex normals.
+// The mesh is not modified, so it can be added at the same time to the volumes of many sub blocks.
 
-bool AddMeshToVolumeM(SMesh &m, std::string meshname, const double w )
+bool AddMeshToVolumeM(Volume<Voxelf> &VV, SMesh &m, std::string meshname, const double w )
 {
     typename SMesh::VertexIterator vi;
     typename SMesh::FaceIterator fi;
@@ -248,9 +259,8 @@ bool AddMeshToVolumeM(SMesh &m, std::string meshname, const double w )
     if(!p.VertSplatFlag)
     {
             float minq=std::numeric_limits<float>::max(), maxq=-std::numeric_limits<float>::max();
-            // Calcolo range qualita geodesica PER FACCIA come media di quelle per vertice
+            // Calcolo range qualita geodesica PER FACCIA (calcolata in InitMesh)
             for(fi=m.face.begin(); fi!=m.face.end();++fi){
-                (*fi).Q()=((*fi).V(0)->Q()+(*fi).V(1)->Q()+(*fi).V(2)->Q())/3.0f;
                 minq=std::min((*fi).Q(),minq);
                 maxq=std::max((*fi).Q(),maxq);
             }
@@ -344,34 +354,100 @@ void Process(vcg::CallBackPos *cb=0)
     if(p.NCell>0) cells = (__int64)(p.NCell)*(__int64)(1000);
     else cells = (__int64)(voxdim[0]/p.VoxSize) * (__int64)(voxdim[1]/p.VoxSize) *(__int64)(voxdim[2]/p.VoxSize) ;
 
+    Box3f fullbf; fullbf.Import(fullb);
     {
-        Volume<Voxelf> B; // local to this small block
-
-        Box3f fullbf; fullbf.Import(fullb);
-        B.Init(cells,fullbf,p.IDiv,p.IPosS);
-        B.Dump(stdout);
-        if(p.WideSize>0) p.WideNum=p.WideSize/B.voxel.Norm();
+        // The voxel size is the same for all the sub blocks:
+        // VV is used to interize the meshes, that are loaded once and shared by all the sub blocks.
+        VV.Init(cells,fullbf,p.IDiv,p.IPosS);
+        VV.Dump(stdout);
+        if(p.WideSize>0) p.WideNum=p.WideSize/VV.voxel.Norm();
 
         // Now the volume has been determined; the quality threshold in absolute units can be computed
         if(p.QualitySmoothAbs==0)
-            p.QualitySmoothAbs= p.QualitySmoothVox * B.voxel.Norm();
+            p.QualitySmoothAbs= p.QualitySmoothVox * VV.voxel.Norm();
     }
 
-
-
+    std::vector<Point3i> blockVec;
     for(p.IPos[0]=p.IPosS[0];p.IPos[0]<=p.IPosE[0];++p.IPos[0])
       for(p.IPos[1]=p.IPosS[1];p.IPos[1]<=p.IPosE[1];++p.IPos[1])
 	for(p.IPos[2]=p.IPosS[2];p.IPos[2]<=p.IPosE[2];++p.IPos[2])
 	  if((p.IPos[2]+(p.IPos[1]*p.IDiv[2])+(p.IPos[0]*p.IDiv[2]*p.IDiv[1])) >=
 	     (p.IPosB[2]+(p.IPosB[1]*p.IDiv[2])+(p.IPosB[0]*p.IDiv[2]*p.IDiv[1]))) // skip until IPos >= IPosB
-	      {
-		printf("----------- SubBlock %2i %2i %2i ----------\n",p.IPos[0],p.IPos[1],p.IPos[2]);
-		//Volume<Voxelf> B;
-		int t0=clock();
+	    blockVec.push_back(p.IPos);
+	  else
+	    printf("----------- skipping SubBlock %2i %2i %2i ----------\n",p.IPos[0],p.IPos[1],p.IPos[2]);
+    if(blockVec.empty()) return;
+
+    // The sub blocks are independent: they are processed in parallel, each one with its own volumes,
+    // as many at once as the memory budget allows for their (dense) volumes.
+    int threadNum=1;
+#ifdef _OPENMP
+    threadNum = (p.ThreadNum>0) ? p.ThreadNum : omp_get_max_threads();
+#endif
+    if(p.VerboseLevel>0) threadNum=1; // the debug slices of all the sub blocks have the same names
+    if(p.MemoryMB>0)
+    {
+      const int volumeNum = (p.SmoothNum>0 || p.IntraSmoothFlag) ? 3 : 2;
+      const double blockMB = double(VV.ssz[0])*double(VV.ssz[1])*double(VV.ssz[2])*sizeof(Voxelf)*volumeNum/(1024.0*1024.0);
+      threadNum = std::max(1,std::min(threadNum,int(p.MemoryMB/blockMB)));
+    }
+    threadNum = std::min(threadNum,int(blockVec.size()));
+    printf("Processing %i SubBlocks with %i threads\n",int(blockVec.size()),threadNum);
+
+    std::vector<std::string> outNameVec(blockVec.size()), outNameSimpVec(blockVec.size());
+    int failed=0, doneNum=0;
+    // with a single thread the progress is given also inside each sub block, within its share of the total
+    vcg::CallBackPos *blockCb = (threadNum==1) ? cb : 0;
+#pragma omp parallel for schedule(dynamic,1) num_threads(threadNum)
+    for(int bi=0;bi<int(blockVec.size());++bi)
+    {
+      int tAdd=0,tMC=0,tSav=0,done;
+      if(!ProcessSubBlock(blockVec[bi],fullbf,cells,saveMask,outNameVec[bi],outNameSimpVec[bi],tAdd,tMC,tSav,blockCb,
+                          (100*bi)/int(blockVec.size()),(100*(bi+1))/int(blockVec.size())))
+      {
+#pragma omp atomic
+        ++failed;
+      }
+#pragma omp critical(PlyMCTimes)
+      {
+        TotAdd+=tAdd; TotMC+=tMC; TotSav+=tSav;
+        done=++doneNum;
+        printf("Adding Meshes %8i\n",TotAdd);
+        printf("MC            %8i\n",TotMC);
+        printf("Saving        %8i\n",TotSav);
+        printf("Total         %8i\n",TotAdd+TotMC+TotSav);
+      }
+      // the callback can be called only by the thread that started the processing
+#ifdef _OPENMP
+      if(cb && omp_get_thread_num()==0) cb((100*done)/int(blockVec.size()),"Merging SubBlocks");
+#else
+      if(cb) cb((100*done)/int(blockVec.size()),"Merging SubBlocks");
+#endif
+    }
+    if(failed) return;
 
-		Box3f fullbf; fullbf.Import(fullb);
+    // the names of the saved meshes are in lexicographic order of the sub blocks, as if they were processed serially
+    for(size_t bi=0;bi<blockVec.size();++bi)
+      if(!outNameVec[bi].empty())
+      {
+        p.OutNameVec.push_back(outNameVec[bi]);
+        if(p.SimplificationFlag) p.OutNameSimpVec.push_back(outNameSimpVec[bi]);
+      }
+}
 
-		VV.Init(cells,fullbf,p.IDiv,p.IPos);
+// Build the volume of a sub block, extract its surface and save it (as soon as it is ready).
+// It can be called in parallel for different sub blocks: the meshes are shared (read only) through the MeshProvider.
+// The callback, if any, must be callable from the thread that runs it;
+// the progress of the sub block is reported in the range [cbStart,cbEnd].
+bool ProcessSubBlock(Point3i IPos, const Box3f &fullbf, __int64 cells, int saveMask,
+                     std::string &outName, std::string &outNameSimp, int &TotAdd, int &TotMC, int &TotSav,
+                     vcg::CallBackPos *cb=0, int cbStart=0, int cbEnd=100)
+{
+		printf("----------- SubBlock %2i %2i %2i ----------\n",IPos[0],IPos[1],IPos[2]);
+		Volume<Voxelf> VV; // local to this sub block
+		int t0=clock();
+
+		VV.Init(cells,fullbf,p.IDiv,IPos);
 		printf("\n\n --------------- Allocated subcells. %i\n",VV.Allocated());
 
 		std::string filename=p.basename;
@@ -387,23 +463,29 @@ void Process(vcg::CallBackPos *cb=0)
     for(int i=0;i<MP.size();++i)
 		{
 		  Box3f bbb= MP.bb(i);
-      /**********************/
-      if(cb) cb((i+1)/MP.size(),"Step 1: Converting meshes into volume");
-      /**********************/
+      if(cb) cb(cbStart+((cbEnd-cbStart)*(i+1))/(2*MP.size()),"Step 1: Converting meshes into volume");
       // if bbox of mesh #i is part of the subblock, then process it
 		  if(bbb.Collide(VV.SubBoxSafe))
 		  {
 		    SMesh *sm;
-		    if(!MP.Find(i,sm) )
+		    bool loaded=true;
+		    // meshes are loaded only once by one of the threads; Find locks the mesh until Release
+#pragma omp critical(PlyMCMeshCache)
 		    {
-          res = InitMesh(*sm,MP.MeshName(i).c_str(),MP.Tr(i));
-          if(!res)
+		      if(!MP.Find(i,sm) )
+		      {
+            loaded = InitMesh(*sm,MP.MeshName(i).c_str(),MP.Tr(i));
+            if(!loaded) MP.Release(i,false);
+		      }
+		    }
+          if(!loaded)
           {
             printf("Failed Init of mesh %s",MP.MeshName(i).c_str());
-            return;
+            return false;
           }
-		    }
-		    res |= AddMeshToVolumeM(*sm, MP.MeshName(i),MP.W(i));
+		    res |= AddMeshToVolumeM(VV, *sm, MP.MeshName(i),MP.W(i));
+#pragma omp critical(PlyMCMeshCache)
+		    MP.Release(i);
 		  }
 		}
 
@@ -459,10 +541,8 @@ void Process(vcg::CallBackPos *cb=0)
 		  MarchingCubes	mc(me, walker);
 		  Box3i currentSubBox=VV.SubPartSafe;
 		  Point3i currentSubBoxRes=VV.ssz;
-      /**********************/
-      if(cb) cb(50,"Step 2: Marching Cube...");
+      if(cb) cb(cbStart+(cbEnd-cbStart)/2,"Step 2: Marching Cube...");
       else printf("Step 2: Marching Cube...\n");
-      /**********************/
       walker.BuildMesh(me,VV,mc,currentSubBox,currentSubBoxRes);
 
       typename MCMesh::VertexIterator vi;
@@ -485,22 +565,20 @@ void Process(vcg::CallBackPos *cb=0)
 		  TotMC+=t2-t1;
 		  if(me.vn >0 || me.fn >0)
 		  {
-        p.OutNameVec.push_back(filename+std::string(".ply"));
-        tri::io::ExporterPLY<MCMesh>::Save(me,p.OutNameVec.back().c_str(),saveMask);
+        outName=filename+std::string(".ply");
+        tri::io::ExporterPLY<MCMesh>::Save(me,outName.c_str(),saveMask);
         if(p.SimplificationFlag)
         {
-          /**********************/
-          if(cb) cb(50,"Step 3: Simplify mesh...");
+          if(cb) cb(cbStart+(3*(cbEnd-cbStart))/4,"Step 3: Simplify mesh...");
           else printf("Step 3: Simplify mesh...\n");
-          /**********************/
-          p.OutNameSimpVec.push_back(filename+std::string(".d.ply"));
+          outNameSimp=filename+std::string(".d.ply");
           me.face.EnableVFAdjacency();
           MCSimplify<MCMesh>(me, VV.voxel[0]/4.0);
           tri::Allocator<MCMesh>::CompactFaceVector(me);
           me.face.EnableFFAdjacency();
           tri::Clean<MCMesh>::RemoveTVertexByFlip(me,20,true);
           tri::Clean<MCMesh>::RemoveFaceFoldByFlip(me);
-          tri::io::ExporterPLY<MCMesh>::Save(me,p.OutNameSimpVec.back().c_str(),saveMask);
+          tri::io::ExporterPLY<MCMesh>::Save(me,outNameSimp.c_str(),saveMask);
         }
 		  }
 		  int t3=clock();  //--------
@@ -509,15 +587,7 @@ void Process(vcg::CallBackPos *cb=0)
 		}
 
 		printf("Mesh Saved '%s':  %8d vertices, %8d faces                   \n",(filename+std::string(".ply")).c_str(),me.vn,me.fn);
-		printf("Adding Meshes %8i\n",TotAdd);
-		printf("MC            %8i\n",TotMC);
-		printf("Saving        %8i\n",TotSav);
-		printf("Total         %8i\n",TotAdd+TotMC+TotSav);
-	      }
-	    else
-	      {
-		 printf("----------- skipping SubBlock %2i %2i %2i ----------\n",p.IPos[0],p.IPos[1],p.IPos[2]);
-	      }
+		return true;
 }
 
 
@@ -1,3 +1,4 @@
+include (../../general.pri)
 TARGET = plymc
 DEPENDPATH += .
 INCLUDEPATH += ../../../../vcglib \
@@ -25,4 +26,3 @@ HEADERS = plymc.h \
     ../../meshlab/alnParser.h
 
 #macx-g++:DEFINES += NDEBUG
-
@@ -39,6 +39,8 @@ void usage()
       " -s...   Compute only a subvolume (specify 6 integers) \n"
       " -S...   Compute all the subvolumes of a partition (specify 3 int) \n"
       " -X...   Compute a range of the the subvolumes of a partition (specify 9 int)\n"
+      " -T#     Set the number of subvolumes processed in parallel (default 0: one for each processor)\n"
+      " -m#     Set the memory (in MB) for the volumes of the subvolumes processed in parallel (default 0: no limit)\n"
       " -M      Apply a 'safe' simplification step that removes only the unecessary triangles\n"
       " -w#     Set distance field Expansion factor in voxel (default 3)\n"
       " -W#     Set distance field Exp. as an absolute dist (override -w)\n"
@@ -131,6 +133,8 @@ int main(int argc, char *argv[])
 	case 'o' :  p.basename=argv[i]+2;printf("Setting Basename  to %s\n",MYbasename.c_str());break;
 	case 'C' :  pmc.MP.setCacheSize(atoi(argv[i]+2));printf("Setting MaxSize of MeshCache to %i\n",atoi(argv[i]+2)); break;
 	case 'c' :  p.NCell   =atoi(argv[i]+2);printf("Setting NCell  to %i\n",p.NCell); break;
+	case 'T' :  p.ThreadNum=atoi(argv[i]+2);printf("Setting ThreadNum to %i\n",p.ThreadNum); break;
+	case 'm' :  p.MemoryMB =atoi(argv[i]+2);printf("Setting MemoryMB to %i\n",p.MemoryMB); break;
 	case 'v' :  p.SaveVolumeFlag=true; VolumeBaseName=argv[i]+2; printf("Saving Volume enabled: volume Basename  to %s\n",VolumeBaseName.c_str());break;
 	case 'V' :  p.VoxSize =atof(argv[i]+2);printf("Setting VoxSize  to %f; overridden NCell\n",p.VoxSize);p.NCell=0;break;
 	case 'w' :  p.WideNum =atoi(argv[i]+2);printf("Setting WideNum  to %i\n",p.WideNum);break;
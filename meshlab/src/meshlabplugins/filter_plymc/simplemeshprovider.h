@@ -16,10 +16,11 @@ template<class TriMeshType>
     class Pair
     {
     public:
-        Pair(){used=0;}
+        Pair(){used=0;locked=0;}
         TriMeshType *M;
         std::string Name;
         int used; // 'data' dell'ultimo accesso. si butta fuori quello lru
+        int locked; // number of Find not yet released: a locked mesh is never given back for another mesh
     };
 
     std::list<Pair> MV;
@@ -36,6 +37,8 @@ public:
 // Restituisce true se la mesh e' in cache;
 // restituisce in ogni caso il puntatore dove sta (o dovrebbe stare) la mesh
 // Gestione LRU
+// The mesh stays locked until it is released, so that it can be shared among many threads
+// (the cache is not thread safe itself, the calls to Find and Release must be serialized).
 
     bool Find(std::string &name,  TriMeshType * &sm)
     {
@@ -48,7 +51,7 @@ public:
 
     for(mi=MV.begin();mi!=MV.end();++mi)
         {
-            if((*mi).used<last)
+            if((*mi).used<last && (*mi).locked==0)
             {
                 last=(*mi).used;
                 oldest=mi;
@@ -56,26 +59,45 @@ public:
             if((*mi).Name==name) {
                 sm=(*mi).M;
                 (*mi).used++;
+                (*mi).locked++;
                 return true;
             }
         }
 
     // we have not found the requested mesh
-    // either allocate a new mesh or give back a previous mesh.
+    // either allocate a new mesh or give back a previous mesh (if it is not locked).
 
-    if(MV.size()>MaxSize)	{
+    if(MV.size()>MaxSize && last!=std::numeric_limits<int>::max())	{
+        // a fresh mesh, nothing of the previous one must survive in the new one
+        delete (*oldest).M;
+        (*oldest).M=new TriMeshType();
         sm=(*oldest).M;
         (*oldest).used=0;
+        (*oldest).locked=1;
         (*oldest).Name=name;
     }	else	{
         MV.push_back(Pair());
         MV.back().Name=name;
     MV.back().M=new TriMeshType();
+        MV.back().locked=1;
         sm=MV.back().M;
     }
     return false;
 }
 
+    // Unlock a mesh given by Find; if it is not valid (e.g. its loading failed) it is forgotten.
+    void Release(const std::string &name, bool valid=true)
+    {
+    typename std::list<Pair>::iterator mi;
+    for(mi=MV.begin();mi!=MV.end();++mi)
+        if((*mi).Name==name && (*mi).locked>0)
+        {
+            (*mi).locked--;
+            if(!valid) { (*mi).Name.clear(); (*mi).used=0; }
+            return;
+        }
+    }
+
 
     size_t MaxSize;
     size_t size() const {return MV.size();}
@@ -155,6 +177,11 @@ template<class TriMeshType>
         return MC.Find(meshnames[i],sm);
     }
 
+    void Release(int i, bool valid=true)
+    {
+        MC.Release(meshnames[i],valid);
+    }
+
     bool InitBBox()
     {
       fullBBox.SetNull();
@@ -27,8 +27,11 @@ private:
   // should be a divisor of bbox size (e.g. if bbox size is 256^3 resolution could be 128,64, etc)
 
 
+  TrivialWalker():_v_cs(0),_v_ns(0),_x_cs(0),_y_cs(0),_z_cs(0),_x_ns(0),_z_ns(0) {}
+
   void Init(const Box3i &bbox, const vcg::Point3i &resolution)
 	{
+		Clear();
 		_bbox				= bbox;
 		_resolution = resolution;
 		_cell_size.X() = _bbox.DimX()/_resolution.X();
@@ -47,7 +50,19 @@ private:
 	};
 
 	~TrivialWalker()
-	{}
+	{
+		Clear();
+	}
+
+	// free the slice caches
+	void Clear()
+	{
+		delete [] _x_cs; delete [] _y_cs; delete [] _z_cs;
+		delete [] _x_ns; delete [] _z_ns;
+		delete [] _v_cs; delete [] _v_ns;
+		_x_cs=_y_cs=_z_cs=_x_ns=_z_ns=0;
+		_v_cs=_v_ns=0;
+	}
 
   template<class EXTRACTOR_TYPE>
 	void BuildMesh(MeshType &mesh, VolumeType &volume, EXTRACTOR_TYPE &extractor)
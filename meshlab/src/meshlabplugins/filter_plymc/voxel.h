@@ -162,9 +162,7 @@ public:
 	void SetC(const Point3f &cc) 	{ c=cc;		}
 	const Color4b C4b() const 
 		{
-			static Color4b cc;
-			cc=Color4b(c[0],c[1],c[2],255);
-			return cc;
+			return Color4b(c[0],c[1],c[2],255);
 		}
 	inline void Blend( Voxelfc const & vx, scalar w)
 	{
@@ -44,11 +44,37 @@ add samplefilter
 #include "filter_poisson.h"
 #include "src/Geometry.h"
 #include "src/PoissonParam.h"
+#include "src/PointStream.h"
 
 using namespace std;
 using namespace vcg;
 
-int Execute2(PoissonParam &Par, vector<Point3D<float> > Pts, vector<Point3D<float> > Nor, 	CoredVectorMeshData &mesh, Point3D<float> &newCenter, float &newScale, vcg::CallBackPos *cb );
+int Execute2(PoissonParam &Par, PointStream<float> &pointStream, 	CoredVectorMeshData &mesh, Point3D<float> &newCenter, float &newScale, vcg::CallBackPos *cb );
+
+// The points of the reconstruction read straight from the vertices of the mesh:
+// the deleted vertices are skipped and the normals are normalized on the fly.
+class CMeshOPointStream : public PointStream<float>
+{
+public:
+  CMeshOPointStream(CMeshO &_m):m(_m),vi(_m.vert.begin()){}
+  void reset() { vi=m.vert.begin(); }
+  bool nextPoint(Point3D<float> &p, Point3D<float> &n)
+  {
+    while(vi!=m.vert.end() && (*vi).IsD()) ++vi;
+    if(vi==m.vert.end()) return false;
+    CMeshO::VertexType::NormalType nv=(*vi).N();
+    nv.Normalize();
+    for(int ii=0;ii<3;++ii){
+      p.coords[ii]=(*vi).P()[ii];
+      n.coords[ii]=nv[ii];
+    }
+    ++vi;
+    return true;
+  }
+private:
+  CMeshO &m;
+  CMeshO::VertexIterator vi;
+};
 
 
 // Constructor usually performs only two simple tasks of filling the two lists 
@@ -142,8 +168,6 @@ bool PoissonPlugin::applyFilter(QAction *filter, MeshDocument &md, RichParameter
 {
 	MeshModel &m=*md.mm();
   MeshModel &pm =*md.addNewMesh("","Poisson mesh");
-  vector<Point3D<float> > Pts(m.cm.vn);
-	vector<Point3D<float> > Nor(m.cm.vn); 	
 	CoredVectorMeshData mesh;
 
 	if (m.hasDataMask(MeshModel::MM_WEDGTEXCOORD)){
@@ -153,18 +177,7 @@ bool PoissonPlugin::applyFilter(QAction *filter, MeshDocument &md, RichParameter
 		m.clearDataMask(MeshModel::MM_VERTTEXCOORD);
 	}
 	
-	int cnt=0;
-	CMeshO::VertexIterator vi;
-	for(vi=m.cm.vert.begin(); vi!=m.cm.vert.end(); ++vi)
-	if(!(*vi).IsD()){
-			(*vi).N().Normalize();
-			for(int ii=0;ii<3;++ii){
-					Pts[cnt].coords[ii]=(*vi).P()[ii];
-					Nor[cnt].coords[ii]=(*vi).N()[ii];
-			}
-			++cnt;
-		}
-	assert(cnt==m.cm.vn);
+	CMeshOPointStream pointStream(m.cm);
 	// Log function dump textual info in the lower part of the MeshLab screen. 
 	PoissonParam pp;
 	pp.Depth=par.getInt("OctDepth");
@@ -174,7 +187,7 @@ bool PoissonPlugin::applyFilter(QAction *filter, MeshDocument &md, RichParameter
 	Point3D<float> center;
 	float scale;
 	
-	int ret= Execute2(pp, Pts, Nor, mesh,center,scale,cb);
+	int ret= Execute2(pp, pointStream, mesh,center,scale,cb);
 	mesh.resetIterator();
 	int vm = mesh.outOfCorePointCount()+mesh.inCorePoints.size();
 	int fm = mesh.triangleCount();
@@ -19,6 +19,7 @@ HEADERS += src/Allocator.h \
            src/MarchingCubes.h \
            src/MultiGridOctreeData.h \
            src/Octree.h \
+           src/PointStream.h \
            src/Polynomial.h \
            src/PPolynomial.h \
            src/SparseMatrix.h \
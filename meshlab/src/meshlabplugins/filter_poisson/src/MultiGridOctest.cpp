@@ -80,7 +80,7 @@ void ShowUsage(char* ex)
 	printf("\t[--verbose]\n");
 }
 template<int Degree>
-int Execute(PoissonParam &Par, std::vector<Point3D<Real> > Pts, std::vector<Point3D<Real> > Nor, 	CoredVectorMeshData &mesh, Point3D<Real> &newCenter, Real &newScale, vcg::CallBackPos *cb)
+int Execute(PoissonParam &Par, PointStream<Real> &pointStream, 	CoredVectorMeshData &mesh, Point3D<Real> &newCenter, Real &newScale, vcg::CallBackPos *cb)
 {
 		int i;
 //	int paramNum=sizeof(paramNames)/sizeof(char*);
@@ -118,7 +118,7 @@ int Execute(PoissonParam &Par, std::vector<Point3D<Real> > Pts, std::vector<Poin
 
 
 #if 1
-	tree.setTree(Pts,Nor,Par.Depth,kernelDepth,Real(Par.SamplesPerNode),Par.Scale,center,scale,!Par.NoResetSamples,Par.Confidence);
+	tree.setTree(pointStream,Par.Depth,kernelDepth,Real(Par.SamplesPerNode),Par.Scale,center,scale,!Par.NoResetSamples,Par.Confidence);
 #else
 if(Confidence.set){
 	tree.setTree(Pts,Nor,Depth.value,kernelDepth,Real(SamplesPerNode.value),Scale.value,center,scale,!NoResetSamples.set,0,1);
@@ -160,7 +160,7 @@ newScale=scale;
 	return 1;
 }
 
-int Execute2(PoissonParam &Par, std::vector<Point3D<Real> > Pts, std::vector<Point3D<Real> > Nor, 	CoredVectorMeshData &mesh, Point3D<Real> &newCenter, Real &newScale, vcg::CallBackPos *cb )
+int Execute2(PoissonParam &Par, PointStream<Real> &pointStream, 	CoredVectorMeshData &mesh, Point3D<Real> &newCenter, Real &newScale, vcg::CallBackPos *cb )
 {
-	return Execute<2>(Par,Pts,Nor,mesh,newCenter,newScale,cb);
+	return Execute<2>(Par,pointStream,mesh,newCenter,newScale,cb);
 }
@@ -30,6 +30,7 @@ DAMAGE.
 #define MULTI_GRID_OCTREE_DATA_INCLUDED
 
 #include "Hash.h"
+#include "PointStream.h"
 
 typedef float Real;
 typedef float FunctionDataReal;
@@ -181,6 +182,7 @@ class Octree{
 	int GetRestrictedFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const int* entries,const int& entryCount,const TreeOctNode* rNode,const Real& radius,const SortedTreeNodes& sNodes);
 
 	void SetIsoSurfaceCorners(const Real& isoValue,const int& subdivisionDepth,const int& fullDepthIso);
+	static void SetParentMCIndex(TreeOctNode* node);
 	static int IsBoundaryFace(const TreeOctNode* node,const int& faceIndex,const int& subdivideDepth);
 	static int IsBoundaryEdge(const TreeOctNode* node,const int& edgeIndex,const int& subdivideDepth);
 	static int IsBoundaryEdge(const TreeOctNode* node,const int& dir,const int& x,const int& y,const int& subidivideDepth);
@@ -226,6 +228,8 @@ class Octree{
 
 	Real getCenterValue(const TreeOctNode* node);
 	Real getCornerValue(const TreeOctNode* node,const int& corner);
+	Real getCornerValue(TreeOctNode::NeighborKey2& key,const TreeOctNode* node,const int& corner);
+	Real evaluateCorner(TreeOctNode::NeighborKey2& key,PointIndexValueFunction& cf,const TreeOctNode* node,const int& corner);
 	void getCornerValueAndNormal(const TreeOctNode* node,const int& corner,Real& value,Point3D<Real>& normal);
 public:
 	static double maxMemoryUsage;
@@ -239,7 +243,7 @@ public:
 	void setFunctionData(const PPolynomial<Degree>& ReconstructionFunction,const int& maxDepth,const int& normalize,const Real& normalSmooth=-1);
 	void finalize1(const int& refineNeighbors=-1);
 	void finalize2(const int& refineNeighbors=-1);
-	int setTree(std::vector<Point3D<Real> > &Pts, std::vector<Point3D<Real> > &Nor, 
+	int setTree(PointStream<Real>& pointStream,
 							const int& maxDepth,const int& kernelDepth,const Real& samplesPerNode,
 							const Real& scaleFactor,Point3D<Real>& center,Real& scale,const int& resetSampleDepths,const int& useConfidence);
 
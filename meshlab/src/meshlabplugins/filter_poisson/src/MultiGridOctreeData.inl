@@ -309,7 +309,7 @@ int Octree<Degree>::NonLinearUpdateWeightContribution(TreeOctNode* node,const Po
 }
 
 template<int Degree>
-int Octree<Degree>::setTree(std::vector<Point3D<Real> > &Pts, std::vector<Point3D<Real> > &Nor,
+int Octree<Degree>::setTree(PointStream<Real>& pointStream,
 							const int& maxDepth,
 							const int& kernelDepth,const Real& samplesPerNode,const Real& scaleFactor,Point3D<Real>& center,Real& scale,
 							const int& resetSamples,const int& useConfidence){
@@ -328,12 +328,11 @@ int Octree<Degree>::setTree(std::vector<Point3D<Real> > &Pts, std::vector<Point3
 	//DumpOutput("Setting bounding box\n");
 	// Read through once to get the center and scale
 	int i,cnt=0;
-	for(int pi=0;pi<Pts.size();++pi)
+	pointStream.reset();
+	while(pointStream.nextPoint(position,normal))
 	{
-		//if(binary){if(fread(c,sizeof(float),2*DIMENSION,fp)!=6){break;}}
-		//else{if(fscanf(fp," %f %f %f %f %f %f ",&c[0],&c[1],&c[2],&c[3],&c[4],&c[5])!=2*DIMENSION){break;}}
 		for(i=0;i<DIMENSION;i++){
-		  c[i]=Pts[pi].coords[i];
+		  c[i]=position.coords[i];
 			if(!cnt || c[i]<min.coords[i]){min.coords[i]=c[i];}
 			if(!cnt || c[i]>max.coords[i]){max.coords[i]=c[i];}
 		}
@@ -349,17 +348,10 @@ int Octree<Degree>::setTree(std::vector<Point3D<Real> > &Pts, std::vector<Point3
 	if(splatDepth>0){
 		printf("Setting sample weights\n");
 		cnt=0;
-		//fseek(fp,SEEK_SET,0);
-			for(int pi=0;pi<Pts.size();++pi)
-			{
-			//if(binary){if(fread(c,sizeof(float),2*DIMENSION,fp)!=2*DIMENSION){break;}}
-			//else{if(fscanf(fp," %f %f %f %f %f %f ",&c[0],&c[1],&c[2],&c[3],&c[4],&c[5])!=2*DIMENSION){break;}}
-			for(i=0;i<DIMENSION;i++){
-				c[i]=Pts[pi].coords[i];
-				c[i+3]=Nor[pi].coords[i];
-				position.coords[i]=(c[i]-center.coords[i])/scale;
-				normal.coords[i]=c[DIMENSION+i];
-			}
+		pointStream.reset();
+		while(pointStream.nextPoint(position,normal))
+		{
+			for(i=0;i<DIMENSION;i++){position.coords[i]=(position.coords[i]-center.coords[i])/scale;}
 			myCenter.coords[0]=myCenter.coords[1]=myCenter.coords[2]=Real(0.5);
 			myWidth=Real(1.0);
 			for(i=0;i<DIMENSION;i++){if(position.coords[i]<myCenter.coords[i]-myWidth/2 || position.coords[i]>myCenter.coords[i]+myWidth/2){break;}}
@@ -390,17 +382,10 @@ int Octree<Degree>::setTree(std::vector<Point3D<Real> > &Pts, std::vector<Point3
 	printf("Adding Points and Normals\n");
 	normals=new std::vector<Point3D<Real> >();
 	cnt=0;
-	//fseek(fp,SEEK_SET,0);
-	for(int pi=0;pi<Pts.size();++pi)
-		{
-		//if(binary){if(fread(c,sizeof(float),2*DIMENSION,fp)!=2*DIMENSION){break;}}
-		//else{if(fscanf(fp," %f %f %f %f %f %f ",&c[0],&c[1],&c[2],&c[3],&c[4],&c[5])!=2*DIMENSION){break;}}
-		for(i=0;i<DIMENSION;i++){
-			c[i]=Pts[pi].coords[i];
-			c[i+3]=Nor[pi].coords[i];
-			position.coords[i]=(c[i]-center.coords[i])/scale;
-			normal.coords[i]=c[DIMENSION+i];
-		}
+	pointStream.reset();
+	while(pointStream.nextPoint(position,normal))
+	{
+		for(i=0;i<DIMENSION;i++){position.coords[i]=(position.coords[i]-center.coords[i])/scale;}
 		myCenter.coords[0]=myCenter.coords[1]=myCenter.coords[2]=Real(0.5);
 		myWidth=Real(1.0);
 		for(i=0;i<DIMENSION;i++){if(position.coords[i]<myCenter.coords[i]-myWidth/2 || position.coords[i]>myCenter.coords[i]+myWidth/2){break;}}
@@ -532,25 +517,32 @@ Real Octree<Degree>::GetDotProduct(const int idx[DIMENSION]) const
 template<int Degree>
 int Octree<Degree>::GetFixedDepthLaplacian(SparseSymmetricMatrix<float>& matrix,const int& depth,const SortedTreeNodes& sNodes)
 {
-	LaplacianMatrixFunction mf;
-	mf.ot=this;
-	mf.offset=sNodes.nodeCount[depth];
 	matrix.Resize(sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth]);
-	mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*matrix.rows);
-	for(int i=sNodes.nodeCount[depth];i<sNodes.nodeCount[depth+1];i++){
-		mf.elementCount=0;
-		mf.d2=int(sNodes.treeNodes[i]->d);
-		mf.x2=int(sNodes.treeNodes[i]->off[0]);
-		mf.y2=int(sNodes.treeNodes[i]->off[1]);
-		mf.z2=int(sNodes.treeNodes[i]->off[2]);
-		mf.index[0]=mf.x2;
-		mf.index[1]=mf.y2;
-		mf.index[2]=mf.z2;
-		TreeOctNode::ProcessTerminatingNodeAdjacentNodes(fData.depth,sNodes.treeNodes[i],2*width-1,&tree,1,&mf);
-		matrix.SetRowSize(i-sNodes.nodeCount[depth],mf.elementCount);
-		memcpy(matrix.m_ppElements[i-sNodes.nodeCount[depth]],mf.rowElements,sizeof(MatrixEntry<float>)*mf.elementCount);
-	}
-	free(mf.rowElements);
+	// The rows are independent: each thread gathers its rows in its own function object,
+	// only the allocation of the row entries (from the shared allocator) is serialized.
+#pragma omp parallel
+	{
+		LaplacianMatrixFunction mf;
+		mf.ot=this;
+		mf.offset=sNodes.nodeCount[depth];
+		mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*matrix.rows);
+#pragma omp for schedule(dynamic,256)
+		for(int i=sNodes.nodeCount[depth];i<sNodes.nodeCount[depth+1];i++){
+			mf.elementCount=0;
+			mf.d2=int(sNodes.treeNodes[i]->d);
+			mf.x2=int(sNodes.treeNodes[i]->off[0]);
+			mf.y2=int(sNodes.treeNodes[i]->off[1]);
+			mf.z2=int(sNodes.treeNodes[i]->off[2]);
+			mf.index[0]=mf.x2;
+			mf.index[1]=mf.y2;
+			mf.index[2]=mf.z2;
+			TreeOctNode::ProcessTerminatingNodeAdjacentNodes(fData.depth,sNodes.treeNodes[i],2*width-1,&tree,1,&mf);
+#pragma omp critical(PoissonMatrixRow)
+			matrix.SetRowSize(i-sNodes.nodeCount[depth],mf.elementCount);
+			memcpy(matrix.m_ppElements[i-sNodes.nodeCount[depth]],mf.rowElements,sizeof(MatrixEntry<float>)*mf.elementCount);
+		}
+		free(mf.rowElements);
+	}
 	return 1;
 }
 template<int Degree>
@@ -558,25 +550,31 @@ int Octree<Degree>::GetRestrictedFixedDepthLaplacian(SparseSymmetricMatrix<float
 													 const TreeOctNode* rNode,const Real& radius,
 													 const SortedTreeNodes& sNodes){
 	int i;
-	RestrictedLaplacianMatrixFunction mf;
 	Real myRadius=int(2*radius-ROUND_EPS)+ROUND_EPS;
-	mf.ot=this;
-	mf.radius=radius;
-	rNode->depthAndOffset(mf.depth,mf.offset);
 	matrix.Resize(entryCount);
-	mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*matrix.rows);
 	for(i=0;i<entryCount;i++){sNodes.treeNodes[entries[i]]->nodeData.nodeIndex=i;}
-	for(i=0;i<entryCount;i++){
-		mf.elementCount=0;
-		mf.index[0]=int(sNodes.treeNodes[entries[i]]->off[0]);
-		mf.index[1]=int(sNodes.treeNodes[entries[i]]->off[1]);
-		mf.index[2]=int(sNodes.treeNodes[entries[i]]->off[2]);
-		TreeOctNode::ProcessTerminatingNodeAdjacentNodes(fData.depth,sNodes.treeNodes[entries[i]],2*width-1,&tree,1,&mf);
-		matrix.SetRowSize(i,mf.elementCount);
-		memcpy(matrix.m_ppElements[i],mf.rowElements,sizeof(MatrixEntry<float>)*mf.elementCount);
+	// As in GetFixedDepthLaplacian the rows are gathered in parallel
+#pragma omp parallel
+	{
+		RestrictedLaplacianMatrixFunction mf;
+		mf.ot=this;
+		mf.radius=radius;
+		rNode->depthAndOffset(mf.depth,mf.offset);
+		mf.rowElements=(MatrixEntry<float>*)malloc(sizeof(MatrixEntry<float>)*matrix.rows);
+#pragma omp for schedule(dynamic,256)
+		for(int j=0;j<entryCount;j++){
+			mf.elementCount=0;
+			mf.index[0]=int(sNodes.treeNodes[entries[j]]->off[0]);
+			mf.index[1]=int(sNodes.treeNodes[entries[j]]->off[1]);
+			mf.index[2]=int(sNodes.treeNodes[entries[j]]->off[2]);
+			TreeOctNode::ProcessTerminatingNodeAdjacentNodes(fData.depth,sNodes.treeNodes[entries[j]],2*width-1,&tree,1,&mf);
+#pragma omp critical(PoissonMatrixRow)
+			matrix.SetRowSize(j,mf.elementCount);
+			memcpy(matrix.m_ppElements[j],mf.rowElements,sizeof(MatrixEntry<float>)*mf.elementCount);
+		}
+		free(mf.rowElements);
 	}
 	for(i=0;i<entryCount;i++){sNodes.treeNodes[entries[i]]->nodeData.nodeIndex=entries[i];}
-	free(mf.rowElements);
 	return 1;
 }
 
@@ -1196,6 +1194,10 @@ Real Octree<Degree>::getCenterValue(const TreeOctNode* node){
 }
 template<int Degree>
 Real Octree<Degree>::getCornerValue(const TreeOctNode* node,const int& corner){
+	return getCornerValue(neighborKey2,node,corner);
+}
+template<int Degree>
+Real Octree<Degree>::getCornerValue(TreeOctNode::NeighborKey2& neighborKey2,const TreeOctNode* node,const int& corner){
 	int idx[3];
 	Real value=0;
 
@@ -1345,15 +1347,27 @@ Real Octree<Degree>::GetIsoValue(void){
 		return isoValue/weightSum;
 	}
 }
+// The value of the implicit function at a corner of a leaf; key and cf are the caller's own,
+// so that different threads can evaluate different corners at the same time.
+template<int Degree>
+Real Octree<Degree>::evaluateCorner(TreeOctNode::NeighborKey2& key,PointIndexValueFunction& cf,const TreeOctNode* node,const int& corner){
+	if(this->width<=3){return getCornerValue(key,node,corner);}
+	int idx[3];
+	VertexData::CornerIndex(node,corner,fData.depth,idx);
+	cf.value=0;
+	cf.index[0]=idx[0]*fData.res;
+	cf.index[1]=idx[1]*fData.res;
+	cf.index[2]=idx[2]*fData.res;
+	TreeOctNode::ProcessPointAdjacentNodes(fData.depth,idx,&tree,width,&cf);
+	return cf.value;
+}
 template<int Degree>
 void Octree<Degree>::SetIsoSurfaceCorners(const Real& isoValue,const int& subdivideDepth,const int& fullDepthIso){
 //	double t=Time();
 	int i,j;
-	hash_map<long long,Real> values;
+	hash_map<long long,int> cornerSlots;
 	Real cornerValues[Cube::CORNERS];
-	PointIndexValueFunction cf;
 	TreeOctNode* temp;
-	int leafCount=tree.leaves();
 	long long key;
 	SortedTreeNodes *sNodes=new SortedTreeNodes();
 	sNodes->set(tree,0);
@@ -1363,91 +1377,82 @@ void Octree<Degree>::SetIsoSurfaceCorners(const Real& isoValue,const int& subdiv
 		temp=tree.nextNode(temp);
 	}
 	TreeNodeData::UseIndex=0;	
-	// Start by setting the corner values of all the nodes
-	cf.valueTables=fData.valueTables;
-	cf.res2=fData.res2;
-	for(i=0;i<sNodes->nodeCount[subdivideDepth];i++){
-		temp=sNodes->treeNodes[i];
-		if(!temp->children){
-			for(j=0;j<Cube::CORNERS;j++){
-				if(this->width<=3){cornerValues[j]=getCornerValue(temp,j);}
-				else{
-					cf.value=0;
-					int idx[3];
-					VertexData::CornerIndex(temp,j,fData.depth,idx);
-					cf.index[0]=idx[0]*fData.res;
-					cf.index[1]=idx[1]*fData.res;
-					cf.index[2]=idx[2]*fData.res;
-					TreeOctNode::ProcessPointAdjacentNodes(fData.depth,idx,&tree,width,&cf);
-					cornerValues[j]=cf.value;
-				}
-			}
-			temp->nodeData.mcIndex=MarchingCubes::GetIndex(cornerValues,isoValue);
-
-			if(temp->parent){
-				TreeOctNode* parent=temp->parent;
-				int c=int(temp-temp->parent->children);
-				int mcid=temp->nodeData.mcIndex&(1<<MarchingCubes::cornerMap[c]);
-				
-				if(mcid){
-					parent->nodeData.mcIndex|=mcid;
-					while(1){
-						if(parent->parent && (parent-parent->parent->children)==c){
-							parent->parent->nodeData.mcIndex|=mcid;
-							parent=parent->parent;
-						}
-						else{break;}
-					}
-				}
-			}
+	// Start by setting the corner values of all the nodes.
+	// The corner values are evaluated in parallel, each leaf setting only its own mcIndex;
+	// the mcIndex bits are then propagated to the parents serially.
+	int leafNum=sNodes->nodeCount[subdivideDepth];
+#pragma omp parallel
+	{
+		TreeOctNode::NeighborKey2 nKey;
+		PointIndexValueFunction cf;
+		Real cv[Cube::CORNERS];
+		nKey.set(fData.depth);
+		cf.valueTables=fData.valueTables;
+		cf.res2=fData.res2;
+#pragma omp for schedule(dynamic,64)
+		for(int l=0;l<leafNum;l++){
+			TreeOctNode* leaf=sNodes->treeNodes[l];
+			if(leaf->children){continue;}
+			for(int c=0;c<Cube::CORNERS;c++){cv[c]=evaluateCorner(nKey,cf,leaf,c);}
+			leaf->nodeData.mcIndex=MarchingCubes::GetIndex(cv,isoValue);
 		}
 	}
+	for(i=0;i<leafNum;i++){
+		temp=sNodes->treeNodes[i];
+		if(!temp->children){SetParentMCIndex(temp);}
+	}
 
 //	MemoryUsage();
 
+	std::vector<TreeOctNode*> leaves;
+	std::vector<int> leafCorners;
+	std::vector<const TreeOctNode*> cornerNodes;
+	std::vector<int> cornerIds;
+	std::vector<Real> values;
 	for(i=sNodes->nodeCount[subdivideDepth];i<sNodes->nodeCount[subdivideDepth+1];i++){
+		// Collect the leaves of the block and their distinct corners: each corner is evaluated
+		// once, from the first leaf that has it (as the serial code did caching the values).
 		temp=sNodes->treeNodes[i]->nextLeaf();
 		while(temp){
+			leaves.push_back(temp);
 			for(j=0;j<Cube::CORNERS;j++){
 				int idx[3];
 				key=VertexData::CornerIndex(temp,j,fData.depth,idx);
-				cf.index[0]=idx[0]*fData.res;
-				cf.index[1]=idx[1]*fData.res;
-				cf.index[2]=idx[2]*fData.res;
-				if(values.find(key)!=values.end()){cornerValues[j]=values[key];}
+				hash_map<long long,int>::iterator si=cornerSlots.find(key);
+				if(si!=cornerSlots.end()){leafCorners.push_back(si->second);}
 				else{
-					if(this->width<=3){values[key]=cornerValues[j]=getCornerValue(temp,j);}
-					else{
-						cf.value=0;
-						TreeOctNode::ProcessPointAdjacentNodes(fData.depth,idx,&tree,width,&cf);
-						values[key]=cf.value;
-						cornerValues[j]=cf.value;
-					}
+					int slot=int(cornerNodes.size());
+					cornerSlots[key]=slot;
+					cornerNodes.push_back(temp);
+					cornerIds.push_back(j);
+					leafCorners.push_back(slot);
 				}
 			}
-			temp->nodeData.mcIndex=MarchingCubes::GetIndex(cornerValues,isoValue);
-
-			if(temp->parent){
-				TreeOctNode* parent=temp->parent;
-				int c=int(temp-temp->parent->children);
-				int mcid=temp->nodeData.mcIndex&(1<<MarchingCubes::cornerMap[c]);
-				
-				if(mcid){
-					parent->nodeData.mcIndex|=mcid;
-					while(1){
-						if(parent->parent && (parent-parent->parent->children)==c){
-							parent->parent->nodeData.mcIndex|=mcid;
-							parent=parent->parent;
-						}
-						else{break;}
-					}
-				}
-			}
-
 			temp=sNodes->treeNodes[i]->nextLeaf(temp);
 		}
+		values.resize(cornerNodes.size());
+		int cornerNum=int(cornerNodes.size());
+#pragma omp parallel
+		{
+			TreeOctNode::NeighborKey2 nKey;
+			PointIndexValueFunction cf;
+			nKey.set(fData.depth);
+			cf.valueTables=fData.valueTables;
+			cf.res2=fData.res2;
+#pragma omp for schedule(dynamic,256)
+			for(int s=0;s<cornerNum;s++){values[s]=evaluateCorner(nKey,cf,cornerNodes[s],cornerIds[s]);}
+		}
+		for(size_t l=0;l<leaves.size();l++){
+			for(j=0;j<Cube::CORNERS;j++){cornerValues[j]=values[leafCorners[l*Cube::CORNERS+j]];}
+			leaves[l]->nodeData.mcIndex=MarchingCubes::GetIndex(cornerValues,isoValue);
+			SetParentMCIndex(leaves[l]);
+		}
 //		MemoryUsage();
-		values.clear();
+		cornerSlots.clear();
+		leaves.clear();
+		leafCorners.clear();
+		cornerNodes.clear();
+		cornerIds.clear();
 	}
 	delete sNodes;
 //	DumpOutput("Set corner values in: %f\n",Time()-t);
@@ -1455,6 +1460,26 @@ void Octree<Degree>::SetIsoSurfaceCorners(const Real& isoValue,const int& subdiv
 
 	if(subdivideDepth){PreValidate(isoValue,fData.depth,subdivideDepth);}
 }
+// Propagate the corner bits of the mcIndex of a leaf to the ancestors sharing the corner
+template<int Degree>
+void Octree<Degree>::SetParentMCIndex(TreeOctNode* node){
+	if(node->parent){
+		TreeOctNode* parent=node->parent;
+		int c=int(node-node->parent->children);
+		int mcid=node->nodeData.mcIndex&(1<<MarchingCubes::cornerMap[c]);
+		
+		if(mcid){
+			parent->nodeData.mcIndex|=mcid;
+			while(1){
+				if(parent->parent && (parent-parent->parent->children)==c){
+					parent->parent->nodeData.mcIndex|=mcid;
+					parent=parent->parent;
+				}
+				else{break;}
+			}
+		}
+	}
+}
 template<int Degree>
 void Octree<Degree>::Subdivide(TreeOctNode* node,const Real& isoValue,const int& maxDepth){
 	int i,j,c[4];
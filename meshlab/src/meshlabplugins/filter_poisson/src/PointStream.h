@@ -0,0 +1,20 @@
+#ifndef POINT_STREAM_INCLUDED
+#define POINT_STREAM_INCLUDED
+
+#include "Geometry.h"
+
+/** The source of the oriented points read by Octree::setTree.
+  * The points are read sequentially, more than once: reset() restarts the sequence
+  * and nextPoint() returns false when the sequence is over.
+  * Reading the points through a stream allows to feed them to the reconstruction
+  * straight from the mesh they come from, without copying them.
+  */
+template<class Real>
+class PointStream{
+public:
+	virtual ~PointStream(void){}
+	virtual void reset(void)=0;
+	virtual bool nextPoint(Point3D<Real>& position,Point3D<Real>& normal)=0;
+};
+
+#endif // POINT_STREAM_INCLUDED
@@ -138,6 +138,17 @@ public:
 template <class T>
 class SparseSymmetricMatrix : public SparseMatrix<T>{
 public:
+	/** The entries of the matrix grouped by column (N is the row of the entry).
+	  * Only one triangle of the matrix is stored, and Multiply scatters the contribution
+	  * of each entry to the row of its column too; with the entries grouped by column
+	  * these contributions can be gathered by row instead, so that the rows can be computed in parallel.
+	  */
+	class Columns{
+	public:
+		std::vector<int> start;
+		std::vector<MatrixEntry<T> > entries;
+	};
+	void GetColumns( Columns& columns ) const;
 
   template<class T2>
 	Vector<T2> operator * (const Vector<T2>& V) const;
@@ -145,6 +156,8 @@ public:
 	Vector<T2> Multiply( const Vector<T2>& V ) const;
 	template<class T2>
 	void Multiply( const Vector<T2>& In, Vector<T2>& Out ) const;
+	template<class T2>
+	void Multiply( const Vector<T2>& In, Vector<T2>& Out, const Columns& columns ) const;
 
 	template<class T2>
 	static int Solve(const SparseSymmetricMatrix<T>& M,const Vector<T2>& b,const int& iters,Vector<T2>& solution,const T2 eps=1e-8,const int& reset=1);
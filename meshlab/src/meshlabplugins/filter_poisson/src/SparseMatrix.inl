@@ -476,17 +476,60 @@ void SparseSymmetricMatrix<T>::Multiply( const Vector<T2>& In,Vector<T2>& Out) c
 	}
 }
 
+template<class T>
+void SparseSymmetricMatrix<T>::GetColumns( Columns& columns ) const
+{
+	columns.start.assign(this->rows+1,0);
+	for (int i=0; i<this->rows; i++)
+		for(int ii=0;ii<this->rowSizes[i];ii++){columns.start[this->m_ppElements[i][ii].N+1]++;}
+	for (int i=0; i<this->rows; i++){columns.start[i+1]+=columns.start[i];}
+	columns.entries.resize(columns.start[this->rows]);
+	std::vector<int> fill(columns.start.begin(),columns.start.end()-1);
+	for (int i=0; i<this->rows; i++){
+		for(int ii=0;ii<this->rowSizes[i];ii++){
+			MatrixEntry<T>& e=columns.entries[fill[this->m_ppElements[i][ii].N]++];
+			e.N=i;
+			e.Value=this->m_ppElements[i][ii].Value;
+		}
+	}
+}
+
+template<class T>
+template<class T2>
+void SparseSymmetricMatrix<T>::Multiply( const Vector<T2>& In,Vector<T2>& Out,const Columns& columns) const
+{
+#pragma omp parallel for schedule(static,1024)
+	for (int i=0; i<this->rows; i++){
+		T2 out1=T2();
+		const MatrixEntry<T>* temp=this->m_ppElements[i];
+		int rs=this->rowSizes[i];
+		for(int ii=0;ii<rs;ii++){
+			T2 v=temp[ii].Value;
+			out1+=v * In.m_pV[temp[ii].N];
+		}
+		for(int ii=columns.start[i];ii<columns.start[i+1];ii++){
+			T2 v=columns.entries[ii].Value;
+			out1+=v * In.m_pV[columns.entries[ii].N];
+		}
+		Out.m_pV[i]=out1;
+	}
+}
+
+// The products are computed by rows in parallel, using the entries grouped by column (see Columns)
 template<class T>
 template<class T2>
 int SparseSymmetricMatrix<T>::Solve(const SparseSymmetricMatrix<T>& M,const Vector<T2>& b,const int& iters,Vector<T2>& solution,const T2 eps,const int& reset){
 	Vector<T2> d,r,Md;
 	T2 alpha,beta,rDotR,bDotB;
+	Columns columns;
+	M.GetColumns(columns);
 	Md.Resize(b.Dimensions());
 	if(reset){
 		solution.Resize(b.Dimensions());
 		solution.SetZero();
 	}
-	d=r=b-M.Multiply(solution);
+	M.Multiply(solution,Md,columns);
+	d=r=b-Md;
 	rDotR=r.Dot(r);
 	bDotB=b.Dot(b);
 	if(b.Dot(b)<=eps){
@@ -496,7 +539,7 @@ int SparseSymmetricMatrix<T>::Solve(const SparseSymmetricMatrix<T>& M,const Vect
 	int i;
 	for(i=0;i<iters;i++){
 		T2 temp;
-		M.Multiply(d,Md);
+		M.Multiply(d,Md,columns);
 		temp=d.Dot(Md);
 		if(fabs(temp)<=eps){break;}
 		alpha=rDotR/temp;
@@ -31,6 +31,11 @@ DAMAGE.
 
 #define Assert assert
 #include <assert.h>
+#include <vector>
+#include <algorithm>
+
+// Size above which the vector operations are run in parallel
+#define VECTOR_PARALLEL_SIZE 4096
 
 template<class T>
 class Vector
@@ -146,7 +146,9 @@ Vector<T> Vector<T>::operator + (const Vector<T>& V0) const
 template<class T>
 Vector<T>& Vector<T>::AddScaled(const Vector<T>& V,const T& scale)
 {
-	for (size_t i=0; i<m_N; i++)
+	const int n=int(m_N);
+#pragma omp parallel for if(n>VECTOR_PARALLEL_SIZE)
+	for (int i=0; i<n; i++)
 		m_pV[i] += V.m_pV[i]*scale;
 
 	return *this;
@@ -154,19 +156,25 @@ Vector<T>& Vector<T>::AddScaled(const Vector<T>& V,const T& scale)
 template<class T>
 Vector<T>& Vector<T>::SubtractScaled(const Vector<T>& V,const T& scale)
 {
-	for (size_t i=0; i<m_N; i++)
+	const int n=int(m_N);
+#pragma omp parallel for if(n>VECTOR_PARALLEL_SIZE)
+	for (int i=0; i<n; i++)
 		m_pV[i] -= V.m_pV[i]*scale;
 
 	return *this;
 }
 template<class T>
 void Vector<T>::Add(const Vector<T>& V1,const T& scale1,const Vector<T>& V2,const T& scale2,Vector<T>& Out){
-	for (size_t i=0; i<V1.m_N; i++)
+	const int n=int(V1.m_N);
+#pragma omp parallel for if(n>VECTOR_PARALLEL_SIZE)
+	for (int i=0; i<n; i++)
 		Out.m_pV[i]=V1.m_pV[i]*scale1+V2.m_pV[i]*scale2;
 }
 template<class T>
 void Vector<T>::Add(const Vector<T>& V1,const T& scale1,const Vector<T>& V2,Vector<T>& Out){
-	for (size_t i=0; i<V1.m_N; i++)
+	const int n=int(V1.m_N);
+#pragma omp parallel for if(n>VECTOR_PARALLEL_SIZE)
+	for (int i=0; i<n; i++)
 		Out.m_pV[i]=V1.m_pV[i]*scale1+V2.m_pV[i];
 }
 template<class T>
@@ -231,8 +239,26 @@ template<class T>
 T Vector<T>::Dot( const Vector<T>& V ) const
 {
 	T V0 = T();
-	for (size_t i=0; i<m_N; i++)
-		V0 += m_pV[i]*V.m_pV[i];
+	// Large vectors are summed by blocks of fixed size, in parallel, and then the block sums in order:
+	// unlike a reduction this gives the same result whatever the number of threads.
+	const int n=int(m_N);
+	if(n<=VECTOR_PARALLEL_SIZE){
+		for (int i=0; i<n; i++)
+			V0 += m_pV[i]*V.m_pV[i];
+		return V0;
+	}
+	const int blockNum=(n+VECTOR_PARALLEL_SIZE-1)/VECTOR_PARALLEL_SIZE;
+	std::vector<T> blockSums(blockNum);
+#pragma omp parallel for
+	for (int b=0; b<blockNum; b++){
+		T sum = T();
+		const int end=std::min(n,(b+1)*VECTOR_PARALLEL_SIZE);
+		for (int i=b*VECTOR_PARALLEL_SIZE; i<end; i++)
+			sum += m_pV[i]*V.m_pV[i];
+		blockSums[b]=sum;
+	}
+	for (int b=0; b<blockNum; b++)
+		V0 += blockSums[b];
 
 	return V0;
 }
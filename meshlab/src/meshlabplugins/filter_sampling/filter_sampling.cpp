@@ -176,6 +176,9 @@ public:
     mean_dist =0;
     RMS_dist = 0;
     n_total_samples = 0;
+    pendingPt.clear();
+    pendingN.clear();
+    pendingV.clear();
   }
 
   void AddFace(const CMeshO::FaceType &f, CMeshO::CoordType interp)
@@ -187,29 +190,54 @@ public:
 
   void AddVert(CMeshO::VertexType &p)
   {
-    p.Q()=AddSample(p.cP(),p.cN());
+    AddSample(p.cP(),p.cN(),&p);
   }
 
-
-  float AddSample(const CMeshO::CoordType &startPt,const CMeshO::CoordType &startN)
+  // The samples are buffered and their closest points are searched in parallel by Flush().
+  // If a vertex is given its quality receives the distance.
+  void AddSample(const CMeshO::CoordType &startPt,const CMeshO::CoordType &startN, CMeshO::VertexType *v=0)
   {
-    // the results
-    Point3f       closestPt,      normf, bestq, ip;
-    float dist = dist_upper_bound;
+    pendingPt.push_back(startPt);
+    pendingN.push_back(startN);
+    pendingV.push_back(v);
+    if(pendingPt.size()>=65536) Flush();
+  }
 
-    // compute distance between startPt and the mesh S2
-    CMeshO::FaceType   *nearestF=0;
-    CMeshO::VertexType   *nearestV=0;
-    vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
-    dist=dist_upper_bound;
+  // Must be called after the sampling to process the samples still buffered.
+  void Flush()
+  {
+    if(pendingPt.empty()) return;
+    std::vector<float> dist;
+    std::vector<Point3f> closestPt;
+    // compute distance between the samples and the mesh S2
     if(useVertexSampling)
-      nearestV =  tri::GetClosestVertex<CMeshO,MetroMeshVertexGrid>(*m,unifGridVert,startPt,dist_upper_bound,dist);
+    {
+      std::vector<CMeshO::VertexPointer> nearestV;
+      vcg::vertex::PointDistanceFunctor<CMeshO::ScalarType> VDistFunct;
+      unifGridVert.GetClosestBatch(VDistFunct,pendingPt,dist_upper_bound,nearestV,dist,closestPt);
+    }
     else
-      nearestF =  unifGridFace.GetClosest(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
+    {
+      std::vector<CMeshO::FacePointer> nearestF;
+      vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
+      unifGridFace.GetClosestBatch(PDistFunct,pendingPt,dist_upper_bound,nearestF,dist,closestPt);
+    }
+    // measures are updated in the order the samples were generated
+    for(size_t i=0;i<pendingPt.size();++i)
+    {
+      UpdateMeasures(pendingPt[i],pendingN[i],closestPt[i],dist[i]);
+      if(pendingV[i]) pendingV[i]->Q()=dist[i];
+    }
+    pendingPt.clear();
+    pendingN.clear();
+    pendingV.clear();
+  }
 
+  void UpdateMeasures(const CMeshO::CoordType &startPt,const CMeshO::CoordType &startN, const CMeshO::CoordType &closestPt, float dist)
+  {
     // update distance measures
     if(dist == dist_upper_bound)
-      return dist;
+      return;
 
     if(dist > max_dist) max_dist = dist;        // L_inf
     if(dist < min_dist) min_dist = dist;        // L_inf
@@ -233,8 +261,12 @@ public:
       closestPtMesh->vert.back().Q() = dist;
       closestPtMesh->vert.back().N() = startN;
     }
-    return dist;
   }
+
+private:
+  std::vector<CMeshO::CoordType> pendingPt;
+  std::vector<CMeshO::CoordType> pendingN;
+  std::vector<CMeshO::VertexPointer> pendingV;
 }; // end class HausdorffSampler
 
 
@@ -301,7 +333,7 @@ public:
   {
     assert(m);
     // the results
-    Point3f       closestPt,      normf, bestq, ip;
+    Point3f       closestPt;
     float dist = dist_upper_bound;
     const CMeshO::CoordType &startPt= p.cP();
     // compute distance between startPt and the mesh S2
@@ -310,14 +342,7 @@ public:
       CMeshO::VertexType   *nearestV=0;
       nearestV =  tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*m,unifGridVert,startPt,dist_upper_bound,dist); //(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
       if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
-      if(storeDistanceAsQualityFlag)  p.Q() = dist;
-      if(dist == dist_upper_bound) return ;
-
-      if(coordFlag) p.P()=nearestV->P();
-      if(colorFlag) p.C() = nearestV->C();
-      if(normalFlag) p.N() = nearestV->N();
-      if(qualityFlag) p.Q()= nearestV->Q();
-      if(selectionFlag) if(nearestV->IsS()) p.SetS();
+      TransferFromVertex(p,nearestV,dist);
     }
     else
     {
@@ -326,18 +351,98 @@ public:
       dist=dist_upper_bound;
       if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
       nearestF =  unifGridFace.GetClosest(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
-      if(dist == dist_upper_bound) return ;
+      TransferFromFace(p,nearestF,closestPt,dist);
+    }
+  }
 
-      Point3f interp;
-      InterpolationParameters(*nearestF,(*nearestF).cN(),closestPt, interp);
-      interp[2]=1.0-interp[1]-interp[0];
+  // Same as calling AddVert for all the vertices of the target mesh,
+  // but the closest points are searched (and the attributes transferred) in parallel.
+  // When source and target are the same mesh the attributes are transferred serially.
+  // The closest points are searched in batches, so that the progress is reported after each of them;
+  // all the searches are done before transferring anything, as the source may be the target.
+  void AddAllVert(CMeshO &trg)
+  {
+    assert(m);
+    std::vector<CMeshO::VertexPointer> trgVert;
+    for(CMeshO::VertexIterator vi=trg.vert.begin();vi!=trg.vert.end();++vi)
+      if(!(*vi).IsD()) trgVert.push_back(&*vi);
+    if(cb) cb(0,"Resampling Vertex attributes");
+    const int n = int(trgVert.size());
+    const int batchSize = std::max(4096,n/100);
+    std::vector<float> dist(n);
+    std::vector<Point3f> closestPt(n);
+    std::vector<CMeshO::VertexPointer> nearestV;
+    std::vector<CMeshO::FacePointer> nearestF;
+    if(useVertexSampling) nearestV.resize(n);
+    else nearestF.resize(n);
+
+    std::vector<CMeshO::CoordType> batchPt;
+    std::vector<float> batchDist;
+    std::vector<Point3f> batchClosestPt;
+    std::vector<CMeshO::VertexPointer> batchV;
+    std::vector<CMeshO::FacePointer> batchF;
+    vcg::vertex::PointDistanceFunctor<CMeshO::ScalarType> VDistFunct;
+    vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
+    for(int start=0;start<n;start+=batchSize)
+    {
+      const int bn = std::min(batchSize,n-start);
+      batchPt.resize(bn);
+      for(int i=0;i<bn;++i) batchPt[i]=trgVert[start+i]->cP();
+      if(useVertexSampling)
+      {
+        unifGridVert.GetClosestBatch(VDistFunct,batchPt,dist_upper_bound,batchV,batchDist,batchClosestPt);
+        std::copy(batchV.begin(),batchV.end(),nearestV.begin()+start);
+      }
+      else
+      {
+        unifGridFace.GetClosestBatch(PDistFunct,batchPt,dist_upper_bound,batchF,batchDist,batchClosestPt);
+        std::copy(batchF.begin(),batchF.end(),nearestF.begin()+start);
+      }
+      std::copy(batchDist.begin(),batchDist.end(),dist.begin()+start);
+      std::copy(batchClosestPt.begin(),batchClosestPt.end(),closestPt.begin()+start);
+      sampleCnt+=bn;
+      if(cb && sampleNum>0) cb(std::min(100,sampleCnt*100/sampleNum),"Resampling Vertex attributes");
+    }
 
-      if(coordFlag) p.P()=closestPt;
-      if(colorFlag) p.C().lerp(nearestF->V(0)->C(),nearestF->V(1)->C(),nearestF->V(2)->C(),interp);
-      if(normalFlag) p.N() = nearestF->V(0)->N()*interp[0] + nearestF->V(1)->N()*interp[1] + nearestF->V(2)->N()*interp[2];
-      if(qualityFlag) p.Q()= nearestF->V(0)->Q()*interp[0] + nearestF->V(1)->Q()*interp[1] + nearestF->V(2)->Q()*interp[2];
-      if(selectionFlag) if(nearestF->IsS()) p.SetS();
+    if(useVertexSampling)
+    {
+#pragma omp parallel for schedule(static) if(&trg!=m)
+      for(int i=0;i<n;++i)
+        TransferFromVertex(*trgVert[i],nearestV[i],dist[i]);
     }
+    else
+    {
+#pragma omp parallel for schedule(static) if(&trg!=m)
+      for(int i=0;i<n;++i)
+        TransferFromFace(*trgVert[i],nearestF[i],closestPt[i],dist[i]);
+    }
+  }
+
+  void TransferFromVertex(CMeshO::VertexType &p, CMeshO::VertexType *nearestV, float dist)
+  {
+    if(storeDistanceAsQualityFlag)  p.Q() = dist;
+    if(dist == dist_upper_bound) return ;
+
+    if(coordFlag) p.P()=nearestV->P();
+    if(colorFlag) p.C() = nearestV->C();
+    if(normalFlag) p.N() = nearestV->N();
+    if(qualityFlag) p.Q()= nearestV->Q();
+    if(selectionFlag) if(nearestV->IsS()) p.SetS();
+  }
+
+  void TransferFromFace(CMeshO::VertexType &p, CMeshO::FaceType *nearestF, const Point3f &closestPt, float dist)
+  {
+    if(dist == dist_upper_bound) return ;
+
+    Point3f interp;
+    InterpolationParameters(*nearestF,(*nearestF).cN(),closestPt, interp);
+    interp[2]=1.0-interp[1]-interp[0];
+
+    if(coordFlag) p.P()=closestPt;
+    if(colorFlag) p.C().lerp(nearestF->V(0)->C(),nearestF->V(1)->C(),nearestF->V(2)->C(),interp);
+    if(normalFlag) p.N() = nearestF->V(0)->N()*interp[0] + nearestF->V(1)->N()*interp[1] + nearestF->V(2)->N()*interp[2];
+    if(qualityFlag) p.Q()= nearestF->V(0)->Q()*interp[0] + nearestF->V(1)->Q()*interp[1] + nearestF->V(2)->Q()*interp[2];
+    if(selectionFlag) if(nearestF->IsS()) p.SetS();
   }
 }; // end class RedetailSampler
 
@@ -926,6 +1031,7 @@ bool FilterDocSampling::applyFilter(QAction *action, MeshDocument &md, RichParam
       tri::SurfaceSampling<CMeshO,HausdorffSampler>::EdgeUniform(mm0->cm,hs,par.getInt("SampleNum"),sampleFauxEdge);
     if(sampleFace)
       tri::SurfaceSampling<CMeshO,HausdorffSampler>::Montecarlo(mm0->cm,hs,par.getInt("SampleNum"));
+    hs.Flush();
 
     Log("Hausdorff Distance computed");
     Log("     Sampled %i pts (rng: 0) on %s searched closest on %s",hs.n_total_samples,qPrintable(mm0->label()),qPrintable(mm1->label()));
@@ -982,7 +1088,7 @@ bool FilterDocSampling::applyFilter(QAction *action, MeshDocument &md, RichParam
     qDebug("Source  mesh has %7i vert %7i face",srcMesh->cm.vn,srcMesh->cm.fn);
     qDebug("Target  mesh has %7i vert %7i face",trgMesh->cm.vn,trgMesh->cm.fn);
 
-    tri::SurfaceSampling<CMeshO,RedetailSampler>::VertexUniform(trgMesh->cm,rs,trgMesh->cm.vn);
+    rs.AddAllVert(trgMesh->cm);
 
     if(rs.coordFlag) tri::UpdateNormal<CMeshO>::PerFaceNormalized(trgMesh->cm);
 
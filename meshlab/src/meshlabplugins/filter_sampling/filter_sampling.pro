@@ -4,5 +4,3 @@ HEADERS       += filter_sampling.h \
     $$VCGDIR/vcg/complex/algorithms/point_sampling.h
 SOURCES       += filter_sampling.cpp
 TARGET        = filter_sampling
-
-
@@ -1,9 +1,6 @@
 #include <vcg/complex/algorithms/intersection.h>
-#include <vcg/space/index/grid_static_ptr.h>
-#include <vcg/space/index/spatial_hashing.h>
 
-#include <vcg/space/index/grid_static_ptr.h> // vcg::GridStaticPtr
-#include <vcg/space/index/spatial_hashing.h> // vcg::SpatialHashTable
+#include <vcg/space/index/ray_bvh.h> // vcg::RayBVH
 
 #include <wrap/qt/to_string.h>
 #include "filter_sdf.h"
@@ -11,9 +8,8 @@
 #include "mysampling.h"
 
 
-//--- Uncomment only one of the two following lines to test different data structures
-typedef vcg::GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType> TriMeshGrid;
-/* typedef vcg::SpatialHashTable<CMeshO::FaceType, CMeshO::float> TriMeshGrid; */
+//--- Number of vertices whose cones are generated and traced at once
+static const int SDF_CHUNK_SIZE = 4096;
 
 using namespace std;
 using namespace vcg;
@@ -87,9 +83,8 @@ bool SdfPlugin::applyFilter(MeshDocument& md, RichParameterSet& pars, vcg::CallB
   
   //--- Add the mesh to an indexing structure (fast ray intersection)
   Log("Initializing spatial accelleration...");
-  mm->updateDataMask(MeshModel::MM_FACEMARK);
-  TriMeshGrid static_grid; //TODO: rename spatial index
-  static_grid.Set(m.face.begin(), m.face.end());
+  RayBVH<CMeshO> bvh;
+  bvh.Set(m);
   Log("Initializing spatial accelleration... DONE!");
    
   // since we are measuring the interior of the shape
@@ -100,51 +95,65 @@ bool SdfPlugin::applyFilter(MeshDocument& md, RichParameterSet& pars, vcg::CallB
   float epsilon = maxDist / 1000.0;
 
   //--- Ray casting
-  vector<Ray3f> cone;
-  vector<float> coneSdf;
-  Ray3f ray; 
-  float t;
+  // The vertices are processed in chunks: the cones of a chunk are generated
+  // serially (generateRayCone relies on rand()), then traced in parallel.
   if( onPrimitive == ON_VERTICES ){
-    for(int i=0; i<m.vert.size(); i++){
-      CVertexO& v = m.vert[i];
+    const int vn = int(m.vert.size());
+    vector<Ray3f> cones;
+    vector<float> coneSdf;
+    vector<Ray3f> cone;
+    Ray3f ray; 
+    for(int start=0; start<vn; start+=SDF_CHUNK_SIZE){
+      const int end = std::min(vn, start+SDF_CHUNK_SIZE);
       //--- Update progressbar
-      cb( 100*i/m.vert.size(), "Casting rays into volume...");
+      cb( 100*start/vn, "Casting rays into volume...");
       
       //--- Generate the set of cones
-      ray.Set( v.P(), -v.N() );
-      ray.SetOrigin( ray.P(epsilon) );
-      generateRayCone( ray, widenessRad, raysPerCone, cone, coneSdf );
-      
-      //--- Trace rays in cone
-      float mind = +numeric_limits<float>::max();
-      float maxd = -numeric_limits<float>::max();
-      for(unsigned int i=0; i<cone.size(); i++){
-        bool hasInt = tri::DoRay<CMeshO,TriMeshGrid>(m,static_grid,cone[i],maxDist,t);
-        coneSdf[i] = (hasInt==true) ? t : numeric_limits<float>::quiet_NaN();
-        mind = (hasInt && (t<mind)) ? t : mind;
-        maxd = (hasInt && (t>maxd)) ? t : maxd;
+      cones.resize((end-start)*raysPerCone);
+      for(int i=start; i<end; i++){
+        ray.Set( m.vert[i].P(), -m.vert[i].N() );
+        ray.SetOrigin( ray.P(epsilon) );
+        generateRayCone( ray, widenessRad, raysPerCone, cone, coneSdf );
+        std::copy(cone.begin(), cone.end(), cones.begin()+(i-start)*raysPerCone);
       }
       
-      //--- Compute per-cone statistics
-      Histogram<float> H;
-      H.Clear();
-      H.SetRange( mind,maxd, 100);
-      for(unsigned int i=0; i<cone.size(); i++)
-        if(!math::IsNAN(coneSdf[i]))
-          H.Add(coneSdf[i]);
-      float loperc = H.Percentile(lo01pec);
-      float hiperc = H.Percentile(hi01pec);
-      
-      //--- Compute average of samples, throwing away outliers
-      float totVal = 0, totCnt = 0;
-      for(unsigned int i=0; i<coneSdf.size(); i++)
-        if( !math::IsNAN(coneSdf[i]) && coneSdf[i]>=loperc && coneSdf[i]<=hiperc ){
-          totVal += coneSdf[i];
-          totCnt += 1;
-        } 
+      #pragma omp parallel for schedule(dynamic,16)
+      for(int i=start; i<end; i++){
+        const Ray3f* vcone = &cones[(i-start)*raysPerCone];
+        vector<float> sdf(raysPerCone);
+        float t;
+        
+        //--- Trace rays in cone
+        float mind = +numeric_limits<float>::max();
+        float maxd = -numeric_limits<float>::max();
+        for(int j=0; j<raysPerCone; j++){
+          bool hasInt = bvh.DoRay(vcone[j],maxDist,t)!=0;
+          sdf[j] = (hasInt==true) ? t : numeric_limits<float>::quiet_NaN();
+          mind = (hasInt && (t<mind)) ? t : mind;
+          maxd = (hasInt && (t>maxd)) ? t : maxd;
+        }
+        
+        //--- Compute per-cone statistics
+        Histogram<float> H;
+        H.Clear();
+        H.SetRange( mind,maxd, 100);
+        for(int j=0; j<raysPerCone; j++)
+          if(!math::IsNAN(sdf[j]))
+            H.Add(sdf[j]);
+        float loperc = H.Percentile(lo01pec);
+        float hiperc = H.Percentile(hi01pec);
+        
+        //--- Compute average of samples, throwing away outliers
+        float totVal = 0, totCnt = 0;
+        for(int j=0; j<raysPerCone; j++)
+          if( !math::IsNAN(sdf[j]) && sdf[j]>=loperc && sdf[j]<=hiperc ){
+            totVal += sdf[j];
+            totCnt += 1;
+          } 
            
-      //--- Save in mesh
-      v.Q() = totCnt>0 ? (totVal/totCnt) : 0;
+        //--- Save in mesh
+        m.vert[i].Q() = totCnt>0 ? (totVal/totCnt) : 0;
+      }
     }
   }
   return true;
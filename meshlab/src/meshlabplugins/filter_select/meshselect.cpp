@@ -156,6 +156,9 @@ void SelectionFilterPlugin::initParameterSet(QAction *action, MeshModel &m, Rich
     case FP_SELECT_FACE_FROM_VERT:
       parlst.addParam(new RichBool("Inclusive", true, "Inclusive Sel.", "If true only the faces with <b>all</b> selected vertices are selected. Otherwise any face with at least one selected vertex will be selected."));
       break;
+    case CP_SELFINTERSECT_SELECT:
+      parlst.addParam(new RichBool("SelectedOnly", false, "Only Selected Faces", "If true only the currently selected faces are checked (against all the faces) and only the intersecting ones among them and the faces they intersect are selected."));
+      break;
     case FP_SELECT_VERT_FROM_FACE:
       parlst.addParam(new RichBool("Inclusive", true, "Inclusive Sel.", "If true only the vertices with <b>all</b> the incident face selected are selected. Otherwise any vertex with at least one incident selected face will be selected."));
       break;
@@ -389,7 +392,7 @@ bool SelectionFilterPlugin::applyFilter(QAction *action, MeshDocument &md, RichP
   case CP_SELFINTERSECT_SELECT:
     {
       std::vector<CFaceO *> IntersFace;
-      tri::Clean<CMeshO>::SelfIntersections(m.cm,IntersFace);
+      tri::Clean<CMeshO>::SelfIntersections(m.cm,IntersFace,par.getBool("SelectedOnly"));
       tri::UpdateSelection<CMeshO>::FaceClear(m.cm);
       std::vector<CFaceO *>::iterator fpi;
       for(fpi=IntersFace.begin();fpi!=IntersFace.end();++fpi)
@@ -430,7 +433,7 @@ MeshFilterInterface::FilterClass SelectionFilterPlugin::getClass(QAction *action
   case CP_SELECT_NON_MANIFOLD_VERTEX:       return MeshModel::MM_FACEFACETOPO;
   case CP_SELECT_TEXBORDER:                   return MeshModel::MM_FACEFACETOPO;
   case CP_SELFINTERSECT_SELECT:
-              return MeshModel::MM_FACEMARK | MeshModel::MM_FACEFACETOPO | MeshModel::MM_FACECOLOR;
+              return MeshModel::MM_FACEFACETOPO | MeshModel::MM_FACECOLOR;
 
 	 default: return 0;
   }
@@ -25,6 +25,13 @@
 #include <common/interfaces.h>
 #include <common/pluginmanager.h>
 #include <common/filterscript.h>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMap>
+#include <QWaitCondition>
+#include <vcg/complex/algorithms/local_optimization/tri_edge_collapse_quadric_block.h>
+#include <wrap/io_trimesh/ply_block_source.h>
+#include <wrap/system/multithreading/util.h>
 
 class FilterData
 {
@@ -41,7 +48,7 @@ class MeshLabServer
 	public:
   MeshLabServer() {}
 
-  ~MeshLabServer() {}
+  ~MeshLabServer() { qDeleteAll(ioMutex); }
 
 	static bool FilterCallBack(const int pos, const char * str)
 	{
@@ -140,6 +147,7 @@ class MeshLabServer
 		int mask = 0;
 
 		RichParameterSet prePar;
+		QMutexLocker locker(pluginMutex(pCurrentIOPlugin));
 		pCurrentIOPlugin->initPreOpenParameter(extension, fileName,prePar);
 
 		if (!pCurrentIOPlugin->open(extension, fileName, mm ,mask,prePar))
@@ -147,6 +155,7 @@ class MeshLabServer
 			printf("MeshLabServer: Failed loading of %s from dir %s\n",qPrintable(fileName),qPrintable(curdir.path()));
 			return false;
 		}
+		locker.unlock();
 
 		// In case of polygonal meshes the normal should be updated accordingly
 		if( mask & vcg::tri::io::Mask::IOM_BITPOLYGONAL) 
@@ -180,6 +189,39 @@ class MeshLabServer
 		return true;
 	}
 
+	// Load a mesh simplifying it with the out of core quadric simplification.
+	// Binary ply files with only triangles are memory mapped and simplified block by block,
+	// so they are never entirely loaded; other files are loaded and then simplified in blocks.
+	bool OpenSimplified(MeshModel &mm, QString fileName, int TargetFaceNum, int BlockFaceNum, int MemoryMB)
+	{
+		typedef vcg::tri::QuadricBlockSimplification<CMeshO> QBS;
+		QBS::Param pp;
+		pp.BlockFaceNum=BlockFaceNum;
+		pp.MemoryBudget=size_t(MemoryMB)<<20;
+		pp.QParam.PreserveBoundary=true;
+
+		vcg::tri::io::PlyBlockSource<CMeshO> plySrc;
+		if(QFileInfo(fileName).suffix().toLower()=="ply" && plySrc.Open(qPrintable(fileName)))
+		{
+			printf("Out of core simplification of %s (%i fn) to %i fn\n",qPrintable(fileName),plySrc.FN(),TargetFaceNum);
+			QBS::Do(plySrc,mm.cm,TargetFaceNum,pp,FilterCallBack);
+		}
+		else
+		{
+			if(!Open(mm,fileName)) return false;
+			printf("Simplification in blocks of %s (%i fn) to %i fn\n",qPrintable(fileName),mm.cm.fn,TargetFaceNum);
+			CMeshO res;
+			vcg::tri::MeshBlockSource<CMeshO> src(mm.cm);
+			QBS::Do(src,res,TargetFaceNum,pp,FilterCallBack);
+			mm.cm.Clear();
+			res.textures.swap(mm.cm.textures);
+			vcg::tri::Append<CMeshO,CMeshO>::Mesh(mm.cm,res);
+		}
+		mm.clearDataMask(MeshModel::MM_VERTFACETOPO | MeshModel::MM_FACEFACETOPO);
+		mm.UpdateBoxAndNormals();
+		return true;
+	}
+
 	bool Save(MeshModel *mm, int mask, QString fileName)
 	{
     QFileInfo fi(fileName);
@@ -200,6 +242,7 @@ class MeshLabServer
 
 		// optional saving parameters (like ascii/binary encoding)
 		RichParameterSet savePar;
+		QMutexLocker locker(pluginMutex(pCurrentIOPlugin));
 		pCurrentIOPlugin->initSaveParameter(extension, *mm, savePar);
 
 		if (!pCurrentIOPlugin->save(extension, fileName, *mm ,mask, savePar))
@@ -228,6 +271,8 @@ class MeshLabServer
 		scriptPtr.open(scriptfile);
 		printf("Starting Script of %i actions",scriptPtr.actionList.size());
 		FilterScript::iterator ii;
+		// kept across the filters, so that each one copies only the data changed by the previous ones
+		MeshModelState preFilterState;
 		for(ii = scriptPtr.actionList.begin();ii!= scriptPtr.actionList.end();++ii)
 		{
       //RichParameterSet &par = (*ii).second;
@@ -290,6 +335,11 @@ class MeshLabServer
 				}
 			}
 
+			// save the portion of the current mesh changed by the filter, to restore it if the filter fails
+			const bool restorable = (meshDocument.mm() != NULL) && MeshModelState::isSupported(iFilter->postCondition(action));
+			if(restorable)
+				preFilterState.create(iFilter->postCondition(action), meshDocument.mm(), &preFilterState);
+
 			bool ret = iFilter->applyFilter( action, meshDocument, (*ii).second, FilterCallBack);
 
       QStringList logOutput;
@@ -300,6 +350,8 @@ class MeshLabServer
 			if(!ret)
 			{
 				printf("Problem with filter: %s\n",qPrintable((*ii).first));
+				if(restorable && preFilterState.apply(meshDocument.mm()))
+					printf("The mesh has been restored as it was before the filter\n");
 				return false;
 			}
 		}
@@ -317,6 +369,16 @@ class MeshLabServer
 			" -s filename		    script to be applied\n"
 			" -d filename       dump on a text file a list of all the filtering fucntion\n"
       " -l filename       the log of the filters is ouput on a file\n"
+      " -q facenum [blockfacenum [MB]] simplify the input meshes to facenum faces while loading them, with the\n"
+      "                   out of core quadric simplification: the mesh is processed in blocks of blockfacenum\n"
+      "                   faces (default 100000) and about MB megabytes of blocks (default 512) are in memory at once.\n"
+      "                   Binary ply files made only of triangles are never loaded as a whole.\n"
+      " -b manifest [workers [MB]] batch mode: process all the meshes listed in the manifest, a text file where\n"
+      "                   each line has an input and an output filename (tab or space separated, '#' starts a comment).\n"
+      "                   The script and the -om/-q options are applied to each mesh; -i and -o are ignored.\n"
+      "                   workers threads (default 2) load the next meshes and save the previous ones while the script\n"
+      "                   runs, as long as the meshes in memory take less than MB megabytes (default 1024).\n"
+      " -t threads        number of threads used by the parallel filters (default 0, one for each processor)\n"
       " -om options       data to save in the output files: vc -> vertex colors, vf -> vertex flags, vq -> vertex quality, vn-> vertex normals, vt -> vertex texture coords, "
       " fc -> face colors, ff -> face flags, fq -> face quality, fn-> face normals, "
 			" wc -> wedge colors, wn-> wedge normals, wt -> wedge texture coords \n"
@@ -335,9 +397,213 @@ class MeshLabServer
 	}
 
 private:
+	// The io plugins are not reentrant (some importers and exporters keep static data, like the
+	// counters of ImporterOBJ): in the batch mode the workers load and save different meshes at
+	// the same time, so each io plugin is used by one thread at a time. Different plugins and
+	// the filters, that run in the main thread, are not serialized.
+	QMutex *pluginMutex(MeshIOInterface *plugin)
+	{
+		QMutexLocker locker(&ioMapMutex);
+		QMutex *&m = ioMutex[plugin];
+		if(m == 0) m = new QMutex();
+		return m;
+	}
+
 	PluginManager PM;
 	RichParameterSet defaultGlobal;
+	QMutex ioMapMutex;
+	QMap<MeshIOInterface *, QMutex *> ioMutex;
+
+};
+
+// One input/output pair of the batch mode (-b option).
+class BatchJob
+{
+public:
+	enum State { Waiting, Loading, Loaded, Saving, Done, Failed };
+	BatchJob(QString _in, QString _out):in(_in),out(_out),md(0),state(Waiting),memory(0){}
+	QString in,out;
+	MeshDocument *md;
+	State state;
+	size_t memory; // memory taken by the mesh (estimated until it is loaded)
+};
+
+// Batch processing of the meshes listed in a manifest, with the plugins loaded only once.
+// The three stages are pipelined: while the script is applied to a mesh in the main thread
+// (some filters need the OpenGL context), a pool of workers loads the next meshes and saves
+// the previous ones. The meshes are loaded in advance only as long as the memory taken by
+// the meshes in the pipeline stays below the given cap (at least one mesh is always processed).
+// An io plugin is used by one thread at a time (see MeshLabServer::pluginMutex), so meshes of
+// the same format are loaded and saved one after the other, while the filters are never held back by the io.
+class MeshLabBatch
+{
+public:
+	MeshLabBatch(MeshLabServer &_server):server(_server),logfp(stdout),mask(0),simpFaceNum(0),simpBlockFaceNum(100000),simpMemoryMB(512),
+		workers(2),memoryCap(size_t(1024)<<20),inMemory(0),loading(0){}
+
+	MeshLabServer &server;
+	FILE *logfp;
+	QString scriptName;
+	int mask;
+	int simpFaceNum,simpBlockFaceNum,simpMemoryMB;
+	int workers;
+	size_t memoryCap;
+
+	// Each non empty line of the manifest is made of an input and an output filename
+	// (separated by a tab, or by spaces if there is no tab); lines starting with '#' are ignored.
+	bool ReadManifest(QString fileName)
+	{
+		QFile file(fileName);
+		if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			printf("Unable to open the manifest %s\n",qPrintable(fileName));
+			return false;
+		}
+		QDir currentdir(QDir::currentPath());
+		QTextStream stream(&file);
+		int lineNum=0;
+		while(!stream.atEnd())
+		{
+			QString line=stream.readLine().trimmed();
+			++lineNum;
+			if(line.isEmpty() || line.startsWith('#')) continue;
+			QStringList names = line.contains('\t') ? line.split('\t',QString::SkipEmptyParts)
+			                                        : line.split(QRegExp("\\s+"),QString::SkipEmptyParts);
+			if(names.size()!=2)
+			{
+				printf("Manifest %s line %i: expected an input and an output filename\n",qPrintable(fileName),lineNum);
+				return false;
+			}
+			jobs.push_back(BatchJob(currentdir.absoluteFilePath(names[0].trimmed()),currentdir.absoluteFilePath(names[1].trimmed())));
+		}
+		printf("Batch of %i meshes from %s\n",int(jobs.size()),qPrintable(fileName));
+		return true;
+	}
+
+	// Process all the jobs; it returns the number of failed ones.
+	int Run()
+	{
+		QThreadPool pool;
+		pool.setMaxThreadCount(std::max(1,workers));
+		int n=int(jobs.size());
+		int next=0;     // next job to load
+		int cur=0;      // next job to filter
+		int released=0; // the jobs before this have been deleted
+		int failed=0;
+		QMutexLocker locker(&mutex);
+		while(released<n)
+		{
+			// start the loads of the next meshes, if the memory cap allows
+			while(next<n && loading<workers)
+			{
+				size_t estimate=EstimateMemory(jobs[next].in);
+				if(inMemory>0 && inMemory+estimate>memoryCap) break;
+				BatchJob &job=jobs[next++];
+				job.md=new MeshDocument();
+				job.md->addNewMesh(job.in,"");
+				job.memory=estimate;
+				job.state=BatchJob::Loading;
+				inMemory+=estimate;
+				++loading;
+				pool.start(new BatchTask(this,&job,true));
+			}
+
+			if(cur<next && jobs[cur].state==BatchJob::Loaded)
+			{
+				// filter the current mesh and queue its saving
+				BatchJob &job=jobs[cur++];
+				locker.unlock();
+				bool ok=true;
+				if(!scriptName.isEmpty())
+				{
+					printf("Apply FilterScript '%s' to %s\n",qPrintable(scriptName),qPrintable(job.in));
+					ok=server.Script(*job.md,scriptName,logfp);
+					if(!ok) printf("Failed to apply FilterScript to %s\n",qPrintable(job.in));
+				}
+				locker.relock();
+				if(ok)
+				{
+					job.state=BatchJob::Saving;
+					pool.start(new BatchTask(this,&job,false));
+				}
+				else job.state=BatchJob::Failed;
+				continue;
+			}
+			if(cur<next && jobs[cur].state==BatchJob::Failed)
+			{
+				++cur;
+				continue;
+			}
 
+			// delete the meshes already saved (or failed) in the main thread, where they were created
+			bool progress=false;
+			while(released<cur && (jobs[released].state==BatchJob::Done || jobs[released].state==BatchJob::Failed))
+			{
+				BatchJob &job=jobs[released++];
+				if(job.state==BatchJob::Failed) ++failed;
+				delete job.md;
+				job.md=0;
+				inMemory-=job.memory;
+				progress=true;
+			}
+			if(!progress) cond.wait(&mutex);
+		}
+		locker.unlock();
+		pool.waitForDone();
+		printf("Batch done: %i meshes processed, %i failed\n",n-failed,failed);
+		return failed;
+	}
+
+private:
+	class BatchTask : public QRunnable
+	{
+	public:
+		BatchTask(MeshLabBatch *_b, BatchJob *_job, bool _load):b(_b),job(_job),load(_load){}
+		void run() { if(load) b->Load(*job); else b->Save(*job); }
+	private:
+		MeshLabBatch *b;
+		BatchJob *job;
+		bool load;
+	};
+
+	// Before the loading the memory is guessed from the file size
+	static size_t EstimateMemory(QString fileName) { return size_t(QFileInfo(fileName).size())*2; }
+	static size_t MeshMemory(MeshModel &mm) { return mm.cm.vert.size()*sizeof(CVertexO) + mm.cm.face.size()*sizeof(CFaceO); }
+
+	void Load(BatchJob &job)
+	{
+		MeshModel &mm=*job.md->mm();
+		bool ok;
+		if(simpFaceNum>0) ok=server.OpenSimplified(mm,job.in,simpFaceNum,simpBlockFaceNum,simpMemoryMB);
+		else              ok=server.Open(mm,job.in);
+		if(ok) printf("Mesh %s loaded has %i vn %i fn\n", qPrintable(job.in), mm.cm.vn, mm.cm.fn);
+		QMutexLocker locker(&mutex);
+		if(ok)
+		{
+			size_t memory=MeshMemory(mm);
+			inMemory=inMemory-job.memory+memory;
+			job.memory=memory;
+		}
+		job.state= ok ? BatchJob::Loaded : BatchJob::Failed;
+		--loading;
+		cond.wakeAll();
+	}
+
+	void Save(BatchJob &job)
+	{
+		MeshModel *mm=job.md->mm();
+		bool ok=server.Save(mm,mask,job.out);
+		if(ok) printf("Mesh %s saved as %s (%i vn %i fn)\n", qPrintable(job.in), qPrintable(job.out), mm->cm.vn, mm->cm.fn);
+		QMutexLocker locker(&mutex);
+		job.state= ok ? BatchJob::Done : BatchJob::Failed;
+		cond.wakeAll();
+	}
+
+	std::vector<BatchJob> jobs;
+	QMutex mutex;
+	QWaitCondition cond;
+	size_t inMemory;
+	int loading; // number of loads in progress
 };
 
 int main(int argc, char *argv[])
@@ -350,6 +616,9 @@ int main(int argc, char *argv[])
 	QString scriptName;
 	FILE *filterFP=0;
 	int mask=0;
+	int simpFaceNum=0, simpBlockFaceNum=100000, simpMemoryMB=512;
+	QString manifestName;
+	int batchWorkers=2, batchMemoryMB=1024;
 	if(argc < 3) server.Usage();
 	int i = 1;
 	QString res = qApp->applicationDirPath();
@@ -457,12 +726,58 @@ int main(int argc, char *argv[])
 				filterFP=fopen(argv[i+1],"w");
 			 i+=2;
 			 break;
+      case 'q' :
+        if( argc <= i+1 ) {
+          printf("Missing target face number\n");
+          exit(-1);
+        }
+        simpFaceNum = atoi(argv[i+1]);
+        i += 2;
+        if( i < argc && argv[i][0] != '-') simpBlockFaceNum = atoi(argv[i++]);
+        if( i < argc && argv[i][0] != '-') simpMemoryMB = atoi(argv[i++]);
+        printf("Out of core simplification to %i faces (blocks of %i faces, %i MB)\n",simpFaceNum,simpBlockFaceNum,simpMemoryMB);
+        break;
+      case 'b' :
+        if( argc <= i+1 ) {
+          printf("Missing manifest name\n");
+          exit(-1);
+        }
+        manifestName = currentdir.absoluteFilePath(argv[i+1]);
+        i += 2;
+        if( i < argc && argv[i][0] != '-') batchWorkers = atoi(argv[i++]);
+        if( i < argc && argv[i][0] != '-') batchMemoryMB = atoi(argv[i++]);
+        printf("Batch mode on %s (%i workers, %i MB)\n",qPrintable(manifestName),batchWorkers,batchMemoryMB);
+        break;
+      case 't' :
+        if( argc <= i+1 ) {
+          printf("Missing thread number\n");
+          exit(-1);
+        }
+        mt::set_thread_count(atoi(argv[i+1]));
+        printf("Parallel filters use %i threads\n",atoi(argv[i+1]));
+        i += 2;
+        break;
 		}
 	}
 	
 	printf("Loading Plugins:\n");
   server.loadPlugins();
   if(filterFP) server.dumpPluginInfoDoxygen(filterFP);
+
+	if(!manifestName.isEmpty())
+	{
+		MeshLabBatch batch(server);
+		if(!batch.ReadManifest(manifestName)) exit(-1);
+		batch.logfp=logfp;
+		batch.scriptName=scriptName;
+		batch.mask=mask;
+		batch.simpFaceNum=simpFaceNum;
+		batch.simpBlockFaceNum=simpBlockFaceNum;
+		batch.simpMemoryMB=simpMemoryMB;
+		batch.workers=batchWorkers;
+		batch.memoryCap=size_t(batchMemoryMB)<<20;
+		return batch.Run()==0 ? 0 : -1;
+	}
 	
 	
 	if(meshNamesIn.isEmpty()) {
@@ -479,7 +794,10 @@ int main(int argc, char *argv[])
 				firstind = mmod->id();
 
 			// MeshModel *mm = new MeshModel( meshNamesIn.at(i).toStdString().c_str() );
-            server.Open(*(meshDocument.mm()), meshNamesIn.at(i));
+            if(simpFaceNum>0)
+              server.OpenSimplified(*(meshDocument.mm()), meshNamesIn.at(i), simpFaceNum, simpBlockFaceNum, simpMemoryMB);
+            else
+              server.Open(*(meshDocument.mm()), meshNamesIn.at(i));
             MeshModel* mm = meshDocument.mm();
 printf("Mesh %s loaded has %i vn %i fn\n", qPrintable(mm->shortName()), mm->cm.vn, mm->cm.fn);
 		}
@@ -2,7 +2,8 @@ include (../general.pri)
 
 HEADERS        = 
 
-SOURCES        = mainserver.cpp
+SOURCES        = mainserver.cpp \
+                 $$VCGDIR/wrap/ply/plylib.cpp
 
 RESOURCES = ../meshlab/meshlab.qrc
 
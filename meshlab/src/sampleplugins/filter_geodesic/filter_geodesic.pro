@@ -5,4 +5,3 @@ HEADERS       += filter_geodesic.h
 SOURCES       += filter_geodesic.cpp 
 		
 TARGET        = filter_geodesic
-
@@ -4,3 +4,11 @@ CONFIG += console stl
 TEMPLATE = app
 # Mac specific Config required to avoid to make application bundles
 CONFIG -= app_bundle
+
+# the parallel loops of the library are compiled in when OpenMP is available
+win32-msvc2008:QMAKE_CXXFLAGS += /openmp
+win32-msvc2010:QMAKE_CXXFLAGS += /openmp
+win32-g++:QMAKE_CXXFLAGS += -fopenmp
+win32-g++:QMAKE_LFLAGS += -fopenmp
+linux-g++*:QMAKE_CXXFLAGS += -fopenmp
+linux-g++*:QMAKE_LFLAGS += -fopenmp
@@ -21,6 +21,7 @@ SUBDIRS       = trimesh_base  \
                 trimesh_kdtree \
                 trimesh_normal \
                 trimesh_optional \
+                trimesh_parallel_decimation \
                 trimesh_pointmatching \
                 trimesh_ray \
                 trimesh_refine \
@@ -28,8 +29,10 @@ SUBDIRS       = trimesh_base  \
                 trimesh_smooth \
                 trimesh_split_vertex \
                 trimesh_texture \
+                trimesh_thread_pool \
                 trimesh_topology \
                 polygonmesh_base \
                 space_packer \
+                space_kdtree_bench \
                 aabb_binary_tree
 
@@ -0,0 +1,150 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2012                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+/*! \file space_kdtree_bench.cpp
+\ingroup code_sample
+
+\brief A small benchmark of the kdtree on large random point clouds
+
+It builds a KdTree over N random points (10M by default, it is meant to be run with 10M-100M points)
+and the same tree with the previous implementation (ReferenceKdTree, see reference_kdtree.h), then
+performs the same kNN queries with the reference tree, with the single context interface (one query
+at a time) and with the parallel batch interface. It checks that the three give the same neighbours
+and that the first queries agree with a brute force search.
+
+Usage: space_kdtree_bench [pointNum] [queryNum] [k]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <vcg/space/point3.h>
+#include <vcg/space/index/kdtree/kdtree.h>
+#include <wrap/system/time/clock.h>
+#include "reference_kdtree.h"
+
+using namespace vcg;
+
+// the ids of the i-th query, sorted: the trees return them in heap order
+static std::vector<unsigned int> SortedIds(const std::vector<unsigned int> &ids, int i, int k)
+{
+  std::vector<unsigned int> a(ids.begin()+size_t(i)*k,ids.begin()+size_t(i+1)*k);
+  std::sort(a.begin(),a.end());
+  return a;
+}
+
+// a small deterministic generator, rand() has only 15 bits on some platforms
+static unsigned int NextRand(unsigned int &seed)
+{
+  seed = seed*1664525u + 1013904223u;
+  return seed>>8;
+}
+
+int main( int argc, char **argv )
+{
+  int pointNum = (argc>1) ? atoi(argv[1]) : 10000000;
+  int queryNum = (argc>2) ? atoi(argv[2]) : 1000000;
+  int k        = (argc>3) ? atoi(argv[3]) : 8;
+  pointNum = std::max(pointNum,1);
+  k = std::max(1,std::min(k,pointNum));
+  queryNum = std::max(1,std::min(queryNum,pointNum));
+
+  printf("Generating %i points\n",pointNum);
+  std::vector<Point3f> pts(pointNum,Point3f(0,0,0));
+  unsigned int seed=1;
+  for(int i=0;i<pointNum;++i)
+    for(int j=0;j<3;++j)
+      pts[i][j] = float(NextRand(seed))/float(1<<24);
+
+  mt::Clock clock;
+  ConstDataWrapper<Point3f> ww(&pts[0],pointNum);
+  clock.start();
+  ReferenceKdTree<float> refTree(ww);
+  printf("Built the reference tree in %i ms\n",clock.elapsed());
+  clock.start();
+  KdTree<float> tree(ww);
+  printf("Built the tree in %i ms\n",clock.elapsed());
+
+  // query points: a subset of the input, slightly jittered
+  std::vector<Point3f> queries(queryNum,Point3f(0,0,0));
+  for(int i=0;i<queryNum;++i)
+    queries[i] = pts[NextRand(seed)%pointNum] + Point3f(1e-4f,-1e-4f,1e-4f);
+
+  clock.start();
+  std::vector<unsigned int> refIds(size_t(queryNum)*k);
+  refTree.setMaxNofNeighbors(k);
+  for(int i=0;i<queryNum;++i)
+  {
+    refTree.doQueryK(queries[i]);
+    for(int j=0;j<k;++j)
+      refIds[size_t(i)*k+j] = refTree.getNeighborId(j);
+  }
+  printf("%i queries (k=%i) on the reference tree in %i ms\n",queryNum,k,clock.elapsed());
+
+  clock.start();
+  std::vector<unsigned int> serialIds(size_t(queryNum)*k);
+  tree.setMaxNofNeighbors(k);
+  for(int i=0;i<queryNum;++i)
+  {
+    tree.doQueryK(queries[i]);
+    for(int j=0;j<k;++j)
+      serialIds[size_t(i)*k+j] = tree.getNeighborId(j);
+  }
+  printf("%i queries (k=%i) one at a time in %i ms\n",queryNum,k,clock.elapsed());
+
+  clock.start();
+  std::vector<unsigned int> batchIds;
+  std::vector<float> batchSqDist;
+  tree.doQueryK(ConstDataWrapper<Point3f>(&queries[0],queryNum),k,batchIds,batchSqDist);
+  printf("%i queries (k=%i) as a parallel batch in %i ms\n",queryNum,k,clock.elapsed());
+
+  int serialMismatch=0, batchMismatch=0;
+  for(int i=0;i<queryNum;++i)
+  {
+    std::vector<unsigned int> r = SortedIds(refIds,i,k);
+    if(r!=SortedIds(serialIds,i,k)) ++serialMismatch;
+    if(r!=SortedIds(batchIds,i,k)) ++batchMismatch;
+  }
+  printf("Reference/serial mismatches: %i\n",serialMismatch);
+  printf("Reference/batch mismatches: %i\n",batchMismatch);
+
+  // the brute force search compares the distances, not the ids, since coincident
+  // points can be returned in any order
+  int bruteNum = std::min(queryNum,20);
+  int bruteMismatch=0;
+  clock.start();
+  for(int i=0;i<bruteNum;++i)
+  {
+    std::vector<float> d(pointNum);
+    for(int j=0;j<pointNum;++j)
+      d[j] = SquaredDistance(queries[i],pts[j]);
+    std::partial_sort(d.begin(),d.begin()+k,d.end());
+    std::vector<float> b(batchSqDist.begin()+size_t(i)*k,batchSqDist.begin()+size_t(i+1)*k);
+    std::sort(b.begin(),b.end());
+    if(!std::equal(b.begin(),b.end(),d.begin())) ++bruteMismatch;
+  }
+  printf("%i brute force queries in %i ms\n",bruteNum,clock.elapsed());
+  printf("Brute force mismatches: %i on %i queries\n",bruteMismatch,bruteNum);
+
+  return (serialMismatch==0 && batchMismatch==0 && bruteMismatch==0) ? 0 : 1;
+}
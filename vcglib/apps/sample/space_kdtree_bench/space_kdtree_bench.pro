@@ -0,0 +1,4 @@
+include(../common.pri)
+TARGET = space_kdtree_bench
+SOURCES += space_kdtree_bench.cpp
+HEADERS += reference_kdtree.h
@@ -0,0 +1,166 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2012                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+/*! \file trimesh_parallel_decimation.cpp
+\ingroup code_sample
+
+\brief A check of the parallel quadric edge collapse (LocalOptimization::DoOptimizationParallel)
+
+A torus is simplified, preserving the topology, with the sequential DoOptimization
+and with DoOptimizationParallel run with 1, 2 and 4 threads. Each result must have the target number of faces (as counted
+by the flags), no non-manifold edges and genus 1; the parallel results must be the same
+for any number of threads. It prints the number of failures and returns 1 if there is any.
+
+Usage: trimesh_parallel_decimation [targetFaceNum]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <vcg/complex/complex.h>
+#include <vcg/complex/algorithms/create/platonic.h>
+#include <vcg/complex/algorithms/clean.h>
+#include <vcg/complex/algorithms/local_optimization.h>
+#include <vcg/complex/algorithms/local_optimization/tri_edge_collapse_quadric.h>
+
+using namespace vcg;
+using namespace std;
+
+class MyVertex;
+class MyEdge;
+class MyFace;
+struct MyUsedTypes : public UsedTypes<	Use<MyVertex>   ::AsVertexType,
+                                        Use<MyEdge>     ::AsEdgeType,
+                                        Use<MyFace>     ::AsFaceType>{};
+
+class MyVertex  : public Vertex<MyUsedTypes, vertex::VFAdj, vertex::Coord3f, vertex::Normal3f, vertex::Mark, vertex::BitFlags  >
+{
+public:
+  math::Quadric<double> &Qd() {return q;}
+private:
+  math::Quadric<double> q;
+};
+class MyEdge    : public Edge<MyUsedTypes>{};
+class MyFace    : public Face< MyUsedTypes, face::VFAdj, face::FFAdj, face::VertexRef, face::BitFlags > {};
+class MyMesh    : public tri::TriMesh< vector<MyVertex>, vector<MyFace> > {};
+
+typedef tri::BasicVertexPair<MyVertex> VertexPair;
+
+class MyCollapse : public tri::TriEdgeCollapseQuadric< MyMesh, VertexPair, MyCollapse, tri::QInfoStandard<MyVertex> >
+{
+public:
+  typedef tri::TriEdgeCollapseQuadric< MyMesh, VertexPair, MyCollapse, tri::QInfoStandard<MyVertex> > TECQ;
+  inline MyCollapse(const VertexPair &p, int i, BaseParameterClass *pp) :TECQ(p,i,pp){}
+};
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what, int threadNum)
+{
+  if(!ok)
+  {
+    printf("FAILED: %s with %i threads\n",what,threadNum);
+    ++failures;
+  }
+}
+
+// threadNum==0 means the sequential DoOptimization
+static void Simplify(MyMesh &m, int targetFaceNum, int threadNum)
+{
+  tri::Torus(m,3,1,800,400);
+  tri::Clean<MyMesh>::RemoveDuplicateVertex(m);
+  tri::Allocator<MyMesh>::CompactEveryVector(m);
+
+  // without the link conditions not even the sequential simplification keeps the topology
+  tri::TriEdgeCollapseQuadricParameter qp;
+  qp.PreserveTopology=true;
+  LocalOptimization<MyMesh> session(m,&qp);
+  session.Init<MyCollapse>();
+  session.SetTargetSimplices(targetFaceNum);
+  if(threadNum==0) session.DoOptimization();
+  else
+  {
+#ifdef _OPENMP
+    omp_set_num_threads(threadNum);
+#endif
+    session.DoOptimizationParallel<MyCollapse>();
+  }
+  session.Finalize<MyCollapse>();
+  tri::Allocator<MyMesh>::CompactEveryVector(m);
+}
+
+static void CheckTopology(MyMesh &m, int targetFaceNum, int threadNum)
+{
+  // after the compaction the counters updated by the collapses must match the vectors
+  Check(m.fn==int(m.face.size()) && m.vn==int(m.vert.size()),"face and vertex count",threadNum);
+  Check(m.fn<=targetFaceNum && m.fn>=targetFaceNum-2,"target face number",threadNum);
+
+  tri::UpdateTopology<MyMesh>::FaceFace(m);
+  Check(tri::Clean<MyMesh>::CountNonManifoldEdgeFF(m)==0,"non manifold edges",threadNum);
+  int edgeNum,borderEdgeNum;
+  tri::Clean<MyMesh>::CountEdges(m,edgeNum,borderEdgeNum);
+  const int genus=tri::Clean<MyMesh>::MeshGenus(m.vn,edgeNum,m.fn,
+                                                tri::Clean<MyMesh>::CountHoles(m),
+                                                tri::Clean<MyMesh>::CountConnectedComponents(m));
+  Check(borderEdgeNum==0 && genus==1,"genus",threadNum);
+  printf("%i threads: %i vertices %i faces genus %i\n",threadNum,m.vn,m.fn,genus);
+}
+
+static bool SameMesh(const MyMesh &a, const MyMesh &b)
+{
+  if(a.vert.size()!=b.vert.size() || a.face.size()!=b.face.size()) return false;
+  for(size_t i=0;i<a.vert.size();++i)
+    if(a.vert[i].cP()!=b.vert[i].cP()) return false;
+  for(size_t i=0;i<a.face.size();++i)
+    for(int j=0;j<3;++j)
+      if(tri::Index(a,a.face[i].cV(j))!=tri::Index(b,b.face[i].cV(j))) return false;
+  return true;
+}
+
+int main( int argc, char **argv )
+{
+  const int targetFaceNum = (argc>1) ? atoi(argv[1]) : 20000;
+
+  MyMesh seq;
+  Simplify(seq,targetFaceNum,0);
+  CheckTopology(seq,targetFaceNum,0);
+
+  MyMesh first;
+  const int threadNums[] = {1,2,4};
+  for(int ti=0;ti<3;++ti)
+  {
+    const int t = threadNums[ti];
+    MyMesh m;
+    Simplify(m,targetFaceNum,t);
+    CheckTopology(m,targetFaceNum,t);
+    if(ti==0) tri::Append<MyMesh,MyMesh>::MeshCopy(first,m);
+    else Check(SameMesh(first,m),"same result of the run with 1 thread",t);
+  }
+
+  printf("%i failures\n",failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,3 @@
+include(../common.pri)
+TARGET = trimesh_parallel_decimation
+SOURCES += trimesh_parallel_decimation.cpp
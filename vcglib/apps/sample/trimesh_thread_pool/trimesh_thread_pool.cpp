@@ -0,0 +1,217 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2012                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+/*! \file trimesh_thread_pool.cpp
+\ingroup code_sample
+
+\brief A check of the thread pool of wrap/system/multithreading and of its use in UpdateNormal
+
+For 1, 2, 4 and 8 threads it compares with a serial computation:
+parallel_for over an index range, parallel_for_each over the vertex vector of a mesh,
+parallel_reduce (whose result must not depend on the number of threads), nested task groups
+and the parallel functions of UpdateNormal on a refined sphere with some deleted faces.
+It prints the number of mismatches and returns 1 if there is any.
+
+Usage: trimesh_thread_pool [sphereRefinement]
+*/
+
+// the parallel functions of UpdateNormal use the thread pool
+#define VCG_USE_THREAD_POOL
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#include <vcg/complex/complex.h>
+#include <vcg/complex/algorithms/create/platonic.h>
+#include <vcg/complex/algorithms/update/normal.h>
+#include <wrap/system/multithreading/thread_pool.h>
+
+using namespace vcg;
+using namespace std;
+
+class MyFace;
+class MyVertex;
+struct MyUsedTypes : public UsedTypes<	Use<MyVertex>   ::AsVertexType,
+                                        Use<MyFace>     ::AsFaceType>{};
+
+class MyVertex  : public Vertex<MyUsedTypes, vertex::Coord3f, vertex::Normal3f, vertex::BitFlags  >{};
+class MyFace    : public Face< MyUsedTypes, face::FFAdj, face::VertexRef, face::Normal3f, face::BitFlags > {};
+class MyMesh    : public tri::TriMesh< vector<MyVertex>, vector<MyFace> > {};
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what, int threadNum)
+{
+  if(!ok)
+  {
+    printf("FAILED: %s with %i threads\n",what,threadNum);
+    ++failures;
+  }
+}
+
+static double Value(int i) { return sin(double(i))*1e-3 + 1.0/(1.0+i); }
+
+struct FillBody
+{
+  FillBody(vector<double> &_a):a(_a){}
+  void operator()(int i) const { a[i] = Value(i); }
+  vector<double> &a;
+};
+
+struct ScaleVertBody
+{
+  void operator()(MyVertex &v) const { v.P() *= 2.0f; }
+};
+
+// a sum of floats, that depends on the order of the additions
+struct SumBody
+{
+  SumBody(const vector<double> &_a):a(_a){}
+  void operator()(int i, float &s) const { s += float(a[i]); }
+  void join(float &s, const float &other) const { s += other; }
+  const vector<double> &a;
+};
+
+// sum of [begin,end): the ranges larger than 1000 are split in two halves run as nested tasks
+class RangeSumTask : public mt::task
+{
+public:
+  RangeSumTask(int _begin, int _end):begin(_begin),end(_end),sum(0){}
+  void run(void)
+  {
+    if(end-begin<=1000)
+    {
+      for(int i=begin;i<end;++i) sum += i;
+      return;
+    }
+    const int mid = (begin+end)/2;
+    RangeSumTask left(begin,mid), right(mid,end);
+    mt::task_group g;
+    g.run(&left);
+    g.run(&right);
+    g.wait();
+    sum = left.sum + right.sum;
+  }
+  int begin, end;
+  long long sum;
+};
+
+// the serial versions of the parallel functions of UpdateNormal
+static void SerialFaceNormalized(MyMesh &m)
+{
+  for(MyMesh::FaceIterator fi=m.face.begin();fi!=m.face.end();++fi)
+    if(!(*fi).IsD())
+    {
+      face::ComputeNormal(*fi);
+      (*fi).N().Normalize();
+    }
+}
+
+static void SerialFaceFromVertexNormal(MyMesh &m)
+{
+  for(MyMesh::FaceIterator fi=m.face.begin();fi!=m.face.end();++fi)
+    if(!(*fi).IsD())
+    {
+      Point3f n(0,0,0);
+      for(int j=0;j<3;++j) n += (*fi).V(j)->cN();
+      (*fi).N() = n.Normalize();
+    }
+}
+
+static bool SameFaceNormals(const MyMesh &a, const MyMesh &b)
+{
+  for(size_t i=0;i<a.face.size();++i)
+    if(!a.face[i].IsD() && a.face[i].cN()!=b.face[i].cN()) return false;
+  return true;
+}
+
+int main( int argc, char **argv )
+{
+  const int refinement = (argc>1) ? atoi(argv[1]) : 6;
+
+  MyMesh sphere;
+  tri::Sphere(sphere,refinement);
+  for(size_t i=0;i<sphere.face.size();i+=7)
+    tri::Allocator<MyMesh>::DeleteFace(sphere,sphere.face[i]);
+  printf("Sphere with %i vertices and %i faces\n",sphere.vn,sphere.fn);
+
+  const int n = 1000003;
+  vector<double> serial(n);
+  for(int i=0;i<n;++i) serial[i] = Value(i);
+  float firstSum = 0;
+
+  const int threadNums[] = {1,2,4,8};
+  for(int ti=0;ti<4;++ti)
+  {
+    const int t = threadNums[ti];
+    mt::set_thread_count(t);
+    Check(mt::thread_count()==t,"thread count",t);
+
+    vector<double> a(n,0.0);
+    mt::parallel_for(0,n,FillBody(a));
+    Check(a==serial,"parallel_for",t);
+
+    MyMesh m;
+    tri::Append<MyMesh,MyMesh>::MeshCopy(m,sphere);
+    mt::parallel_for_each(m.vert,ScaleVertBody());
+    bool scaled=true;
+    for(size_t i=0;i<m.vert.size();++i)
+      if(m.vert[i].cP()!=sphere.vert[i].cP()*2.0f) scaled=false;
+    Check(scaled,"parallel_for_each",t);
+
+    const float sum = mt::parallel_reduce(0,n,0.0f,SumBody(serial));
+    if(ti==0) firstSum = sum;
+    Check(sum==firstSum,"parallel_reduce (result depends on the thread count)",t);
+    Check(fabs(sum-14.3928)<1e-2,"parallel_reduce (wrong sum)",t);
+
+    RangeSumTask root(0,n);
+    mt::task_group g;
+    g.run(&root);
+    g.wait();
+    Check(root.sum==(long long)(n)*(n-1)/2,"nested task groups",t);
+
+    MyMesh ref;
+    tri::Append<MyMesh,MyMesh>::MeshCopy(m,sphere);
+    tri::Append<MyMesh,MyMesh>::MeshCopy(ref,sphere);
+    tri::UpdateNormal<MyMesh>::PerFaceNormalized(m);
+    SerialFaceNormalized(ref);
+    Check(SameFaceNormals(m,ref),"UpdateNormal::PerFaceNormalized",t);
+
+    tri::UpdateNormal<MyMesh>::PerVertexNormalized(m);
+    tri::UpdateNormal<MyMesh>::PerVertex(ref);
+    for(size_t i=0;i<ref.vert.size();++i)
+      if(!ref.vert[i].IsD()) ref.vert[i].N().Normalize();
+    bool sameVert=true;
+    for(size_t i=0;i<m.vert.size();++i)
+      if(m.vert[i].cN()!=ref.vert[i].cN()) sameVert=false;
+    Check(sameVert,"UpdateNormal::PerVertexNormalized",t);
+
+    tri::UpdateNormal<MyMesh>::PerFaceFromCurrentVertexNormal(m);
+    SerialFaceFromVertexNormal(ref);
+    Check(SameFaceNormals(m,ref),"UpdateNormal::PerFaceFromCurrentVertexNormal",t);
+  }
+
+  printf("%i failures\n",failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,4 @@
+include(../common.pri)
+TARGET = trimesh_thread_pool
+SOURCES += trimesh_thread_pool.cpp
+unix:LIBS += -lpthread
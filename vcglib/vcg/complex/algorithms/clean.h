@@ -27,6 +27,7 @@
 // Standard headers
 #include <map>
 #include <algorithm>
+#include <string.h>
 #include <utility>
 #include <stack>
 
@@ -146,68 +147,140 @@ private:
 				}
 			};
 
+			/// Hash of a position such that equal positions (zeros of any sign included) have the same hash
+			static size_t PositionHash(const typename MeshType::CoordType &p)
+			{
+				size_t h=2166136261u;
+				for(int c=0;c<3;++c)
+				{
+					ScalarType v = (p[c]==0) ? ScalarType(0) : p[c];
+					unsigned char b[sizeof(ScalarType)];
+					memcpy(b,&v,sizeof(ScalarType));
+					for(size_t k=0;k<sizeof(ScalarType);++k)
+						h = (h ^ b[k]) * 16777619u;
+				}
+				return h;
+			}
 
-			/** This function removes all duplicate vertices of the mesh by looking only at their spatial positions.
-			Note that it does not update any topology relation that could be affected by this like the VT or TT relation.
-			the reason this function is usually performed BEFORE building any topology information.
+			/** Compute for each vertex the index of the vertex that replaces it when the vertices with the same position are merged:
+			the one with the lowest index among the not deleted vertices with that position (deleted vertices are mapped on themselves).
+			The vertices are partitioned in buckets by the hash of their position, in parallel and keeping their order,
+			then each bucket is sorted by hash and index and scanned independently; so the result does not depend on the number of threads.
+			Returns the number of vertices that are replaced by another one.
 			*/
-			static int RemoveDuplicateVertex( MeshType & m, bool RemoveDegenerateFlag=true)    // V1.0
+			static int DuplicateVertexRemap(MeshType &m, std::vector<int> &remap)
 			{
-				if(m.vert.size()==0 || m.vn==0) return 0;
+				const int n = int(m.vert.size());
+				remap.resize(n);
+				std::vector<size_t> hash(n);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+				for(int i=0;i<n;++i)
+				{
+					remap[i]=i;
+					if(!m.vert[i].IsD()) hash[i]=PositionHash(m.vert[i].cP());
+				}
 
-				std::map<VertexPointer, VertexPointer> mp;
-				size_t i,j;
-				VertexIterator vi;
-				int deleted=0;
-				int k=0;
-				size_t num_vert = m.vert.size();
-				std::vector<VertexPointer> perm(num_vert);
-				for(vi=m.vert.begin(); vi!=m.vert.end(); ++vi, ++k)
-					perm[k] = &(*vi);
-
-				RemoveDuplicateVert_Compare c_obj;
-
-				std::sort(perm.begin(),perm.end(),c_obj);
-
-				j = 0;
-				i = j;
-				mp[perm[i]] = perm[j];
-				++i;
-				for(;i!=num_vert;)
+				// counting sort of the vertex indexes by bucket, the chunks of vertices are counted and scattered in parallel
+				int bucketNum=1;
+				while(bucketNum<(1<<14) && bucketNum*256<n) bucketNum*=2;
+				const int chunkNum = std::min(64,n/4096+1);
+				std::vector<int> offset(size_t(chunkNum)*bucketNum,0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+				for(int c=0;c<chunkNum;++c)
 				{
-					if( (! (*perm[i]).IsD()) &&
-						(! (*perm[j]).IsD()) &&
-						(*perm[i]).P() == (*perm[j]).cP() )
+					int *cnt=&offset[size_t(c)*bucketNum];
+					for(int i=int((long long)(n)*c/chunkNum);i<int((long long)(n)*(c+1)/chunkNum);++i)
+						if(!m.vert[i].IsD()) ++cnt[hash[i]&(bucketNum-1)];
+				}
+				std::vector<int> bucketStart(bucketNum+1,0);
+				for(int b=0;b<bucketNum;++b)
+				{
+					int pos=bucketStart[b];
+					for(int c=0;c<chunkNum;++c)
 					{
-						VertexPointer t = perm[i];
-						mp[perm[i]] = perm[j];
-						++i;
-						Allocator<MeshType>::DeleteVertex(m,*t);
-						deleted++;
+						int cnt=offset[size_t(c)*bucketNum+b];
+						offset[size_t(c)*bucketNum+b]=pos;
+						pos+=cnt;
 					}
-					else
+					bucketStart[b+1]=pos;
+				}
+				std::vector<int> order(bucketStart[bucketNum]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+				for(int c=0;c<chunkNum;++c)
+				{
+					int *pos=&offset[size_t(c)*bucketNum];
+					for(int i=int((long long)(n)*c/chunkNum);i<int((long long)(n)*(c+1)/chunkNum);++i)
+						if(!m.vert[i].IsD()) order[pos[hash[i]&(bucketNum-1)]++]=i;
+				}
+
+				int duplicated=0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:duplicated)
+#endif
+				for(int b=0;b<bucketNum;++b)
+				{
+					std::vector<std::pair<size_t,int> > hv;
+					for(int k=bucketStart[b];k<bucketStart[b+1];++k)
+						hv.push_back(std::make_pair(hash[order[k]],order[k]));
+					std::sort(hv.begin(),hv.end());
+					// within a run of equal hashes the first vertex with a given position is its representative
+					std::vector<int> reps;
+					for(size_t k=0;k<hv.size();++k)
 					{
-						j = i;
-						++i;
+						if(k==0 || hv[k].first!=hv[k-1].first) reps.clear();
+						const int i=hv[k].second;
+						size_t r=0;
+						while(r<reps.size() && !(m.vert[reps[r]].cP()==m.vert[i].cP())) ++r;
+						if(r<reps.size()) { remap[i]=reps[r]; ++duplicated; }
+						else reps.push_back(i);
 					}
 				}
+				return duplicated;
+			}
 
-		for(FaceIterator fi = m.face.begin(); fi!=m.face.end(); ++fi)
-					if( !(*fi).IsD() )
-						for(k = 0; k < 3; ++k)
-							if( mp.find( (typename MeshType::VertexPointer)(*fi).V(k) ) != mp.end() )
-							{
-								(*fi).V(k) = &*mp[ (*fi).V(k) ];
-							}
-
+			/** This function removes all duplicate vertices of the mesh by looking only at their spatial positions.
+			Note that it does not update any topology relation that could be affected by this like the VT or TT relation.
+			the reason this function is usually performed BEFORE building any topology information.
+			Duplicates are found with a parallel hash partition (see DuplicateVertexRemap) and the
+			references of faces and edges are rewritten in parallel through the resulting index array.
+			*/
+			static int RemoveDuplicateVertex( MeshType & m, bool RemoveDegenerateFlag=true)    // V1.0
+			{
+				if(m.vert.size()==0 || m.vn==0) return 0;
 
-        for(EdgeIterator ei = m.edge.begin(); ei!=m.edge.end(); ++ei)
-          if( !(*ei).IsD() )
-            for(k = 0; k < 2; ++k)
-              if( mp.find( (typename MeshType::VertexPointer)(*ei).V(k) ) != mp.end() )
-              {
-                (*ei).V(k) = &*mp[ (*ei).V(k) ];
-              }
+				std::vector<int> remap;
+				const int deleted = DuplicateVertexRemap(m,remap);
+				if(deleted>0)
+				{
+					const int vn = int(m.vert.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+					for(int i=0;i<vn;++i)
+						if(remap[i]!=i) m.vert[i].SetD();
+					m.vn-=deleted;
+
+					VertexPointer vbase = &*m.vert.begin();
+					const int fn = int(m.face.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+					for(int i=0;i<fn;++i)
+						if( !m.face[i].IsD() )
+							for(int k = 0; k < 3; ++k)
+								m.face[i].V(k) = vbase + remap[m.face[i].V(k) - vbase];
+
+					for(EdgeIterator ei = m.edge.begin(); ei!=m.edge.end(); ++ei)
+						if( !(*ei).IsD() )
+							for(int k = 0; k < 2; ++k)
+								(*ei).V(k) = vbase + remap[(*ei).V(k) - vbase];
+				}
         if(RemoveDegenerateFlag) RemoveDegenerateFace(m);
         if(RemoveDegenerateFlag && m.en>0) {
           RemoveDegenerateEdge(m);
@@ -1492,43 +1565,218 @@ private:
         return total;
     }
 
-	  static bool SelfIntersections(MeshType &m, std::vector<FaceType*> &ret)
+	/** Hierarchy of the bounding boxes of the faces (a binary BVH split at the median), used to find the faces
+	whose boxes overlap a given box. The boxes are closed, so also the flat boxes of the axis aligned faces overlap.
+	The top of the tree is built serially, then its subtrees are built in parallel.
+	*/
+	class FaceBoxTree
+	{
+	public:
+		struct Node
+		{
+			Box3Type box;
+			int left;        // index of the left child, the right one follows it; -1 for the leaves
+			int first, last; // the faces of the node are Order[first..last)
+		};
+
+		std::vector<Box3Type> FaceBox; // indexed as the faces of the mesh
+		std::vector<int> Order;
+		std::vector<Node> Nodes;
+
+		void Build(MeshType &m, int leafSize=4)
+		{
+			const int fn=int(m.face.size());
+			FaceBox.resize(fn);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for(int i=0;i<fn;++i)
+				if(!m.face[i].IsD()) m.face[i].GetBBox(FaceBox[i]);
+			Order.clear();
+			for(int i=0;i<fn;++i)
+				if(!m.face[i].IsD()) Order.push_back(i);
+			Nodes.clear();
+			if(Order.empty()) return;
+
+			const int n=int(Order.size());
+			const int stopSize=std::max(leafSize,n/64);
+			std::vector<int> pending;
+			Nodes.push_back(MakeNode(0,n));
+			BuildSubtree(Nodes,leafSize,stopSize,&pending);
+
+			std::vector<std::vector<Node> > sub(pending.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+			for(int k=0;k<int(pending.size());++k)
 			{
-		RequirePerFaceMark(m);
-			Box3< ScalarType> bbox;
-				TriMeshGrid   gM;
-		ret.clear();
-				FaceIterator fi;
-		  int referredBit = FaceType::NewBitFlag();
-		tri::UpdateFlags<MeshType>::FaceClear(m,referredBit);
+				sub[k].push_back(Nodes[pending[k]]);
+				BuildSubtree(sub[k],leafSize,0,0);
+			}
+			// append each subtree, its local node k becoming Nodes[offset+k-1]
+			for(size_t k=0;k<pending.size();++k)
+			{
+				const int offset=int(Nodes.size())-1;
+				for(size_t j=0;j<sub[k].size();++j)
+					if(sub[k][j].left>=0) sub[k][j].left+=offset;
+				Nodes[pending[k]]=sub[k][0];
+				Nodes.insert(Nodes.end(),sub[k].begin()+1,sub[k].end());
+			}
+			// the children follow their parent, so the boxes can be computed bottom up in a backward scan
+			for(int ni=int(Nodes.size())-1;ni>=0;--ni)
+			{
+				Node &nd=Nodes[ni];
+				nd.box.SetNull();
+				if(nd.left<0)
+					for(int k=nd.first;k<nd.last;++k) nd.box.Add(FaceBox[Order[k]]);
+				else
+				{
+					nd.box.Add(Nodes[nd.left].box);
+					nd.box.Add(Nodes[nd.left+1].box);
+				}
+			}
+		}
 
-				std::vector<FaceType*> inBox;
-				gM.Set(m.face.begin(),m.face.end());
+		static bool Overlap(const Box3Type &a, const Box3Type &b)
+		{
+			return a.min.X()<=b.max.X() && b.min.X()<=a.max.X() &&
+			       a.min.Y()<=b.max.Y() && b.min.Y()<=a.max.Y() &&
+			       a.min.Z()<=b.max.Z() && b.min.Z()<=a.max.Z();
+		}
 
-				for(fi=m.face.begin();fi!=m.face.end();++fi) if(!(*fi).IsD())
+		/// The indexes of the faces whose box overlaps bb.
+		void GetInBox(const Box3Type &bb, std::vector<int> &faces) const
+		{
+			faces.clear();
+			if(Nodes.empty()) return;
+			int stack[64]; // the tree is balanced, so its depth is about log2 of the faces
+			int top=0;
+			stack[top++]=0;
+			while(top>0)
+			{
+				const Node &nd=Nodes[stack[--top]];
+				if(!Overlap(nd.box,bb)) continue;
+				if(nd.left<0)
 				{
-		  (*fi).SetUserBit(referredBit);
-					(*fi).GetBBox(bbox);
-					vcg::tri::GetInBoxFace(m, gM, bbox,inBox);
-					bool Intersected=false;
-		  typename std::vector<FaceType*>::iterator fib;
-		  for(fib=inBox.begin();fib!=inBox.end();++fib)
-		  {
-			if(!(*fib)->IsUserBit(referredBit) && (*fib != &*fi) )
-			  if(TestFaceFaceIntersection(&*fi,*fib)){
-				ret.push_back(*fib);
-				if(!Intersected) {
-				  ret.push_back(&*fi);
-				  Intersected=true;
+					for(int k=nd.first;k<nd.last;++k)
+						if(Overlap(FaceBox[Order[k]],bb)) faces.push_back(Order[k]);
 				}
-			  }
-		  }
-					inBox.clear();
+				else
+				{
+					stack[top++]=nd.left+1;
+					stack[top++]=nd.left;
 				}
+			}
+		}
 
-		FaceType::DeleteBitFlag(referredBit);
-				return (ret.size()>0);
+	private:
+		class CenterCompare
+		{
+		public:
+			CenterCompare(const std::vector<Box3Type> &_fb, int _axis):fb(_fb),axis(_axis){}
+			bool operator()(int a, int b) const
+			{ return fb[a].min[axis]+fb[a].max[axis] < fb[b].min[axis]+fb[b].max[axis]; }
+			const std::vector<Box3Type> &fb;
+			int axis;
+		};
+
+		Node MakeNode(int first, int last) const
+		{
+			Node nd;
+			nd.first=first; nd.last=last; nd.left=-1;
+			return nd;
+		}
+
+		// Split the node nv[0] and its descendants down to leafSize faces; if pending is given,
+		// the nodes with at most stopSize faces are not split but appended to it
+		void BuildSubtree(std::vector<Node> &nv, int leafSize, int stopSize, std::vector<int> *pending)
+		{
+			std::vector<int> stack(1,0);
+			while(!stack.empty())
+			{
+				const int ni=stack.back();
+				stack.pop_back();
+				const int first=nv[ni].first, last=nv[ni].last;
+				if(last-first<=leafSize) continue;
+				if(pending && last-first<=stopSize) { pending->push_back(ni); continue; }
+				Box3Type cb; // the box of the face centers, to choose the split axis
+				for(int k=first;k<last;++k) cb.Add(FaceBox[Order[k]].Center());
+				const int mid=(first+last)/2;
+				std::nth_element(Order.begin()+first,Order.begin()+mid,Order.begin()+last,CenterCompare(FaceBox,cb.MaxDim()));
+				nv[ni].left=int(nv.size());
+				nv.push_back(MakeNode(first,mid));
+				nv.push_back(MakeNode(mid,last));
+				stack.push_back(nv[ni].left);
+				stack.push_back(nv[ni].left+1);
+			}
+		}
+	};
+
+	/** Find the pairs of faces that intersect (see TestFaceFaceIntersection), each pair once, with the lower index first
+	and sorted. If selectedOnly, only the pairs where at least one face is selected are tested.
+	The candidate pairs come from a FaceBoxTree and are tested in parallel, each thread collecting its own pairs,
+	so the result does not depend on the number of threads.
+	*/
+	static bool SelfIntersections(MeshType &m, std::vector<std::pair<FaceType*,FaceType*> > &ret, bool selectedOnly=false)
+	{
+		ret.clear();
+		FaceBoxTree tree;
+		tree.Build(m);
+		// visiting the faces in the order of the tree, the consecutive queries touch the same nodes
+		std::vector<int> query;
+		for(size_t k=0;k<tree.Order.size();++k)
+			if(!selectedOnly || m.face[tree.Order[k]].IsS()) query.push_back(tree.Order[k]);
+
+		std::vector<std::pair<int,int> > pairs;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+		{
+			std::vector<std::pair<int,int> > local;
+			std::vector<int> inBox;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,256)
+#endif
+			for(int q=0;q<int(query.size());++q)
+			{
+				const int i=query[q];
+				tree.GetInBox(tree.FaceBox[i],inBox);
+				for(size_t k=0;k<inBox.size();++k)
+				{
+					const int j=inBox[k];
+					// each pair is tested by its lower face, or by its selected face if only one is selected
+					if(j==i) continue;
+					if(j<i && (!selectedOnly || m.face[j].IsS())) continue;
+					const int f0=std::min(i,j), f1=std::max(i,j);
+					if(TestFaceFaceIntersection(&m.face[f0],&m.face[f1]))
+						local.push_back(std::make_pair(f0,f1));
+				}
 			}
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+			pairs.insert(pairs.end(),local.begin(),local.end());
+		}
+		std::sort(pairs.begin(),pairs.end());
+		ret.resize(pairs.size());
+		for(size_t k=0;k<pairs.size();++k)
+			ret[k]=std::make_pair(&m.face[pairs[k].first],&m.face[pairs[k].second]);
+		return (ret.size()>0);
+	}
+
+	/// The faces that intersect some other face (see above), each one once and in index order.
+	static bool SelfIntersections(MeshType &m, std::vector<FaceType*> &ret, bool selectedOnly=false)
+	{
+		std::vector<std::pair<FaceType*,FaceType*> > pairs;
+		SelfIntersections(m,pairs,selectedOnly);
+		std::vector<char> hit(m.face.size(),0);
+		for(size_t k=0;k<pairs.size();++k)
+			hit[tri::Index(m,pairs[k].first)]=hit[tri::Index(m,pairs[k].second)]=1;
+		ret.clear();
+		for(size_t i=0;i<m.face.size();++i)
+			if(hit[i]) ret.push_back(&m.face[i]);
+		return (ret.size()>0);
+	}
 
       /**
       This function simply test that the vn and fn counters be consistent with the size of the containers and the number of deleted simplexes.
@@ -1640,39 +1888,69 @@ static int MergeCloseVertex(MeshType &m, const ScalarType radius)
 			return mergedCnt;
 	}
 
+/**
+	  Greedy clustering of the vertices: in index order, each vertex not yet clustered moves onto itself all
+	  the not yet clustered vertices closer than radius. The vertices closer than radius to each one of a batch
+	  are gathered in parallel, then the batch is clustered serially; since a vertex is moved only when it is
+	  clustered, the gathered candidates still have their original positions and the result is the same of a serial visit.
+*/
 static int ClusterVertex(MeshType &m, const ScalarType radius)
     {
       if(m.vn==0) return 0;
       // some spatial indexing structure does not work well with deleted vertices...
       tri::Allocator<MeshType>::CompactVertexVector(m);
-      typedef vcg::SpatialHashTable<VertexType, ScalarType> SampleSHT;
-            SampleSHT sht;
-            tri::VertTmark<MeshType> markerFunctor;
-            typedef vcg::vertex::PointDistanceFunctor<ScalarType> VDistFunct;
-            std::vector<VertexType*> closests;
-            int mergedCnt=0;
-      sht.Set(m.vert.begin(), m.vert.end());
-            UpdateFlags<MeshType>::VertexClearV(m);
-            for(VertexIterator viv = m.vert.begin(); viv!= m.vert.end(); ++viv)
-                if(!(*viv).IsD() && !(*viv).IsV())
-                    {
-                        (*viv).SetV();
-                        Point3<ScalarType> p = viv->cP();
-                        Box3<ScalarType> bb(p-Point3<ScalarType>(radius,radius,radius),p+Point3<ScalarType>(radius,radius,radius));
-                        GridGetInBox(sht, markerFunctor, bb, closests);
-                        // qDebug("Vertex %i has %i closest", &*viv - &*m.vert.begin(),closests.size());
-            for(size_t i=0; i<closests.size(); ++i)
-                        {
-                            ScalarType dist = Distance(p,closests[i]->cP());
-                            if(dist < radius && !closests[i]->IsV())
-                                                {
-//													printf("%f %f \n",dist,radius);
-													mergedCnt++;
-													closests[i]->SetV();
-													closests[i]->P()=p;
-												}
-						}
-					}
+      typedef GridStaticPtr<VertexType, ScalarType> VertexGrid;
+      VertexGrid grid;
+      grid.Set(m.vert.begin(), m.vert.end());
+      UpdateFlags<MeshType>::VertexClearV(m);
+      const int n = int(m.vert.size());
+      const int batchSize = 1<<14;
+      std::vector<std::vector<int> > closeVec(batchSize);
+      int mergedCnt=0;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        typename VertexGrid::LocalMarker marker(grid);
+        std::vector<VertexType*> closests;
+        for(int start=0;start<n;start+=batchSize)
+        {
+          const int end = std::min(n,start+batchSize);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+          for(int i=start;i<end;++i)
+          {
+            std::vector<int> &close = closeVec[i-start];
+            close.clear();
+            if(m.vert[i].IsV()) continue;
+            Point3<ScalarType> p = m.vert[i].cP();
+            Box3<ScalarType> bb(p-Point3<ScalarType>(radius,radius,radius),p+Point3<ScalarType>(radius,radius,radius));
+            GridGetInBox(grid, marker, bb, closests);
+            for(size_t j=0; j<closests.size(); ++j)
+              if(closests[j]!=&m.vert[i] && !closests[j]->IsV() && Distance(p,closests[j]->cP()) < radius)
+                close.push_back(int(tri::Index(m,closests[j])));
+          }
+#ifdef _OPENMP
+#pragma omp single
+#endif
+          {
+            for(int i=start;i<end;++i)
+              if(!m.vert[i].IsV())
+              {
+                m.vert[i].SetV();
+                const std::vector<int> &close = closeVec[i-start];
+                for(size_t j=0; j<close.size(); ++j)
+                  if(!m.vert[close[j]].IsV())
+                  {
+                    mergedCnt++;
+                    m.vert[close[j]].SetV();
+                    m.vert[close[j]].P()=m.vert[i].cP();
+                  }
+              }
+          }
+        }
+      }
 			return mergedCnt;
 	}
 
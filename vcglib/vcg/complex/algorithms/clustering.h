@@ -67,6 +67,7 @@ First working Version
 #include<vcg/space/triangle3.h>
 #include<vcg/complex/algorithms/update/topology.h>
 #include<vcg/space/index/grid_util.h>
+#include <wrap/callback.h>
 
 #include <iostream>
 #include <math.h>
@@ -430,6 +431,228 @@ class Clustering
 
   }
 }; //end class clustering
+
+/** Vertex clustering of a stream of triangles, for meshes that do not fit in memory.
+  The triangles can be given in chunks with AddTriangles (e.g. by io::ImporterSTL::ReadBinaryTriangles),
+  read from a face source, like MeshBlockSource or io::PlyBlockSource, with AddSource, or taken from a mesh with AddMesh.
+  Unlike Clustering, only the occupied cells and the clustered triangles are kept, in two
+  open addressing tables indexed by cell coords and by cell triples, so the memory needed
+  is bounded by the size of the result and not by the size of the input.
+  Each cell averages the positions of the vertices falling in it and sums the
+  (area weighted) normals of their faces, like AverageColorCell.
+  */
+template<class MeshType>
+class ClusteringStream
+{
+public:
+  typedef typename MeshType::ScalarType  ScalarType;
+  typedef typename MeshType::CoordType CoordType;
+
+  // same meaning of Clustering::DuplicateFaceParam
+  bool DuplicateFaceParam;
+
+  BasicGrid<ScalarType> Grid;
+
+  ClusteringStream():DuplicateFaceParam(false){}
+
+  // Same parameters of Clustering::Init: all the points added later must be inside _mbb.
+  void Init(Box3<ScalarType> _mbb, int _size, ScalarType _cellsize=0)
+  {
+    cellVec.clear(); cellTable.clear();
+    triVec.clear();  triTable.clear();
+    Grid.bbox=_mbb;
+    ScalarType infl = (_cellsize == (ScalarType)0) ? (Grid.bbox.Diag() / _size) : (_cellsize);
+    Grid.bbox.min-=CoordType(infl,infl,infl);
+    Grid.bbox.max+=CoordType(infl,infl,infl);
+    Grid.dim  = Grid.bbox.max - Grid.bbox.min;
+    if(_cellsize==0)
+      BestDim( _size, Grid.dim, Grid.siz );
+    else
+      Grid.siz = Point3i::Construct(Grid.dim / _cellsize);
+    Grid.voxel[0] = Grid.dim[0]/Grid.siz[0];
+    Grid.voxel[1] = Grid.dim[1]/Grid.siz[1];
+    Grid.voxel[2] = Grid.dim[2]/Grid.siz[2];
+  }
+
+  /// The bounding box of the vertices of a face source, to be passed to Init.
+  template <class SourceType>
+  static Box3<ScalarType> SourceBox(const SourceType &src)
+  {
+    Box3<ScalarType> bb;
+    for(int i=0;i<src.VN();++i)
+    {
+      CoordType p; p.Import(src.GetVert(i));
+      bb.Add(p);
+    }
+    return bb;
+  }
+
+  void AddTriangle(const CoordType &p0, const CoordType &p1, const CoordType &p2)
+  {
+    const CoordType *p[3]={&p0,&p1,&p2};
+    Point3d d[3];
+    for(int i=0;i<3;++i) d[i].Import(*p[i]);
+    // the un-normalized face normal, as in AverageColorCell
+    const Point3d n=(d[1]-d[0])^(d[2]-d[0]);
+    Point3i t;
+    for(int i=0;i<3;++i)
+    {
+      Point3i pi;
+      Grid.PToIP(*p[i],pi);
+      t[i]=CellIndex(pi);
+      Cell &c=cellVec[t[i]];
+      c.p+=d[i];
+      c.n+=n;
+      c.cnt++;
+    }
+    if( (t[0]!=t[1]) && (t[0]!=t[2]) && (t[1]!=t[2]) )
+    {
+      if(DuplicateFaceParam) SortOrient(t);
+      else std::sort(&t[0],&t[0]+3);
+      AddTri(t);
+    }
+  }
+
+  /// Add triNum triangles, p holds the three vertices of each one.
+  template <class PointType>
+  void AddTriangles(const PointType *p, int triNum)
+  {
+    for(int i=0;i<triNum;++i)
+    {
+      CoordType q[3];
+      for(int j=0;j<3;++j) q[j].Import(p[3*i+j]);
+      AddTriangle(q[0],q[1],q[2]);
+    }
+  }
+
+  void AddMesh(MeshType &m)
+  {
+    for(typename MeshType::FaceIterator fi=m.face.begin();fi!=m.face.end();++fi) if(!(*fi).IsD())
+      AddTriangle((*fi).cP(0),(*fi).cP(1),(*fi).cP(2));
+  }
+
+  /// Add all the faces of a source, reading them in chunks (see MeshBlockSource for the interface).
+  template <class SourceType>
+  void AddSource(const SourceType &src, CallBackPos *cb=0)
+  {
+    const int chunkSize=1<<16;
+    std::vector<CoordType> tri;
+    tri.reserve(3*chunkSize);
+    const int fn=src.FN();
+    for(int start=0;start<fn;start+=chunkSize)
+    {
+      const int end=std::min(fn,start+chunkSize);
+      tri.clear();
+      for(int i=start;i<end;++i)
+      {
+        int v[3];
+        if(!src.GetFace(i,v)) continue;
+        for(int j=0;j<3;++j)
+        {
+          CoordType p; p.Import(src.GetVert(v[j]));
+          tri.push_back(p);
+        }
+      }
+      if(!tri.empty()) AddTriangles(&tri[0],int(tri.size()/3));
+      if(cb) cb(int(100.0*end/fn),"Clustering faces...");
+    }
+  }
+
+  int CountPointSet() const { return int(cellVec.size()); }
+  int CountTriangles() const { return int(triVec.size()); }
+
+  void ExtractMesh(MeshType &m)
+  {
+    m.Clear();
+    if (triVec.empty() || cellVec.empty()) return;
+
+    Allocator<MeshType>::AddVertices(m,cellVec.size());
+    for(size_t i=0;i<cellVec.size();++i)
+      m.vert[i].P().Import(cellVec[i].p/double(cellVec[i].cnt));
+
+    Allocator<MeshType>::AddFaces(m,triVec.size());
+    for(size_t i=0;i<triVec.size();++i)
+    {
+      const Point3i &t=triVec[i];
+      for(int j=0;j<3;++j)
+        m.face[i].V(j)=&(m.vert[t[j]]);
+      // if we are merging faces even when opposite we choose
+      // the best orientation according to the averaged normal
+      if(!DuplicateFaceParam)
+      {
+        Point3d N; N.Import(vcg::Normal(m.face[i]));
+        int badOrient=0;
+        for(int j=0;j<3;++j)
+          if( N.dot(cellVec[t[j]].n) <0) ++badOrient;
+        if(badOrient>2)
+          std::swap(m.face[i].V(0),m.face[i].V(1));
+      }
+    }
+  }
+
+private:
+  struct Cell
+  {
+    Cell(const Point3i &_pi):pi(_pi),p(0,0,0),n(0,0,0),cnt(0){}
+    Point3i pi;
+    Point3d p;
+    Point3d n;
+    int cnt;
+  };
+
+  std::vector<Cell>    cellVec;
+  std::vector<int>     cellTable; // indexes in cellVec, -1 for the empty slots
+  std::vector<Point3i> triVec;    // cell triples
+  std::vector<int>     triTable;  // indexes in triVec, -1 for the empty slots
+
+  static size_t Hash(const Point3i &p)
+  {
+    unsigned int h = (unsigned int)(p[0])*HASH_P0 ^ (unsigned int)(p[1])*HASH_P1 ^ (unsigned int)(p[2])*HASH_P2;
+    return size_t(h ^ (h>>16));
+  }
+
+  // Sort the cells of the face maintaining its orientation (as SimpleTri::sortOrient)
+  static void SortOrient(Point3i &t)
+  {
+    if(t[1] < t[0] && t[1] < t[2] ) { std::swap(t[0],t[1]); std::swap(t[1],t[2]); return; }
+    if(t[2] < t[0] && t[2] < t[1] ) { std::swap(t[0],t[2]); std::swap(t[1],t[2]); return; }
+  }
+
+  static const Point3i &Key(const Cell &c) { return c.pi; }
+  static const Point3i &Key(const Point3i &t) { return t; }
+
+  // Linear probing; the tables are kept at most half full and rebuilt from the vectors when they grow.
+  template <class ElemType>
+  static size_t Find(const std::vector<int> &table, const std::vector<ElemType> &vec, const Point3i &key)
+  {
+    const size_t mask=table.size()-1;
+    size_t s=Hash(key)&mask;
+    while(table[s]!=-1 && Key(vec[table[s]])!=key)
+      s=(s+1)&mask;
+    return s;
+  }
+
+  template <class ElemType>
+  static int Insert(std::vector<int> &table, std::vector<ElemType> &vec, const Point3i &key)
+  {
+    if(2*(vec.size()+1)>table.size())
+    {
+      table.assign(std::max<size_t>(1024,table.size()*2),-1);
+      for(size_t i=0;i<vec.size();++i)
+        table[Find(table,vec,Key(vec[i]))]=int(i);
+    }
+    const size_t s=Find(table,vec,key);
+    if(table[s]==-1)
+    {
+      table[s]=int(vec.size());
+      vec.push_back(ElemType(key));
+    }
+    return table[s];
+  }
+
+  int CellIndex(const Point3i &pi) { return Insert(cellTable,cellVec,pi); }
+  void AddTri(const Point3i &t) { Insert(triTable,triVec,t); }
+}; //end class ClusteringStream
  } // namespace tri
 } // namespace vcg
 
@@ -23,6 +23,7 @@
 #include <vcg/simplex/face/pos.h>
 #include <vcg/simplex/face/topology.h>
 #include <vcg/complex/algorithms/update/quality.h>
+#include <algorithm>
 #include <deque>
 #include <functional>
 #ifndef __VCGLIB_GEODESIC
@@ -67,7 +68,7 @@ public:
 
 
 
-/* Auxiliary class for keeping the heap of vertices to visit and their estimated distance */
+/* Auxiliary class for keeping the seeds to start from and their distance */
   struct VertDist{
     VertDist(){}
     VertDist(VertexPointer _v, ScalarType _d):v(_v),d(_d){}
@@ -76,54 +77,98 @@ public:
     ScalarType d;
   };
 
+  /* Auxiliary indexed 4-ary min heap of element indexes (vertices or faces) keyed by their tentative distance.
+     Each index is queued at most once: lowering the key of a queued index moves it up (decrease key)
+     instead of pushing another copy, so the heap never holds more entries than elements and
+     the keys are never changed behind its back. Ties are broken on the index. */
+  class IndexedHeap
+  {
+  public:
+    void Init(int n) { heap.clear(); pos.assign(n,-1); }
+    bool Empty() const { return heap.empty(); }
+    int Top() const { return heap[0].second; }
 
-  struct DIJKDist{
-    DIJKDist(VertexPointer _v):v(_v){}
-    VertexPointer v;
-
-    bool operator < (const DIJKDist &o) const
+    // queue the index i with the given key, or change its key if it is already queued
+    void Push(int i, ScalarType key)
     {
-      if( v->Q() != o.v->Q())
-        return v->Q() > o.v->Q();
-      return v<o.v;
+      int k=pos[i];
+      if(k<0)
+      {
+        k=int(heap.size());
+        heap.push_back(Entry(key,i));
+        Up(k);
+      }
+      else if(key<heap[k].first) { heap[k].first=key; Up(k); }
+      else { heap[k].first=key; Down(k); }
     }
-   };
 
-  /* Auxiliary class for keeping the heap of vertices to visit and their estimated distance */
-    struct FaceDist{
-      FaceDist(FacePointer _f):f(_f){}
-      FacePointer f;
-      bool operator < (const FaceDist &o) const
+    int Pop()
+    {
+      const int top=heap[0].second;
+      pos[top]=-1;
+      const Entry last=heap.back();
+      heap.pop_back();
+      if(!heap.empty())
       {
-        if( f->Q() != o.f->Q())
-          return f->Q() > o.f->Q();
-        return f<o.f;
+        heap[0]=last;
+        Down(0);
       }
-    };
+      return top;
+    }
 
-  /* Temporary data to associate to all the vertices: estimated distance and boolean flag */
-  struct TempData{
-    TempData(){}
-    TempData(const ScalarType & _d):d(_d),source(0),parent(0){}
+  private:
+    typedef std::pair<ScalarType,int> Entry;
+    std::vector<Entry> heap;
+    std::vector<int> pos; // position in the heap of each index, -1 if not queued
 
-    ScalarType d;
-    VertexPointer source;//closest source
-    VertexPointer parent;
-  };
+    void Up(int k)
+    {
+      const Entry e=heap[k];
+      while(k>0)
+      {
+        const int p=(k-1)/4;
+        if(!(e<heap[p])) break;
+        heap[k]=heap[p]; pos[heap[k].second]=k;
+        k=p;
+      }
+      heap[k]=e; pos[e.second]=k;
+    }
 
-  typedef SimpleTempData<std::vector<VertexType>, TempData >  TempDataType;
+    void Down(int k)
+    {
+      const Entry e=heap[k];
+      const int n=int(heap.size());
+      for(;;)
+      {
+        const int c0=4*k+1;
+        if(c0>=n) break;
+        int best=c0;
+        for(int c=c0+1;c<std::min(c0+4,n);++c)
+          if(heap[c]<heap[best]) best=c;
+        if(!(heap[best]<e)) break;
+        heap[k]=heap[best]; pos[heap[k].second]=k;
+        k=best;
+      }
+      heap[k]=e; pos[e.second]=k;
+    }
+  };
 
+  /* Auxiliary class for the parallel visit: a candidate distance d for the vertex v,
+     reached from the vertex parent of the region of the seed source */
+  struct Candidate{
+    Candidate(){}
+    Candidate(int _v, ScalarType _d, int _source, int _parent):v(_v),source(_source),parent(_parent),d(_d){}
 
-  struct pred: public std::binary_function<VertDist,VertDist,bool>{
-    pred(){}
-    bool operator()(const VertDist& v0, const VertDist& v1) const
-    {return (v0.d > v1.d);}
-  };
+    int v,source,parent;
+    ScalarType d;
 
-  struct pred_addr: public std::binary_function<VertDist,VertDist,bool>{
-    pred_addr(){}
-    bool operator()(const VertDist& v0, const VertDist& v1) const
-    {return (v0.v > v1.v);}
+    // lexicographic on (d,source,parent), so that the best candidate does not depend on the order they are found
+    bool Improves(ScalarType _d, int _source, int _parent) const
+    {
+      if(d!=_d) return d<_d;
+      if(source!=_source) return unsigned(source)<unsigned(_source);
+      return unsigned(parent)<unsigned(_parent);
+    }
   };
 
   //************** calcolo della distanza di pw in base alle distanze note di pw1 e curr
@@ -172,126 +217,294 @@ public:
     return (curr_d);
   }
 
+  /* Tentative distance of pw reached from curr through the face (curr,pw,pw1): the unfolding of the triangle
+     when curr and pw1 belong to the same region and their distances are consistent, otherwise the length of the edge */
+  static ScalarType Relax(const VertexPointer &pw,
+                          const VertexPointer &pw1,
+                          const VertexPointer &curr,
+                          const ScalarType &d_pw1,
+                          const ScalarType &d_curr,
+                          bool sameSource)
+  {
+    if(sameSource)
+    {
+      const ScalarType inter  = DistanceFunctor()(curr,pw1);
+      const ScalarType tol = (inter + d_curr + d_pw1)*.0001f;
+
+      if (	(inter + d_curr >= d_pw1  +tol   ) &&
+            (inter + d_pw1  >= d_curr +tol  ) &&
+            (d_curr + d_pw1  >= inter +tol  )   // triangular inequality
+            )
+        return Distance(pw,pw1,curr,d_pw1,d_curr);
+    }
+    return d_curr + DistanceFunctor()(pw,curr);
+  }
+
 /*
-This is the low level version of the geodesic computation framework.
-Starting from the seeds, it assign a distance value to each vertex. The distance of a vertex is its
-approximated geodesic distance to the closest seeds.
-This is function is not meant to be called (although is not prevented). Instead, it is invoked by
-wrapping function.
+Serial visit: a Dijkstra like flood fill from the seeds over an indexed heap.
+The results are in flat arrays indexed as m.vert: the distance (max() for the vertices not reached),
+the position in seedVec of the closest seed and the parent vertex (-1 for the vertices not reached).
+It stops after visiting the first vertex farther than distance_threshold; it returns the index of the farthest
+visited vertex (only among the border ones if farthestOnBorder is set) or -1.
 */
-  static  VertexPointer Visit(
-      MeshType & m,
-      std::vector<VertDist> & seedVec, // the set of seed to start from
-      bool farthestOnBorder = false,
-      ScalarType distance_threshold  = std::numeric_limits<ScalarType>::max(),                    // cut off distance (do no compute anything farther than this value)
-      typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertSource = NULL,    // if present we put in this attribute the closest source for each vertex
-      typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertParent = NULL,    // if present we put in this attribute the parent in the path that goes from the vertex to the closest source
-      std::vector<VertexPointer> *InInterval=NULL)
+  static int HeapVisit(MeshType & m,
+                       const std::vector<VertexPointer> & seedVec,
+                       bool farthestOnBorder,
+                       ScalarType distance_threshold,
+                       std::vector<ScalarType> & dist,
+                       std::vector<int> & source,
+                       std::vector<int> & parent,
+                       std::vector<VertexPointer> *InInterval=NULL)
   {
-    std::vector<VertDist> frontier;
-    VertexPointer farthest=0,pw,pw1;
+    const int vn = int(m.vert.size());
+    dist.assign(vn,std::numeric_limits<ScalarType>::max());
+    source.assign(vn,-1);
+    parent.assign(vn,-1);
 
-    //Requirements
-    if(!HasVFAdjacency(m)) throw vcg::MissingComponentException("VFAdjacency");
-    if(!HasPerVertexQuality(m)) throw vcg::MissingComponentException("VertexQuality");
-    assert(!seedVec.empty());
-
-    TempDataType TD(m.vert, std::numeric_limits<ScalarType>::max());
-
-    typename std::vector <VertDist >::iterator ifr;
-    for(ifr = seedVec.begin(); ifr != seedVec.end(); ++ifr){
-      (*ifr).d = 0.0;
-      TD[(*ifr).v].d = 0.0;
-      TD[(*ifr).v].source  = (*ifr).v;
-      TD[(*ifr).v].parent  = (*ifr).v;
-      frontier.push_back(VertDist((*ifr).v,0.0));
+    IndexedHeap frontier;
+    frontier.Init(vn);
+    for(size_t i=0;i<seedVec.size();++i)
+    {
+      const int s = int(tri::Index(m,seedVec[i]));
+      dist[s] = 0;
+      source[s] = int(i);
+      parent[s] = s;
+      frontier.Push(s,0);
     }
-    // initialize Heap
-    make_heap(frontier.begin(),frontier.end(),pred());
 
-    ScalarType curr_d,d_curr = 0.0,d_heap;
+    int farthest=-1;
     ScalarType max_distance=0.0;
 
-    while(!frontier.empty() && max_distance < distance_threshold)
+    while(!frontier.Empty() && max_distance < distance_threshold)
     {
-      pop_heap(frontier.begin(),frontier.end(),pred());
-      VertexPointer curr = (frontier.back()).v;
-      if (InInterval!=NULL) InInterval->push_back(curr);
-
-      if(vertSource!=NULL)  (*vertSource)[curr] = TD[curr].source;
-      if(vertParent!=NULL)  (*vertParent)[curr] = TD[curr].parent;
-
-      d_heap = (frontier.back()).d;
-      frontier.pop_back();
+      const int curr = frontier.Pop();
+      VertexPointer vc = &m.vert[curr];
+      if (InInterval!=NULL) InInterval->push_back(vc);
+
+      const ScalarType d_curr = dist[curr];
+      face::VFIterator<FaceType> x;
+      for( x.f = vc->VFp(), x.z = vc->VFi(); x.f!=0; ++x )
+        for(int k=0;k<2;++k)
+        {
+          VertexPointer pw  = (k==0) ? x.f->V1(x.z) : x.f->V2(x.z);
+          VertexPointer pw1 = (k==0) ? x.f->V2(x.z) : x.f->V1(x.z);
+          const int iw  = int(tri::Index(m,pw));
+          const int iw1 = int(tri::Index(m,pw1));
+
+          const ScalarType curr_d = Relax(pw,pw1,vc,dist[iw1],d_curr,source[iw1]==source[curr]);
+          if(dist[iw] > curr_d){
+            dist[iw] = curr_d;
+            source[iw] = source[curr];
+            parent[iw] = curr;
+            frontier.Push(iw,curr_d);
+          }
+        }
 
-      assert(TD[curr].d <= d_heap);
-      if(TD[curr].d < d_heap ) // a vertex whose distance has been improved after it was inserted in the queue
-        continue;
-      assert(TD[curr].d == d_heap);
+      if(!farthestOnBorder || vc->IsB())
+        if(d_curr > max_distance){
+          max_distance = d_curr;
+          farthest = curr;
+        }
+    }// end while
+    return farthest;
+  }
 
-      d_curr =  TD[curr].d;
+/*
+Parallel visit for many seeds (delta stepping): the vertices are kept in buckets of width delta of their tentative distance.
+The smallest non empty bucket is relaxed in rounds: in each round all its vertices propose in parallel a distance to
+their neighbours, then the best proposal of each vertex is applied and the improved vertices are put back in their bucket.
+A round only reads the values of the previous one, and the best proposal does not depend on the order they are found,
+so the result does not depend on the number of threads.
+The vertices farther than distance_threshold are not expanded.
+The flat result arrays are the ones of HeapVisit(); the values can slightly differ from the ones
+of the serial visit, as the unfolding depends on the order the vertices are reached.
+*/
+  static void ParallelVisit(MeshType & m,
+                            const std::vector<VertexPointer> & seedVec,
+                            ScalarType distance_threshold,
+                            ScalarType delta,
+                            std::vector<ScalarType> & dist,
+                            std::vector<int> & source,
+                            std::vector<int> & parent)
+  {
+    const int vn = int(m.vert.size());
+    dist.assign(vn,std::numeric_limits<ScalarType>::max());
+    source.assign(vn,-1);
+    parent.assign(vn,-1);
 
-      bool isLeaf = (!farthestOnBorder || curr->IsB());
+    if(!(delta>0))
+    {
+      // default bucket width: the average edge length, larger ones give more parallelism but more vertices visited again
+      double edgeSum=0;
+      int edgeNum=0;
+      for(size_t i=0;i<m.face.size();++i) if(!m.face[i].IsD())
+        for(int k=0;k<3;++k)
+        {
+          edgeSum+=DistanceFunctor()(m.face[i].V0(k),m.face[i].V1(k));
+          ++edgeNum;
+        }
+      delta = (edgeSum>0) ? ScalarType(edgeSum/edgeNum) : ScalarType(1);
+    }
 
-      face::VFIterator<FaceType> x;int k;
+    std::vector<std::vector<int> > bucket(1);
+    for(size_t i=0;i<seedVec.size();++i)
+    {
+      const int s = int(tri::Index(m,seedVec[i]));
+      dist[s] = 0;
+      source[s] = int(i);
+      parent[s] = s;
+      bucket[0].push_back(s);
+    }
 
-      for( x.f = curr->VFp(), x.z = curr->VFi(); x.f!=0; ++x )
-        for(k=0;k<2;++k)
+    std::vector<char> queued(vn,0);
+    std::vector<int> frontier,improved;
+    std::vector<Candidate> candVec;
+    for(size_t b=0;b<bucket.size();++b)
+      while(!bucket[b].empty())
+      {
+        // the vertices of the bucket, once each (the ones moved to a farther bucket are stale entries)
+        const ScalarType bucketEnd = ScalarType(b+1)*delta;
+        frontier.clear();
+        for(size_t i=0;i<bucket[b].size();++i)
         {
-          if(k==0) {
-            pw = x.f->V1(x.z);
-            pw1=x.f->V2(x.z);
-          }
-          else {
-            pw = x.f->V2(x.z);
-            pw1=x.f->V1(x.z);
+          const int v=bucket[b][i];
+          if(!queued[v] && dist[v]<bucketEnd)
+          {
+            queued[v]=1;
+            frontier.push_back(v);
           }
-
-          const ScalarType & d_pw1  =  TD[pw1].d;
+        }
+        bucket[b].clear();
+        for(size_t i=0;i<frontier.size();++i) queued[frontier[i]]=0;
+        std::sort(frontier.begin(),frontier.end());
+
+        candVec.clear();
+        const int fn=int(frontier.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          std::vector<Candidate> local;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+          for(int i=0;i<fn;++i)
           {
-            const ScalarType inter  = DistanceFunctor()(curr,pw1);//(curr->P() - pw1->P()).Norm();
-            const ScalarType tol = (inter + d_curr + d_pw1)*.0001f;
-
-            if (	(TD[pw1].source != TD[curr].source)||// not the same source
-                    (inter + d_curr < d_pw1  +tol   ) ||
-                    (inter + d_pw1  < d_curr +tol  ) ||
-                    (d_curr + d_pw1  < inter +tol  )   // triangular inequality
-                    )
-              curr_d = d_curr + DistanceFunctor()(pw,curr);//(pw->P()-curr->P()).Norm();
-            else
-              curr_d = Distance(pw,pw1,curr,d_pw1,d_curr);
+            const int curr=frontier[i];
+            VertexPointer vc = &m.vert[curr];
+            const ScalarType d_curr = dist[curr];
+            face::VFIterator<FaceType> x;
+            for( x.f = vc->VFp(), x.z = vc->VFi(); x.f!=0; ++x )
+              for(int k=0;k<2;++k)
+              {
+                VertexPointer pw  = (k==0) ? x.f->V1(x.z) : x.f->V2(x.z);
+                VertexPointer pw1 = (k==0) ? x.f->V2(x.z) : x.f->V1(x.z);
+                const int iw  = int(tri::Index(m,pw));
+                const int iw1 = int(tri::Index(m,pw1));
+
+                const Candidate c(iw,Relax(pw,pw1,vc,dist[iw1],d_curr,source[iw1]==source[curr]),source[curr],curr);
+                if(c.Improves(dist[iw],source[iw],parent[iw])) local.push_back(c);
+              }
           }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+          candVec.insert(candVec.end(),local.begin(),local.end());
+        }
 
-          if(TD[pw].d > curr_d){
-            TD[pw].d = curr_d;
-            TD[pw].source = TD[curr].source;
-            TD[pw].parent = curr;
-            frontier.push_back(VertDist(pw,curr_d));
-            push_heap(frontier.begin(),frontier.end(),pred());
+        for(size_t i=0;i<candVec.size();++i)
+        {
+          const Candidate &c=candVec[i];
+          if(c.Improves(dist[c.v],source[c.v],parent[c.v]))
+          {
+            dist[c.v]=c.d;
+            source[c.v]=c.source;
+            parent[c.v]=c.parent;
+            if(!queued[c.v]) { queued[c.v]=1; improved.push_back(c.v); }
           }
-          if(isLeaf){
-            if(d_curr > max_distance){
-              max_distance = d_curr;
-              farthest = curr;
-            }
+        }
+        for(size_t i=0;i<improved.size();++i)
+        {
+          const int v=improved[i];
+          queued[v]=0;
+          if(dist[v] < distance_threshold)
+          {
+            const size_t vb = std::max(b,size_t(dist[v]/delta));
+            if(vb>=bucket.size()) bucket.resize(vb+1);
+            bucket[vb].push_back(v);
           }
         }
-    }// end while
+        improved.clear();
+      }
+  }
 
-    // Copy found distance onto the Quality (\todo parametric!)
+  // Copy the flat results of a visit onto the vertex quality and the optional attributes
+  static void StoreResult(MeshType & m,
+                          const std::vector<VertexPointer> & seedVec,
+                          const std::vector<ScalarType> & dist,
+                          const std::vector<int> & source,
+                          const std::vector<int> & parent,
+                          std::vector<VertexPointer> *InInterval,
+                          typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertSource,
+                          typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertParent,
+                          bool clearUnreached)
+  {
     if (InInterval==NULL)
     {
-      for(VertexIterator vi = m.vert.begin(); vi != m.vert.end(); ++vi) if(!(*vi).IsD())
-        (*vi).Q() =  TD[&(*vi)].d;
+      for(size_t i=0;i<m.vert.size();++i) if(!m.vert[i].IsD())
+        m.vert[i].Q() = dist[i];
     }
     else
     {
       assert(InInterval->size()>0);
       for(size_t i=0;i<InInterval->size();i++)
-        (*InInterval)[i]->Q() =  TD[(*InInterval)[i]].d;
+        (*InInterval)[i]->Q() = dist[tri::Index(m,(*InInterval)[i])];
     }
 
-    return farthest;
+    for(size_t i=0;i<m.vert.size();++i)
+      if(source[i]>=0 || clearUnreached)
+      {
+        if(vertSource!=NULL) (*vertSource)[i] = (source[i]>=0) ? seedVec[source[i]] : 0;
+        if(vertParent!=NULL) (*vertParent)[i] = (parent[i]>=0) ? &m.vert[parent[i]] : 0;
+      }
+  }
+
+/*
+This is the low level version of the geodesic computation framework.
+Starting from the seeds, it assign a distance value to each vertex. The distance of a vertex is its
+approximated geodesic distance to the closest seeds.
+This is function is not meant to be called (although is not prevented). Instead, it is invoked by
+wrapping function.
+*/
+  static  VertexPointer Visit(
+      MeshType & m,
+      std::vector<VertDist> & seedVec, // the set of seed to start from
+      bool farthestOnBorder = false,
+      ScalarType distance_threshold  = std::numeric_limits<ScalarType>::max(),                    // cut off distance (do no compute anything farther than this value)
+      typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertSource = NULL,    // if present we put in this attribute the closest source for each vertex
+      typename MeshType::template PerVertexAttributeHandle<VertexPointer> * vertParent = NULL,    // if present we put in this attribute the parent in the path that goes from the vertex to the closest source
+      std::vector<VertexPointer> *InInterval=NULL)
+  {
+    //Requirements
+    if(!HasVFAdjacency(m)) throw vcg::MissingComponentException("VFAdjacency");
+    if(!HasPerVertexQuality(m)) throw vcg::MissingComponentException("VertexQuality");
+    assert(!seedVec.empty());
+
+    std::vector<VertexPointer> seedPtrVec(seedVec.size());
+    for(size_t i=0;i<seedVec.size();++i)
+    {
+      seedVec[i].d = 0.0;
+      seedPtrVec[i] = seedVec[i].v;
+    }
+
+    std::vector<ScalarType> dist;
+    std::vector<int> source,parent;
+    const int farthest = HeapVisit(m,seedPtrVec,farthestOnBorder,distance_threshold,dist,source,parent,InInterval);
+
+    // Copy found distance onto the Quality (\todo parametric!)
+    StoreResult(m,seedPtrVec,dist,source,parent,InInterval,vertSource,vertParent,false);
+
+    return (farthest>=0) ? &m.vert[farthest] : 0;
   }
 
 
@@ -325,6 +538,7 @@ It requires per vertex Quality (e.g. vertex::Quality component)
 
 \warning that this function has ALWAYS at least a linear cost (it use additional attributes that have a linear initialization)
 \todo make it O(output) by using incremental mark and persistent attributes.
+\sa ComputeField() for the parallel version for many seeds
             */
   static bool Compute( MeshType & m,
                        const std::vector<VertexPointer> & seedVec,
@@ -344,9 +558,59 @@ It requires per vertex Quality (e.g. vertex::Quality component)
     return true;
   }
 
+  /*! \brief Multi source parallel version of Compute() returning the results in flat arrays
+
+\param m the mesh
+\param seedVec a vector of Vertex pointers with the \em sources of the flood fill
+\param distVec for each vertex (indexed as m.vert) its approximated geodesic distance from the closest seed, max() if not reached
+\param seedIndexVec for each vertex the position in seedVec of its closest seed, -1 if not reached
+\param maxDistanceThr the vertices farther than this distance are not expanded
+\param parentVec if present, for each vertex the index of its parent in the closest tree, -1 if not reached
+\param delta width of the distance buckets that are processed in parallel; 0 means the average edge length
+
+The seeds are propagated together with delta stepping, so the cost is shared among the threads
+and it is well suited for many seeds (e.g. Voronoi partitions or distance from the border).
+It does not touch the vertex quality, so it requires just the VF adjacency relation;
+the result does not depend on the number of threads.
+            */
+  static bool ComputeField(MeshType & m,
+                           const std::vector<VertexPointer> & seedVec,
+                           std::vector<ScalarType> & distVec,
+                           std::vector<int> & seedIndexVec,
+                           ScalarType maxDistanceThr = std::numeric_limits<ScalarType>::max(),
+                           std::vector<int> * parentVec = NULL,
+                           ScalarType delta = 0)
+  {
+    tri::RequireVFAdjacency(m);
+    if(seedVec.empty())	return false;
+    std::vector<int> parent;
+    ParallelVisit(m, seedVec, maxDistanceThr, delta, distVec, seedIndexVec, (parentVec!=NULL) ? *parentVec : parent);
+    return true;
+  }
+
+  /*! \brief Same as Compute() (without withinDistanceVec) but using ComputeField()
+
+The distance is stored in the vertex::Quality component; the sourceSeed and parentSeed attributes,
+if present, are set for all the vertices (NULL for the ones not reached).
+            */
+  static bool ComputeParallel( MeshType & m,
+                               const std::vector<VertexPointer> & seedVec,
+                               ScalarType maxDistanceThr  = std::numeric_limits<ScalarType>::max(),
+                               typename MeshType::template PerVertexAttributeHandle<VertexPointer> * sourceSeed = NULL,
+                               typename MeshType::template PerVertexAttributeHandle<VertexPointer> * parentSeed = NULL
+                               )
+  {
+    tri::RequirePerVertexQuality(m);
+    std::vector<ScalarType> dist;
+    std::vector<int> source,parent;
+    if(!ComputeField(m, seedVec, dist, source, maxDistanceThr, &parent)) return false;
+    StoreResult(m, seedVec, dist, source, parent, NULL, sourceSeed, parentSeed, true);
+    return true;
+  }
+
   /* \brief Assigns to each vertex of the mesh its distance to the closest vertex on the boundary
 
-It is just a simple wrapper of the basic Compute()
+It is just a simple wrapper of ComputeParallel(), as all the border vertices are seeds
 
             Note: update the field Q() of the vertices
             Note: it needs the border bit set.
@@ -360,7 +624,7 @@ It is just a simple wrapper of the basic Compute()
     if(fro.empty()) return false;
 
     tri::UpdateQuality<MeshType>::VertexConstant(m,0);
-    return Compute(m,fro,std::numeric_limits<ScalarType>::max(),0,sources);
+    return ComputeParallel(m,fro,std::numeric_limits<ScalarType>::max(),sources);
   }
 
 
@@ -401,7 +665,8 @@ It is just a simple wrapper of the basic Compute()
     typename MeshType::template PerFaceAttributeHandle<FacePointer> parentHandle
         = tri::Allocator<MeshType>::template GetPerFaceAttribute<FacePointer> (m,"parent");
 
-    std::vector<FaceDist> Heap;
+    IndexedHeap Heap;
+    Heap.Init(int(m.face.size()));
     tri::UnMarkAll(m);
     for(size_t i=0;i<seedVec.size();++i)
     {
@@ -409,17 +674,15 @@ It is just a simple wrapper of the basic Compute()
       seedVec[i]->Q()=0;
       sourceHandle[seedVec[i]]=seedVec[i];
       parentHandle[seedVec[i]]=seedVec[i];
-      Heap.push_back(FaceDist(seedVec[i]));
+      Heap.Push(int(tri::Index(m,seedVec[i])),0);
       if (InInterval!=NULL) InInterval->push_back(seedVec[i]);
     }
 
-    std::make_heap(Heap.begin(),Heap.end());
-    while(!Heap.empty())
+    while(!Heap.Empty())
     {
-      pop_heap(Heap.begin(),Heap.end());
-      FacePointer curr = (Heap.back()).f;
+      FacePointer curr = &m.face[Heap.Top()];
       if ((FaceTarget!=NULL)&&(curr==FaceTarget))return;
-      Heap.pop_back();
+      Heap.Pop();
 
       for(int i=0;i<3;++i)
       {
@@ -433,8 +696,7 @@ It is just a simple wrapper of the basic Compute()
             nextF->Q() = nextDist;
             if ((avoid_selected)&&(nextF->IsS()))continue;
             tri::Mark(m,nextF);
-            Heap.push_back(FaceDist(nextF));
-            push_heap(Heap.begin(),Heap.end());
+            Heap.Push(int(tri::Index(m,nextF)),nextDist);
             if (InInterval!=NULL) InInterval->push_back(nextF);
             sourceHandle[nextF] = sourceHandle[curr];
             parentHandle[nextF] = curr;
@@ -463,7 +725,8 @@ It is just a simple wrapper of the basic Compute()
     typename MeshType::template PerVertexAttributeHandle<VertexPointer> parentHandle
         = tri::Allocator<MeshType>::template GetPerVertexAttribute<VertexPointer> (m,"parent");
 
-    std::vector<DIJKDist> Heap;
+    IndexedHeap Heap;
+    Heap.Init(int(m.vert.size()));
     tri::UnMarkAll(m);
 
     for(size_t i=0;i<seedVec.size();++i)
@@ -473,17 +736,15 @@ It is just a simple wrapper of the basic Compute()
       seedVec[i]->Q()=0;
       sourceHandle[seedVec[i]]=seedVec[i];
       parentHandle[seedVec[i]]=seedVec[i];
-      Heap.push_back(DIJKDist(seedVec[i]));
+      Heap.Push(int(tri::Index(m,seedVec[i])),0);
       if (InInterval!=NULL) InInterval->push_back(seedVec[i]);
     }
 
-    std::make_heap(Heap.begin(),Heap.end());
-    while(!Heap.empty())
+    while(!Heap.Empty())
     {
-      pop_heap(Heap.begin(),Heap.end());
-      VertexPointer curr = (Heap.back()).v;
+      VertexPointer curr = &m.vert[Heap.Top()];
       if ((target!=NULL)&&(target==curr))return;
-      Heap.pop_back();
+      Heap.Pop();
       std::vector<VertexPointer> vertVec;
       face::VVStarVF<FaceType>(curr,vertVec);
       for(size_t i=0;i<vertVec.size();++i)
@@ -496,8 +757,7 @@ It is just a simple wrapper of the basic Compute()
         {
           nextV->Q() = nextDist;
           tri::Mark(m,nextV);
-          Heap.push_back(DIJKDist(nextV));
-          push_heap(Heap.begin(),Heap.end());
+          Heap.Push(int(tri::Index(m,nextV)),nextDist);
           if (InInterval!=NULL) InInterval->push_back(nextV);
           sourceHandle[nextV] = sourceHandle[curr];
           parentHandle[nextV] = curr;
@@ -47,6 +47,10 @@ compiling error resolved
 #ifndef VCG_INSIDE
 #define VCG_INSIDE
 
+namespace vcg {
+	template <class MeshType> class RayBVH;
+}
+
 
 /// This static funtion is used to see if one point is inside a triangular mesh or not... 
 /// First parameter is a spatial indexing structure (eg. a grid) used to perform research operation, initialized with faces of the triangular mesh of type TriMeshType
@@ -79,7 +83,7 @@ namespace vcg {
 				{
 					ScalarType dist;
 					CoordType Norm, ip, nearest;
-					FaceType *f = vcg::tri::GetClosestFace< TriMeshType, FaceSpatialIndexing >( m, _g_mesh, test, m.bbox.Diag(), dist, nearest, Norm, ip );
+					FaceType *f = vcg::tri::GetClosestFaceEP< TriMeshType, FaceSpatialIndexing >( m, _g_mesh, test, m.bbox.Diag(), dist, nearest, Norm, ip );
 					assert( f != NULL );			/// Check if there is any face in the mesh
 					/// If the point is on the face is considered inside.
 					if( ( test - nearest ).Norm() <= EPSILON ) return true;
@@ -109,6 +113,41 @@ namespace vcg {
 			}
 
 		}; // end class
+
+		/// Specialization for a RayBVH: the point is inside if the first face hit by a ray leaving it
+		/// is crossed from the inside, i.e. its normal agrees with the ray direction.
+		/// A ray hitting close to an edge or a vertex is discarded and cast again along another direction.
+		template <class TriMeshType>
+		class Inside< RayBVH<TriMeshType>, TriMeshType >
+		{
+		private:
+
+			typedef typename RayBVH<TriMeshType>::CoordType CoordType;
+			typedef typename RayBVH<TriMeshType>::ScalarType ScalarType;
+
+		public:
+
+			/// Return true if the point is inside the mesh.
+			static bool Is_Inside( TriMeshType & m, const RayBVH<TriMeshType> & bvh, const CoordType & test )
+			{
+				typedef typename TriMeshType::FaceType FaceType;
+				const ScalarType EPSILON = 0.0001;
+				if( !( m.bbox.IsIn(test) ) ) return false;
+				static const ScalarType dirs[3][3] = { {0.5773f,0.5812f,0.5734f}, {-0.6116f,0.5547f,-0.5641f}, {0.5422f,-0.6321f,-0.5536f} };
+				bool inside = false;
+				for(int k=0;k<3;++k)
+				{
+					CoordType d(dirs[k][0],dirs[k][1],dirs[k][2]);
+					typename RayBVH<TriMeshType>::Hit h;
+					if( !bvh.ClosestHit( Ray3<ScalarType>(test,d), m.bbox.Diag(), h ) ) return false;
+					FaceType &f = *h.f;
+					inside = ( vcg::Normal(f.cP(0),f.cP(1),f.cP(2)) * d ) > 0;
+					if( ( h.u > EPSILON ) && ( h.v > EPSILON ) && ( 1 - h.u - h.v > EPSILON ) ) break;
+				}
+				return inside;
+			}
+
+		}; // end class
 	}
 }
 
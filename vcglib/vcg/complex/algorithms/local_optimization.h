@@ -167,7 +167,7 @@ template<class MeshType>
 class LocalOptimization
 {
 public:
-  LocalOptimization(MeshType &mm, BaseParameterClass *_pp): m(mm){ ClearTermination();e=0.0;HeapSimplexRatio=5; pp=_pp;}
+  LocalOptimization(MeshType &mm, BaseParameterClass *_pp): m(mm){ ClearTermination();e=0.0;HeapSimplexRatio=5; HeapLimit=0; ParallelRoundSize=4096; Round=0; pp=_pp;}
 
 	struct  HeapElem;
 	// scalar type
@@ -208,6 +208,13 @@ public:
 
   float HeapSimplexRatio; 
 
+  // The heap is purged also when it is larger than twice the number of valid operations
+  // left by the previous purge (see IsHeapTooLarge), so its memory is bounded by the valid operations
+  size_t HeapLimit;
+
+  // Max number of operations performed in each round by DoOptimizationParallel
+  int ParallelRoundSize;
+
 	void SetTerminationFlag		(int v){tf |= v;}
 	void ClearTerminationFlag	(int v){tf &= ~v;}
 	bool IsTerminationFlag		(int v){return ((tf & v)!=0);}
@@ -231,7 +238,11 @@ public:
 	/// the mesh to optimize
 	MeshType & m;
 
-
+  // per vertex marks and supports of the candidates used by DoOptimizationParallel
+  std::vector<unsigned int> VertStamp;
+  unsigned int Round;
+  std::vector<std::vector<typename MeshType::VertexPointer> > SupportWritten,SupportRead;
+  std::vector<HeapType> NewOps;
 
 	///the heap of operations
 	HeapType h;
@@ -289,7 +300,7 @@ public:
 		nPerfmormedOps =0;
 		while( !GoalReached() && !h.empty())
 			{
-        if(h.size()> m.SimplexNumber()*HeapSimplexRatio )  ClearHeap();
+        if(IsHeapTooLarge())  ClearHeap();
 				std::pop_heap(h.begin(),h.end());
         LocModPtrType  locMod   = h.back().locModPtr;
 				currMetric=h.back().pri;
@@ -312,32 +323,159 @@ public:
 		return !(h.empty());
   }
  
+  /// Parallel version of the main cycle of optimization.
+  /// At each round the up to date operations with the lowest priorities (at most ParallelRoundSize)
+  /// are extracted from the heap; among them, in order of priority, are chosen the ones that
+  /// do not interfere with the already chosen ones, and these are executed in parallel.
+  /// The interference is decided on the vertices touched by each operation, as given by
+  /// LocalModificationType::GetSupport(written,read): an operation is chosen only if the vertices
+  /// it writes are neither written nor read by the chosen ones, and the vertices it reads are not
+  /// written by them. The discarded candidates go back in the heap for the next rounds.
+  /// Each chosen operation collects its new operations in its own heap, with its own mark
+  /// (see UpdateHeap(h,pp,mark)), and these heaps are merged in order at the end of the round.
+  /// So the result does not depend on the number of threads, but it is not the same of DoOptimization
+  /// because inside a round the operations are not performed in strict priority order.
+  template <class LocalModificationType> bool DoOptimizationParallel()
+  {
+    typedef typename MeshType::VertexPointer VertexPointer;
+    start=clock();
+    nPerfmormedOps =0;
+    if(VertStamp.size()!=m.vert.size())
+    {
+      VertStamp.assign(m.vert.size(),0);
+      Round=0;
+    }
+    std::vector<LocModPtrType> cand,sel;
+    while( !GoalReached() && !h.empty())
+    {
+      if(IsHeapTooLarge())  ClearHeap();
+
+      // 1) pop the candidates of this round
+      int roundSize=RoundSize();
+      cand.clear();
+      while(int(cand.size())<roundSize && !h.empty())
+      {
+        if(IsTerminationFlag(LOMetric) && h.front().pri > targetMetric) break;
+        std::pop_heap(h.begin(),h.end());
+        LocModPtrType  locMod   = h.back().locModPtr;
+        currMetric=h.back().pri;
+        h.pop_back();
+        if( locMod->IsUpToDate() ) cand.push_back(locMod);
+                              else delete locMod;
+      }
+      if(cand.empty()) break;
+
+      // 2) gather the vertices touched by each candidate
+      int cn=int(cand.size());
+      if(int(SupportWritten.size())<cn)
+      {
+        SupportWritten.resize(cn);
+        SupportRead.resize(cn);
+      }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+      for(int i=0;i<cn;++i)
+        static_cast<LocalModificationType *>(cand[i])->GetSupport(SupportWritten[i],SupportRead[i]);
+
+      // 3) choose greedily the independent candidates in priority order;
+      // VertStamp marks with 2*Round+1 the vertices written in this round and with 2*Round the read ones.
+      ++Round;
+      const unsigned int readStamp=2*Round, writtenStamp=2*Round+1;
+      VertexPointer base=&m.vert[0];
+      sel.clear();
+      for(int i=0;i<cn;++i)
+      {
+        const std::vector<VertexPointer> &wv=SupportWritten[i];
+        const std::vector<VertexPointer> &rv=SupportRead[i];
+        bool independent=true;
+        for(size_t j=0;j<wv.size() && independent;++j)
+          if(VertStamp[wv[j]-base]>=readStamp) independent=false;
+        for(size_t j=0;j<rv.size() && independent;++j)
+          if(VertStamp[rv[j]-base]==writtenStamp) independent=false;
+        if(!independent)
+        {
+          h.push_back(HeapElem(cand[i]));
+          std::push_heap(h.begin(),h.end());
+          continue;
+        }
+        for(size_t j=0;j<rv.size();++j)
+          if(VertStamp[rv[j]-base]<readStamp) VertStamp[rv[j]-base]=readStamp;
+        for(size_t j=0;j<wv.size();++j)
+          VertStamp[wv[j]-base]=writtenStamp;
+        sel.push_back(cand[i]);
+      }
+
+      // 4) execute the chosen operations, the i-th one with the mark mark0+i+1
+      int sn=int(sel.size());
+      if(int(NewOps.size())<sn) NewOps.resize(sn);
+      std::vector<char> done(sn,0);
+      const int mark0=LocalModificationType::UpdateMark(this->pp);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,16)
+#endif
+      for(int i=0;i<sn;++i)
+      {
+        LocalModificationType *locMod=static_cast<LocalModificationType *>(sel[i]);
+        NewOps[i].clear();
+        if(locMod->IsFeasible(this->pp))
+        {
+          locMod->Execute(m,this->pp);
+          locMod->UpdateHeap(NewOps[i],this->pp,mark0+i+1);
+          done[i]=1;
+        }
+        delete sel[i];
+      }
+      LocalModificationType::UpdateMark(this->pp)=mark0+sn;
+
+      for(int i=0;i<sn;++i)
+      {
+        nPerfmormedOps+=done[i];
+        for(size_t j=0;j<NewOps[i].size();++j)
+        {
+          h.push_back(NewOps[i][j]);
+          std::push_heap(h.begin(),h.end());
+        }
+      }
+    }
+    return !(h.empty());
+  }
+
 // It removes from the heap all the operations that are no more 'uptodate' 
 // (e.g. collapses that have some recently modified vertices)
-// This function  is called from time to time by the doOptimization (e.g. when the heap is larger than fn*3)
+// This function  is called from time to time by the doOptimization (see IsHeapTooLarge)
 void ClearHeap()
 {
-	typename HeapType::iterator hi;
-	//int sz=h.size();
-	for(hi=h.begin();hi!=h.end();)
-	{
-    if(!(*hi).locModPtr->IsUpToDate())
-		{
-			delete (*hi).locModPtr;
-			*hi=h.back();
-			if(&*hi==&h.back()) 
-			{
-				hi=h.end();
-				h.pop_back();
-				break;
-			}
-		    h.pop_back();
-			continue;
-		}
-		++hi;
-	}
-	//qDebug("\nReduced heap from %7i to %7i (fn %7i) ",sz,h.size(),m.fn);
+  size_t n=h.size(),k=0;
+  for(size_t i=0;i<n;++i)
+  {
+    if(h[i].locModPtr->IsUpToDate()) h[k++]=h[i];
+                                else delete h[i].locModPtr;
+  }
+  h.resize(k);
+	//qDebug("\nReduced heap from %7i to %7i (fn %7i) ",n,h.size(),m.fn);
 	make_heap(h.begin(),h.end());
+  HeapLimit=std::max(2*h.size(),size_t(1024));
+}
+
+// The heap is purged when it exceeds HeapSimplexRatio times the number of simplices
+// or twice its size after the previous purge: so it never holds more than twice the valid
+// operations, and the purges cost a constant amortized time for each operation.
+bool IsHeapTooLarge()
+{
+  return h.size() > m.SimplexNumber()*HeapSimplexRatio || (HeapLimit>0 && h.size() > HeapLimit);
+}
+
+// Number of candidates popped by a round of DoOptimizationParallel,
+// reduced near the end so that the termination conditions are not overcome.
+int RoundSize()
+{
+  // on small meshes fewer candidates, otherwise most of them would interfere
+  int rs=std::max(1,std::min(ParallelRoundSize,m.SimplexNumber()/256));
+  if(IsTerminationFlag(LOnSimplices)) rs=std::min(rs,std::max(1,(m.SimplexNumber()-nTargetSimplices)/2));
+  if(IsTerminationFlag(LOnVertices))  rs=std::min(rs,std::max(1,m.VertexNumber()-nTargetVertices));
+  if(IsTerminationFlag(LOnOps))       rs=std::min(rs,std::max(1,nTargetOps-nPerfmormedOps));
+  return rs;
 }
 
 	///initialize for all vertex the temporary mark must call only at the start of decimation
@@ -352,6 +490,7 @@ void ClearHeap()
 		
     LocalModificationType::Init(m,h,pp);
     std::make_heap(h.begin(),h.end());
+    HeapLimit=std::max(2*h.size(),size_t(1024));
     if(!h.empty()) currMetric=h.front().pri;
 	}
 
@@ -88,6 +88,11 @@ protected:
 	ScalarType _priority;
 
 	public:
+	///mark given by UpdateHeap to the modified vertex and to the new collapses; by default it is
+	///the GlobalMark shared by all the meshes. A derived class can keep it elsewhere, e.g. in its
+	///parameters, to simplify different meshes at the same time (see QuadricBlockSimplification)
+	static int& UpdateMark(BaseParameterClass *){ return GlobalMark();}
+
 	/// Default Constructor
 	inline	TriEdgeCollapse()
 			{}
@@ -134,10 +139,16 @@ public:
 
   inline  void UpdateHeap(HeapType & h_ret, BaseParameterClass *pp)
   {
-    GlobalMark()++;
+    UpdateHeap(h_ret,pp,++MYTYPE::UpdateMark(pp));
+  }
+
+  // As above, but with the given mark, that must be greater than all the marks given before:
+  // LocalOptimization::DoOptimizationParallel gives a different one to each collapse of a round.
+  inline  void UpdateHeap(HeapType & h_ret, BaseParameterClass *pp, int mark)
+  {
     VertexType *v[2];
     v[0]= pos.V(0);v[1]=pos.V(1);
-    v[1]->IMark() = GlobalMark();
+    v[1]->IMark() = mark;
 
     // First loop around the remaining vertex to unmark visited flags
     vcg::face::VFIterator<FaceType> vfi(v[1]);
@@ -156,20 +167,20 @@ public:
       if( !(vfi.V1()->IsV()) && (vfi.V1()->IsRW()))
       {
         vfi.V1()->SetV();
-        h_ret.push_back(HeapElem(new MYTYPE(VertexPair( vfi.V(),vfi.V1() ),GlobalMark(),pp)));
+        h_ret.push_back(HeapElem(new MYTYPE(VertexPair( vfi.V(),vfi.V1() ),mark,pp)));
         std::push_heap(h_ret.begin(),h_ret.end());
         if(! this->IsSymmetric(pp)){
-          h_ret.push_back(HeapElem(new MYTYPE(VertexPair( vfi.V1(),vfi.V()),GlobalMark(),pp)));
+          h_ret.push_back(HeapElem(new MYTYPE(VertexPair( vfi.V1(),vfi.V()),mark,pp)));
           std::push_heap(h_ret.begin(),h_ret.end());
         }
       }
       if(  !(vfi.V2()->IsV()) && (vfi.V2()->IsRW()))
       {
         vfi.V2()->SetV();
-        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.F()->V(vfi.I()),vfi.F()->V2(vfi.I())),GlobalMark(),pp)));
+        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.F()->V(vfi.I()),vfi.F()->V2(vfi.I())),mark,pp)));
         std::push_heap(h_ret.begin(),h_ret.end());
         if(! this->IsSymmetric(pp)){
-          h_ret.push_back(HeapElem(new MYTYPE(VertexPair (vfi.F()->V1(vfi.I()),vfi.F()->V(vfi.I())),GlobalMark(),pp)));
+          h_ret.push_back(HeapElem(new MYTYPE(VertexPair (vfi.F()->V1(vfi.I()),vfi.F()->V(vfi.I())),mark,pp)));
           std::push_heap(h_ret.begin(),h_ret.end());
         }
       }
@@ -188,6 +199,33 @@ public:
 
   ModifierType IsOfType(){ return TriEdgeCollapseOp;}
 
+  /// The vertices touched by this collapse, used by LocalOptimization::DoOptimizationParallel.
+  /// Written: the one ring of the two vertices of the pair (that contains both, as the pair is an edge). Execute rewires the faces around
+  /// the pair and detaches the deleted faces from the VF lists of the opposite vertices, the new
+  /// collapses of UpdateHeap move the vertices of their pair while computing the priority, and
+  /// UpdateHeap sets the visited flags and the mark of the one ring of the surviving vertex.
+  /// Read: the one ring of the written vertices, whose faces are read by those priorities.
+  /// The read vector can contain duplicated vertices.
+  void GetSupport(std::vector<VertexType *> &written, std::vector<VertexType *> &read)
+  {
+    written.clear();
+    read.clear();
+    for(int i=0;i<2;++i)
+      for(vcg::face::VFIterator<FaceType> vfi(pos.V(i));!vfi.End();++vfi)
+      {
+        written.push_back(vfi.V1());
+        written.push_back(vfi.V2());
+      }
+    std::sort(written.begin(),written.end());
+    written.erase(std::unique(written.begin(),written.end()),written.end());
+    for(size_t i=0;i<written.size();++i)
+      for(vcg::face::VFIterator<FaceType> vfi(written[i]);!vfi.End();++vfi)
+      {
+        read.push_back(vfi.V1());
+        read.push_back(vfi.V2());
+      }
+  }
+
   inline bool IsFeasible(BaseParameterClass *){
     return EdgeCollapser<TriMeshType,VertexPair>::LinkConditions(pos);
 	}
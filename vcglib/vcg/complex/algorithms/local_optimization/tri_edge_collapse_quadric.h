@@ -223,7 +223,15 @@ public:
       if(!pp->PreserveTopology) return true;
 
       bool res = ( EdgeCollapser<TriMeshType, VertexPair>::LinkConditions(this->pos) );
-      if(!res) ++( TEC::FailStat::LinkConditionEdge() );
+      if(!res)
+      {
+        // DoOptimizationParallel calls it from many threads
+        int &failCnt=TEC::FailStat::LinkConditionEdge();
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        ++failCnt;
+      }
       return res;
     }
 
@@ -261,6 +269,14 @@ public:
     }
 
   static void Init(TriMeshType &m, HeapType &h_ret, BaseParameterClass *_pp)
+  {
+  vcg::tri::UpdateTopology<TriMeshType>::VertexFace(m);
+  vcg::tri::UpdateFlags<TriMeshType>::FaceBorderFromVF(m);
+  InitWithBorder(m,h_ret,_pp);
+  }
+
+  /// The part of Init that follows the computation of the VF topology and of the face border flags
+  static void InitWithBorder(TriMeshType &m, HeapType &h_ret, BaseParameterClass *_pp)
   {
     QParameter *pp=(QParameter *)_pp;
 
@@ -269,9 +285,6 @@ public:
 
   pp->CosineThr=cos(pp->NormalThrRad);
 
-  vcg::tri::UpdateTopology<TriMeshType>::VertexFace(m);
-  vcg::tri::UpdateFlags<TriMeshType>::FaceBorderFromVF(m);
-
   if(pp->FastPreserveBoundary)
     {
       for(pf=m.face.begin();pf!=m.face.end();++pf)
@@ -315,11 +328,11 @@ public:
                   assert(x.F()->V(x.I())==&(*vi));
                   if((x.V0()<x.V1()) && x.V1()->IsRW() && !x.V1()->IsV()){
                         x.V1()->SetV();
-                        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(x.V0(),x.V1()),TriEdgeCollapse< TriMeshType,VertexPair,MYTYPE>::GlobalMark(),_pp )));
+                        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(x.V0(),x.V1()),MYTYPE::UpdateMark(_pp),_pp )));
                         }
                   if((x.V0()<x.V2()) && x.V2()->IsRW()&& !x.V2()->IsV()){
                         x.V2()->SetV();
-                        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(x.V0(),x.V2()),TriEdgeCollapse< TriMeshType,VertexPair,MYTYPE>::GlobalMark(),_pp )));
+                        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(x.V0(),x.V2()),MYTYPE::UpdateMark(_pp),_pp )));
                       }
                 }
             }
@@ -335,10 +348,10 @@ public:
 						{
 							assert(x.F()->V(x.I())==&(*vi));
 							if(x.V()->IsRW() && x.V1()->IsRW() && !IsMarked(m,x.F()->V1(x.I()))){
-                    h_ret.push_back( HeapElem( new MYTYPE( VertexPair (x.V(),x.V1()),TriEdgeCollapse< TriMeshType,VertexPair,MYTYPE>::GlobalMark(),_pp)));
+                    h_ret.push_back( HeapElem( new MYTYPE( VertexPair (x.V(),x.V1()),MYTYPE::UpdateMark(_pp),_pp)));
 										}
 							if(x.V()->IsRW() && x.V2()->IsRW() && !IsMarked(m,x.F()->V2(x.I()))){
-                    h_ret.push_back( HeapElem( new MYTYPE( VertexPair (x.V(),x.V2()),TriEdgeCollapse< TriMeshType,VertexPair,MYTYPE>::GlobalMark(),_pp)));
+                    h_ret.push_back( HeapElem( new MYTYPE( VertexPair (x.V(),x.V2()),MYTYPE::UpdateMark(_pp),_pp)));
 									}
 						}
 					}	
@@ -451,13 +464,18 @@ public:
 //static double MaxError() {return 1e100;}
 //
   inline  void UpdateHeap(HeapType & h_ret,BaseParameterClass *_pp)
+  {
+    UpdateHeap(h_ret,_pp,++MYTYPE::UpdateMark(_pp));
+  }
+
+  // As above, with the mark given by LocalOptimization::DoOptimizationParallel
+  inline  void UpdateHeap(HeapType & h_ret,BaseParameterClass *_pp, int mark)
   {
     QParameter *pp=(QParameter *)_pp;
-    this->GlobalMark()++;
     VertexType *v[2];
     v[0]= this->pos.V(0);
     v[1]= this->pos.V(1);
-    v[1]->IMark() = this->GlobalMark();
+    v[1]->IMark() = mark;
 
     // First loop around the remaining vertex to unmark visited flags
     vcg::face::VFIterator<FaceType> vfi(v[1]);
@@ -475,29 +493,29 @@ public:
       if( !(vfi.V1()->IsV()) && vfi.V1()->IsRW())
       {
         vfi.V1()->SetV();
-        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V0(),vfi.V1()), this->GlobalMark(),_pp)));
+        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V0(),vfi.V1()), mark,_pp)));
         std::push_heap(h_ret.begin(),h_ret.end());
         if(!IsSymmetric(pp)){
-          h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V1(),vfi.V0()), this->GlobalMark(),_pp)));
+          h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V1(),vfi.V0()), mark,_pp)));
           std::push_heap(h_ret.begin(),h_ret.end());
         }
       }
       if(  !(vfi.V2()->IsV()) && vfi.V2()->IsRW())
       {
         vfi.V2()->SetV();
-        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V0(),vfi.V2()),this->GlobalMark(),_pp)));
+        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V0(),vfi.V2()),mark,_pp)));
         std::push_heap(h_ret.begin(),h_ret.end());
         if(!IsSymmetric(pp)){
-          h_ret.push_back( HeapElem(new MYTYPE(VertexPair(vfi.V2(),vfi.V0()), this->GlobalMark(),_pp) )  );
+          h_ret.push_back( HeapElem(new MYTYPE(VertexPair(vfi.V2(),vfi.V0()), mark,_pp) )  );
           std::push_heap(h_ret.begin(),h_ret.end());
         }
       }
       if(pp->SafeHeapUpdate && vfi.V1()->IsRW() && vfi.V2()->IsRW() )
       {
-        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V1(),vfi.V2()),this->GlobalMark(),_pp)));
+        h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V1(),vfi.V2()),mark,_pp)));
         std::push_heap(h_ret.begin(),h_ret.end());
         if(!IsSymmetric(pp)){
-          h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V2(),vfi.V1()), this->GlobalMark(),_pp)));
+          h_ret.push_back(HeapElem(new MYTYPE(VertexPair(vfi.V2(),vfi.V1()), mark,_pp)));
           std::push_heap(h_ret.begin(),h_ret.end());
         }
       }
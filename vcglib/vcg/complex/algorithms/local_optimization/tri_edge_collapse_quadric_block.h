@@ -0,0 +1,549 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+#ifndef __VCG_TRI_EDGE_COLLAPSE_QUADRIC_BLOCK
+#define __VCG_TRI_EDGE_COLLAPSE_QUADRIC_BLOCK
+
+#include <vector>
+#include <algorithm>
+#include <vcg/complex/algorithms/local_optimization.h>
+#include <vcg/complex/algorithms/local_optimization/tri_edge_collapse_quadric.h>
+#include <vcg/complex/algorithms/update/bounding.h>
+#include <vcg/space/index/grid_util.h>
+#include <vcg/container/simple_temporary_data.h>
+
+namespace vcg{
+namespace tri{
+
+/** Block source over a mesh that is already in memory.
+  It is also the reference for the interface that QuadricBlockSimplification
+  expects from a source of faces: all the methods must be callable
+  concurrently from different threads.
+  Vertices and faces are identified by their index in the containers;
+  GetFace returns false for deleted faces.
+  ImportVert and ImportFace are used both on the block meshes (QuadricBlockMesh)
+  and on the result.
+  */
+template <class MeshType>
+class MeshBlockSource
+{
+public:
+  typedef typename MeshType::CoordType CoordType;
+
+  MeshBlockSource(MeshType &_m):m(_m){}
+
+  int VN() const { return int(m.vert.size()); }
+  int FN() const { return int(m.face.size()); }
+
+  CoordType GetVert(int i) const { return m.vert[i].cP(); }
+
+  bool GetFace(int i, int v[3]) const
+  {
+    if(m.face[i].IsD()) return false;
+    for(int j=0;j<3;++j)
+      v[j]=int(m.face[i].cV(j)-&*m.vert.begin());
+    return true;
+  }
+
+  /// Copy the data of vertex (face) i of the source in the block element v (f).
+  template <class VertexType> void ImportVert(int i, VertexType &v) const { v.ImportData(m.vert[i]); }
+  template <class FaceType> void ImportFace(int i, FaceType &f) const { f.ImportData(m.face[i]); }
+
+  /// Called on the result (and on the result of the first pass) before anything is added,
+  /// e.g. to enable the optional components that have to be imported.
+  template <class BlockMeshType> void InitBlock(BlockMeshType &) const {}
+
+  MeshType &m;
+};
+
+/** The meshes where the blocks of QuadricBlockSimplification are simplified.
+  They have only what the quadric edge collapse needs, the quadric is a member of the vertex;
+  the other attributes are copied from the source when the blocks are appended to the result.
+  */
+class QuadricBlockVertex;
+class QuadricBlockFace;
+class QuadricBlockUsedTypes: public UsedTypes< Use<QuadricBlockVertex>::AsVertexType, Use<QuadricBlockFace>::AsFaceType >{};
+
+class QuadricBlockVertex : public Vertex< QuadricBlockUsedTypes, vertex::VFAdj, vertex::Coord3d, vertex::Qualityf, vertex::Mark, vertex::BitFlags >
+{
+public:
+  math::Quadric<double> &Qd() {return q;}
+private:
+  math::Quadric<double> q;
+};
+class QuadricBlockFace : public Face< QuadricBlockUsedTypes, face::VFAdj, face::VertexRef, face::BitFlags > {};
+class QuadricBlockMesh : public TriMesh< std::vector<QuadricBlockVertex>, std::vector<QuadricBlockFace> > {};
+
+/** The parameters of the simplification of a block, with the mark of its collapses. */
+class QuadricBlockParameter : public TriEdgeCollapseQuadricParameter
+{
+public:
+  QuadricBlockParameter(const TriEdgeCollapseQuadricParameter &qp):TriEdgeCollapseQuadricParameter(qp),Mark(0){}
+  int Mark;
+};
+
+/** The collapse used on the blocks. As different blocks are simplified at the same time
+  nothing static is modified: the mark is kept in the QuadricBlockParameter of the block,
+  the failure statistics are not collected and the border flags are computed without
+  reserving a user bit (as FaceBorderFromVF would do).
+  */
+class QuadricBlockCollapse : public TriEdgeCollapseQuadric< QuadricBlockMesh, BasicVertexPair<QuadricBlockVertex>, QuadricBlockCollapse, QInfoStandard<QuadricBlockVertex> >
+{
+public:
+  typedef BasicVertexPair<QuadricBlockVertex> VertexPair;
+  typedef TriEdgeCollapseQuadric< QuadricBlockMesh, VertexPair, QuadricBlockCollapse, QInfoStandard<QuadricBlockVertex> > TECQ;
+  typedef TECQ::HeapType HeapType;
+
+  inline QuadricBlockCollapse(const VertexPair &p, int i, BaseParameterClass *pp):TECQ(p,i,pp){}
+
+  static int &UpdateMark(BaseParameterClass *pp) { return static_cast<QuadricBlockParameter *>(pp)->Mark; }
+
+  static void Init(QuadricBlockMesh &m, HeapType &h_ret, BaseParameterClass *pp)
+  {
+    UpdateTopology<QuadricBlockMesh>::VertexFace(m);
+    UpdateFlags<QuadricBlockMesh>::FaceBorderFromNone(m);
+    TECQ::InitWithBorder(m,h_ret,pp);
+  }
+
+  inline bool IsUpToDate() const
+  {
+    QuadricBlockVertex *v0=this->pos.cV(0);
+    QuadricBlockVertex *v1=this->pos.cV(1);
+    return !v0->IsD() && !v1->IsD() && this->localMark >= v0->IMark() && this->localMark >= v1->IMark();
+  }
+
+  inline bool IsFeasible(BaseParameterClass *pp)
+  {
+    if(!static_cast<QParameter *>(pp)->PreserveTopology) return true;
+    return EdgeCollapser<QuadricBlockMesh,VertexPair>::LinkConditions(this->pos);
+  }
+};
+
+/** Out of core quadric edge collapse simplification.
+
+  The faces of the source are partitioned with a regular grid in blocks of about
+  BlockFaceNum faces (a face belongs to the block containing its barycenter).
+  Each block is extracted in a small mesh and simplified with the quadric edge collapse
+  while the vertices that could be shared with other blocks are kept locked;
+  the simplified blocks are then appended to the result and the locked vertices merged back.
+  A vertex is locked when some of its faces are not in its block: the number of faces
+  of each vertex is counted while scanning the source, so no connectivity is needed.
+
+  Blocks are simplified in parallel, in batches that keep in memory about MemoryBudget bytes
+  of block meshes; the source is scanned once for each batch, so a memory mapped file
+  (see wrap/io_trimesh/ply_block_source.h) is never loaded as a whole.
+  If SeamPass is set a second pass, over the in memory result of the first one and with the grid
+  shifted by half a block, simplifies the locked seams and reaches the target face number
+  (the quadrics of the second pass are computed again from the result of the first one).
+
+  The blocks are QuadricBlockMesh, whatever MeshType is: the vertices and faces of the result
+  get their attributes from the source, and the vertices their new position from the block.
+  Unreferenced vertices of the source are not copied in the result.
+  */
+template <class MeshType>
+class QuadricBlockSimplification
+{
+public:
+  typedef typename MeshType::ScalarType ScalarType;
+  typedef typename MeshType::CoordType CoordType;
+  typedef typename MeshType::VertexType VertexType;
+  typedef typename MeshType::FaceType FaceType;
+  typedef typename MeshType::VertexIterator VertexIterator;
+  typedef typename MeshType::FaceIterator FaceIterator;
+  typedef Box3<ScalarType> BoxType;
+
+  class Param
+  {
+  public:
+    int BlockFaceNum;       // (approximate) number of input faces of each block
+    size_t MemoryBudget;    // bytes of block meshes that can be in memory at the same time
+    bool SeamPass;          // simplify the seams with a second pass on a shifted grid
+    TriEdgeCollapseQuadricParameter QParam;
+
+    Param()
+    {
+      BlockFaceNum=100000;
+      MemoryBudget=size_t(512)<<20;
+      SeamPass=true;
+    }
+  };
+
+  template <class SourceType>
+  static void Do(SourceType &src, MeshType &m, int TargetFaceNum, Param &pp, CallBackPos *cb=0)
+  {
+    // The non fast boundary preservation keeps a global list of vertices
+    // that cannot be shared among threads; the fast one locks them all the same.
+    if(pp.QParam.PreserveBoundary)
+    {
+      pp.QParam.FastPreserveBoundary=true;
+      pp.QParam.PreserveBoundary=false;
+    }
+
+    m.Clear();
+    src.InitBlock(m);
+    if(!pp.SeamPass)
+    {
+      Pass(src,m,TargetFaceNum,pp,false,cb,0,100);
+      return;
+    }
+
+    // The first pass stops a bit before the target, so that the second one,
+    // where the seams are free, has to remove the dense strips along them.
+    MeshType firstPass;
+    src.InitBlock(firstPass);
+    Pass(src,firstPass,TargetFaceNum+TargetFaceNum/4,pp,false,cb,0,60);
+    SeamSource<SourceType> seamSrc(firstPass,src);
+    Pass(seamSrc,m,TargetFaceNum,pp,true,cb,60,100);
+  }
+
+protected:
+  /// Source for the second pass: the result of the first one, with the block
+  /// initialization of the original source.
+  template <class SourceType>
+  class SeamSource : public MeshBlockSource<MeshType>
+  {
+  public:
+    SeamSource(MeshType &_m, const SourceType &_src):MeshBlockSource<MeshType>(_m),src(_src){}
+    template <class BlockMeshType> void InitBlock(BlockMeshType &bm) const { src.InitBlock(bm); }
+    const SourceType &src;
+  };
+
+  /// The regular grid that defines the blocks.
+  class BlockGrid
+  {
+  public:
+    Point3<ScalarType> origin,voxel;
+    Point3i siz;
+
+    void Init(const BoxType &bb, int blockNum, bool shifted)
+    {
+      Point3<ScalarType> dim=bb.Dim();
+      BestDim((__int64)(blockNum),dim,siz);
+      origin=bb.min;
+      for(int k=0;k<3;++k)
+      {
+        if(siz[k]<1 || dim[k]<=0) siz[k]=1;
+        voxel[k]= (dim[k]>0) ? dim[k]/siz[k] : ScalarType(1);
+        if(shifted && siz[k]>1)
+        {
+          origin[k]-=voxel[k]/2;
+          ++siz[k];
+        }
+      }
+    }
+    int Size() const { return siz[0]*siz[1]*siz[2]; }
+    int CellAxis(ScalarType v, int k) const
+    {
+      int c=int(floor((v-origin[k])/voxel[k]));
+      return std::max(0,std::min(siz[k]-1,c));
+    }
+    int Cell(const Point3<ScalarType> &p) const
+    {
+      return CellAxis(p[0],0)+siz[0]*(CellAxis(p[1],1)+siz[1]*CellAxis(p[2],2));
+    }
+  };
+
+  /// A simplified block ready to be appended to the result.
+  class Block
+  {
+  public:
+    QuadricBlockMesh m;
+    std::vector<int> globalInd;   // source index of each vertex of m
+    std::vector<int> faceInd;     // source index of each face of m
+    std::vector<bool> locked;     // vertices that can be shared with other blocks
+  };
+
+  static void SimplifyBlock(QuadricBlockMesh &bm, int TargetFaceNum, const TriEdgeCollapseQuadricParameter &qp)
+  {
+    QuadricBlockParameter bp(qp);
+    LocalOptimization<QuadricBlockMesh> DeciSession(bm,&bp);
+    DeciSession.template Init<QuadricBlockCollapse>();
+    DeciSession.SetTargetSimplices(TargetFaceNum);
+    DeciSession.DoOptimization();
+    DeciSession.template Finalize<QuadricBlockCollapse>();
+  }
+
+  template <class SourceType>
+  static void Pass(SourceType &src, MeshType &m, int TargetFaceNum, Param &pp, bool shifted,
+                   CallBackPos *cb, int cbStart, int cbEnd)
+  {
+    const int fn=src.FN();
+    const int chunkSize=65536;
+    const int chunkNum=(fn+chunkSize-1)/chunkSize;
+
+    // 1) bounding box of the faces and number of faces of each vertex.
+    BoxType bb;
+    int liveFn=0;
+    std::vector<int> valence(src.VN(),0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      BoxType lbb;
+      int lfn=0;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int i=0;i<fn;++i)
+      {
+        int v[3];
+        if(!src.GetFace(i,v)) continue;
+        for(int j=0;j<3;++j)
+        {
+          CoordType p;
+          p.Import(src.GetVert(v[j]));
+          lbb.Add(p);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+          ++valence[v[j]];
+        }
+        ++lfn;
+      }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      {
+        bb.Add(lbb);
+        liveFn+=lfn;
+      }
+    }
+    if(liveFn==0) return;
+
+    BlockGrid g;
+    g.Init(bb,std::max(1,liveFn/std::max(1,pp.BlockFaceNum)),shifted);
+
+    // 2) number of faces of each block, to pack the blocks in batches.
+    std::vector<int> blockFn(g.Size(),0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<int> lblockFn(g.Size(),0);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for(int i=0;i<fn;++i)
+      {
+        int v[3];
+        if(src.GetFace(i,v)) ++lblockFn[BarycenterCell(src,g,v)];
+      }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      for(int b=0;b<g.Size();++b) blockFn[b]+=lblockFn[b];
+    }
+
+    const size_t faceBytes=sizeof(QuadricBlockFace)+sizeof(QuadricBlockVertex)+128; // rough size of a face and its share of vertices and heap
+    std::vector<std::pair<int,int> > seam; // (source index, index in m) of the locked vertices
+    int doneFn=0;
+    int b0=0;
+    while(b0<g.Size())
+    {
+      // 3) the next batch of blocks [b0,b1)
+      int b1=b0;
+      size_t batchBytes=0;
+      while(b1<g.Size() && (b1==b0 || batchBytes+blockFn[b1]*faceBytes<=pp.MemoryBudget))
+        batchBytes+=blockFn[b1++]*faceBytes;
+
+      // 4) scan the source collecting the faces of the blocks of the batch,
+      // chunk by chunk so that the order of the faces does not depend on the threads.
+      std::vector<std::vector<std::pair<int,int> > > chunkFaces(chunkNum);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for(int c=0;c<chunkNum;++c)
+      {
+        const int end=std::min(fn,(c+1)*chunkSize);
+        for(int i=c*chunkSize;i<end;++i)
+        {
+          int v[3];
+          if(!src.GetFace(i,v)) continue;
+          int b=BarycenterCell(src,g,v);
+          if(b>=b0 && b<b1) chunkFaces[c].push_back(std::make_pair(b-b0,i));
+        }
+      }
+      std::vector<std::vector<int> > blockFaces(b1-b0);
+      for(int b=b0;b<b1;++b) blockFaces[b-b0].reserve(blockFn[b]);
+      for(int c=0;c<chunkNum;++c)
+      {
+        for(size_t k=0;k<chunkFaces[c].size();++k)
+          blockFaces[chunkFaces[c][k].first].push_back(chunkFaces[c][k].second);
+        std::vector<std::pair<int,int> >().swap(chunkFaces[c]);
+      }
+
+      // 5) extract and simplify the blocks.
+      std::vector<Block *> blocks(b1-b0,(Block *)0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for(int b=b0;b<b1;++b)
+      {
+        if(blockFaces[b-b0].empty()) continue;
+        Block *bl=new Block();
+        bl->faceInd.swap(blockFaces[b-b0]);
+        ExtractBlock(src,valence,*bl);
+
+        int blockTarget=int(double(bl->m.fn)*TargetFaceNum/liveFn+0.5);
+        tri::UpdateBounding<QuadricBlockMesh>::Box(bl->m);
+        SimplifyBlock(bl->m,blockTarget,pp.QParam);
+        blocks[b-b0]=bl;
+      }
+
+      // 6) append them to the result, in order.
+      for(int b=b0;b<b1;++b)
+      {
+        if(blocks[b-b0]==0) continue;
+        doneFn+=blockFn[b];
+        AppendBlock(src,m,*blocks[b-b0],seam);
+        delete blocks[b-b0];
+      }
+      if(cb) cb(cbStart+int((cbEnd-cbStart)*double(doneFn)/liveFn),"Simplifying blocks...");
+      b0=b1;
+    }
+
+    MergeSeam(m,seam);
+  }
+
+  template <class SourceType>
+  static int BarycenterCell(const SourceType &src, const BlockGrid &g, const int v[3])
+  {
+    CoordType p[3];
+    for(int j=0;j<3;++j) p[j].Import(src.GetVert(v[j]));
+    return g.Cell((p[0]+p[1]+p[2])/ScalarType(3));
+  }
+
+  template <class SourceType>
+  static void ExtractBlock(const SourceType &src, const std::vector<int> &valence, Block &bl)
+  {
+    QuadricBlockMesh &bm=bl.m;
+    const std::vector<int> &faceInd=bl.faceInd;
+    std::vector<int> &gv=bl.globalInd;
+    gv.reserve(faceInd.size()*3);
+    std::vector<int> fv(faceInd.size()*3);
+    for(size_t i=0;i<faceInd.size();++i)
+    {
+      src.GetFace(faceInd[i],&fv[i*3]);
+      gv.push_back(fv[i*3]); gv.push_back(fv[i*3+1]); gv.push_back(fv[i*3+2]);
+    }
+    std::sort(gv.begin(),gv.end());
+    gv.erase(std::unique(gv.begin(),gv.end()),gv.end());
+    std::vector<int>(gv).swap(gv);
+
+    QuadricBlockMesh::VertexIterator vi=Allocator<QuadricBlockMesh>::AddVertices(bm,int(gv.size()));
+    for(size_t k=0;k<gv.size();++k,++vi)
+    {
+      src.ImportVert(gv[k],*vi);
+      (*vi).ClearD();
+      (*vi).SetW();
+    }
+
+    std::vector<int> localValence(gv.size(),0);
+    QuadricBlockMesh::FaceIterator fi=Allocator<QuadricBlockMesh>::AddFaces(bm,int(faceInd.size()));
+    for(size_t i=0;i<faceInd.size();++i,++fi)
+    {
+      src.ImportFace(faceInd[i],*fi);
+      (*fi).ClearD();
+      for(int j=0;j<3;++j)
+      {
+        int k=int(std::lower_bound(gv.begin(),gv.end(),fv[i*3+j])-gv.begin());
+        (*fi).V(j)=&bm.vert[k];
+        ++localValence[k];
+      }
+    }
+
+    // Locked if some of its faces belong to other blocks.
+    bl.locked.resize(gv.size());
+    for(size_t k=0;k<gv.size();++k)
+    {
+      bl.locked[k]= localValence[k]<valence[gv[k]];
+      if(bl.locked[k]) bm.vert[k].ClearW();
+    }
+  }
+
+  template <class SourceType>
+  static void AppendBlock(const SourceType &src, MeshType &m, Block &bl, std::vector<std::pair<int,int> > &seam)
+  {
+    QuadricBlockMesh &bm=bl.m;
+    // vertices left without faces (e.g. locked vertices whose faces were all collapsed) are skipped.
+    std::vector<int> remap(bm.vert.size(),-1);
+    for(QuadricBlockMesh::FaceIterator fi=bm.face.begin();fi!=bm.face.end();++fi) if(!(*fi).IsD())
+      for(int j=0;j<3;++j) remap[tri::Index(bm,(*fi).V(j))]=0;
+    int vn=0;
+    for(size_t k=0;k<bm.vert.size();++k)
+      if(remap[k]==0 && !bm.vert[k].IsD()) remap[k]=vn++;
+      else remap[k]=-1;
+
+    int firstV=int(m.vert.size());
+    VertexIterator vi=Allocator<MeshType>::AddVertices(m,vn);
+    for(size_t k=0;k<bm.vert.size();++k) if(remap[k]>=0)
+    {
+      src.ImportVert(bl.globalInd[k],*vi);
+      (*vi).P().Import(bm.vert[k].cP());
+      (*vi).ClearD();
+      if(bl.locked[k])
+      {
+        (*vi).SetW();
+        seam.push_back(std::make_pair(bl.globalInd[k],firstV+remap[k]));
+      }
+      ++vi;
+    }
+    FaceIterator fi=Allocator<MeshType>::AddFaces(m,bm.fn);
+    for(size_t i=0;i<bm.face.size();++i) if(!bm.face[i].IsD())
+    {
+      src.ImportFace(bl.faceInd[i],*fi);
+      (*fi).ClearD();
+      for(int j=0;j<3;++j)
+        (*fi).V(j)=&m.vert[firstV+remap[tri::Index(bm,bm.face[i].V(j))]];
+      ++fi;
+    }
+  }
+
+  /// Merge the copies of the locked vertices, that are identical as they have not been touched.
+  static void MergeSeam(MeshType &m, std::vector<std::pair<int,int> > &seam)
+  {
+    std::sort(seam.begin(),seam.end());
+    std::vector<int> redirect(m.vert.size(),-1);
+    for(size_t i=0;i<seam.size();)
+    {
+      size_t j=i+1;
+      for(;j<seam.size() && seam[j].first==seam[i].first;++j)
+      {
+        redirect[seam[j].second]=seam[i].second;
+        Allocator<MeshType>::DeleteVertex(m,m.vert[seam[j].second]);
+      }
+      i=j;
+    }
+    for(FaceIterator fi=m.face.begin();fi!=m.face.end();++fi) if(!(*fi).IsD())
+      for(int j=0;j<3;++j)
+      {
+        int r=redirect[tri::Index(m,(*fi).V(j))];
+        if(r>=0) (*fi).V(j)=&m.vert[r];
+      }
+    Allocator<MeshType>::CompactVertexVector(m);
+    tri::UpdateBounding<MeshType>::Box(m);
+  }
+};
+
+} // end namespace tri
+} // end namespace vcg
+#endif
@@ -1175,13 +1175,133 @@ static void ComputePoissonSampleRadii(MetroMesh &sampleMesh, ScalarType diskRadi
 	}
 }
 
+// Uniform grid used by PoissonDiskPruning.
+// The samples are sorted by cell, so that each non empty cell is a contiguous range of the sample vector;
+// removing a sample just marks it. Cells are found by binary search on their (sorted) linear index.
+struct PruningGrid
+{
+  BasicGrid<ScalarType> grid;
+  std::vector<VertexPointer> sample;     // samples sorted by cell
+  std::vector<char> removed;             // for each sample, true if it has been removed
+  std::vector<long long> cellKey;        // linear index of each non empty cell, sorted
+  std::vector<Point3i> cellPos;          // integer coords of each non empty cell
+  std::vector<int> cellStart;            // samples of the i-th cell are in [cellStart[i], cellStart[i+1])
+  std::vector<int> cellFirst;            // no sample of the i-th cell before cellFirst[i] is still alive
+
+  long long Key(const Point3i &pi) const
+  {
+    return (((long long)(pi[2])*(grid.siz[1]+1)) + pi[1])*(grid.siz[0]+1) + pi[0];
+  }
+
+  void Init(MetroMesh &m, const BoxType &bb, const Point3i &gridsize)
+  {
+    grid.bbox=bb;
+    grid.siz=gridsize;
+    grid.ComputeDimAndVoxel();
+
+    std::vector<VertexPointer> vertVec;
+    for (VertexIterator vi = m.vert.begin(); vi != m.vert.end(); vi++)
+      if(!(*vi).IsD()) vertVec.push_back(&*vi);
+
+    // sort by (cell, position in the mesh): the first sample of a cell is the first one in the mesh order
+    std::vector< std::pair<long long,int> > keyVec(vertVec.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for(int i=0;i<int(vertVec.size());++i)
+      keyVec[i]=std::make_pair(Key(grid.GridP(vertVec[i]->cP())),i);
+    SortKeys(keyVec);
+
+    sample.resize(vertVec.size());
+    removed.assign(vertVec.size(),0);
+    cellKey.clear(); cellPos.clear(); cellStart.clear();
+    for(size_t i=0;i<keyVec.size();++i)
+    {
+      sample[i]=vertVec[keyVec[i].second];
+      if(cellKey.empty() || cellKey.back()!=keyVec[i].first)
+      {
+        cellKey.push_back(keyVec[i].first);
+        cellPos.push_back(grid.GridP(sample[i]->cP()));
+        cellStart.push_back(int(i));
+      }
+    }
+    cellStart.push_back(int(sample.size()));
+    cellFirst.assign(cellStart.begin(),cellStart.end()-1);
+  }
+
+  // parallel sort of the keys: blocks are sorted independently and then merged pairwise.
+  // Keys are all different, so the result does not depend on the number of blocks.
+  static void SortKeys(std::vector< std::pair<long long,int> > &keyVec)
+  {
+    const int blockNum = std::max(1,std::min(64,int(keyVec.size()/65536)));
+    std::vector<size_t> bound(blockNum+1);
+    for(int b=0;b<=blockNum;++b) bound[b]=keyVec.size()*b/blockNum;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+    for(int b=0;b<blockNum;++b)
+      std::sort(keyVec.begin()+bound[b],keyVec.begin()+bound[b+1]);
+    for(int step=1;step<blockNum;step*=2)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+      for(int b=0;b<blockNum-step;b+=2*step)
+        std::inplace_merge(keyVec.begin()+bound[b],keyVec.begin()+bound[b+step],keyVec.begin()+bound[std::min(b+2*step,blockNum)]);
+    }
+  }
+
+  // returns the first alive sample of the i-th cell, or -1 if the cell is empty
+  int FirstAlive(int i)
+  {
+    while(cellFirst[i]<cellStart[i+1] && removed[cellFirst[i]]) ++cellFirst[i];
+    return (cellFirst[i]<cellStart[i+1]) ? cellFirst[i] : -1;
+  }
+
+  // removes all the samples closer than radius to p (using the approximate geodesic distance if geodesicFlag);
+  // only the cells overlapping both the box of side 2*radius around p and the cell range bound are touched.
+  int RemoveInSphere(const CoordType &p, const CoordType &n, bool geodesicFlag, ScalarType radius, const Box3i &bound)
+  {
+    Box3i ib;
+    grid.BoxToIBox(BoxType(p-CoordType(radius,radius,radius),p+CoordType(radius,radius,radius)),ib);
+    ib.Intersect(bound);
+    ib.Intersect(Box3i(Point3i(0,0,0),grid.siz));
+    if(ib.IsNull()) return 0;
+    vertex::ApproximateGeodesicDistanceFunctor<VertexType> GDF;
+    const ScalarType r2=radius*radius;
+    int cnt=0;
+    for(int z=ib.min[2];z<=ib.max[2];++z)
+      for(int y=ib.min[1];y<=ib.max[1];++y)
+      {
+        // the cells of a row along x are consecutive in the key order
+        const long long lastKey = Key(Point3i(ib.max[0],y,z));
+        int ci = int(std::lower_bound(cellKey.begin(),cellKey.end(),Key(Point3i(ib.min[0],y,z)))-cellKey.begin());
+        for(;ci<int(cellKey.size()) && cellKey[ci]<=lastKey;++ci)
+          for(int si=cellFirst[ci];si<cellStart[ci+1];++si)
+          {
+            if(removed[si]) continue;
+            const VertexType &v = *sample[si];
+            bool inside = geodesicFlag ? GDF(p,n,v.cP(),v.cN()) <= radius
+                            : SquaredDistance(p,v.cP()) <= r2;
+            if(inside) { removed[si]=1; ++cnt; }
+          }
+      }
+    return cnt;
+  }
+};
+
 // Trivial approach that puts all the samples in a UG and removes all the ones that surely do not fit the
+// Poisson-disk constraint.
+//
+// At each round every non empty cell contributes its first surviving sample, that removes all the samples
+// within its radius. Two cells whose integer coords differ by more than twice the (maximum) radius in voxels
+// along some axis cannot touch the same samples, so the cells are split in phase groups by their coords
+// modulo that stride and the cells of a group are processed in parallel; groups are processed one after
+// the other, in random order. The result does not depend on the number of threads.
 static void PoissonDiskPruning(VertexSampler &ps, MetroMesh &montecarloMesh,
                                ScalarType diskRadius, const struct PoissonDiskParam pp=PoissonDiskParam())
 {
-    // spatial index of montecarlo samples - used to choose a new sample to insert
-    MontecarloSHT montecarloSHT;
-    // initialize spatial hash table for searching
+    // initialize the grid
     // radius is the radius of empty disk centered over the samples (e.g. twice of the empty space disk)
     // This radius implies that when we pick a sample in a cell all that cell will not be touched again.
     ScalarType cellsize = 2.0f* diskRadius / sqrt(3.0);
@@ -1202,47 +1322,86 @@ static void PoissonDiskPruning(VertexSampler &ps, MetroMesh &montecarloMesh,
     if(pp.adaptiveRadiusFlag)
         ComputePoissonSampleRadii(montecarloMesh, diskRadius, pp.radiusVariance, pp.invertQuality);
 
-    montecarloSHT.InitEmpty(bb, gridsize);
-
-    for (VertexIterator vi = montecarloMesh.vert.begin(); vi != montecarloMesh.vert.end(); vi++)
-        montecarloSHT.Add(&(*vi));
-
-    montecarloSHT.UpdateAllocatedCells();
+    PruningGrid pg;
+    pg.Init(montecarloMesh, bb, gridsize);
+    const int cellNum = int(pg.cellKey.size());
 
+    // largest radius used to remove samples, it gives the stride of the phase groups
+    ScalarType maxRadius = diskRadius;
+    if(pp.adaptiveRadiusFlag)
+      for(size_t i=0;i<pg.sample.size();++i)
+        maxRadius = std::max(maxRadius, pg.sample[i]->cQ());
+    Point3i reach, stride;
+    for(int k=0;k<3;++k)
+    {
+      reach[k] = int(ceil(maxRadius/pg.grid.voxel[k]));
+      stride[k] = 2*reach[k]+1;
+    }
+    const int phaseNum = stride[0]*stride[1]*stride[2];
+    std::vector< std::vector<int> > phaseCells(phaseNum);
+    for(int i=0;i<cellNum;++i)
+    {
+      const Point3i &pi = pg.cellPos[i];
+      phaseCells[(pi[2]%stride[2]*stride[1] + pi[1]%stride[1])*stride[0] + pi[0]%stride[0]].push_back(i);
+    }
+    std::vector<int> phaseOrder(phaseNum);
+    for(int i=0;i<phaseNum;++i) phaseOrder[i]=i;
 
-    unsigned int (*p_myrandom)(unsigned int) = RandomInt;
-    std::random_shuffle(montecarloSHT.AllocatedCells.begin(),montecarloSHT.AllocatedCells.end(), p_myrandom);
     int t1 = clock();
     if(pp.pds) {
-      pp.pds->gridCellNum = (int)montecarloSHT.AllocatedCells.size();
+      pp.pds->gridCellNum = cellNum;
       pp.pds->montecarloSampleNum = montecarloMesh.vn;
     }
-    int removedCnt=0;
     if(pp.preGenFlag)
     {
-      // Initial pass for pruning the Hashed grid with the an eventual pre initialized set of samples
+      // Initial pass for pruning the grid with the an eventual pre initialized set of samples
       for(VertexIterator vi =pp.preGenMesh->vert.begin(); vi!=pp.preGenMesh->vert.end();++vi)
       {
         ps.AddVert(*vi);
-        removedCnt += montecarloSHT.RemoveInSphere(vi->cP(),diskRadius);
+        pg.RemoveInSphere(vi->cP(),vi->cN(),false,diskRadius,Box3i(Point3i(0,0,0),gridsize));
       }
-      montecarloSHT.UpdateAllocatedCells();
     }
-    vertex::ApproximateGeodesicDistanceFunctor<VertexType> GDF;
-    while(!montecarloSHT.AllocatedCells.empty())
+
+    std::vector<int> picked;
+    bool emptyFlag=false;
+    while(!emptyFlag)
     {
-        removedCnt=0;
-        for (size_t i = 0; i < montecarloSHT.AllocatedCells.size(); i++)
+      unsigned int (*p_myrandom)(unsigned int) = RandomInt;
+      std::random_shuffle(phaseOrder.begin(),phaseOrder.end(), p_myrandom);
+      for(int pi=0;pi<phaseNum;++pi)
+      {
+        const std::vector<int> &cells = phaseCells[phaseOrder[pi]];
+        picked.resize(cells.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,64)
+#endif
+        for(int i=0;i<int(cells.size());++i)
         {
-            if( montecarloSHT.EmptyCell(montecarloSHT.AllocatedCells[i])  ) continue;
-            VertexPointer sp = getPrecomputedMontecarloSample(montecarloSHT.AllocatedCells[i], montecarloSHT);
-            ps.AddVert(*sp);
-            ScalarType sampleRadius = diskRadius;
-            if(pp.adaptiveRadiusFlag)  sampleRadius = sp->Q();
-            if(pp.geodesicDistanceFlag) removedCnt += montecarloSHT.RemoveInSphereNormal(sp->cP(),sp->cN(),GDF,sampleRadius);
-                            else        removedCnt += montecarloSHT.RemoveInSphere(sp->cP(),sampleRadius);
+          int si = pg.FirstAlive(cells[i]);
+          picked[i]=si;
+          if(si<0) continue;
+          VertexPointer sp = pg.sample[si];
+          ScalarType sampleRadius = diskRadius;
+          if(pp.adaptiveRadiusFlag)  sampleRadius = sp->Q();
+          // the bound keeps the cells touched by this sample within its phase stride (it matters only for rounding)
+          const Point3i &cp = pg.cellPos[cells[i]];
+          pg.RemoveInSphere(sp->cP(), sp->cN(), pp.geodesicDistanceFlag, sampleRadius, Box3i(cp-reach,cp+reach));
         }
-        montecarloSHT.UpdateAllocatedCells();
+        for(size_t i=0;i<cells.size();++i)
+          if(picked[i]>=0) ps.AddVert(*pg.sample[picked[i]]);
+      }
+
+      // drop the cells that have been emptied
+      emptyFlag=true;
+      for(int ph=0;ph<phaseNum;++ph)
+      {
+        std::vector<int> &cells = phaseCells[ph];
+        size_t cnt=0;
+        for(size_t i=0;i<cells.size();++i)
+          if(pg.FirstAlive(cells[i])>=0) cells[cnt++]=cells[i];
+        cells.resize(cnt);
+        if(cnt>0) emptyFlag=false;
+      }
     }
     int t2 = clock();
     if(pp.pds)
@@ -37,26 +37,42 @@ public:
 
   static void ComputeUndirectedNormal(MeshType &m, int nn, float maxDist, KdTree<float> &tree,vcg::CallBackPos * cb=0)
   {
-    tree.setMaxNofNeighbors(nn);
-    int cnt=0;
-    int step=m.vn/100;
-    for (VertexIterator vi=m.vert.begin();vi!=m.vert.end();++vi)
+    // the vertices are processed in blocks (to report the progress from the main thread),
+    // the vertices of a block in parallel, each thread with its own query context
+    const int vertNum=int(m.vert.size());
+    const int blockSize=std::max(1024,vertNum/100);
+    for (int blockStart=0;blockStart<vertNum;blockStart+=blockSize)
     {
-        tree.doQueryK(vi->cP());
-        if(cb && (++cnt%step)==0) cb(cnt/step,"Fitting planes");
-
-        int neighbours = tree.getNofFoundNeighbors();
+      const int blockEnd=std::min(vertNum,blockStart+blockSize);
+      if(cb) cb((100*blockStart)/vertNum,"Fitting planes");
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        KdTree<float>::QueryContext ctx(nn);
         std::vector<CoordType> ptVec;
-
-        for (int i = 0; i < neighbours; i++)
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,256)
+#endif
+        for (int vInd=blockStart;vInd<blockEnd;++vInd)
         {
-            int neightId = tree.getNeighborId(i);
-            if(Distance(vi->cP(),m.vert[neightId].cP())<maxDist)
-            ptVec.push_back(m.vert[neightId].cP());
+          VertexPointer vp=&m.vert[vInd];
+          tree.doQueryK(vp->cP(),ctx);
+
+          int neighbours = ctx.getNofFoundNeighbors();
+          ptVec.clear();
+
+          for (int i = 0; i < neighbours; i++)
+          {
+              int neightId = ctx.getNeighborId(i);
+              if(Distance(vp->cP(),m.vert[neightId].cP())<maxDist)
+              ptVec.push_back(m.vert[neightId].cP());
+          }
+          Plane3f plane;
+          FitPlaneToPointSet(ptVec,plane);
+          vp->N()=plane.Direction();
         }
-        Plane3f plane;
-        FitPlaneToPointSet(ptVec,plane);
-        vi->N()=plane.Direction();
+      }
     }
   }
 
@@ -34,6 +34,8 @@
 #include <vcg/complex/algorithms/update/halfedge_topology.h>
 #include <vcg/complex/algorithms/closest.h>
 #include <vcg/space/index/kdtree/kdtree.h>
+#include <vector>
+#include <algorithm>
 
 
 namespace vcg
@@ -260,21 +262,207 @@ static void AccumulateLaplacianInfo(MeshType &m, SimpleTempData<typename MeshTyp
 			}
 }
 
+/** Compact (CSR) vertex-vertex adjacency used by the laplacian smoothing functions.
+  It is built once from the faces and their border flags and can be reused by many iterations and by
+  different smoothing functions, as long as the faces and their border flags do not change.
+  The laplacians are computed by gathering, for each vertex, the values of its adjacent vertices from a
+  contiguous copy of them, so that all the vertices can be processed in parallel.
+  Vertex i gathers from Nbr[Start[i]..Start[i+1]) with integer weights W, the number of times each edge
+  was counted by the scatter over the faces (AccumulateLaplacianInfo), whose sum is WSum[i]:
+  - LaplacianMode: a vertex on a border edge (Border[i]) gathers only from its neighbours along the border,
+    so a border is smoothed only along itself; the other vertices from all their neighbours.
+  - CotangentMode: as LaplacianMode, but the repeated edges are not merged and FaceEdge keeps the face edge
+    (3*face+edge) of each entry, whose cotangent weight has to be computed at each iteration.
+  - HCMode: every edge counts once for each face, and border edges twice.
+*/
+class LaplacianAdjacency
+{
+public:
+  enum { LaplacianMode, CotangentMode, HCMode };
+
+  int Mode;
+  std::vector<int> Start;
+  std::vector<int> Nbr;
+  std::vector<int> W;
+  std::vector<int> WSum;
+  std::vector<int> FaceEdge;
+  std::vector<char> Border;
+
+  LaplacianAdjacency():Mode(LaplacianMode) {}
+  LaplacianAdjacency(MeshType &m, int mode=LaplacianMode) { Build(m,mode); }
+
+  void Build(MeshType &m, int mode=LaplacianMode)
+  {
+    Mode=mode;
+    const int vn=int(m.vert.size());
+    const int fn=int(m.face.size());
+    Border.assign(vn,0);
+    if(Mode!=HCMode)
+      for(int f=0;f<fn;++f) if(!m.face[f].IsD())
+        for(int j=0;j<3;++j) if(m.face[f].IsB(j))
+          Border[tri::Index(m,m.face[f].V0(j))]=Border[tri::Index(m,m.face[f].V1(j))]=1;
+
+    // the neighbours gathered by each vertex, repeated as many times as they are counted
+    std::vector<int> rawStart(vn+1,0);
+    for(int f=0;f<fn;++f) if(!m.face[f].IsD())
+      for(int j=0;j<3;++j)
+      {
+        const bool eb=m.face[f].IsB(j);
+        rawStart[tri::Index(m,m.face[f].V0(j))+1]+=Count(eb,tri::Index(m,m.face[f].V0(j)));
+        rawStart[tri::Index(m,m.face[f].V1(j))+1]+=Count(eb,tri::Index(m,m.face[f].V1(j)));
+      }
+    for(int i=0;i<vn;++i) rawStart[i+1]+=rawStart[i];
+    std::vector<int> raw(rawStart[vn]);
+    std::vector<int> rawFaceEdge(Mode==CotangentMode ? rawStart[vn] : 0);
+    std::vector<int> pos(rawStart.begin(),rawStart.end()-1);
+    for(int f=0;f<fn;++f) if(!m.face[f].IsD())
+      for(int j=0;j<3;++j)
+      {
+        const bool eb=m.face[f].IsB(j);
+        const int v0=int(tri::Index(m,m.face[f].V0(j)));
+        const int v1=int(tri::Index(m,m.face[f].V1(j)));
+        for(int k=Count(eb,v0);k>0;--k) { if(Mode==CotangentMode) rawFaceEdge[pos[v0]]=3*f+j; raw[pos[v0]++]=v1; }
+        for(int k=Count(eb,v1);k>0;--k) { if(Mode==CotangentMode) rawFaceEdge[pos[v1]]=3*f+j; raw[pos[v1]++]=v0; }
+      }
+
+    WSum.resize(vn);
+    for(int i=0;i<vn;++i) WSum[i]=rawStart[i+1]-rawStart[i];
+    if(Mode==CotangentMode)
+    {
+      Start.swap(rawStart);
+      Nbr.swap(raw);
+      FaceEdge.swap(rawFaceEdge);
+      W.assign(Nbr.size(),1);
+      return;
+    }
+    FaceEdge.clear();
+
+    // sort the neighbours of each vertex and merge the repeated ones into the weights
+    Start.assign(vn+1,0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1024)
+#endif
+    for(int i=0;i<vn;++i)
+    {
+      std::sort(raw.begin()+rawStart[i],raw.begin()+rawStart[i+1]);
+      int uniq=0;
+      for(int r=rawStart[i];r<rawStart[i+1];++r)
+        if(r==rawStart[i] || raw[r]!=raw[r-1]) ++uniq;
+      Start[i+1]=uniq;
+    }
+    for(int i=0;i<vn;++i) Start[i+1]+=Start[i];
+    Nbr.resize(Start[vn]);
+    W.resize(Start[vn]);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1024)
+#endif
+    for(int i=0;i<vn;++i)
+    {
+      int k=Start[i];
+      for(int r=rawStart[i];r<rawStart[i+1];++r)
+        if(r==rawStart[i] || raw[r]!=raw[r-1]) { Nbr[k]=raw[r]; W[k]=1; ++k; }
+        else ++W[k-1];
+    }
+  }
+
+  /// Weighted sum of the values of the neighbours of vertex i; val is indexed as the vertices of the mesh.
+  template <class ValueType>
+  ValueType Gather(const std::vector<ValueType> &val, int i, ValueType sum) const
+  {
+    for(int k=Start[i];k<Start[i+1];++k)
+      sum+=val[Nbr[k]]*W[k];
+    return sum;
+  }
+
+private:
+  // how many times vertex v gathers from the other endpoint of an edge
+  int Count(bool edgeBorder, size_t v) const
+  {
+    if(Mode==HCMode) return edgeBorder ? 2 : 1;
+    return (!Border[v] || edgeBorder) ? 1 : 0;
+  }
+};
+
+// Contiguous copy of the vertex positions, read by the gather kernels while the vertices are updated.
+static void CopyVertexCoord(MeshType &m, std::vector<CoordType> &pos)
+{
+  const int vn=int(m.vert.size());
+  pos.resize(vn);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int i=0;i<vn;++i)
+    pos[i]=m.vert[i].cP();
+}
+
+// The laplacian sum of the positions around vertex i, with the same values of AccumulateLaplacianInfo:
+// the vertices on a border edge also count their own position. Returns false if there is nothing to average.
+// In CotangentMode the weights of the face edges are taken from cotW.
+static bool LaplacianCoordSum(const LaplacianAdjacency &adj, const std::vector<CoordType> &pos, const std::vector<ScalarType> &cotW,
+                              int i, CoordType &sum, ScalarType &cnt)
+{
+  sum=CoordType(0,0,0);
+  cnt=0;
+  if(adj.Mode==LaplacianAdjacency::CotangentMode && !adj.Border[i])
+  {
+    for(int k=adj.Start[i];k<adj.Start[i+1];++k)
+    {
+      sum+=pos[adj.Nbr[k]]*cotW[adj.FaceEdge[k]];
+      cnt+=cotW[adj.FaceEdge[k]];
+    }
+  }
+  else
+  {
+    sum=adj.Gather(pos,i,sum);
+    cnt=ScalarType(adj.WSum[i]);
+  }
+  if(adj.Border[i]) { sum+=pos[i]; cnt+=1; }
+  return cnt>0;
+}
+
+// Cotangent weight of each face edge, as computed by AccumulateLaplacianInfo.
+static void CotangentWeights(MeshType &m, std::vector<ScalarType> &cotW)
+{
+  const int fn=int(m.face.size());
+  cotW.resize(3*fn);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int f=0;f<fn;++f)
+    if(!m.face[f].IsD())
+      for(int j=0;j<3;++j)
+      {
+        const FaceType &fc=m.face[f];
+        float angle = Angle(fc.cP1(j)-fc.cP2(j),fc.cP0(j)-fc.cP2(j));
+        cotW[3*f+j] = tan(M_PI_2 - angle);
+      }
+}
+
 static void VertexCoordLaplacian(MeshType &m, int step, bool SmoothSelected=false, bool cotangentWeight=false, vcg::CallBackPos * cb=0)
 {
-  VertexIterator vi;
-	LaplacianInfo lpz(CoordType(0,0,0),0);
-	SimpleTempData<typename MeshType::VertContainer,LaplacianInfo > TD(m.vert,lpz);
-	for(int i=0;i<step;++i)
+	LaplacianAdjacency adj(m, cotangentWeight ? LaplacianAdjacency::CotangentMode : LaplacianAdjacency::LaplacianMode);
+	VertexCoordLaplacian(m,adj,step,SmoothSelected,cb);
+}
+
+static void VertexCoordLaplacian(MeshType &m, const LaplacianAdjacency &adj, int step, bool SmoothSelected=false, vcg::CallBackPos * cb=0)
+{
+	const int vn=int(m.vert.size());
+	std::vector<CoordType> pos;
+	std::vector<ScalarType> cotW;
+	for(int s=0;s<step;++s)
 		{
-			if(cb)cb(100*i/step, "Classic Laplacian Smoothing");
-			TD.Init(lpz);
-			AccumulateLaplacianInfo(m,TD,cotangentWeight);
-			for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-				if(!(*vi).IsD() && TD[*vi].cnt>0 )
+			if(cb)cb(100*s/step, "Classic Laplacian Smoothing");
+			CopyVertexCoord(m,pos);
+			if(adj.Mode==LaplacianAdjacency::CotangentMode) CotangentWeights(m,cotW);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for(int i=0;i<vn;++i)
+				if(!m.vert[i].IsD() && (!SmoothSelected || m.vert[i].IsS()))
 				{
-							if(!SmoothSelected || (*vi).IsS())
-									(*vi).P() = ( (*vi).P() + TD[*vi].sum)/(TD[*vi].cnt+1);
+					CoordType sum; ScalarType cnt;
+					if(LaplacianCoordSum(adj,pos,cotW,i,sum,cnt))
+						m.vert[i].P() = ( pos[i] + sum)/(cnt+1);
 				}
 		}
 }
@@ -333,23 +521,36 @@ static void VertexCoordPlanarLaplacian(MeshType &m, int step, float AngleThrRad
 
 static void VertexCoordLaplacianBlend(MeshType &m, int step, float alpha, bool SmoothSelected=false)
 {
-	VertexIterator vi;
-	LaplacianInfo lpz(CoordType(0,0,0),0);
-	assert (alpha<= 1.0);
-	SimpleTempData<typename MeshType::VertContainer,LaplacianInfo > TD(m.vert);
+	LaplacianAdjacency adj(m);
+	VertexCoordLaplacianBlend(m,adj,step,alpha,SmoothSelected);
+}
 
+static void VertexCoordLaplacianBlend(MeshType &m, const LaplacianAdjacency &adj, int step, float alpha, bool SmoothSelected=false)
+{
+	assert (alpha<= 1.0);
 	for(int i=0;i<step;++i)
+		VertexCoordLaplacianStep(m,adj,alpha,SmoothSelected);
+}
+
+// Move each vertex by factor times its laplacian, computed on the positions at the start of the step.
+static void VertexCoordLaplacianStep(MeshType &m, const LaplacianAdjacency &adj, ScalarType factor, bool SmoothSelected)
+{
+	const int vn=int(m.vert.size());
+	std::vector<CoordType> pos;
+	std::vector<ScalarType> cotW;
+	CopyVertexCoord(m,pos);
+	if(adj.Mode==LaplacianAdjacency::CotangentMode) CotangentWeights(m,cotW);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	for(int i=0;i<vn;++i)
+		if(!m.vert[i].IsD() && (!SmoothSelected || m.vert[i].IsS()))
 		{
-		TD.Init(lpz);
-		AccumulateLaplacianInfo(m,TD);
-		for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-			if(!(*vi).IsD() && TD[*vi].cnt>0 )
+			CoordType sum; ScalarType cnt;
+			if(LaplacianCoordSum(adj,pos,cotW,i,sum,cnt))
 			{
-				if(!SmoothSelected || (*vi).IsS())
-				{
-					CoordType Delta = TD[*vi].sum/TD[*vi].cnt - (*vi).P();
-					(*vi).P() = (*vi).P() + Delta*alpha;
-				}
+				CoordType Delta = sum/cnt - pos[i];
+				m.vert[i].P() = pos[i] + Delta*factor;
 			}
 		}
 }
@@ -374,35 +575,18 @@ So if
 
 static void VertexCoordTaubin(MeshType &m, int step, float lambda, float mu, bool SmoothSelected=false, vcg::CallBackPos * cb=0)
 {
-	LaplacianInfo lpz(CoordType(0,0,0),0);
-	SimpleTempData<typename MeshType::VertContainer,LaplacianInfo > TD(m.vert,lpz);
-	VertexIterator vi;
+	LaplacianAdjacency adj(m);
+	VertexCoordTaubin(m,adj,step,lambda,mu,SmoothSelected,cb);
+}
+
+static void VertexCoordTaubin(MeshType &m, const LaplacianAdjacency &adj, int step, float lambda, float mu, bool SmoothSelected=false, vcg::CallBackPos * cb=0)
+{
 	for(int i=0;i<step;++i)
 		{
-		  if(cb) cb(100*i/step, "Taubin Smoothing");
-			TD.Init(lpz);
-			AccumulateLaplacianInfo(m,TD);
-			for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-				if(!(*vi).IsD() && TD[*vi].cnt>0 )
-				{
-					if(!SmoothSelected || (*vi).IsS())
-					{
-						CoordType Delta = TD[*vi].sum/TD[*vi].cnt - (*vi).P();
-						(*vi).P() = (*vi).P() + Delta*lambda ;
-					}
-				}
-			TD.Init(lpz);
-			AccumulateLaplacianInfo(m,TD);
-			for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-					if(!(*vi).IsD() && TD[*vi].cnt>0 )
-					{
-						if(!SmoothSelected || (*vi).IsS())
-						{
-							CoordType Delta = TD[*vi].sum/TD[*vi].cnt - (*vi).P();
-							(*vi).P() = (*vi).P() + Delta*mu ;
-						}
-					}
-			} // end for step
+			if(cb) cb(100*i/step, "Taubin Smoothing");
+			VertexCoordLaplacianStep(m,adj,lambda,SmoothSelected);
+			VertexCoordLaplacianStep(m,adj,mu,SmoothSelected);
+		} // end for step
 }
 
 
@@ -440,59 +624,40 @@ public:
 
 static void VertexCoordLaplacianHC(MeshType &m, int step, bool SmoothSelected=false )
 {
-	ScalarType beta=0.5;
-  HCSmoothInfo lpz;
-	lpz.sum=CoordType(0,0,0);
-	lpz.dif=CoordType(0,0,0);
-	lpz.cnt=0;
-		for(int i=0;i<step;++i)
+	LaplacianAdjacency adj(m,LaplacianAdjacency::HCMode);
+	VertexCoordLaplacianHC(m,adj,step,SmoothSelected);
+}
+
+static void VertexCoordLaplacianHC(MeshType &m, const LaplacianAdjacency &adj, int step, bool SmoothSelected=false )
+{
+	assert(adj.Mode==LaplacianAdjacency::HCMode);
+	const ScalarType beta=0.5;
+	const int vn=int(m.vert.size());
+	std::vector<CoordType> pos, avg(vn), dif(vn);
+	for(int i=0;i<step;++i)
 		{
-			SimpleTempData<typename MeshType::VertContainer,HCSmoothInfo > TD(m.vert,lpz);
-			// First Loop compute the laplacian
-			FaceIterator fi;
-			for(fi=m.face.begin();fi!=m.face.end();++fi)if(!(*fi).IsD())
+			CopyVertexCoord(m,pos);
+			// First Loop compute the laplacian, and how much it moves each vertex
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for(int j=0;j<vn;++j)
 				{
-					for(int j=0;j<3;++j)
-					{
-						TD[(*fi).V(j)].sum+=(*fi).V1(j)->P();
-						TD[(*fi).V1(j)].sum+=(*fi).V(j)->P();
-						++TD[(*fi).V(j)].cnt;
-						++TD[(*fi).V1(j)].cnt;
-						// se l'edge j e' di bordo si deve sommare due volte
-						if((*fi).IsB(j))
-						{
-							TD[(*fi).V(j)].sum+=(*fi).V1(j)->P();
-							TD[(*fi).V1(j)].sum+=(*fi).V(j)->P();
-							++TD[(*fi).V(j)].cnt;
-							++TD[(*fi).V1(j)].cnt;
-						}
-					}
+					avg[j]=pos[j];
+					if(!m.vert[j].IsD() && adj.WSum[j]>0)
+						avg[j]=adj.Gather(pos,j,CoordType(0,0,0))/ScalarType(adj.WSum[j]);
+					dif[j]=avg[j]-pos[j];
 				}
-			VertexIterator vi;
-			for(vi=m.vert.begin();vi!=m.vert.end();++vi) if(!(*vi).IsD())
-				 TD[*vi].sum/=(float)TD[*vi].cnt;
 
 			// Second Loop compute average difference
-			for(fi=m.face.begin();fi!=m.face.end();++fi) if(!(*fi).IsD())
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for(int j=0;j<vn;++j)
+				if(!m.vert[j].IsD() && adj.WSum[j]>0 && (!SmoothSelected || m.vert[j].IsS()))
 				{
-					for(int j=0;j<3;++j)
-					{
-						TD[(*fi).V(j)].dif +=TD[(*fi).V1(j)].sum-(*fi).V1(j)->P();
-						TD[(*fi).V1(j)].dif+=TD[(*fi).V(j)].sum-(*fi).V(j)->P();
-						// se l'edge j e' di bordo si deve sommare due volte
-						if((*fi).IsB(j))
-						{
-							TD[(*fi).V(j)].dif +=TD[(*fi).V1(j)].sum-(*fi).V1(j)->P();
-							TD[(*fi).V1(j)].dif+=TD[(*fi).V(j)].sum-(*fi).V(j)->P();
-						}
-					}
-				}
-
-			for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-				{
-				 TD[*vi].dif/=(float)TD[*vi].cnt;
-				 if(!SmoothSelected || (*vi).IsS())
-						(*vi).P()= TD[*vi].sum - (TD[*vi].sum - (*vi).P())*beta  + (TD[*vi].dif)*(1.f-beta);
+					CoordType d=adj.Gather(dif,j,CoordType(0,0,0))/ScalarType(adj.WSum[j]);
+					m.vert[j].P()= avg[j] - (avg[j] - pos[j])*beta  + d*(1.f-beta);
 				}
 		} // end for step
 };
@@ -512,75 +677,35 @@ public:
 
 static void VertexColorLaplacian(MeshType &m, int step, bool SmoothSelected=false, vcg::CallBackPos * cb=0)
 {
-	ColorSmoothInfo csi;
-	csi.r=0; csi.g=0; csi.b=0; csi.cnt=0;
-	SimpleTempData<typename MeshType::VertContainer, ColorSmoothInfo> TD(m.vert,csi);
+	LaplacianAdjacency adj(m);
+	VertexColorLaplacian(m,adj,step,SmoothSelected,cb);
+}
 
+static void VertexColorLaplacian(MeshType &m, const LaplacianAdjacency &adj, int step, bool SmoothSelected=false, vcg::CallBackPos * cb=0)
+{
+	assert(adj.Mode!=LaplacianAdjacency::HCMode);
+	const int vn=int(m.vert.size());
+	std::vector<Point4i> col(vn);
 	for(int i=0;i<step;++i)
 	{
 		if(cb) cb(100*i/step, "Vertex Color Laplacian Smoothing");
-		VertexIterator vi;
-		for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-			TD[*vi]=csi;
-
-		FaceIterator fi;
-		for(fi=m.face.begin();fi!=m.face.end();++fi)
-			if(!(*fi).IsD())
-				for(int j=0;j<3;++j)
-					if(!(*fi).IsB(j))
-					{
-						TD[(*fi).V(j)].r+=(*fi).V1(j)->C()[0];
-						TD[(*fi).V(j)].g+=(*fi).V1(j)->C()[1];
-						TD[(*fi).V(j)].b+=(*fi).V1(j)->C()[2];
-						TD[(*fi).V(j)].a+=(*fi).V1(j)->C()[3];
-
-						TD[(*fi).V1(j)].r+=(*fi).V(j)->C()[0];
-						TD[(*fi).V1(j)].g+=(*fi).V(j)->C()[1];
-						TD[(*fi).V1(j)].b+=(*fi).V(j)->C()[2];
-						TD[(*fi).V1(j)].a+=(*fi).V(j)->C()[3];
-
-						++TD[(*fi).V(j)].cnt;
-						++TD[(*fi).V1(j)].cnt;
-					}
-
-		// si azzaera i dati per i vertici di bordo
-		for(fi=m.face.begin();fi!=m.face.end();++fi)
-			if(!(*fi).IsD())
-				for(int j=0;j<3;++j)
-					if((*fi).IsB(j))
-					{
-						TD[(*fi).V(j)]=csi;
-						TD[(*fi).V1(j)]=csi;
-					}
-
-		// se l'edge j e' di bordo si deve mediare solo con gli adiacenti
-		for(fi=m.face.begin();fi!=m.face.end();++fi)
-			if(!(*fi).IsD())
-				for(int j=0;j<3;++j)
-					if((*fi).IsB(j))
-					{
-						TD[(*fi).V(j)].r+=(*fi).V1(j)->C()[0];
-						TD[(*fi).V(j)].g+=(*fi).V1(j)->C()[1];
-						TD[(*fi).V(j)].b+=(*fi).V1(j)->C()[2];
-						TD[(*fi).V(j)].a+=(*fi).V1(j)->C()[3];
-
-						TD[(*fi).V1(j)].r+=(*fi).V(j)->C()[0];
-						TD[(*fi).V1(j)].g+=(*fi).V(j)->C()[1];
-						TD[(*fi).V1(j)].b+=(*fi).V(j)->C()[2];
-						TD[(*fi).V1(j)].a+=(*fi).V(j)->C()[3];
-
-						++TD[(*fi).V(j)].cnt;
-						++TD[(*fi).V1(j)].cnt;
-					}
-
-		for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-			if(!(*vi).IsD() && TD[*vi].cnt>0 )
-				if(!SmoothSelected || (*vi).IsS())
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			col[j]=Point4i(m.vert[j].C()[0],m.vert[j].C()[1],m.vert[j].C()[2],m.vert[j].C()[3]);
+
+		// the border vertices are averaged only with their adjacent border vertices
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			if(!m.vert[j].IsD() && adj.WSum[j]>0 )
+				if(!SmoothSelected || m.vert[j].IsS())
 				{
-					(*vi).C()[0] = (unsigned int) ceil((double) (TD[*vi].r / TD[*vi].cnt));
-					(*vi).C()[1] = (unsigned int) ceil((double) (TD[*vi].g / TD[*vi].cnt));
-					(*vi).C()[2] = (unsigned int) ceil((double) (TD[*vi].b / TD[*vi].cnt));
-					(*vi).C()[3] = (unsigned int) ceil((double) (TD[*vi].a / TD[*vi].cnt));
+					Point4i sum=adj.Gather(col,j,Point4i(0,0,0,0));
+					for(int k=0;k<4;++k)
+						m.vert[j].C()[k] = (unsigned char) (sum[k] / adj.WSum[j]);
 				}
 	} // end for step
 };
@@ -635,112 +760,61 @@ public:
 
 static void VertexQualityLaplacian(MeshType &m, int step=1, bool SmoothSelected=false)
 {
-  QualitySmoothInfo lpz;
-	lpz.sum=0;
-	lpz.cnt=0;
-	SimpleTempData<typename MeshType::VertContainer,QualitySmoothInfo> TD(m.vert,lpz);
-	//TD.Start(lpz);
+	LaplacianAdjacency adj(m);
+	VertexQualityLaplacian(m,adj,step,SmoothSelected);
+}
+
+static void VertexQualityLaplacian(MeshType &m, const LaplacianAdjacency &adj, int step=1, bool SmoothSelected=false)
+{
+	assert(adj.Mode!=LaplacianAdjacency::HCMode);
+	const int vn=int(m.vert.size());
+	std::vector<ScalarType> q(vn);
 	for(int i=0;i<step;++i)
 	{
-		VertexIterator vi;
-		for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-			 TD[*vi]=lpz;
-
-		FaceIterator fi;
-		for(fi=m.face.begin();fi!=m.face.end();++fi)
-			if(!(*fi).IsD())
-				for(int j=0;j<3;++j)
-					if(!(*fi).IsB(j))
-						{
-							TD[(*fi).V(j)].sum+=(*fi).V1(j)->Q();
-							TD[(*fi).V1(j)].sum+=(*fi).V(j)->Q();
-							++TD[(*fi).V(j)].cnt;
-							++TD[(*fi).V1(j)].cnt;
-					}
-
-			// si azzaera i dati per i vertici di bordo
-			for(fi=m.face.begin();fi!=m.face.end();++fi)
-				if(!(*fi).IsD())
-					for(int j=0;j<3;++j)
-						if((*fi).IsB(j))
-							{
-								TD[(*fi).V(j)]=lpz;
-								TD[(*fi).V1(j)]=lpz;
-							}
-
-			// se l'edge j e' di bordo si deve mediare solo con gli adiacenti
-			for(fi=m.face.begin();fi!=m.face.end();++fi)
-				if(!(*fi).IsD())
-					for(int j=0;j<3;++j)
-						if((*fi).IsB(j))
-							{
-								TD[(*fi).V(j)].sum+=(*fi).V1(j)->Q();
-								TD[(*fi).V1(j)].sum+=(*fi).V(j)->Q();
-								++TD[(*fi).V(j)].cnt;
-								++TD[(*fi).V1(j)].cnt;
-						}
-
-	//VertexIterator vi;
-	for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-		if(!(*vi).IsD() && TD[*vi].cnt>0 )
-			if(!SmoothSelected || (*vi).IsS())
-					(*vi).Q()=TD[*vi].sum/TD[*vi].cnt;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			q[j]=m.vert[j].Q();
+
+		// the border vertices are averaged only with their adjacent border vertices
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			if(!m.vert[j].IsD() && adj.WSum[j]>0 )
+				if(!SmoothSelected || m.vert[j].IsS())
+					m.vert[j].Q()=adj.Gather(q,j,ScalarType(0))/adj.WSum[j];
 	}
-
-	//TD.Stop();
 };
 
 static void VertexNormalLaplacian(MeshType &m, int step,bool SmoothSelected=false)
 {
-    LaplacianInfo lpz;
-      lpz.sum=CoordType(0,0,0);
-      lpz.cnt=0;
-    SimpleTempData<typename MeshType::VertContainer,LaplacianInfo > TD(m.vert,lpz);
-    for(int i=0;i<step;++i)
-	{
-		VertexIterator vi;
-		for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-			 TD[*vi]=lpz;
-
-		FaceIterator fi;
-		for(fi=m.face.begin();fi!=m.face.end();++fi)
-			if(!(*fi).IsD())
-				for(int j=0;j<3;++j)
-					if(!(*fi).IsB(j))
-						{
-							TD[(*fi).V(j)].sum+=(*fi).V1(j)->N();
-							TD[(*fi).V1(j)].sum+=(*fi).V(j)->N();
-							++TD[(*fi).V(j)].cnt;
-							++TD[(*fi).V1(j)].cnt;
-					}
-
-			// si azzaera i dati per i vertici di bordo
-			for(fi=m.face.begin();fi!=m.face.end();++fi)
-				if(!(*fi).IsD())
-					for(int j=0;j<3;++j)
-						if((*fi).IsB(j))
-							{
-								TD[(*fi).V(j)]=lpz;
-								TD[(*fi).V1(j)]=lpz;
-							}
-
-			// se l'edge j e' di bordo si deve mediare solo con gli adiacenti
-			for(fi=m.face.begin();fi!=m.face.end();++fi)
-				if(!(*fi).IsD())
-					for(int j=0;j<3;++j)
-						if((*fi).IsB(j))
-							{
-								TD[(*fi).V(j)].sum+=(*fi).V1(j)->N();
-								TD[(*fi).V1(j)].sum+=(*fi).V(j)->N();
-								++TD[(*fi).V(j)].cnt;
-								++TD[(*fi).V1(j)].cnt;
-						}
+	LaplacianAdjacency adj(m);
+	VertexNormalLaplacian(m,adj,step,SmoothSelected);
+}
 
-	//VertexIterator vi;
-	for(vi=m.vert.begin();vi!=m.vert.end();++vi)
-		if(!(*vi).IsD() && TD[*vi].cnt>0 )
-			if(!SmoothSelected || (*vi).IsS())
-					(*vi).N()=TD[*vi].sum/TD[*vi].cnt;
+static void VertexNormalLaplacian(MeshType &m, const LaplacianAdjacency &adj, int step,bool SmoothSelected=false)
+{
+	assert(adj.Mode!=LaplacianAdjacency::HCMode);
+	const int vn=int(m.vert.size());
+	std::vector<typename VertexType::NormalType> nrm(vn);
+	for(int i=0;i<step;++i)
+	{
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			nrm[j]=m.vert[j].cN();
+
+		// the border vertices are averaged only with their adjacent border vertices
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for(int j=0;j<vn;++j)
+			if(!m.vert[j].IsD() && adj.WSum[j]>0 )
+				if(!SmoothSelected || m.vert[j].IsS())
+					m.vert[j].N()=adj.Gather(nrm,j,typename VertexType::NormalType(0,0,0))/adj.WSum[j];
 	}
 
 };
@@ -1241,20 +1315,31 @@ static void VertexNormalPointCloud(MeshType &m, int neighborNum, int iterNum, Kd
   if(tp==0) tree = new KdTree<float>(ww);
   else tree=tp;
 
-  tree->setMaxNofNeighbors(neighborNum);
   for(int ii=0;ii<iterNum;++ii)
   {
-    for (VertexIterator vi = m.vert.begin();vi!=m.vert.end();++vi)
+    // each vertex only writes its own TD entry, so the queries can run in parallel,
+    // every thread with its own query context
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
     {
-      tree->doQueryK(vi->cP());
-      int neighbours = tree->getNofFoundNeighbors();
-      for (int i = 0; i < neighbours; i++)
+      KdTree<float>::QueryContext ctx(neighborNum);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,1024)
+#endif
+      for (int vInd = 0; vInd < int(m.vert.size()); ++vInd)
       {
-        int neightId = tree->getNeighborId(i);
-        if(m.vert[neightId].cN()*vi->cN()>0)
-          TD[vi]+= m.vert[neightId].cN();
-        else
-          TD[vi]-= m.vert[neightId].cN();
+        VertexPointer vp = &m.vert[vInd];
+        tree->doQueryK(vp->cP(),ctx);
+        int neighbours = ctx.getNofFoundNeighbors();
+        for (int i = 0; i < neighbours; i++)
+        {
+          int neightId = ctx.getNeighborId(i);
+          if(m.vert[neightId].cN()*vp->cN()>0)
+            TD[vp]+= m.vert[neightId].cN();
+          else
+            TD[vp]-= m.vert[neightId].cN();
+        }
       }
     }
     for (VertexIterator vi = m.vert.begin();vi!=m.vert.end();++vi)
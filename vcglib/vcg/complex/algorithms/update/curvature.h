@@ -94,7 +94,12 @@ public:
     vcg::tri::UpdateNormal<MeshType>::PerVertexAngleWeighted(m);
     vcg::tri::UpdateNormal<MeshType>::NormalizePerVertex(m);
 
-    for (VertexIterator vi =m.vert.begin(); vi !=m.vert.end(); ++vi) {
+    // each vertex reads its one ring and writes only itself, so the vertices are processed in parallel
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,256)
+#endif
+    for (int vIdx = 0; vIdx < int(m.vert.size()); ++vIdx) {
+      VertexIterator vi = m.vert.begin()+vIdx;
       if ( ! (*vi).IsD() && (*vi).VFp() != NULL) {
 
         VertexType * central_vertex = &(*vi);
@@ -258,12 +263,6 @@ public:
 
 
 
-  class AreaData
-  {
-  public:
-    float A;
-  };
-
   /** Curvature meseaure as described in the paper:
 Robust principal curvatures on Multiple Scales, Yong-Liang Yang, Yu-Kun Lai, Shi-Min Hu Helmut Pottmann
 SGP 2004
@@ -276,13 +275,9 @@ If pointVSfaceInt==false the covariance is computed by (analytic)integration ove
 
   static void PrincipalDirectionsPCA(MeshType &m, ScalarType r, bool pointVSfaceInt = true,vcg::CallBackPos * cb = NULL)
   {
-    std::vector<VertexType*> closests;
-    std::vector<ScalarType> distances;
-    std::vector<CoordType> points;
     VertexIterator vi;
     ScalarType area;
     MeshType tmpM;
-    typename std::vector<CoordType>::iterator ii;
     vcg::tri::TrivialSampler<MeshType> vs;
     tri::UpdateNormal<MeshType>::PerVertexAngleWeighted(m);
     tri::UpdateNormal<MeshType>::NormalizePerVertex(m);
@@ -304,37 +299,64 @@ If pointVSfaceInt==false the covariance is computed by (analytic)integration ove
       mGrid.Set(m.face.begin(),m.face.end());
     }
 
-    int jj = 0;
-    for(vi  = m.vert.begin(); vi != m.vert.end(); ++vi)
+    const int vn = int(m.vert.size());
+    const int blockSize = 1<<14;
+    if(pointVSfaceInt)
     {
-      vcg::Matrix33<ScalarType> A, eigenvectors;
-      vcg::Point3<ScalarType> bp, eigenvalues;
-//      int nrot;
-
-      // sample the neighborhood
-      if(pointVSfaceInt)
+      // the neighborhoods are sampled in parallel, each thread with its own marker on the shared grid
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
       {
-        vcg::tri::GetInSphereVertex<
-            MeshType,
-            PointsGridType,std::vector<VertexType*>,
-            std::vector<ScalarType>,
-            std::vector<CoordType> >(tmpM,pGrid,  (*vi).cP(),r ,closests,distances,points);
-
-        A.Covariance(points,bp);
-        A*=area*area/1000;
+        typename PointsGridType::LocalMarker marker(pGrid);
+        std::vector<VertexType*> closests;
+        std::vector<CoordType> points;
+        for(int start = 0; start < vn; start += blockSize)
+        {
+#ifdef _OPENMP
+#pragma omp master
+#endif
+          if (cb) (*cb)(int(100.0f * (float)start / (float)vn),"Vertices Analysis");
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,64)
+#endif
+          for(int i = start; i < std::min(vn,start+blockSize); ++i) if(!m.vert[i].IsD())
+          {
+            // sample the neighborhood
+            const CoordType p = m.vert[i].cP();
+            vcg::GridGetInBox(pGrid, marker, Box3<ScalarType>(p-CoordType(r,r,r),p+CoordType(r,r,r)), closests);
+            points.clear();
+            for(size_t j = 0; j < closests.size(); ++j)
+              if(Distance(p,closests[j]->cP()) <= r) points.push_back(closests[j]->cP());
+
+            vcg::Matrix33<ScalarType> A;
+            vcg::Point3<ScalarType> bp;
+            A.Covariance(points,bp);
+            A*=area*area/1000;
+            PrincipalDirectionsFromCovariance(m.vert[i],A,r);
+          }
+        }
       }
-      else{
-        IntersectionBallMesh<MeshType,ScalarType>( m ,vcg::Sphere3<ScalarType>((*vi).cP(),r),tmpM );
+    }
+    else
+    {
+      for(int i = 0; i < vn; ++i) if(!m.vert[i].IsD())
+      {
+        if (cb && i%blockSize==0) (*cb)(int(100.0f * (float)i / (float)vn),"Vertices Analysis");
+        vcg::Matrix33<ScalarType> A;
+        IntersectionBallMesh<MeshType,ScalarType>( m ,vcg::Sphere3<ScalarType>(m.vert[i].cP(),r),tmpM );
         vcg::Point3<ScalarType> _bary;
         vcg::tri::Inertia<MeshType>::Covariance(tmpM,_bary,A);
+        PrincipalDirectionsFromCovariance(m.vert[i],A,r);
       }
+    }
+  }
 
-//      Eigen::Matrix3f AA; AA=A;
-//      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> eig(AA);
-//      Eigen::Vector3f c_val = eig.eigenvalues();
-//      Eigen::Matrix3f c_vec = eig.eigenvectors();
-
-//      Jacobi(A,  eigenvalues , eigenvectors, nrot);
+  // Principal directions and curvatures of a vertex from the covariance A of its neighborhood of radius r
+  static void PrincipalDirectionsFromCovariance(VertexType &v, const vcg::Matrix33<ScalarType> &A, ScalarType r)
+  {
+    vcg::Matrix33<ScalarType> eigenvectors;
+    vcg::Point3<ScalarType> eigenvalues;
 
 	  Eigen::Matrix3d AA;
 	  A.ToEigenMatrix(AA);
@@ -343,45 +365,36 @@ If pointVSfaceInt==false the covariance is computed by (analytic)integration ove
 	  Eigen::Matrix3d c_vec = eig.eigenvectors(); // eigenvector are stored as columns.
 	  eigenvectors.FromEigenMatrix(c_vec);
 	  eigenvalues.FromEigenVector(c_val);
-//	  EV.transposeInPlace();
-//	  ev.FromEigenVector(c_val);
 
       // get the estimate of curvatures from eigenvalues and eigenvectors
       // find the 2 most tangent eigenvectors (by finding the one closest to the normal)
-      int best = 0; ScalarType bestv = fabs( (*vi).cN().dot(eigenvectors.GetColumn(0).normalized()) );
+      int best = 0; ScalarType bestv = fabs( v.cN().dot(eigenvectors.GetColumn(0).normalized()) );
       for(int i  = 1 ; i < 3; ++i){
-        ScalarType prod = fabs((*vi).cN().dot(eigenvectors.GetColumn(i).normalized()));
+        ScalarType prod = fabs(v.cN().dot(eigenvectors.GetColumn(i).normalized()));
         if( prod > bestv){bestv = prod; best = i;}
       }
 
-      (*vi).PD1()  = eigenvectors.GetColumn( (best+1)%3).normalized();
-      (*vi).PD2()  = eigenvectors.GetColumn( (best+2)%3).normalized();
+      v.PD1()  = eigenvectors.GetColumn( (best+1)%3).normalized();
+      v.PD2()  = eigenvectors.GetColumn( (best+2)%3).normalized();
 
       // project them to the plane identified by the normal
       vcg::Matrix33<ScalarType> rot;
-      ScalarType angle = acos((*vi).PD1().dot((*vi).N()));
-      rot.SetRotateRad(  - (M_PI*0.5 - angle),(*vi).PD1()^(*vi).N());
-      (*vi).PD1() = rot*(*vi).PD1();
-      angle = acos((*vi).PD2().dot((*vi).N()));
-      rot.SetRotateRad(  - (M_PI*0.5 - angle),(*vi).PD2()^(*vi).N());
-      (*vi).PD2() = rot*(*vi).PD2();
+      ScalarType angle = acos(v.PD1().dot(v.N()));
+      rot.SetRotateRad(  - (M_PI*0.5 - angle),v.PD1()^v.N());
+      v.PD1() = rot*v.PD1();
+      angle = acos(v.PD2().dot(v.N()));
+      rot.SetRotateRad(  - (M_PI*0.5 - angle),v.PD2()^v.N());
+      v.PD2() = rot*v.PD2();
 
 
       // copmutes the curvature values
       const ScalarType r5 = r*r*r*r*r;
       const ScalarType r6 = r*r5;
-      (*vi).K1() = (2.0/5.0) * (4.0*M_PI*r5 + 15*eigenvalues[(best+2)%3]-45.0*eigenvalues[(best+1)%3])/(M_PI*r6);
-      (*vi).K2() = (2.0/5.0) * (4.0*M_PI*r5 + 15*eigenvalues[(best+1)%3]-45.0*eigenvalues[(best+2)%3])/(M_PI*r6);
-      if((*vi).K1() < (*vi).K2())	{	std::swap((*vi).K1(),(*vi).K2());
-        std::swap((*vi).PD1(),(*vi).PD2());
-        if (cb)
-        {
-          (*cb)(int(100.0f * (float)jj / (float)m.vn),"Vertices Analysis");
-          ++jj;
-        }													}
-    }
-
-
+      v.K1() = (2.0/5.0) * (4.0*M_PI*r5 + 15*eigenvalues[(best+2)%3]-45.0*eigenvalues[(best+1)%3])/(M_PI*r6);
+      v.K2() = (2.0/5.0) * (4.0*M_PI*r5 + 15*eigenvalues[(best+1)%3]-45.0*eigenvalues[(best+2)%3])/(M_PI*r6);
+      if(v.K1() < v.K2())	{	std::swap(v.K1(),v.K2());
+        std::swap(v.PD1(),v.PD2());
+      }
   }
 
 /// \brief Computes the discrete mean gaussian curvature.
@@ -400,98 +413,81 @@ static void MeanAndGaussian(MeshType & m)
 {
   tri::RequireFFAdjacency(m);
 
-  float area0, area1, area2, angle0, angle1, angle2;
-  FaceIterator fi;
-  VertexIterator vi;
-  typename MeshType::CoordType  e01v ,e12v ,e20v;
+  const int fn = int(m.face.size());
+  const int vn = int(m.vert.size());
 
-  SimpleTempData<VertContainer, AreaData> TDAreaPtr(m.vert);
-  SimpleTempData<VertContainer, typename MeshType::CoordType> TDContr(m.vert);
+  // Each face computes, for each one of its corners, what it adds to the area, to the mean curvature vector
+  // and to the angle deficit of the vertex; then each vertex gathers the values of its corners.
+  // The corners of a vertex are gathered in face order, so the sums are the same of a serial visit of the faces.
+  std::vector<double> cornerArea(3*fn,0);
+  std::vector<float> cornerAngle(3*fn,0), cornerBorderAngle(3*fn,0);
+  std::vector<CoordType> cornerContr(3*fn,CoordType(0,0,0));
+  std::vector<char> cornerSkip(3*fn,1);
 
   vcg::tri::UpdateNormal<MeshType>::PerVertexNormalized(m);
-  //Compute AreaMix in H (vale anche per K)
-  for(vi=m.vert.begin(); vi!=m.vert.end(); ++vi) if(!(*vi).IsD())
-  {
-    (TDAreaPtr)[*vi].A = 0.0;
-    (TDContr)[*vi]  =typename MeshType::CoordType(0.0,0.0,0.0);
-    (*vi).Kh() = 0.0;
-    (*vi).Kg() = (float)(2.0 * M_PI);
-  }
 
-  for(fi=m.face.begin();fi!=m.face.end();++fi) if( !(*fi).IsD())
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int fIdx=0; fIdx<fn; ++fIdx)
   {
+    FaceType &f = m.face[fIdx];
+    if(f.IsD()) continue;
+    float area0, area1, area2, angle0, angle1, angle2;
+    typename MeshType::CoordType  e01v ,e12v ,e20v;
+    double *area = &cornerArea[3*fIdx];
+
+    //Compute AreaMix in H (vale anche per K)
     // angles
-    angle0 = math::Abs(Angle(	(*fi).P(1)-(*fi).P(0),(*fi).P(2)-(*fi).P(0) ));
-    angle1 = math::Abs(Angle(	(*fi).P(0)-(*fi).P(1),(*fi).P(2)-(*fi).P(1) ));
+    angle0 = math::Abs(Angle(	f.P(1)-f.P(0),f.P(2)-f.P(0) ));
+    angle1 = math::Abs(Angle(	f.P(0)-f.P(1),f.P(2)-f.P(1) ));
     angle2 = M_PI-(angle0+angle1);
 
     if((angle0 < M_PI/2) && (angle1 < M_PI/2) && (angle2 < M_PI/2))  // triangolo non ottuso
     {
-      float e01 = SquaredDistance( (*fi).V(1)->cP() , (*fi).V(0)->cP() );
-      float e12 = SquaredDistance( (*fi).V(2)->cP() , (*fi).V(1)->cP() );
-      float e20 = SquaredDistance( (*fi).V(0)->cP() , (*fi).V(2)->cP() );
+      float e01 = SquaredDistance( f.V(1)->cP() , f.V(0)->cP() );
+      float e12 = SquaredDistance( f.V(2)->cP() , f.V(1)->cP() );
+      float e20 = SquaredDistance( f.V(0)->cP() , f.V(2)->cP() );
 
       area0 = ( e20*(1.0/tan(angle1)) + e01*(1.0/tan(angle2)) ) / 8.0;
       area1 = ( e01*(1.0/tan(angle2)) + e12*(1.0/tan(angle0)) ) / 8.0;
       area2 = ( e12*(1.0/tan(angle0)) + e20*(1.0/tan(angle1)) ) / 8.0;
 
-      (TDAreaPtr)[(*fi).V(0)].A  += area0;
-      (TDAreaPtr)[(*fi).V(1)].A  += area1;
-      (TDAreaPtr)[(*fi).V(2)].A  += area2;
-
+      area[0] = area0;
+      area[1] = area1;
+      area[2] = area2;
     }
     else // obtuse
     {
-      if(angle0 >= M_PI/2)
-      {
-        (TDAreaPtr)[(*fi).V(0)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 4.0;
-        (TDAreaPtr)[(*fi).V(1)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-        (TDAreaPtr)[(*fi).V(2)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-      }
-      else if(angle1 >= M_PI/2)
-      {
-        (TDAreaPtr)[(*fi).V(0)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-        (TDAreaPtr)[(*fi).V(1)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 4.0;
-        (TDAreaPtr)[(*fi).V(2)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-      }
-      else
-      {
-        (TDAreaPtr)[(*fi).V(0)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-        (TDAreaPtr)[(*fi).V(1)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 8.0;
-        (TDAreaPtr)[(*fi).V(2)].A += vcg::DoubleArea<typename MeshType::FaceType>((*fi)) / 4.0;
-      }
+      const double obtuse = vcg::DoubleArea<typename MeshType::FaceType>(f) / 4.0;
+      const double acute = vcg::DoubleArea<typename MeshType::FaceType>(f) / 8.0;
+      area[0] = (angle0 >= M_PI/2) ? obtuse : acute;
+      area[1] = (angle0 < M_PI/2 && angle1 >= M_PI/2) ? obtuse : acute;
+      area[2] = (angle0 < M_PI/2 && angle1 < M_PI/2) ? obtuse : acute;
     }
-  }
-
-
-  for(fi=m.face.begin();fi!=m.face.end();++fi) if( !(*fi).IsD() )
-  {
-    angle0 = math::Abs(Angle(	(*fi).P(1)-(*fi).P(0),(*fi).P(2)-(*fi).P(0) ));
-    angle1 = math::Abs(Angle(	(*fi).P(0)-(*fi).P(1),(*fi).P(2)-(*fi).P(1) ));
-    angle2 = M_PI-(angle0+angle1);
 
     // Skip degenerate triangles.
     if(angle0==0 || angle1==0 || angle1==0) continue;
 
-    e01v = ( (*fi).V(1)->cP() - (*fi).V(0)->cP() ) ;
-    e12v = ( (*fi).V(2)->cP() - (*fi).V(1)->cP() ) ;
-    e20v = ( (*fi).V(0)->cP() - (*fi).V(2)->cP() ) ;
-
-    TDContr[(*fi).V(0)] += ( e20v * (1.0/tan(angle1)) - e01v * (1.0/tan(angle2)) ) / 4.0;
-    TDContr[(*fi).V(1)] += ( e01v * (1.0/tan(angle2)) - e12v * (1.0/tan(angle0)) ) / 4.0;
-    TDContr[(*fi).V(2)] += ( e12v * (1.0/tan(angle0)) - e20v * (1.0/tan(angle1)) ) / 4.0;
+    e01v = ( f.V(1)->cP() - f.V(0)->cP() ) ;
+    e12v = ( f.V(2)->cP() - f.V(1)->cP() ) ;
+    e20v = ( f.V(0)->cP() - f.V(2)->cP() ) ;
 
-    (*fi).V(0)->Kg() -= angle0;
-    (*fi).V(1)->Kg() -= angle1;
-    (*fi).V(2)->Kg() -= angle2;
+    cornerContr[3*fIdx+0] = ( e20v * (1.0/tan(angle1)) - e01v * (1.0/tan(angle2)) ) / 4.0;
+    cornerContr[3*fIdx+1] = ( e01v * (1.0/tan(angle2)) - e12v * (1.0/tan(angle0)) ) / 4.0;
+    cornerContr[3*fIdx+2] = ( e12v * (1.0/tan(angle0)) - e20v * (1.0/tan(angle1)) ) / 4.0;
 
+    cornerAngle[3*fIdx+0] = angle0;
+    cornerAngle[3*fIdx+1] = angle1;
+    cornerAngle[3*fIdx+2] = angle2;
 
     for(int i=0;i<3;i++)
     {
-      if(vcg::face::IsBorder((*fi), i))
+      cornerSkip[3*fIdx+i] = 0;
+      if(vcg::face::IsBorder(f, i))
       {
         CoordType e1,e2;
-        vcg::face::Pos<FaceType> hp(&*fi, i, (*fi).V(i));
+        vcg::face::Pos<FaceType> hp(&f, i, f.V(i));
         vcg::face::Pos<FaceType> hp1=hp;
 
         hp1.FlipV();
@@ -499,22 +495,52 @@ static void MeanAndGaussian(MeshType & m)
         hp1.FlipV();
         hp1.NextB();
         e2=hp1.v->cP() - hp.v->cP();
-        (*fi).V(i)->Kg() -= math::Abs(Angle(e1,e2));
+        cornerBorderAngle[3*fIdx+i] = math::Abs(Angle(e1,e2));
       }
     }
   }
 
-  for(vi=m.vert.begin(); vi!=m.vert.end(); ++vi) if(!(*vi).IsD() /*&& !(*vi).IsB()*/)
+  // the corners of each vertex, in face order
+  std::vector<int> cornerStart(vn+1,0);
+  for(int fIdx=0; fIdx<fn; ++fIdx) if(!m.face[fIdx].IsD())
+    for(int i=0;i<3;++i) ++cornerStart[tri::Index(m,m.face[fIdx].V(i))+1];
+  for(int vIdx=0; vIdx<vn; ++vIdx) cornerStart[vIdx+1]+=cornerStart[vIdx];
+  std::vector<int> corner(cornerStart[vn]);
+  std::vector<int> fill(cornerStart.begin(),cornerStart.end()-1);
+  for(int fIdx=0; fIdx<fn; ++fIdx) if(!m.face[fIdx].IsD())
+    for(int i=0;i<3;++i) corner[fill[tri::Index(m,m.face[fIdx].V(i))]++]=3*fIdx+i;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int vIdx=0; vIdx<vn; ++vIdx)
   {
-    if((TDAreaPtr)[*vi].A<=std::numeric_limits<ScalarType>::epsilon())
+    VertexType &v = m.vert[vIdx];
+    if(v.IsD() /*|| v.IsB()*/) continue;
+    float A = 0.0;
+    CoordType contr(0.0,0.0,0.0);
+    v.Kh() = 0.0;
+    v.Kg() = (float)(2.0 * M_PI);
+    for(int k=cornerStart[vIdx]; k<cornerStart[vIdx+1]; ++k)
+      A += cornerArea[corner[k]];
+    for(int k=cornerStart[vIdx]; k<cornerStart[vIdx+1]; ++k)
     {
-      (*vi).Kh() = 0;
-      (*vi).Kg() = 0;
+      const int c = corner[k];
+      if(cornerSkip[c]) continue;
+      contr += cornerContr[c];
+      v.Kg() -= cornerAngle[c];
+      if(cornerBorderAngle[c]!=0) v.Kg() -= cornerBorderAngle[c];
+    }
+
+    if(A<=std::numeric_limits<ScalarType>::epsilon())
+    {
+      v.Kh() = 0;
+      v.Kg() = 0;
     }
     else
     {
-      (*vi).Kh()  = (((TDContr)[*vi].dot((*vi).cN())>0)?1.0:-1.0)*((TDContr)[*vi] / (TDAreaPtr) [*vi].A).Norm();
-      (*vi).Kg() /= (TDAreaPtr)[*vi].A;
+      v.Kh()  = ((contr.dot(v.cN())>0)?1.0:-1.0)*(contr / A).Norm();
+      v.Kg() /= A;
     }
   }
 }
@@ -592,8 +618,11 @@ static void MeanAndGaussian(MeshType & m)
 	{
 	  tri::RequireVFAdjacency(m);
 
-	  for(VertexIterator vi = m.vert.begin(); vi != m.vert.end(); ++vi)
-		ComputeSingleVertexCurvature(&*vi,false);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+	  for(int i = 0; i < int(m.vert.size()); ++i)
+		ComputeSingleVertexCurvature(&m.vert[i],false);
 	}
 
 
@@ -613,10 +642,12 @@ static void MeanAndGaussian(MeshType & m)
 	  tri::RequireFFAdjacency(m);
 	  tri::RequirePerFaceNormal(m);
 
-		typename MeshType::VertexIterator vi;
-
-		for(vi = m.vert.begin(); vi != m.vert.end(); ++vi)
-		if(!((*vi).IsD())){
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,256)
+#endif
+		for(int vIdx = 0; vIdx < int(m.vert.size()); ++vIdx)
+		if(!(m.vert[vIdx].IsD())){
+			typename MeshType::VertexIterator vi = m.vert.begin()+vIdx;
 			vcg::Matrix33<ScalarType> m33;m33.SetZero();
 			face::JumpingPos<typename MeshType::FaceType> p((*vi).VFp(),&(*vi));
 			p.FlipE();
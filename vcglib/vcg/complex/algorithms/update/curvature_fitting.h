@@ -235,9 +235,13 @@ class Quadric
         vcg::tri::UpdateNormal<MeshType>::NormalizePerVertex(m);
 
 
-        VertexIterator vi;
-        for(vi = m.vert.begin(); vi!=m.vert.end(); ++vi )
+        // each vertex reads the positions of its two rings and writes only itself
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,256)
+#endif
+        for(int vIdx = 0; vIdx < int(m.vert.size()); ++vIdx)
         {
+            VertexIterator vi = m.vert.begin()+vIdx;
             std::vector<CoordType> ref = computeReferenceFrames(&*vi);
 
             Quadric q = fitQuadric(&*vi,ref);
@@ -27,6 +27,9 @@
 #include <vcg/complex/algorithms/update/flag.h>
 #include <vcg/math/matrix44.h>
 #include <vcg/complex/exception.h>
+#ifdef VCG_USE_THREAD_POOL
+#include <wrap/system/multithreading/thread_pool.h>
+#endif
 
 namespace vcg {
 namespace tri {
@@ -41,6 +44,10 @@ This class is used to compute or to update the normals that can be stored in the
 A number of different algorithms for computing per vertex normals are present.
 
 It must be included \b after complex.h
+
+When VCG_USE_THREAD_POOL is defined, the functions that update each element independently
+(PerFace, PerFaceFromCurrentVertexNormal and the normalizations) run in parallel on the
+default pool of wrap/system/multithreading/thread_pool.h; the results are the same.
 */
 
 template <class ComputeMeshType>
@@ -58,6 +65,59 @@ typedef typename MeshType::FaceType       FaceType;
 typedef typename MeshType::FacePointer    FacePointer;
 typedef typename MeshType::FaceIterator   FaceIterator;
 
+private:
+// Call body(i) for each i in [0,n), in parallel with the thread pool if enabled;
+// small meshes are processed serially anyway.
+template <class Body>
+static void ForEachIndex(int n, const Body &body)
+{
+#ifdef VCG_USE_THREAD_POOL
+  mt::parallel_for(0,n,body,4096);
+#else
+  for(int i=0;i<n;++i) body(i);
+#endif
+}
+
+struct FaceNormalBody
+{
+  FaceNormalBody(MeshType &_m):m(_m){}
+  void operator()(int i) const { if(!m.face[i].IsD()) face::ComputeNormal(m.face[i]); }
+  MeshType &m;
+};
+
+struct FaceFromVertexNormalBody
+{
+  FaceFromVertexNormalBody(MeshType &_m):m(_m){}
+  void operator()(int i) const
+  {
+    FaceType &f=m.face[i];
+    if(f.IsD()) return;
+    NormalType n;
+    n.SetZero();
+    for(int j=0; j<3; ++j)
+      n += f.V(j)->cN();
+    n.Normalize();
+    f.N() = n;
+  }
+  MeshType &m;
+};
+
+struct NormalizeVertexBody
+{
+  NormalizeVertexBody(MeshType &_m):m(_m){}
+  void operator()(int i) const { if(!m.vert[i].IsD() && m.vert[i].IsRW()) m.vert[i].N().Normalize(); }
+  MeshType &m;
+};
+
+struct NormalizeFaceBody
+{
+  NormalizeFaceBody(MeshType &_m):m(_m){}
+  void operator()(int i) const { if(!m.face[i].IsD()) m.face[i].N().Normalize(); }
+  MeshType &m;
+};
+
+public:
+
 /// \brief Set to zero all the PerVertex normals
 /**
  Set to zero all the PerVertex normals. Used by all the face averaging algorithms.
@@ -160,9 +220,7 @@ static void PerVertexNelsonMaxWeighted(ComputeMeshType &m)
 static void PerFace(ComputeMeshType &m)
 {
   if(!HasPerFaceNormal(m)) throw vcg::MissingComponentException("PerFaceNormal");
-  for(FaceIterator f=m.face.begin();f!=m.face.end();++f)
-            if( !(*f).IsD() )
-                face::ComputeNormal(*f);
+  ForEachIndex(int(m.face.size()),FaceNormalBody(m));
 }
 
 /// \brief Calculates the vertex normal by averaging the current per-face normals.
@@ -196,33 +254,21 @@ static void PerFaceFromCurrentVertexNormal(ComputeMeshType &m)
 {
   tri::RequirePerVertexNormal(m);
   tri::RequirePerFaceNormal(m);
-  for (FaceIterator fi=m.face.begin(); fi!=m.face.end(); ++fi)
-   if( !(*fi).IsD())
-        {
-        NormalType n;
-        n.SetZero();
-        for(int j=0; j<3; ++j)
-            n += fi->V(j)->cN();
-        n.Normalize();
-        fi->N() = n;
-    }
+  ForEachIndex(int(m.face.size()),FaceFromVertexNormalBody(m));
 }
 
 /// \brief Normalize the length of the vertex normals.
 static void NormalizePerVertex(ComputeMeshType &m)
 {
   tri::RequirePerVertexNormal(m);
-  for(VertexIterator vi=m.vert.begin();vi!=m.vert.end();++vi)
-		if( !(*vi).IsD() && (*vi).IsRW() ) 
-			(*vi).N().Normalize();
+  ForEachIndex(int(m.vert.size()),NormalizeVertexBody(m));
 }
 
 /// \brief Normalize the length of the face normals.
 static void NormalizePerFace(ComputeMeshType &m)
 {
   tri::RequirePerFaceNormal(m);
-  for(FaceIterator fi=m.face.begin();fi!=m.face.end();++fi)
-      if( !(*fi).IsD() )	(*fi).N().Normalize();
+  ForEachIndex(int(m.face.size()),NormalizeFaceBody(m));
 }
 
 /// \brief Set the length of the face normals to their area (without recomputing their directions).
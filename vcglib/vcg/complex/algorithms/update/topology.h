@@ -27,6 +27,9 @@
 #include <vector>
 #include <vcg/simplex/face/pos.h>
 #include <vcg/simplex/face/topology.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace vcg {
 namespace tri {
@@ -98,34 +101,155 @@ inline bool operator == ( const PEdge & pe ) const
 
 };
 
+/// \brief Auxiliairy data structure of FaceFace: an edge identified by the indexes of its two vertices (ordered).
+class PEdgeIndex
+{
+public:
+	unsigned int key;  // index of the first vertex (the smaller one)
+	unsigned int v1;   // index of the second vertex
+	int f;             // index of the face where this edge belong
+	int z;             // index of the edge in the face
+
+	inline bool operator < ( const PEdgeIndex & pe ) const { return v1 < pe.v1; }
+};
+
+class EdgeCounter
+{
+public:
+	EdgeCounter(bool _includeFauxEdge):includeFauxEdge(_includeFauxEdge){}
+	int operator()(const FaceType &f) const
+	{
+		int n=0;
+		for(int j=0;j<f.VN();++j) if(includeFauxEdge || !f.IsF(j)) ++n;
+		return n;
+	}
+	bool includeFauxEdge;
+};
+
+// Split the face vector in chunks that can be filled in parallel:
+// the chunk c spans the faces [chunkStart[c],chunkStart[c+1]) and its items (counted with cnt on the not deleted faces)
+// start at offset[c] of the filled vector; offset.back() is the total number of items.
+// The number of chunks depends only on the number of faces.
+template <class CountFunctor>
+static void FaceChunks(MeshType &m, const CountFunctor &cnt, std::vector<int> &chunkStart, std::vector<size_t> &offset)
+{
+	const int fn=int(m.face.size());
+	const int chunkNum=std::max(1,std::min(256,fn/4096));
+	chunkStart.resize(chunkNum+1);
+	for(int c=0;c<=chunkNum;++c) chunkStart[c]=int((long long)(fn)*c/chunkNum);
+	offset.assign(chunkNum+1,0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+	for(int c=0;c<chunkNum;++c)
+	{
+		size_t n=0;
+		for(int i=chunkStart[c];i<chunkStart[c+1];++i)
+			if(!m.face[i].IsD()) n+=cnt(m.face[i]);
+		offset[c+1]=n;
+	}
+	for(int c=0;c<chunkNum;++c) offset[c+1]+=offset[c];
+}
+
+/// \brief Stable sort of a vector of items by their unsigned integer member key (at most maxKey).
+/**
+It is a least significant digit radix sort, with 11 bits for each pass: each pass counts the digits
+in parallel chunks of the vector and then moves the items of each chunk in parallel.
+Being stable, the items with the same key keep their order, whatever is the number of threads.
+*/
+template <class ItemType>
+static void RadixSort(std::vector<ItemType> &v, unsigned int maxKey)
+{
+	const int RadixBits=11;
+	const int RadixSize=1<<RadixBits;
+	const int n=int(v.size());
+	const int chunkNum=std::max(1,std::min(64,n/65536));
+	std::vector<int> chunkStart(chunkNum+1);
+	for(int c=0;c<=chunkNum;++c) chunkStart[c]=int((long long)(n)*c/chunkNum);
+	std::vector<int> cnt(chunkNum*RadixSize);
+	std::vector<ItemType> tmp;
+
+	for(int shift=0; shift<32 && (maxKey>>shift)!=0; shift+=RadixBits)
+	{
+		if(tmp.empty()) tmp.resize(n);
+		std::fill(cnt.begin(),cnt.end(),0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+		for(int c=0;c<chunkNum;++c)
+		{
+			int *h=&cnt[c*RadixSize];
+			for(int i=chunkStart[c];i<chunkStart[c+1];++i)
+				++h[(v[i].key>>shift)&(RadixSize-1)];
+		}
+		// the items with the same digit go in the order of the chunks
+		int sum=0;
+		for(int d=0;d<RadixSize;++d)
+			for(int c=0;c<chunkNum;++c)
+			{
+				const int t=cnt[c*RadixSize+d];
+				cnt[c*RadixSize+d]=sum;
+				sum+=t;
+			}
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+		for(int c=0;c<chunkNum;++c)
+		{
+			int *h=&cnt[c*RadixSize];
+			for(int i=chunkStart[c];i<chunkStart[c+1];++i)
+				tmp[h[(v[i].key>>shift)&(RadixSize-1)]++]=v[i];
+		}
+		v.swap(tmp);
+	}
+}
+
+// Split a vector sorted by key in chunkNum parts, none of them breaking a run of items with the same key.
+template <class ItemType>
+static void KeyRunChunks(const std::vector<ItemType> &v, std::vector<int> &chunkStart)
+{
+	const int n=int(v.size());
+	const int chunkNum=std::max(1,std::min(256,n/4096));
+	chunkStart.resize(chunkNum+1);
+	for(int c=0;c<=chunkNum;++c)
+	{
+		int i=int((long long)(n)*c/chunkNum);
+		while(i>0 && i<n && v[i].key==v[i-1].key) ++i;
+		chunkStart[c]=i;
+	}
+}
+
 // Fill a vector with all the edges of the mesh.
 // each edge is stored in the vector the number of times that it appears in the mesh, with the referring face.
 // optionally it can skip the faux edges (to retrieve only the real edges of a triangulated polygonal mesh)
+// The faces are processed in parallel chunks, the order of the edges is the one of the faces.
 
 static void FillEdgeVector(MeshType &m, std::vector<PEdge> &e, bool includeFauxEdge=true)
 {
-	FaceIterator pf;
-	typename std::vector<PEdge>::iterator p;
-
-	// Alloco il vettore ausiliario
-	//e.resize(m.fn*3);
-	FaceIterator fi;
-	int n_edges = 0;
-	for(fi = m.face.begin(); fi != m.face.end(); ++fi) if(! (*fi).IsD()) n_edges+=(*fi).VN();
-	e.resize(n_edges);
-
-	p = e.begin();
-	for(pf=m.face.begin();pf!=m.face.end();++pf)
-		if( ! (*pf).IsD() )
-			for(int j=0;j<(*pf).VN();++j)
-			if(includeFauxEdge || !(*pf).IsF(j))
-				{
-					(*p).Set(&(*pf),j);
-					++p;
-				}
-
-	if(includeFauxEdge) assert(p==e.end());
-	else e.resize(p-e.begin());
+	std::vector<int> chunkStart;
+	std::vector<size_t> offset;
+	FaceChunks(m,EdgeCounter(includeFauxEdge),chunkStart,offset);
+	e.resize(offset.back());
+
+	const int chunkNum=int(chunkStart.size())-1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+	for(int c=0;c<chunkNum;++c)
+	{
+		typename std::vector<PEdge>::iterator p=e.begin()+offset[c];
+		for(int i=chunkStart[c];i<chunkStart[c+1];++i)
+		{
+			FaceType &f=m.face[i];
+			if(!f.IsD())
+				for(int j=0;j<f.VN();++j)
+					if(includeFauxEdge || !f.IsF(j))
+					{
+						(*p).Set(&f,j);
+						++p;
+					}
+		}
+	}
 }
 
 static void FillUniqueEdgeVector(MeshType &m, std::vector<PEdge> &Edges, bool includeFauxEdge=true)
@@ -213,46 +337,88 @@ static void AllocateEdge(MeshType &m)
 }
 
 /// \brief Update the Face-Face topological relation by allowing to retrieve for each face what other faces shares their edges.
+/**
+The edges are sorted by the indexes of their vertices with a parallel radix sort (on the first vertex,
+then on the second one inside each run of edges with the same first vertex), and the edges shared by
+the same faces are linked in parallel.
+The edges with the same vertices are linked in a ring in the order of their faces (and of their index in
+the face), so the result is the same whatever is the number of threads.
+*/
 static void FaceFace(MeshType &m)
 {
   RequireFFAdjacency(m);
   if( m.fn == 0 ) return;
 
-  std::vector<PEdge> e;
-  FillEdgeVector(m,e);
-  sort(e.begin(), e.end());							// Lo ordino per vertici
+  std::vector<int> chunkStart;
+  std::vector<size_t> offset;
+  FaceChunks(m,EdgeCounter(true),chunkStart,offset);
+  std::vector<PEdgeIndex> e(offset.back());
+  int chunkNum=int(chunkStart.size())-1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+  for(int c=0;c<chunkNum;++c)
+  {
+    size_t k=offset[c];
+    for(int i=chunkStart[c];i<chunkStart[c+1];++i)
+    {
+      FaceType &f=m.face[i];
+      if(!f.IsD())
+        for(int j=0;j<f.VN();++j)
+        {
+          unsigned int v0=unsigned(tri::Index(m,f.V(j)));
+          unsigned int v1=unsigned(tri::Index(m,f.V(f.Next(j))));
+          assert(v0 != v1); // The face is Degenerate (two coincident vertexes)
+          if(v0>v1) std::swap(v0,v1);
+          e[k].key=v0;
+          e[k].v1=v1;
+          e[k].f=i;
+          e[k].z=j;
+          ++k;
+        }
+    }
+  }
 
-  int ne = 0;											// Numero di edge reali
+  RadixSort(e,unsigned(m.vert.size()));
 
-  typename std::vector<PEdge>::iterator pe,ps;
-  ps = e.begin();pe=e.begin();
-  //for(ps = e.begin(),pe=e.begin();pe<=e.end();++pe)	// Scansione vettore ausiliario
-  do
+  KeyRunChunks(e,chunkStart);
+  chunkNum=int(chunkStart.size())-1;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic,1)
+#endif
+  for(int c=0;c<chunkNum;++c)
   {
-    if( pe==e.end() || !(*pe == *ps) )					// Trovo blocco di edge uguali
+    int ps=chunkStart[c];
+    while(ps<chunkStart[c+1])
     {
-      typename std::vector<PEdge>::iterator q,q_next;
-      for (q=ps;q<pe-1;++q)						// Scansione facce associate
+      // sort the run of edges with the same first vertex by the second one (they are few, but for the fans of high valence vertices)
+      int pe=ps+1;
+      while(pe<chunkStart[c+1] && e[pe].key==e[ps].key) ++pe;
+      if(pe-ps<=16)
       {
-        assert((*q).z>=0);
-        //assert((*q).z< 3);
-        q_next = q;
-        ++q_next;
-        assert((*q_next).z>=0);
-        assert((*q_next).z< (*q_next).f->VN());
-        (*q).f->FFp(q->z) = (*q_next).f;				// Collegamento in lista delle facce
-        (*q).f->FFi(q->z) = (*q_next).z;
+        for(int q=ps+1;q<pe;++q)
+          for(int r=q;r>ps && e[r]<e[r-1];--r) std::swap(e[r],e[r-1]);
       }
-      assert((*q).z>=0);
-      assert((*q).z< (*q).f->VN());
-      (*q).f->FFp((*q).z) = ps->f;
-      (*q).f->FFi((*q).z) = ps->z;
-      ps = pe;
-      ++ne;										// Aggiorno il numero di edge
+      else std::stable_sort(e.begin()+ps,e.begin()+pe);
+
+      // link in a ring the faces of each block of equal edges
+      int bs=ps;
+      while(bs<pe)
+      {
+        int be=bs+1;
+        while(be<pe && e[be].v1==e[bs].v1) ++be;
+        for(int q=bs;q<be;++q)
+        {
+          const int qn=(q+1<be) ? q+1 : bs;
+          assert(e[qn].z>=0 && e[qn].z<m.face[e[qn].f].VN());
+          m.face[e[q].f].FFp(e[q].z)=&(m.face[e[qn].f]);
+          m.face[e[q].f].FFi(e[q].z)=e[qn].z;
+        }
+        bs=be;
+      }
+      ps=pe;
     }
-    if(pe==e.end()) break;
-    ++pe;
-  } while(true);
+  }
 }
 
 /// \brief Update the Vertex-Face topological relation.
@@ -267,23 +433,45 @@ static void VertexFace(MeshType &m)
 {
   RequireVFAdjacency(m);
 
-  for(VertexIterator vi=m.vert.begin();vi!=m.vert.end();++vi)
+  const int vn=int(m.vert.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for(int i=0;i<vn;++i)
   {
-    (*vi).VFp() = 0;
-    (*vi).VFi() = 0; // note that (0,-1) means uninitiazlied while 0,0 is the valid initialized values for isolated vertices.
+    m.vert[i].VFp() = 0;
+    m.vert[i].VFi() = 0; // note that (0,-1) means uninitiazlied while 0,0 is the valid initialized values for isolated vertices.
   }
 
-  for(FaceIterator fi=m.face.begin();fi!=m.face.end();++fi)
-    if( ! (*fi).IsD() )
+  // Each thread scans all the faces in order, but updates only the lists of its own range of vertices:
+  // the lists are the same built by a serial scan, whatever is the number of threads.
+  const int fn=int(m.face.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    int vb=0, ve=vn;
+#ifdef _OPENMP
+    const int tn=omp_get_num_threads(), ti=omp_get_thread_num();
+    vb=int((long long)(vn)*ti/tn);
+    ve=int((long long)(vn)*(ti+1)/tn);
+#endif
+    VertexPointer v0=(vn>0) ? &(m.vert[0]) : 0;
+    for(int i=0;i<fn;++i)
     {
-      for(int j=0;j<(*fi).VN();++j)
-      {
-        (*fi).VFp(j) = (*fi).V(j)->VFp();
-        (*fi).VFi(j) = (*fi).V(j)->VFi();
-        (*fi).V(j)->VFp() = &(*fi);
-        (*fi).V(j)->VFi() = j;
-      }
+      FaceType &f=m.face[i];
+      if( ! f.IsD() )
+        for(int j=0;j<f.VN();++j)
+        {
+          const int vi=int(f.V(j)-v0);
+          if(vi<vb || vi>=ve) continue;
+          f.VFp(j) = f.V(j)->VFp();
+          f.VFi(j) = f.V(j)->VFi();
+          f.V(j)->VFp() = &f;
+          f.V(j)->VFi() = j;
+        }
     }
+  }
 }
 
 
@@ -108,7 +108,7 @@ static void ComputePerVertexSources(MeshType &m, std::vector<VertexType *> &seed
   PerFacePointerHandle faceSources =  tri::Allocator<MeshType>:: template AddPerFaceAttribute<VertexPointer> (m,"sources");
 
   assert(tri::Allocator<MeshType>::IsValidHandle(m,vertexSources));
-  tri::Geodesic<MeshType>::Compute(m,seedVec,std::numeric_limits<ScalarType>::max(),0,&vertexSources);
+  tri::Geodesic<MeshType>::ComputeParallel(m,seedVec,std::numeric_limits<ScalarType>::max(),&vertexSources);
 }
 
 static void VoronoiColoring(MeshType &m, std::vector<VertexType *> &seedVec, bool frontierFlag=true)
@@ -126,7 +126,7 @@ static void VoronoiColoring(MeshType &m, std::vector<VertexType *> &seedVec, boo
 				std::vector< std::pair<float,VertexPointer> > regionArea(m.vert.size(),zz);
 				std::vector<VertexPointer> borderVec;
 				GetAreaAndFrontier(m, sources,  regionArea, borderVec);
-				tri::Geodesic<MeshType>::Compute(m,borderVec);
+				tri::Geodesic<MeshType>::ComputeParallel(m,borderVec);
 		}
 
 		tri::UpdateColor<MeshType>::PerVertexQualityRamp(m);
@@ -280,7 +280,7 @@ static void VoronoiRelaxing(MeshType &m, std::vector<VertexType *> &seedVec, int
 		typename MeshType::template PerVertexAttributeHandle<VertexPointer> sources;
 		sources = tri::Allocator<MeshType>:: template AddPerVertexAttribute<VertexPointer> (m,"sources");
 		
-		tri::Geodesic<MeshType>::Compute(m,seedVec,std::numeric_limits<ScalarType>::max(),0,&sources);
+		tri::Geodesic<MeshType>::ComputeParallel(m,seedVec,std::numeric_limits<ScalarType>::max(),&sources);
 
 		// Delete all the (hopefully) small regions that have not been reached by the seeds;
 		tri::UpdateFlags<MeshType>::VertexClearV(m);
@@ -318,7 +318,7 @@ static void VoronoiRelaxing(MeshType &m, std::vector<VertexType *> &seedVec, int
   
 		if(cb) cb(iter*100/relaxIter,"Voronoi Lloyd Relaxation: Searching New Seeds");
 			
-		tri::Geodesic<MeshType>::Compute(m,borderVec);
+		tri::Geodesic<MeshType>::ComputeParallel(m,borderVec);
         tri::UpdateColor<MeshType>::PerVertexQualityRamp(m);
 
 		// Search the local maxima for each region and use them as new seeds	
@@ -540,23 +540,31 @@ namespace tri {
 
 		/** Function to delete a face from the mesh.
 			NOTE: THIS FUNCTION ALSO UPDATE FN
+			(atomically, so that different threads can delete different faces)
 		*/
 		static void DeleteFace(MeshType &m, FaceType &f)
 		{
 			assert(&f >= &m.face.front() && &f <= &m.face.back());
 			assert(!f.IsD());
 			f.SetD();
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
 			--m.fn;
 		}
 
 		/** Function to delete a vertex from the mesh.
 			NOTE: THIS FUNCTION ALSO UPDATE vn
+			(atomically, so that different threads can delete different vertices)
 		*/
 		static void DeleteVertex(MeshType &m, VertexType &v)
 		{
 			assert(&v >= &m.vert.front() && &v <= &m.vert.back());
 			assert(!v.IsD());
 			v.SetD();
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
 			--m.vn;
 		}
 
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <stdio.h>
 
 #include <vcg/space/box3.h>
@@ -130,6 +131,34 @@ namespace vcg {
 
 		std::vector<Cell> grid;   /// Griglia vera e propria
 
+		/// Range of addresses of the indexed objects, used by LocalMarker
+		/// (objSpan is zero when the objects are not stored contiguously)
+		ObjPtr objBase;
+		size_t objSpan;
+
+		GridStaticPtr():objBase(0),objSpan(0){}
+
+		/** Marker that keeps its own marks, one for each indexed object, instead of using
+		the per object mark of the mesh. Each thread can use its own LocalMarker to query
+		the same grid concurrently. If the objects are not contiguous in memory the marker
+		does nothing (objects shared by many cells are just tested more than once).
+		*/
+		class LocalMarker
+		{
+		public:
+			LocalMarker(const GridStaticPtr &g):base(g.objBase),stamp(1),marks(g.objSpan,0){}
+			void UnMarkAll()
+			{
+				if(++stamp==0) { std::fill(marks.begin(),marks.end(),0); stamp=1; }
+			}
+			bool IsMarked(ObjPtr obj) const { return !marks.empty() && marks[obj-base]==stamp; }
+			void Mark(ObjPtr obj) { if(!marks.empty()) marks[obj-base]=stamp; }
+		private:
+			ObjPtr base;
+			unsigned int stamp;
+			std::vector<unsigned int> marks;
+		};
+
 
 
     bool Empty() const {return links.empty();}
@@ -317,8 +346,6 @@ namespace vcg {
 		template <class OBJITER>
     inline void Set(const OBJITER & _oBegin, const OBJITER & _oEnd, const Box3x &_bbox, Point3i _siz)
 		{
-			OBJITER i;
-			
 			this->bbox=_bbox;
 			this->siz=_siz;
 			
@@ -332,60 +359,119 @@ namespace vcg {
         // Allocate the grid (add one more for the final sentinel)
 				grid.resize( this->siz[0]*this->siz[1]*this->siz[2]+1 );
 
-        // Insert all the objects into the grid
-				links.clear();
-				for(i=_oBegin; i!=_oEnd; ++i)
+				// Collect the objects so that they can be processed in parallel
+				std::vector<ObjPtr> objs;
+				for(OBJITER i=_oBegin; i!=_oEnd; ++i)
+					objs.push_back(&(*i));
+				const int n = int(objs.size());
+				SetObjRange(objs);
+
+				// Voxel box of each object and position of its first link
+				std::vector<Box3i> iboxes(n);
+				std::vector<int> firstLink(n+1,0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+				for(int k=0;k<n;++k)
 				{
 					Box3x bb;			// Boundig box del tetraedro corrente
-					(*i).GetBBox(bb);
+					objs[k]->GetBBox(bb);
 					bb.Intersect(this->bbox);
-					if(! bb.IsNull() )
-					{
+					if(bb.IsNull()) continue;
+					this->BoxToIBox( bb,iboxes[k] );
+					Point3i d = iboxes[k].max - iboxes[k].min + Point3i(1,1,1);
+					firstLink[k+1] = d[0]*d[1]*d[2];
+				}
+				for(int k=0;k<n;++k)
+					firstLink[k+1]+=firstLink[k];
 
-						Box3i ib;		// Boundig box in voxels
-						this->BoxToIBox( bb,ib );
-						int x,y,z;
-						for(z=ib.min[2];z<=ib.max[2];++z)
+        // Insert all the objects into the grid, each object writes its own range of links
+				links.resize(firstLink[n]+1);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+				for(int k=0;k<n;++k)
+				{
+					if(firstLink[k]==firstLink[k+1]) continue;
+					const Box3i &ib = iboxes[k];
+					int l = firstLink[k];
+					int x,y,z;
+					for(z=ib.min[2];z<=ib.max[2];++z)
+					{
+						int bz = z*this->siz[1];
+						for(y=ib.min[1];y<=ib.max[1];++y)
 						{
-							int bz = z*this->siz[1];
-							for(y=ib.min[1];y<=ib.max[1];++y)
-							{
-								int by = (y+bz)*this->siz[0];
-								for(x=ib.min[0];x<=ib.max[0];++x)
-									// Inserire calcolo cella corrente
-									// if( pt->Intersect( ... )
-									links.push_back( Link(&(*i),by+x) );
-							}
+							int by = (y+bz)*this->siz[0];
+							for(x=ib.min[0];x<=ib.max[0];++x)
+								// Inserire calcolo cella corrente
+								// if( pt->Intersect( ... )
+								links[l++] = Link(objs[k],by+x);
 						}
 					}
 				}
 				// Push della sentinella
-				/*links.push_back( Link((typename ContainerType::iterator)NULL,
-				(grid.size()-1)));*/
-
-				links.push_back( Link( NULL,	int(grid.size())-1) );
+				links.back() = Link( NULL,	int(grid.size())-1);
 
 				// Ordinamento dei links
-				sort( links.begin(), links.end() );
+				SortLinks(links);
 
-				// Creazione puntatori ai links
-				typename std::vector<Link>::iterator pl;
-				unsigned int pg;
-				pl = links.begin();
-				for(pg=0;pg<grid.size();++pg)
+				// Creazione puntatori ai links: each cell points to the first link with index not smaller than its own
+				const int nl = int(links.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+				for(int k=0;k<nl;++k)
 				{
-					assert(pl!=links.end());
-					grid[pg] = &*pl;
-					while( (int)pg == pl->Index() )	// Trovato inizio
-					{
-						++pl;		// Ricerca prossimo blocco
-						if(pl==links.end())
-							break;
-					}
+					const int prev = (k==0) ? -1 : links[k-1].Index();
+					for(int pg=prev+1;pg<=links[k].Index();++pg)
+						grid[pg] = &links[k];
 				}
-
 		}		
 
+		/// Stable sort of the links by cell index: blocks are sorted in parallel and then merged pairwise,
+		/// so the result does not depend on the number of threads
+		/// (links of the same cell keep the order of the objects).
+		static void SortLinks(std::vector<Link> &v)
+		{
+			const int n = int(v.size());
+			const int nb = std::max(1,std::min(64,n/(1<<16)));
+			std::vector<int> bound(nb+1);
+			for(int b=0;b<=nb;++b)
+				bound[b] = int((long long)(n)*b/nb);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for(int b=0;b<nb;++b)
+				std::stable_sort(v.begin()+bound[b],v.begin()+bound[b+1]);
+			for(int w=1;w<nb;w*=2)
+			{
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+				for(int b=0;b<nb-w;b+=2*w)
+					std::inplace_merge(v.begin()+bound[b],v.begin()+bound[b+w],v.begin()+bound[std::min(b+2*w,nb)]);
+			}
+		}
+
+		/// Find the address range of the objects; it is used only if the objects
+		/// are (almost) contiguous, as it happens for the elements of a mesh.
+		void SetObjRange(const std::vector<ObjPtr> &objs)
+		{
+			objBase=0; objSpan=0;
+			if(objs.empty()) return;
+			ObjPtr lo=objs[0], hi=objs[0];
+			for(size_t k=1;k<objs.size();++k)
+			{
+				if(std::less<ObjPtr>()(objs[k],lo)) lo=objs[k];
+				if(std::less<ObjPtr>()(hi,objs[k])) hi=objs[k];
+			}
+			size_t span = size_t(hi-lo)+1;
+			if(span <= 2*objs.size()+1024)
+			{
+				objBase=lo;
+				objSpan=span;
+			}
+		}
 
 		int MemUsed()
 		{
@@ -401,6 +487,40 @@ namespace vcg {
 		}
 
 
+		/** Batched version of GetClosest: for each query point _p[i] it finds the closest object
+		_objectPtrs[i] (NULL if nothing is nearer than _maxDist), its distance _minDists[i] and the
+		closest point _closestPts[i]. The queries are answered in parallel, each thread with its own
+		copy of the distance functor and its own LocalMarker, so the functor must be copyable and
+		the objects must not be modified during the call.
+		*/
+		template <class OBJPOINTDISTFUNCTOR, class QUERYCONTAINER, class OBJPTRCONTAINER, class DISTCONTAINER, class POINTCONTAINER>
+			void GetClosestBatch(OBJPOINTDISTFUNCTOR & _getPointDistance, const QUERYCONTAINER & _p, const ScalarType & _maxDist,
+				OBJPTRCONTAINER & _objectPtrs, DISTCONTAINER & _minDists, POINTCONTAINER & _closestPts)
+		{
+			const int n = int(_p.size());
+			_objectPtrs.resize(n);
+			_minDists.resize(n);
+			_closestPts.resize(n);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+			{
+				OBJPOINTDISTFUNCTOR getPointDistance(_getPointDistance);
+				LocalMarker marker(*this);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,256)
+#endif
+				for(int i=0;i<n;++i)
+				{
+					ScalarType minDist;
+					CoordType closestPt;
+					_objectPtrs[i] = vcg::GridClosest<GridPtrType,OBJPOINTDISTFUNCTOR,LocalMarker>(*this,getPointDistance,marker,_p[i],_maxDist,minDist,closestPt);
+					_minDists[i] = minDist;
+					_closestPts[i] = closestPt;
+				}
+			}
+		}
+
 		template <class OBJPOINTDISTFUNCTOR, class OBJMARKER, class OBJPTRCONTAINER,class DISTCONTAINER, class POINTCONTAINER>
 			unsigned int GetKClosest(OBJPOINTDISTFUNCTOR & _getPointDistance,OBJMARKER & _marker, 
 			const unsigned int _k, const CoordType & _p, const ScalarType & _maxDist,OBJPTRCONTAINER & _objectPtrs,
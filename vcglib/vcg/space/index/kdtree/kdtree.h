@@ -6,6 +6,7 @@
 #include "mlsutils.h"
 #include "priorityqueue.h"
 #include <vector>
+#include <algorithm>
 #include <limits>
 #include <iostream>
 
@@ -42,6 +43,16 @@ public:
 
 /**
  * This class allows to create a Kd-Tree thought to perform the k-nearest neighbour query
+ *
+ * The points are stored per coordinate (x, y and z in three separate arrays) in the
+ * leaf order, so that the distances to all the points of a leaf are computed by a tight
+ * loop that the compiler can vectorize.
+ *
+ * The query state (heap of the neighbours and traversal stack) lives in a QueryContext:
+ * the tree itself is never modified by a query, hence several threads can query the same
+ * tree at the same time as long as each one uses its own QueryContext. The old interface
+ * (setMaxNofNeighbors/doQueryK/getNeighbor*) is kept and uses a context owned by the tree,
+ * so it is NOT thread safe.
  */
 template<typename _Scalar>
 class KdTree
@@ -55,32 +66,67 @@ public:
 	struct Node
 	{
 		union {
-                        //standard node
+			//standard node
 			struct {
 				Scalar splitValue;
-				unsigned int firstChildId:24;
+				unsigned int firstChildId:29;
 				unsigned int dim:2;
 				unsigned int leaf:1;
 			};
-                        //leaf
+			//leaf
 			struct {
 				unsigned int start;
 				unsigned short size;
 			};
-                };
+		};
 	};
 	typedef std::vector<Node> NodeList;
 
-        // return the protected members which store the nodes and the points list
+	/** The state of a kNN query.
+	 *
+	 * The result of the query, the k-nearest neighbors, are stored into a heap, where the
+	 * topmost element [0] is NOT the nearest but the farthest!! (they are not sorted)
+	 */
+	class QueryContext
+	{
+	public:
+		QueryContext(unsigned int k = 1) : mTree(0) { setMaxNofNeighbors(k); }
+
+		inline void setMaxNofNeighbors(unsigned int k) { mNeighborQueue.setMaxSize(k); }
+		inline int getNofFoundNeighbors(void) const { return mNeighborQueue.getNofElements(); }
+		inline VectorType getNeighbor(int i) const { return mTree->getPoint(mNeighborQueue.getIndex(i)); }
+		inline unsigned int getNeighborId(int i) const { return mTree->mIndices[mNeighborQueue.getIndex(i)]; }
+		inline Scalar getNeighborSquaredDistance(int i) const { return mNeighborQueue.getWeight(i); }
+
+	protected:
+		friend class KdTree;
+
+		// element of the stack
+		struct QueryNode
+		{
+			QueryNode() {}
+			QueryNode(unsigned int id) : nodeId(id) {}
+			unsigned int nodeId;  // id of the next node
+			Scalar sq;            // squared distance to the next node
+		};
+
+		const KdTree* mTree; //tree of the last query
+		HeapMaxPriorityQueue<int,Scalar> mNeighborQueue; //used to perform the knn-query
+		std::vector<QueryNode> mNodeStack; //used in the implementation of the knn-query
+	};
+	friend class QueryContext;
+
+	// return the protected members which store the nodes
 	inline const NodeList& _getNodes(void) { return mNodes; }
-	inline const std::vector<VectorType>& _getPoints(void) { return mPoints; }
 
+	// the i-th point of the tree, in the internal (leaf) order
+	inline VectorType getPoint(unsigned int i) const { return VectorType(mPoints[0][i], mPoints[1][i], mPoints[2][i]); }
 
-	void setMaxNofNeighbors(unsigned int k);
-	inline int getNofFoundNeighbors(void) { return mNeighborQueue.getNofElements(); }
-	inline const VectorType& getNeighbor(int i) { return mPoints[ mNeighborQueue.getIndex(i) ]; }
-	inline unsigned int getNeighborId(int i) { return mIndices[mNeighborQueue.getIndex(i)]; }
-	inline float getNeighborSquaredDistance(int i) { return mNeighborQueue.getWeight(i); }
+	inline void setMaxNofNeighbors(unsigned int k) { mDefaultContext.setMaxNofNeighbors(k); }
+	inline int getNofFoundNeighbors(void) { return mDefaultContext.getNofFoundNeighbors(); }
+	inline VectorType getNeighbor(int i) { return mDefaultContext.getNeighbor(i); }
+	inline unsigned int getNeighborId(int i) { return mDefaultContext.getNeighborId(i); }
+	inline float getNeighborSquaredDistance(int i) { return mDefaultContext.getNeighborSquaredDistance(i); }
 
 public:
 
@@ -88,56 +134,119 @@ public:
 
 	~KdTree();
 
-	void doQueryK(const VectorType& p);
+	void doQueryK(const VectorType& p) { doQueryK(p, mDefaultContext); }
+
+	void doQueryK(const VectorType& p, QueryContext& context) const;
+
+	void doQueryK(const ConstDataWrapper<VectorType>& queryPoints, unsigned int k,
+				  std::vector<unsigned int>& neighbors, std::vector<Scalar>& squaredDistances) const;
 
 protected:
 
-	// element of the stack
-	struct QueryNode
+	// a node whose sub-tree still has to be built, see the constructor
+	struct SubTree
 	{
-			QueryNode() {}
-			QueryNode(unsigned int id) : nodeId(id) {}
-			unsigned int nodeId;  // id of the next node
-			Scalar sq;            // squared distance to the next node
+		SubTree() {}
+		SubTree(unsigned int id, unsigned int s, unsigned int e, unsigned int l) : nodeId(id), start(s), end(e), level(l) {}
+		unsigned int nodeId, start, end, level;
 	};
 
 	// used to build the tree: split the subset [start..end[ according to dim and splitValue,
 	// and returns the index of the first element of the second subset
-	unsigned int split(int start, int end, unsigned int dim, float splitValue);
+	unsigned int split(int start, int end, unsigned int dim, Scalar splitValue);
 
-	void createTree(unsigned int nodeId, unsigned int start, unsigned int end, unsigned int level, unsigned int targetCellsize, unsigned int targetMaxDepth);
+	AxisAlignedBoxType computeAABB(unsigned int start, unsigned int end) const;
+
+	void createTree(NodeList& nodes, unsigned int nodeId, unsigned int start, unsigned int end, unsigned int level,
+					unsigned int targetCellsize, unsigned int targetMaxDepth, std::vector<SubTree>* deferred);
 
 protected:
 
-        AxisAlignedBoxType mAABB; //BoundingBox
-        NodeList mNodes; //kd-tree nodes
-        std::vector<VectorType> mPoints; //points read from the input DataWrapper
-        std::vector<int> mIndices; //points indices
+	AxisAlignedBoxType mAABB; //BoundingBox
+	NodeList mNodes; //kd-tree nodes
+	unsigned int mMaxDepth; //maximal depth of the tree, bounds the size of the query stack
+	std::vector<Scalar> mPoints[3]; //coordinates of the points read from the input DataWrapper
+	std::vector<int> mIndices; //points indices
 
-        HeapMaxPriorityQueue<int,Scalar> mNeighborQueue; //used to perform the knn-query
-        QueryNode mNodeStack[64]; //used in the implementation of the knn-query
+	QueryContext mDefaultContext; //used by the non thread safe query interface
 };
 
 template<typename Scalar>
 KdTree<Scalar>::KdTree(const ConstDataWrapper<VectorType>& points, unsigned int nofPointsPerCell, unsigned int maxDepth)
-        : mPoints(points.size()), mIndices(points.size())
+	: mMaxDepth(maxDepth), mIndices(points.size())
 {
-        // compute the AABB of the input
-        mPoints[0] = points[0];
-        mAABB.Set(mPoints[0]);
-        for (unsigned int i=1 ; i<mPoints.size() ; ++i)
-        {
-                mPoints[i] = points[i];
-                mIndices[i] = i;
-                mAABB.Add(mPoints[i]);
-        }
-
-        mNodes.reserve(4*mPoints.size()/nofPointsPerCell);
-
-        //first node inserted (no leaf). The others are made by the createTree function (recursively)
-        mNodes.resize(1);
-        mNodes.back().leaf = 0;
-        createTree(0, 0, mPoints.size(), 1, nofPointsPerCell, maxDepth);
+	const int n = int(points.size());
+	for (int k=0 ; k<3 ; ++k)
+		mPoints[k].resize(n);
+
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
+#endif
+	for (int i=0 ; i<n ; ++i)
+	{
+		const VectorType& p = points[i];
+		mPoints[0][i] = p[0];
+		mPoints[1][i] = p[1];
+		mPoints[2][i] = p[2];
+		mIndices[i] = i;
+	}
+
+	mNodes.reserve(4*n/nofPointsPerCell+1);
+
+	//first node inserted (no leaf). The others are made by the createTree function
+	mNodes.resize(1);
+	if (n == 0)
+	{
+		mNodes.back().leaf = 1;
+		mNodes.back().start = 0;
+		mNodes.back().size = 0;
+		return;
+	}
+	mNodes.back().leaf = 0;
+	mAABB = computeAABB(0, n);
+
+	// The top of the tree is built breadth first, until there are enough sub-trees to keep
+	// all the threads busy; then each sub-tree is built independently into its own node list,
+	// and the lists are appended in order. The result is exactly the tree of a sequential build
+	// (the same splits), only the numbering of the nodes changes.
+	const size_t nofSubTrees = 256;
+	const unsigned int minSubTreeSize = 1<<14;
+	std::vector<SubTree> todo(1, SubTree(0, 0, n, 1));
+	std::vector<SubTree> subTrees;
+	for (size_t i=0 ; i<todo.size() ; ++i)
+	{
+		const SubTree& st = todo[i];
+		if (todo.size() - i + subTrees.size() < nofSubTrees && st.end - st.start >= minSubTreeSize)
+			createTree(mNodes, st.nodeId, st.start, st.end, st.level, nofPointsPerCell, maxDepth, &todo);
+		else
+			subTrees.push_back(st);
+	}
+
+	std::vector<NodeList> subNodes(subTrees.size());
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(dynamic,1)
+#endif
+	for (int i=0 ; i<int(subTrees.size()) ; ++i)
+	{
+		const SubTree& st = subTrees[i];
+		subNodes[i].reserve(4*(st.end-st.start)/nofPointsPerCell+1);
+		subNodes[i].resize(1);
+		subNodes[i][0].leaf = 0;
+		createTree(subNodes[i], 0, st.start, st.end, st.level, nofPointsPerCell, maxDepth, 0);
+	}
+
+	// the root of each sub-tree replaces its placeholder, the other nodes are appended
+	for (size_t i=0 ; i<subTrees.size() ; ++i)
+	{
+		NodeList& nodes = subNodes[i];
+		const unsigned int offset = (unsigned int)(mNodes.size()) - 1;
+		for (size_t j=0 ; j<nodes.size() ; ++j)
+			if (!nodes[j].leaf)
+				nodes[j].firstChildId = nodes[j].firstChildId + offset;
+		mNodes[subTrees[i].nodeId] = nodes[0];
+		mNodes.insert(mNodes.end(), nodes.begin()+1, nodes.end());
+		NodeList().swap(nodes);
+	}
 }
 
 template<typename Scalar>
@@ -145,94 +254,151 @@ KdTree<Scalar>::~KdTree()
 {
 }
 
+/** Performs the kNN query.
+	*
+	* This algorithm uses the simple distance to the split plane to prune nodes.
+	* A more elaborated approach consists to track the closest corner of the cell
+	* relatively to the current query point. This strategy allows to save about 5%
+	* of the leaves. However, in practice the slight overhead due to this tracking
+	* reduces the overall performance.
+	*
+	* This algorithm also use a simple stack while a priority queue using the squared
+	* distances to the cells as a priority values allows to save about 10% of the leaves.
+	* But, again, priority queue insertions and deletions are quite involved, and therefore
+	* a simple stack is by far much faster.
+	*
+	* The result of the query is stored into the context, the tree is not modified.
+	*/
 template<typename Scalar>
-void KdTree<Scalar>::setMaxNofNeighbors(unsigned int k)
+void KdTree<Scalar>::doQueryK(const VectorType& queryPoint, QueryContext& context) const
 {
-        mNeighborQueue.setMaxSize(k);
+	typedef typename QueryContext::QueryNode QueryNode;
+	HeapMaxPriorityQueue<int,Scalar>& neighborQueue = context.mNeighborQueue;
+	//a path from the root to a leaf never has more than mMaxDepth+1 nodes
+	if (context.mNodeStack.size() < mMaxDepth+2)
+		context.mNodeStack.resize(mMaxDepth+2);
+	QueryNode* nodeStack = &context.mNodeStack[0];
+
+	context.mTree = this;
+	neighborQueue.init();
+	neighborQueue.insert(0xffffffff, std::numeric_limits<Scalar>::max());
+
+	nodeStack[0].nodeId = 0;
+	nodeStack[0].sq = 0.f;
+	unsigned int count = 1;
+
+	const Scalar qx = queryPoint[0], qy = queryPoint[1], qz = queryPoint[2];
+	const Scalar* px = mPoints[0].empty() ? 0 : &mPoints[0][0];
+	const Scalar* py = mPoints[1].empty() ? 0 : &mPoints[1][0];
+	const Scalar* pz = mPoints[2].empty() ? 0 : &mPoints[2][0];
+	const unsigned int block = 16;
+	Scalar sqDist[block];
+
+	while (count)
+	{
+		//we select the last node (AABB) inserted in the stack
+		QueryNode& qnode = nodeStack[count-1];
+
+		//while going down the tree qnode.nodeId is the nearest sub-tree, otherwise,
+		//in backtracking, qnode.nodeId is the other sub-tree that will be visited iff
+		//the actual nearest node is further than the split distance.
+		const Node& node = mNodes[qnode.nodeId];
+
+		//if the distance is less than the top of the max-heap, it could be one of the k-nearest neighbours
+		if (qnode.sq < neighborQueue.getTopWeight())
+		{
+			//when we arrive to a lef
+			if (node.leaf)
+			{
+				--count; //pop of the leaf
+
+				//adding the element of the leaf to the heap, a block at a time:
+				//first all the distances (vectorizable), then the insertions
+				const unsigned int end = node.start+node.size;
+				for (unsigned int b=node.start ; b<end ; b+=block)
+				{
+					const unsigned int nb = std::min(block, end-b);
+					for (unsigned int i=0 ; i<nb ; ++i)
+					{
+						Scalar dx = px[b+i] - qx;
+						Scalar dy = py[b+i] - qy;
+						Scalar dz = pz[b+i] - qz;
+						sqDist[i] = dx*dx + dy*dy + dz*dz;
+					}
+					for (unsigned int i=0 ; i<nb ; ++i)
+						neighborQueue.insert(b+i, sqDist[i]);
+				}
+			}
+			//otherwise, if we're not on a leaf
+			else
+			{
+				// the new offset is the distance between the searched point and the actual split coordinate
+				Scalar new_off = queryPoint[node.dim] - node.splitValue;
+
+				//left sub-tree
+				if (new_off < 0.)
+				{
+					nodeStack[count].nodeId  = node.firstChildId;
+					//in the father's nodeId we save the index of the other sub-tree (for backtracking)
+					qnode.nodeId = node.firstChildId+1;
+				}
+				//right sub-tree (same as above)
+				else
+				{
+					nodeStack[count].nodeId  = node.firstChildId+1;
+					qnode.nodeId = node.firstChildId;
+				}
+				//distance is inherited from the father (while descending the tree it's equal to 0)
+				nodeStack[count].sq = qnode.sq;
+				//distance of the father is the squared distance from the split plane
+				qnode.sq = new_off*new_off;
+				++count;
+			}
+		}
+		else
+		{
+			// pop
+			--count;
+		}
+	}
 }
 
-/** Performs the kNN query.
-        *
-        * This algorithm uses the simple distance to the split plane to prune nodes.
-        * A more elaborated approach consists to track the closest corner of the cell
-        * relatively to the current query point. This strategy allows to save about 5%
-        * of the leaves. However, in practice the slight overhead due to this tracking
-        * reduces the overall performance.
-        *
-        * This algorithm also use a simple stack while a priority queue using the squared
-        * distances to the cells as a priority values allows to save about 10% of the leaves.
-        * But, again, priority queue insertions and deletions are quite involved, and therefore
-        * a simple stack is by far much faster.
-  *
-  * The result of the query, the k-nearest neighbors, are internally stored into a stack, where the
-  * topmost element [0] is NOT the nearest but the farthest!! (they are not sorted but arranged into a heap)
-        */
+/** Performs a kNN query for each point of queryPoints, in parallel.
+	*
+	* The ids (as returned by getNeighborId) and the squared distances of the neighbours of the i-th
+	* query point are stored in neighbors[i*k .. i*k+k-1] and squaredDistances[i*k .. i*k+k-1],
+	* arranged into a heap as in QueryContext. k is clamped to the number of points of the tree.
+	*/
 template<typename Scalar>
-void KdTree<Scalar>::doQueryK(const VectorType& queryPoint)
+void KdTree<Scalar>::doQueryK(const ConstDataWrapper<VectorType>& queryPoints, unsigned int k,
+							  std::vector<unsigned int>& neighbors, std::vector<Scalar>& squaredDistances) const
 {
-        mNeighborQueue.init();
-        mNeighborQueue.insert(0xffffffff, std::numeric_limits<Scalar>::max());
-
-        mNodeStack[0].nodeId = 0;
-        mNodeStack[0].sq = 0.f;
-        unsigned int count = 1;
-
-        while (count)
-        {
-                //we select the last node (AABB) inserted in the stack
-                QueryNode& qnode = mNodeStack[count-1];
-
-                //while going down the tree qnode.nodeId is the nearest sub-tree, otherwise,
-                //in backtracking, qnode.nodeId is the other sub-tree that will be visited iff
-                //the actual nearest node is further than the split distance.
-                Node& node = mNodes[qnode.nodeId];
-
-                //if the distance is less than the top of the max-heap, it could be one of the k-nearest neighbours
-                if (qnode.sq < mNeighborQueue.getTopWeight())
-                {
-                        //when we arrive to a lef
-                        if (node.leaf)
-                        {
-                                --count; //pop of the leaf
-
-                                //end is the index of the last element of the leaf in mPoints
-                                unsigned int end = node.start+node.size;
-                                //adding the element of the leaf to the heap
-                                for (unsigned int i=node.start ; i<end ; ++i)
-                                                mNeighborQueue.insert(i, vcg::SquaredNorm(queryPoint - mPoints[i]));
-                        }
-                        //otherwise, if we're not on a leaf
-                        else
-                        {   
-                                // the new offset is the distance between the searched point and the actual split coordinate
-                                float new_off = queryPoint[node.dim] - node.splitValue;
-
-                                //left sub-tree
-                                if (new_off < 0.)
-                                {
-                                                mNodeStack[count].nodeId  = node.firstChildId;
-                                                //in the father's nodeId we save the index of the other sub-tree (for backtracking)
-                                                qnode.nodeId = node.firstChildId+1;
-                                }
-                                //right sub-tree (same as above)
-                                else
-                                {
-                                                mNodeStack[count].nodeId  = node.firstChildId+1;
-                                                qnode.nodeId = node.firstChildId;
-                                }
-                                //distance is inherited from the father (while descending the tree it's equal to 0)
-                                mNodeStack[count].sq = qnode.sq;
-                                //distance of the father is the squared distance from the split plane
-                                qnode.sq = new_off*new_off;
-                                ++count;
-                        }
-                }
-                else
-                {
-                        // pop
-                        --count;
-                }
-        }
+	k = std::min<unsigned int>(k, (unsigned int)(mIndices.size()));
+	const int n = int(queryPoints.size());
+	neighbors.resize(size_t(n)*k);
+	squaredDistances.resize(size_t(n)*k);
+	if (k == 0)
+		return;
+
+#ifdef _OPENMP
+	#pragma omp parallel
+#endif
+	{
+		QueryContext context(k);
+#ifdef _OPENMP
+		#pragma omp for schedule(dynamic,1024)
+#endif
+		for (int i=0 ; i<n ; ++i)
+		{
+			doQueryK(queryPoints[i], context);
+			const size_t base = size_t(i)*k;
+			for (unsigned int j=0 ; j<k ; ++j)
+			{
+				neighbors[base+j] = context.getNeighborId(j);
+				squaredDistances[base+j] = context.getNeighborSquaredDistance(j);
+			}
+		}
+	}
 }
 
 /**
@@ -241,103 +407,135 @@ void KdTree<Scalar>::doQueryK(const VectorType& queryPoint)
  * using the "dim" coordinate [0 = x, 1 = y, 2 = z].
  */
 template<typename Scalar>
-unsigned int KdTree<Scalar>::split(int start, int end, unsigned int dim, float splitValue)
+unsigned int KdTree<Scalar>::split(int start, int end, unsigned int dim, Scalar splitValue)
 {
-        int l(start), r(end-1);
-        for ( ; l<r ; ++l, --r)
-        {
-                while (l < end && mPoints[l][dim] < splitValue)
-                        l++;
-                while (r >= start && mPoints[r][dim] >= splitValue)
-                        r--;
-                if (l > r)
-                        break;
-                std::swap(mPoints[l],mPoints[r]);
-                std::swap(mIndices[l],mIndices[r]);
-        }
-        //returns the index of the first element on the second part
-        return (mPoints[l][dim] < splitValue ? l+1 : l);
+	std::vector<Scalar>& coord = mPoints[dim];
+	int l(start), r(end-1);
+	for ( ; l<r ; ++l, --r)
+	{
+		while (l < end && coord[l] < splitValue)
+			l++;
+		while (r >= start && coord[r] >= splitValue)
+			r--;
+		if (l > r)
+			break;
+		std::swap(mPoints[0][l],mPoints[0][r]);
+		std::swap(mPoints[1][l],mPoints[1][r]);
+		std::swap(mPoints[2][l],mPoints[2][r]);
+		std::swap(mIndices[l],mIndices[r]);
+	}
+	//returns the index of the first element on the second part
+	return (coord[l] < splitValue ? l+1 : l);
 }
 
-/** recursively builds the kdtree
-        *
-        *  The heuristic is the following:
-        *   - if the number of points in the node is lower than targetCellsize then make a leaf
-        *   - else compute the AABB of the points of the node and split it at the middle of
-        *     the largest AABB dimension.
-        *
-        *  This strategy might look not optimal because it does not explicitly prune empty space,
-        *  unlike more advanced SAH-like techniques used for RT. On the other hand it leads to a shorter tree,
-        *  faster to traverse and our experience shown that in the special case of kNN queries,
-        *  this strategy is indeed more efficient (and much faster to build). Moreover, for volume data
-        *  (e.g., fluid simulation) pruning the empty space is useless.
-        *
-        *  Actually, storing at each node the exact AABB (we therefore have a binary BVH) allows
-        *  to prune only about 10% of the leaves, but the overhead of this pruning (ball/ABBB intersection)
-        *  is more expensive than the gain it provides and the memory consumption is x4 higher !
-        */
+/** Computes the bounding box of the points in [start..end[, large ranges are split in
+	* blocks that are processed in parallel.
+	*/
 template<typename Scalar>
-void KdTree<Scalar>::createTree(unsigned int nodeId, unsigned int start, unsigned int end, unsigned int level, unsigned int targetCellSize, unsigned int targetMaxDepth)
+typename KdTree<Scalar>::AxisAlignedBoxType KdTree<Scalar>::computeAABB(unsigned int start, unsigned int end) const
 {
-        //select the first node
-        Node& node = mNodes[nodeId];
-        AxisAlignedBoxType aabb;
-
-        //putting all the points in the bounding box
-        aabb.Set(mPoints[start]);
-        for (unsigned int i=start+1 ; i<end ; ++i)
-                aabb.Add(mPoints[i]);
-
-        //bounding box diagonal
-        VectorType diag = aabb.max - aabb.min;
-
-        //the split "dim" is the dimension of the box with the biggest value
-        unsigned int dim = vcg::MaxCoeffId(diag);
-        node.dim = dim;
-        //we divide the bounding box in 2 partitions, considering the average of the "dim" dimension
-        node.splitValue = Scalar(0.5*(aabb.max[dim] + aabb.min[dim]));
-
-        //midId is the index of the first element in the second partition
-        unsigned int midId = split(start, end, dim, node.splitValue);
-
-
-        node.firstChildId = mNodes.size();
-        mNodes.resize(mNodes.size()+2);
-
-        {
-                // left child
-                unsigned int childId = mNodes[nodeId].firstChildId;
-                Node& child = mNodes[childId];
-                if (midId - start <= targetCellSize || level>=targetMaxDepth)
-                {
-                                child.leaf = 1;
-                                child.start = start;
-                                child.size = midId - start;
-                }
-                else
-                {
-                                child.leaf = 0;
-                                createTree(childId, start, midId, level+1, targetCellSize, targetMaxDepth);
-                }
-        }
-
-        {
-                // right child
-                unsigned int childId = mNodes[nodeId].firstChildId+1;
-                Node& child = mNodes[childId];
-                if (end - midId <= targetCellSize || level>=targetMaxDepth)
-                {
-                        child.leaf = 1;
-                        child.start = midId;
-                        child.size = end - midId;
-                }
-                else
-                {
-                        child.leaf = 0;
-                        createTree(childId, midId, end, level+1, targetCellSize, targetMaxDepth);
-                }
-        }
-}
+	const unsigned int blockSize = 1<<16;
+	AxisAlignedBoxType aabb;
+	if (end-start <= blockSize)
+	{
+		const Scalar* p[3] = { &mPoints[0][0], &mPoints[1][0], &mPoints[2][0] };
+		for (int k=0 ; k<3 ; ++k)
+		{
+			Scalar minV = p[k][start], maxV = p[k][start];
+			for (unsigned int i=start+1 ; i<end ; ++i)
+			{
+				minV = std::min(minV, p[k][i]);
+				maxV = std::max(maxV, p[k][i]);
+			}
+			aabb.min[k] = minV;
+			aabb.max[k] = maxV;
+		}
+		return aabb;
+	}
 
+	const int nofBlocks = int((end-start+blockSize-1)/blockSize);
+	std::vector<AxisAlignedBoxType> boxes(nofBlocks);
+#ifdef _OPENMP
+	#pragma omp parallel for schedule(static)
 #endif
+	for (int b=0 ; b<nofBlocks ; ++b)
+	{
+		const unsigned int s = start + b*blockSize;
+		boxes[b] = computeAABB(s, std::min(end, s+blockSize));
+	}
+	aabb = boxes[0];
+	for (int b=1 ; b<nofBlocks ; ++b)
+		aabb.Add(boxes[b]);
+	return aabb;
+}
 
+/** builds the kdtree
+	*
+	*  The heuristic is the following:
+	*   - if the number of points in the node is lower than targetCellsize then make a leaf
+	*   - else compute the AABB of the points of the node and split it at the middle of
+	*     the largest AABB dimension.
+	*
+	*  This strategy might look not optimal because it does not explicitly prune empty space,
+	*  unlike more advanced SAH-like techniques used for RT. On the other hand it leads to a shorter tree,
+	*  faster to traverse and our experience shown that in the special case of kNN queries,
+	*  this strategy is indeed more efficient (and much faster to build). Moreover, for volume data
+	*  (e.g., fluid simulation) pruning the empty space is useless.
+	*
+	*  Actually, storing at each node the exact AABB (we therefore have a binary BVH) allows
+	*  to prune only about 10% of the leaves, but the overhead of this pruning (ball/ABBB intersection)
+	*  is more expensive than the gain it provides and the memory consumption is x4 higher !
+	*
+	*  The children are recursively built, unless deferred is not null: in that case the inner
+	*  children are just appended to it and their sub-trees are left to the caller.
+	*/
+template<typename Scalar>
+void KdTree<Scalar>::createTree(NodeList& nodes, unsigned int nodeId, unsigned int start, unsigned int end, unsigned int level,
+								unsigned int targetCellSize, unsigned int targetMaxDepth, std::vector<SubTree>* deferred)
+{
+	//select the first node
+	Node& node = nodes[nodeId];
+
+	//putting all the points in the bounding box
+	AxisAlignedBoxType aabb = computeAABB(start, end);
+
+	//bounding box diagonal
+	VectorType diag = aabb.max - aabb.min;
+
+	//the split "dim" is the dimension of the box with the biggest value
+	unsigned int dim = vcg::MaxCoeffId(diag);
+	node.dim = dim;
+	//we divide the bounding box in 2 partitions, considering the average of the "dim" dimension
+	node.splitValue = Scalar(0.5*(aabb.max[dim] + aabb.min[dim]));
+
+	//midId is the index of the first element in the second partition
+	unsigned int midId = split(start, end, dim, node.splitValue);
+
+	node.firstChildId = nodes.size();
+	nodes.resize(nodes.size()+2);
+
+	const unsigned int childStart[2] = { start, midId };
+	const unsigned int childEnd[2] = { midId, end };
+	for (int c=0 ; c<2 ; ++c)
+	{
+		// left child, then right child
+		unsigned int childId = nodes[nodeId].firstChildId+c;
+		Node& child = nodes[childId];
+		if (childEnd[c] - childStart[c] <= targetCellSize || level>=targetMaxDepth)
+		{
+			child.leaf = 1;
+			child.start = childStart[c];
+			child.size = childEnd[c] - childStart[c];
+		}
+		else
+		{
+			child.leaf = 0;
+			if (deferred)
+				deferred->push_back(SubTree(childId, childStart[c], childEnd[c], level+1));
+			else
+				createTree(nodes, childId, childStart[c], childEnd[c], level+1, targetCellSize, targetMaxDepth, 0);
+		}
+	}
+}
+
+#endif
@@ -41,6 +41,31 @@ public:
 	{
 		mElements = 0;
 		mMaxSize = 0;
+		mCount = 0;
+	}
+
+	HeapMaxPriorityQueue(const HeapMaxPriorityQueue& other)
+	{
+		mElements = 0;
+		mMaxSize = 0;
+		*this = other;
+	}
+
+	~HeapMaxPriorityQueue(void)
+	{
+		delete[] mElements;
+	}
+
+	HeapMaxPriorityQueue& operator= (const HeapMaxPriorityQueue& other)
+	{
+		if (this != &other)
+		{
+			setMaxSize(other.mMaxSize);
+			mCount = other.mCount;
+			for (int i=0 ; i<mCount ; ++i)
+				mElements[i] = other.mElements[i];
+		}
+		return *this;
 	}
 
 	inline void setMaxSize(int maxSize)
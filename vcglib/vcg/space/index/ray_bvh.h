@@ -0,0 +1,589 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef __VCGLIB_RAY_BVH
+#define __VCGLIB_RAY_BVH
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <assert.h>
+
+#include <vcg/space/box3.h>
+#include <vcg/space/ray3.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VCG_RAY_BVH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace vcg {
+
+namespace ray_bvh {
+
+/** Four floats processed together: SSE when available, plain loops otherwise.
+  The comparisons return masks that can be combined with And() and read with Mask(). */
+struct Float4
+{
+#ifdef VCG_RAY_BVH_SSE
+	__m128 v;
+	static Float4 Load(const float *p) { Float4 r; r.v=_mm_loadu_ps(p); return r; }
+	static Float4 Splat(float a) { Float4 r; r.v=_mm_set1_ps(a); return r; }
+	void Store(float *p) const { _mm_storeu_ps(p,v); }
+	Float4 operator + (const Float4 &b) const { Float4 r; r.v=_mm_add_ps(v,b.v); return r; }
+	Float4 operator - (const Float4 &b) const { Float4 r; r.v=_mm_sub_ps(v,b.v); return r; }
+	Float4 operator * (const Float4 &b) const { Float4 r; r.v=_mm_mul_ps(v,b.v); return r; }
+	Float4 operator / (const Float4 &b) const { Float4 r; r.v=_mm_div_ps(v,b.v); return r; }
+	static Float4 Min(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_min_ps(a.v,b.v); return r; }
+	static Float4 Max(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_max_ps(a.v,b.v); return r; }
+	static Float4 LessEq(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_cmple_ps(a.v,b.v); return r; }
+	static Float4 Less(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_cmplt_ps(a.v,b.v); return r; }
+	static Float4 NotEq(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_cmpneq_ps(a.v,b.v); return r; }
+	static Float4 And(const Float4 &a, const Float4 &b) { Float4 r; r.v=_mm_and_ps(a.v,b.v); return r; }
+	static int Mask(const Float4 &a) { return _mm_movemask_ps(a.v); }
+#else
+	float v[4];
+	static Float4 Load(const float *p) { Float4 r; for(int i=0;i<4;++i) r.v[i]=p[i]; return r; }
+	static Float4 Splat(float a) { Float4 r; for(int i=0;i<4;++i) r.v[i]=a; return r; }
+	void Store(float *p) const { for(int i=0;i<4;++i) p[i]=v[i]; }
+	Float4 operator + (const Float4 &b) const { Float4 r; for(int i=0;i<4;++i) r.v[i]=v[i]+b.v[i]; return r; }
+	Float4 operator - (const Float4 &b) const { Float4 r; for(int i=0;i<4;++i) r.v[i]=v[i]-b.v[i]; return r; }
+	Float4 operator * (const Float4 &b) const { Float4 r; for(int i=0;i<4;++i) r.v[i]=v[i]*b.v[i]; return r; }
+	Float4 operator / (const Float4 &b) const { Float4 r; for(int i=0;i<4;++i) r.v[i]=v[i]/b.v[i]; return r; }
+	// same operand order as the SSE min/max: the second operand is returned when a comparison fails (NaN)
+	static Float4 Min(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]<b.v[i])?a.v[i]:b.v[i]; return r; }
+	static Float4 Max(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]>b.v[i])?a.v[i]:b.v[i]; return r; }
+	static Float4 LessEq(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]<=b.v[i])?1.0f:0.0f; return r; }
+	static Float4 Less(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]<b.v[i])?1.0f:0.0f; return r; }
+	static Float4 NotEq(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]!=b.v[i])?1.0f:0.0f; return r; }
+	static Float4 And(const Float4 &a, const Float4 &b) { Float4 r; for(int i=0;i<4;++i) r.v[i]=(a.v[i]!=0.0f && b.v[i]!=0.0f)?1.0f:0.0f; return r; }
+	static int Mask(const Float4 &a) { int m=0; for(int i=0;i<4;++i) if(a.v[i]!=0.0f) m|=(1<<i); return m; }
+#endif
+};
+
+} // end namespace ray_bvh
+
+/** Bounding Volume Hierarchy over the faces of a triangle mesh, for fast ray casting on the CPU.
+
+  The hierarchy is built with the surface area heuristic (binned) and then
+  collapsed into a four wide tree: each node stores the boxes of its four children
+  and each leaf stores four triangles, so that a ray is tested against four boxes
+  or four triangles at once (with SSE when available).
+  The triangles are copied in the tree in single precision, the mesh is used
+  only to return the hit faces; the tree must be rebuilt with Set() when the mesh changes.
+
+  The queries do not modify the tree, so they can be issued from many threads at once;
+  the batch versions of the queries process a vector of rays in parallel (OpenMP).
+  The faces are two-sided and the hit distance t is measured along the normalized
+  direction of the ray, in [0,maxDist], as in tri::DoRay().
+
+  Example:
+
+    RayBVH<CMeshO> bvh;
+    bvh.Set(m);
+    float t;
+    CFaceO *f = bvh.DoRay(ray, m.bbox.Diag(), t);
+  */
+template <class MeshType>
+class RayBVH
+{
+public:
+	typedef typename MeshType::FaceType FaceType;
+	typedef typename MeshType::FacePointer FacePointer;
+	typedef typename MeshType::ScalarType ScalarType;
+	typedef Point3<ScalarType> CoordType;
+	typedef Ray3<ScalarType> RayType;
+
+	/// The result of a closest hit query: the face (0 if none), the distance along the ray
+	/// and the barycentric coordinates of the hit point, w.r.t. V(1) and V(2) of the face.
+	struct Hit
+	{
+		Hit() : f(0), t(0), u(0), v(0) {}
+		FacePointer f;
+		ScalarType t;
+		ScalarType u, v;
+	};
+
+	RayBVH() : mesh(0) {}
+
+	/// Build the hierarchy over the non deleted faces of m.
+	void Set(MeshType &m)
+	{
+		mesh = &m;
+		nodes.clear();
+		tris.clear();
+
+		std::vector<BuildPrim> prims;
+		prims.reserve(m.fn);
+		for(int i=0;i<int(m.face.size());++i) if(!m.face[i].IsD())
+		{
+			BuildPrim p;
+			p.face = i;
+			p.box.SetNull();
+			for(int j=0;j<3;++j) p.box.Add(Point3f::Construct(m.face[i].cP(j)));
+			p.center = p.box.Center();
+			prims.push_back(p);
+		}
+		if(prims.empty()) return;
+
+		std::vector<BuildNode> bnodes;
+		bnodes.reserve(2*prims.size()/LeafSize+1);
+		BuildRecursive(prims,0,int(prims.size()),0,bnodes);
+
+		nodes.reserve(bnodes.size()/2+1);
+		tris.reserve(bnodes.size()/2+1);
+		if(bnodes[0].count>0)
+		{
+			// a single leaf: a root with one child
+			nodes.resize(1);
+			InitNode(nodes[0]);
+			SetChild(0,0,bnodes[0],MakeLeaf(bnodes[0],prims));
+		}
+		else Collapse(0,bnodes,prims);
+	}
+
+	bool Empty() const { return nodes.empty(); }
+
+	/// The closest face hit by the ray within maxDist, 0 if none; as tri::DoRay().
+	FacePointer DoRay(const RayType &ray, const ScalarType &maxDist, ScalarType &t) const
+	{
+		Hit h;
+		if(!ClosestHit(ray,maxDist,h)) return 0;
+		t=h.t;
+		return h.f;
+	}
+
+	/// Find the closest hit of the ray within maxDist.
+	bool ClosestHit(const RayType &ray, ScalarType maxDist, Hit &hit) const
+	{
+		hit=Hit();
+		if(nodes.empty()) return false;
+		RayData r(ray,maxDist);
+		int bestFace=-1;
+		float bestU=0,bestV=0;
+		Traverse<false>(r,bestFace,bestU,bestV);
+		if(bestFace<0) return false;
+		hit.f=&mesh->face[bestFace];
+		hit.t=ScalarType(r.tMax);
+		hit.u=ScalarType(bestU);
+		hit.v=ScalarType(bestV);
+		return true;
+	}
+
+	/// Whether the ray hits any face within maxDist (e.g. a shadow or visibility ray).
+	bool AnyHit(const RayType &ray, ScalarType maxDist) const
+	{
+		if(nodes.empty()) return false;
+		RayData r(ray,maxDist);
+		int face=-1;
+		float u,v;
+		return Traverse<true>(r,face,u,v);
+	}
+
+	/// Closest hits of a batch of rays, computed in parallel.
+	void ClosestHit(const std::vector<RayType> &rays, ScalarType maxDist, std::vector<Hit> &hits) const
+	{
+		hits.resize(rays.size());
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic,64)
+#endif
+		for(int i=0;i<int(rays.size());++i)
+			ClosestHit(rays[i],maxDist,hits[i]);
+	}
+
+	/// Any hit test of a batch of rays, computed in parallel: occluded[i] is 1 if rays[i] hits a face within maxDist.
+	void AnyHit(const std::vector<RayType> &rays, ScalarType maxDist, std::vector<char> &occluded) const
+	{
+		occluded.resize(rays.size());
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic,64)
+#endif
+		for(int i=0;i<int(rays.size());++i)
+			occluded[i]=AnyHit(rays[i],maxDist)?1:0;
+	}
+
+	/// As above, with a distance per ray (e.g. the distance of a light or of a viewpoint).
+	void AnyHit(const std::vector<RayType> &rays, const std::vector<ScalarType> &maxDist, std::vector<char> &occluded) const
+	{
+		assert(rays.size()==maxDist.size());
+		occluded.resize(rays.size());
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic,64)
+#endif
+		for(int i=0;i<int(rays.size());++i)
+			occluded[i]=AnyHit(rays[i],maxDist[i])?1:0;
+	}
+
+private:
+	typedef ray_bvh::Float4 Float4;
+
+	enum { LeafSize = 4, BinNum = 16, StackSize = 512, MaxSAHDepth = 48 };
+
+	/// four children boxes, in SoA layout; child[k]>0 is a node, child[k]<0 is the leaf -(child[k]+1)
+	/// and child[k]==0 (the root, that is nobody's child) marks an unused child.
+	struct Node
+	{
+		float bmin[3][4], bmax[3][4];
+		int child[4];
+	};
+
+	/// four triangles as first vertex and edges, in SoA layout; face[k]<0 for an unused triangle (degenerate)
+	struct Tri4
+	{
+		float v0[3][4], e1[3][4], e2[3][4];
+		int face[4];
+	};
+
+	struct BuildPrim
+	{
+		Box3f box;
+		Point3f center;
+		int face;
+	};
+
+	struct BuildNode
+	{
+		Box3f box;
+		int left, right;   // children, for inner nodes
+		int first, count;  // range of prims, for leaves (count>0)
+	};
+
+	struct RayData
+	{
+		RayData(const RayType &ray, ScalarType maxDist)
+		{
+			Point3f o=Point3f::Construct(ray.Origin());
+			Point3f d=Point3f::Construct(ray.Direction());
+			d.Normalize();
+			for(int a=0;a<3;++a)
+			{
+				// avoid zero components: an infinite inverse could give a NaN slab
+				float da = d[a];
+				if(fabs(da)<1e-20f) da = (da<0)? -1e-20f : 1e-20f;
+				org[a]=Float4::Splat(o[a]);
+				dir[a]=Float4::Splat(d[a]);
+				invDir[a]=Float4::Splat(1.0f/da);
+				o3[a]=o[a]; d3[a]=d[a];
+			}
+			tMax=float(maxDist);
+		}
+		Float4 org[3], dir[3], invDir[3];
+		float o3[3], d3[3];
+		float tMax;
+	};
+
+	MeshType *mesh;
+	std::vector<Node> nodes;
+	std::vector<Tri4> tris;
+
+	static float HalfArea(const Box3f &b)
+	{
+		if(b.IsNull()) return 0;
+		Point3f d=b.Dim();
+		return d[0]*d[1]+d[1]*d[2]+d[2]*d[0];
+	}
+
+	// binned SAH build; leaves have at most LeafSize prims (a leaf is tested with a single SIMD test)
+	// beyond MaxSAHDepth the prims are split at the median, to bound the depth of the tree (and of the traversal stack)
+	int BuildRecursive(std::vector<BuildPrim> &prims, int first, int count, int depth, std::vector<BuildNode> &bnodes)
+	{
+		const int id=int(bnodes.size());
+		bnodes.push_back(BuildNode());
+		Box3f box, cbox;
+		box.SetNull(); cbox.SetNull();
+		for(int i=first;i<first+count;++i) { box.Add(prims[i].box); cbox.Add(prims[i].center); }
+		bnodes[id].box=box;
+		bnodes[id].left=bnodes[id].right=-1;
+		bnodes[id].first=first;
+		bnodes[id].count=0;
+		if(count<=LeafSize)
+		{
+			bnodes[id].count=count;
+			return id;
+		}
+
+		int bestAxis=-1, bestBin=0;
+		float bestCost=std::numeric_limits<float>::max();
+		for(int a=0;a<3 && depth<MaxSAHDepth;++a)
+		{
+			const float ext=cbox.max[a]-cbox.min[a];
+			if(!(ext>0)) continue;
+			int binCount[BinNum];
+			Box3f binBox[BinNum];
+			for(int b=0;b<BinNum;++b) { binCount[b]=0; binBox[b].SetNull(); }
+			for(int i=first;i<first+count;++i)
+			{
+				const int b=BinOf(prims[i].center[a],cbox.min[a],ext);
+				binCount[b]++;
+				binBox[b].Add(prims[i].box);
+			}
+			// right to left sweep, then left to right evaluating the cost of the split after bin b
+			float rightArea[BinNum];
+			int rightCount[BinNum];
+			Box3f acc; acc.SetNull();
+			int cnt=0;
+			for(int b=BinNum-1;b>0;--b)
+			{
+				acc.Add(binBox[b]); cnt+=binCount[b];
+				rightArea[b]=HalfArea(acc); rightCount[b]=cnt;
+			}
+			acc.SetNull(); cnt=0;
+			for(int b=0;b<BinNum-1;++b)
+			{
+				acc.Add(binBox[b]); cnt+=binCount[b];
+				if(cnt==0 || rightCount[b+1]==0) continue;
+				const float cost=HalfArea(acc)*cnt + rightArea[b+1]*rightCount[b+1];
+				if(cost<bestCost) { bestCost=cost; bestAxis=a; bestBin=b; }
+			}
+		}
+
+		int mid;
+		if(bestAxis>=0)
+		{
+			const int a=bestAxis;
+			const float ext=cbox.max[a]-cbox.min[a];
+			BuildPrim *p=&prims[first];
+			mid=first+int(std::partition(p,p+count,BinLess(a,cbox.min[a],ext,bestBin))-p);
+		}
+		else
+		{
+			mid=first+count/2;
+			const int a=(depth<MaxSAHDepth)? 0 : cbox.MaxDim(); // all the centers coincide: any split will do
+			BuildPrim *p=&prims[first];
+			std::nth_element(p,p+(mid-first),p+count,CenterLess(a));
+		}
+
+		const int l=BuildRecursive(prims,first,mid-first,depth+1,bnodes);
+		const int r=BuildRecursive(prims,mid,first+count-mid,depth+1,bnodes);
+		bnodes[id].left=l;
+		bnodes[id].right=r;
+		return id;
+	}
+
+	static int BinOf(float c, float minc, float ext)
+	{
+		int b=int(BinNum*(c-minc)/ext);
+		return std::max(0,std::min(int(BinNum)-1,b));
+	}
+
+	struct BinLess
+	{
+		BinLess(int _a, float _minc, float _ext, int _bin):a(_a),minc(_minc),ext(_ext),bin(_bin){}
+		bool operator()(const BuildPrim &p) const { return BinOf(p.center[a],minc,ext)<=bin; }
+		int a; float minc, ext; int bin;
+	};
+
+	struct CenterLess
+	{
+		CenterLess(int _a):a(_a){}
+		bool operator()(const BuildPrim &p0, const BuildPrim &p1) const { return p0.center[a]<p1.center[a]; }
+		int a;
+	};
+
+	static void InitNode(Node &n)
+	{
+		for(int k=0;k<4;++k)
+		{
+			for(int a=0;a<3;++a)
+			{
+				n.bmin[a][k]= std::numeric_limits<float>::max();
+				n.bmax[a][k]=-std::numeric_limits<float>::max();
+			}
+			n.child[k]=0;
+		}
+	}
+
+	void SetChild(int nodeId, int k, const BuildNode &bn, int ref)
+	{
+		for(int a=0;a<3;++a)
+		{
+			nodes[nodeId].bmin[a][k]=bn.box.min[a];
+			nodes[nodeId].bmax[a][k]=bn.box.max[a];
+		}
+		nodes[nodeId].child[k]=ref;
+	}
+
+	int MakeLeaf(const BuildNode &bn, const std::vector<BuildPrim> &prims)
+	{
+		Tri4 t;
+		for(int k=0;k<4;++k)
+		{
+			Point3f v0(0,0,0), v1(0,0,0), v2(0,0,0);
+			t.face[k]=-1;
+			if(k<bn.count)
+			{
+				const FaceType &f=mesh->face[prims[bn.first+k].face];
+				v0=Point3f::Construct(f.cP(0));
+				v1=Point3f::Construct(f.cP(1));
+				v2=Point3f::Construct(f.cP(2));
+				t.face[k]=prims[bn.first+k].face;
+			}
+			for(int a=0;a<3;++a)
+			{
+				t.v0[a][k]=v0[a];
+				t.e1[a][k]=v1[a]-v0[a];
+				t.e2[a][k]=v2[a]-v0[a];
+			}
+		}
+		tris.push_back(t);
+		return -int(tris.size());
+	}
+
+	// turn the binary node bId (an inner one) into a four wide node, opening its largest inner descendants
+	int Collapse(int bId, const std::vector<BuildNode> &bnodes, const std::vector<BuildPrim> &prims)
+	{
+		int ch[4];
+		int chNum=2;
+		ch[0]=bnodes[bId].left;
+		ch[1]=bnodes[bId].right;
+		while(chNum<4)
+		{
+			int best=-1;
+			float bestArea=-1;
+			for(int k=0;k<chNum;++k)
+				if(bnodes[ch[k]].count==0 && HalfArea(bnodes[ch[k]].box)>bestArea) { best=k; bestArea=HalfArea(bnodes[ch[k]].box); }
+			if(best<0) break;
+			const int open=ch[best];
+			ch[best]=bnodes[open].left;
+			ch[chNum++]=bnodes[open].right;
+		}
+
+		const int id=int(nodes.size());
+		nodes.push_back(Node());
+		InitNode(nodes[id]);
+		for(int k=0;k<chNum;++k)
+		{
+			const BuildNode &bn=bnodes[ch[k]];
+			const int ref = (bn.count>0) ? MakeLeaf(bn,prims) : Collapse(ch[k],bnodes,prims);
+			SetChild(id,k,bn,ref);
+		}
+		return id;
+	}
+
+	// test the ray against the four triangles of a leaf; returns the mask of the hits closer than r.tMax
+	static int IntersectTri4(const Tri4 &t, const RayData &r, Float4 &tt, Float4 &uu, Float4 &vv)
+	{
+		const Float4 e1x=Float4::Load(t.e1[0]), e1y=Float4::Load(t.e1[1]), e1z=Float4::Load(t.e1[2]);
+		const Float4 e2x=Float4::Load(t.e2[0]), e2y=Float4::Load(t.e2[1]), e2z=Float4::Load(t.e2[2]);
+		// pvec = dir ^ e2
+		const Float4 px=r.dir[1]*e2z-r.dir[2]*e2y;
+		const Float4 py=r.dir[2]*e2x-r.dir[0]*e2z;
+		const Float4 pz=r.dir[0]*e2y-r.dir[1]*e2x;
+		const Float4 det=e1x*px+e1y*py+e1z*pz;
+		const Float4 zero=Float4::Splat(0.0f), one=Float4::Splat(1.0f);
+		const Float4 invDet=one/det;
+		// tvec = org - v0
+		const Float4 tx=r.org[0]-Float4::Load(t.v0[0]);
+		const Float4 ty=r.org[1]-Float4::Load(t.v0[1]);
+		const Float4 tz=r.org[2]-Float4::Load(t.v0[2]);
+		uu=(tx*px+ty*py+tz*pz)*invDet;
+		// qvec = tvec ^ e1
+		const Float4 qx=ty*e1z-tz*e1y;
+		const Float4 qy=tz*e1x-tx*e1z;
+		const Float4 qz=tx*e1y-ty*e1x;
+		vv=(r.dir[0]*qx+r.dir[1]*qy+r.dir[2]*qz)*invDet;
+		tt=(e2x*qx+e2y*qy+e2z*qz)*invDet;
+		Float4 ok=Float4::NotEq(det,zero);
+		ok=Float4::And(ok,Float4::LessEq(zero,uu));
+		ok=Float4::And(ok,Float4::LessEq(zero,vv));
+		ok=Float4::And(ok,Float4::LessEq(uu+vv,one));
+		ok=Float4::And(ok,Float4::LessEq(zero,tt));
+		ok=Float4::And(ok,Float4::LessEq(tt,Float4::Splat(r.tMax)));
+		return Float4::Mask(ok);
+	}
+
+	// test the ray against the four boxes of a node; returns the mask of the hit boxes and their entry distances
+	static int IntersectNode(const Node &n, const RayData &r, float tNear[4])
+	{
+		Float4 t0=Float4::Splat(0.0f);
+		Float4 t1=Float4::Splat(r.tMax);
+		for(int a=0;a<3;++a)
+		{
+			const Float4 ta=(Float4::Load(n.bmin[a])-r.org[a])*r.invDir[a];
+			const Float4 tb=(Float4::Load(n.bmax[a])-r.org[a])*r.invDir[a];
+			t0=Float4::Max(Float4::Min(ta,tb),t0);
+			t1=Float4::Min(Float4::Max(ta,tb),t1);
+		}
+		t0.Store(tNear);
+		return Float4::Mask(Float4::LessEq(t0,t1));
+	}
+
+	// Closest hit (ANY=false) or any hit (ANY=true) traversal; r.tMax shrinks to the closest hit found.
+	template <bool ANY>
+	bool Traverse(RayData &r, int &bestFace, float &bestU, float &bestV) const
+	{
+		int stack[StackSize];
+		float stackT[StackSize];
+		int sp=0;
+		stack[sp]=0; stackT[sp]=0; ++sp;
+		bool found=false;
+		while(sp>0)
+		{
+			--sp;
+			if(stackT[sp]>r.tMax) continue;
+			const int ref=stack[sp];
+			if(ref<0)
+			{
+				const Tri4 &t=tris[-ref-1];
+				Float4 tt,uu,vv;
+				const int mask=IntersectTri4(t,r,tt,uu,vv);
+				if(mask==0) continue;
+				if(ANY) return true;
+				float ta[4],ua[4],va[4];
+				tt.Store(ta); uu.Store(ua); vv.Store(va);
+				for(int k=0;k<4;++k)
+					if((mask&(1<<k)) && ta[k]<=r.tMax)
+					{
+						r.tMax=ta[k];
+						bestFace=t.face[k]; bestU=ua[k]; bestV=va[k];
+						found=true;
+					}
+				continue;
+			}
+			const Node &n=nodes[ref];
+			float tNear[4];
+			const int mask=IntersectNode(n,r,tNear);
+			// push the hit children from the farthest to the nearest, so that the nearest is visited first
+			int order[4], cnt=0;
+			for(int k=0;k<4;++k) if((mask&(1<<k)) && n.child[k]!=0)
+			{
+				int j=cnt++;
+				while(j>0 && tNear[order[j-1]]<tNear[k]) { order[j]=order[j-1]; --j; }
+				order[j]=k;
+			}
+			assert(sp+cnt<=StackSize);
+			for(int j=0;j<cnt;++j)
+			{
+				stack[sp]=n.child[order[j]];
+				stackT[sp]=tNear[order[j]];
+				++sp;
+			}
+		}
+		return found;
+	}
+};
+
+} // end namespace vcg
+
+#endif
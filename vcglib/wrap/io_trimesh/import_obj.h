@@ -35,6 +35,9 @@
 #include <vcg/space/color4.h>
 
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -70,7 +73,10 @@ namespace vcg {
 					{
 						mask	= 0;
 						cb		= 0;
+						numVertices=0;
+						numFaces=0;
 						numTexCoords=0;
+						numNormals=0;
 					}
 
 					/// It returns a bit mask describing the field preesnt in the ply file
@@ -90,6 +96,11 @@ namespace vcg {
 					/// number of normals
 					int numNormals;
 
+					/// content of the file, filled by LoadMask and released by Open
+					std::vector<char> buffer;
+					/// name of the file whose content is in buffer
+					std::string bufferName;
+
 				}; // end class
 
 
@@ -104,6 +115,7 @@ namespace vcg {
 				struct ObjIndexedFace
 				{
 					void set(const int & num){v.resize(num);n.resize(num); t.resize(num);}
+					int Size() const {return int(v.size());}
 					std::vector<int> v;
 					std::vector<int> n;
 					std::vector<int> t;
@@ -112,12 +124,82 @@ namespace vcg {
 					Color4b c;
 				};
 
+				/// Fixed size version of ObjIndexedFace used when loading triangle meshes
+				struct ObjTriangle
+				{
+					int Size() const {return 3;}
+					int v[3];
+					int n[3];
+					int t[3];
+					int tInd;
+					bool edge[3];
+					Color4b c;
+				};
+
 				struct ObjTexCoord
 				{
 					float u;
 					float v;
 				};
 
+				/// Indexes of a face corner as read from the file
+				struct ObjCorner
+				{
+					int v;
+					int t;
+					int n;
+				};
+
+				/// Material state (texture index and face color) that applies to the records following a usemtl
+				struct ObjState
+				{
+					int tInd;
+					Color4b color;
+				};
+
+				/// A mtllib or usemtl statement, with the position in the chunk where it was found
+				struct ObjStateEvent
+				{
+					bool isMtlLib;
+					std::string name;
+					int vertBefore;
+					int faceBefore;
+					ObjState state;
+				};
+
+				/*!
+				* A piece of the file, made of whole lines, that is parsed independently from the others.
+				* Negative (relative) indexes are stored relative to the beginning of the chunk and
+				* marked in cornerRel (bit 0 vertex, bit 1 texcoord, bit 2 normal); cornerRel is
+				* allocated only when the chunk contains relative indexes.
+				*/
+				struct ObjChunk
+				{
+					ObjChunk() : begin(0), end(0), error(E_NOERROR), mrgbLines(0), hasRel(false), vBase(0), tBase(0), nBase(0), fBase(0) {}
+					const char *begin;
+					const char *end;
+					int error;
+					int mrgbLines;
+					bool hasRel;
+
+					std::vector<CoordType> vp;
+					std::vector<Color4b> vc;
+					std::vector<bool> vcFlag;
+					std::vector<ObjTexCoord> vt;
+					std::vector<CoordType> vn;
+					std::vector<int> faceStart;
+					std::vector<ObjCorner> corners;
+					std::vector<unsigned char> cornerRel;
+					std::vector<ObjStateEvent> events;
+					std::vector<Color4b> mrgb;
+
+					std::vector<ObjTriangle> tris;
+					std::vector<ObjIndexedFace> polys;
+
+					int vBase, tBase, nBase, fBase;
+					ObjState startState;
+				};
+
 				enum OBJError {
 					// Successfull opening
 					E_NOERROR													= 0x000,	//	0  (position of correspondig string in the array)
@@ -214,6 +296,11 @@ namespace vcg {
 				* \param m The mesh model to be populated with data stored into the file
 				* \param filename The name of the file to be opened
 				* \param oi A structure containing infos about the object to be opened
+				*
+				* The file is read in memory only once (by LoadMask, that keeps it in oi)
+				* and split in chunks at line boundaries; the chunks are parsed in parallel
+				* and then stitched together, resolving relative indexes and material
+				* changes in file order.
 				*/
 				static int Open( OpenMeshType &m, const char * filename, Info &oi)
 				{
@@ -222,11 +309,15 @@ namespace vcg {
 					m.Clear();
 					CallBackPos *cb = oi.cb;
 
-					// if LoadMask has not been called yet, we call it here
-					if (oi.mask == -1)
-						LoadMask(filename, oi);
+					// if LoadMask has not been called yet (or it was called on another file) we call it here
+					if (oi.mask == -1 || oi.bufferName != filename)
+					{
+						const int userMask = oi.mask;
+						if (!LoadMask(filename, oi))
+							return E_CANTOPEN;
+						if (userMask != -1) oi.mask = userMask;
+					}
 
-					const int inputMask = oi.mask;
 					Mask::ClampMask<OpenMeshType>(m,oi.mask);
 
 					if (oi.numVertices == 0)
@@ -236,300 +327,52 @@ namespace vcg {
 					//if (oi.numFaces == 0)
 					//	return E_NO_FACE;
 
-					std::ifstream stream(filename);
-					if (stream.fail())
-						return E_CANTOPEN;
+					std::vector<ObjChunk> chunks;
+					SplitBuffer(oi.buffer, chunks);
+					const int nChunks = int(chunks.size());
 
-					std::vector<Material>	materials;  // materials vector
-					std::vector<ObjTexCoord>	texCoords;  // texture coordinates
-					std::vector<CoordType>  normals;		// vertex normals
-					std::vector<ObjIndexedFace> indexedFaces;
-					std::vector< std::string > tokens;
-					std::string	header;
+					// First pass: every chunk is tokenized and its records are stored in
+					// chunk local arrays. Indexes are not resolved yet.
+					if ((cb != NULL) && !(*cb)(0, "Parsing")) return E_ABORTED;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+					for (int ci = 0; ci < nChunks; ++ci)
+						ParseChunk(chunks[ci], oi.mask, HasPerVertexColor(m));
 
-					short currentMaterialIdx = 0;			// index of current material into materials vector
-					Color4b currentColor=Color4b::LightGray;	// we declare this outside code block since other
-					// triangles of this face will share the same color
+					for (int ci = 0; ci < nChunks; ++ci)
+						if (ErrorCritical(chunks[ci].error)) return chunks[ci].error;
 
+					// Serial pass: prefix sums of the counts and, in file order, the
+					// material statements that change the state used by the following records.
+					std::vector<Material>	materials;  // materials vector
 					Material defaultMaterial;					// default material: white
 					materials.push_back(defaultMaterial);
-
-					int numVertices  = 0;  // stores the number of vertices been read till now
-					int numTriangles = 0;  // stores the number of faces been read till now
-					int numTexCoords = 0;  // stores the number of texture coordinates been read till now
-					int numVNormals	 = 0;  // stores the number of vertex normals been read till now
-
-					int numVerticesPlusFaces = oi.numVertices + oi.numFaces;
-					int extraTriangles=0;
-					// vertices and faces allocatetion
-					VertexIterator vi = vcg::tri::Allocator<OpenMeshType>::AddVertices(m,oi.numVertices);
-					//FaceIterator   fi = Allocator<OpenMeshType>::AddFaces(m,oi.numFaces);
-					std::vector<Color4b> vertexColorVector;
-					ObjIndexedFace	ff;
-					const char *loadingStr = "Loading";
-					while (!stream.eof())
+					short currentMaterialIdx = 0;			// index of current material into materials vector
+					Color4b currentColor=Color4b::LightGray;
+					int totV = 0, totT = 0, totN = 0;
+					for (int ci = 0; ci < nChunks; ++ci)
 					{
-						tokens.clear();
-						TokenizeNextLine(stream, tokens,&vertexColorVector);
-
-						unsigned int numTokens = static_cast<unsigned int>(tokens.size());
-						if (numTokens > 0)
+						ObjChunk &c = chunks[ci];
+						c.vBase = totV; c.tBase = totT; c.nBase = totN;
+						totV += int(c.vp.size()); totT += int(c.vt.size()); totN += int(c.vn.size());
+						c.startState.color = currentColor;
+						c.startState.tInd = materials[currentMaterialIdx].index;
+						for (size_t ei = 0; ei < c.events.size(); ++ei)
 						{
-							header.clear();
-							header = tokens[0];
-
-							// callback invocation, abort loading process if the call returns false
-							if ((cb !=NULL) && (((numTriangles + numVertices)%100)==0) && !(*cb)((100*(numTriangles + numVertices))/numVerticesPlusFaces, loadingStr))
-								return E_ABORTED;
-
-							if (header.compare("v")==0)	// vertex
-							{
-								loadingStr="Vertex Loading";
-								if (numTokens < 4) return E_BAD_VERTEX_STATEMENT;
-
-								(*vi).P()[0] = (ScalarType) atof(tokens[1].c_str());
-								(*vi).P()[1] = (ScalarType) atof(tokens[2].c_str());
-								(*vi).P()[2] = (ScalarType) atof(tokens[3].c_str());
-								++numVertices;
-
-								// assigning vertex color
-								// ----------------------
-								if (((oi.mask & vcg::tri::io::Mask::IOM_VERTCOLOR) != 0) && (HasPerVertexColor(m)))
-								{
-									if(numTokens>=7)
-									{
-										ScalarType rf(atof(tokens[4].c_str())), gf(atof(tokens[5].c_str())), bf(atof(tokens[6].c_str()));
-										ScalarType scaling = (rf<=1 && gf<=1 && bf<=1) ? 255. : 1;
-
-										unsigned char r			= (unsigned char) ((ScalarType) atof(tokens[4].c_str()) * scaling);
-										unsigned char g			= (unsigned char) ((ScalarType) atof(tokens[5].c_str()) * scaling);
-										unsigned char b			= (unsigned char) ((ScalarType) atof(tokens[6].c_str()) * scaling);
-										unsigned char alpha = (unsigned char) ((numTokens>=8 ? (ScalarType) atof(tokens[7].c_str()) : 1)  * scaling);
-										(*vi).C() = Color4b(r, g, b, alpha);
-									}
-									else
-									{
-										(*vi).C() = currentColor;
-									}
-								}
-
-								++vi;  // move to next vertex iterator
-							}
-							else if (header.compare("vt")==0)	// vertex texture coords
-							{
-								loadingStr="Vertex Texture Loading";
-
-								if (numTokens < 3) return E_BAD_VERT_TEX_STATEMENT;
-
-								ObjTexCoord t;
-								t.u = static_cast<float>(atof(tokens[1].c_str()));
-								t.v = static_cast<float>(atof(tokens[2].c_str()));
-								texCoords.push_back(t);
-
-								numTexCoords++;
-							}
-							else if (header.compare("vn")==0)  // vertex normal
-							{
-								loadingStr="Vertex Normal Loading";
-
-								if (numTokens != 4) return E_BAD_VERT_NORMAL_STATEMENT;
-
-								CoordType n;
-								n[0] = (ScalarType) atof(tokens[1].c_str());
-								n[1] = (ScalarType) atof(tokens[2].c_str());
-								n[2] = (ScalarType) atof(tokens[3].c_str());
-								normals.push_back(n);
-
-								numVNormals++;
-							}
-							else if( (header.compare("f")==0) || (header.compare("q")==0) )  // face
+							ObjStateEvent &ev = c.events[ei];
+							if (ev.isMtlLib)
 							{
-								loadingStr="Face Loading";
-
-								bool QuadFlag = false; // QOBJ format by Silva et al for simply storing quadrangular meshes.
-								if(header.compare("q")==0) { QuadFlag=true; assert(numTokens == 5); }
-
-								if (numTokens < 4) return E_LESS_THAN_3VERTINFACE;
-								int vertexesPerFace = static_cast<int>(tokens.size()-1);
-
-								if( (vertexesPerFace>3) && OpenMeshType::FaceType::HasPolyInfo() )
-								{
-									//_BEGIN___ if  you are loading a GENERIC POLYGON mesh
-									ff.set(vertexesPerFace);
-									for(int i=0;i<vertexesPerFace;++i) { // remember index starts from 1 instead of 0
-										SplitToken(tokens[i+1], ff.v[i], ff.n[i], ff.t[i], inputMask);
-										if(QuadFlag) ff.v[i]++; // NOTE THAT THE STUPID QOBJ FORMAT IS ZERO INDEXED!!!!
-									}
-									if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD )
-									{
-										// verifying validity of texture coords indices
-										for(int i=0;i<vertexesPerFace;i++)
-											if(!GoodObjIndex(ff.t[i],oi.numTexCoords))
-												return E_BAD_VERT_TEX_INDEX;
-
-										ff.tInd=materials[currentMaterialIdx].index;
-									}
-
-									// verifying validity of vertex indices
-									std::vector<int> tmp = ff.v;
-									std::sort(tmp.begin(),tmp.end());
-									std::unique(tmp.begin(),tmp.end());
-									if(tmp.size() != ff.v.size())
-										result = E_VERTICES_WITH_SAME_IDX_IN_FACE;
-
-									for(int i=0;i<vertexesPerFace;i++)
-										if(!GoodObjIndex(ff.v[i],numVertices))
-											return E_BAD_VERT_INDEX;
-
-
-									if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL ) // assigning face normal
-									{
-										// verifying validity of vertex normal indices
-										for(int i=0;i<vertexesPerFace;i++)
-											if(!GoodObjIndex(ff.n[i],numVNormals)) return E_BAD_VERT_NORMAL_INDEX;
-									}
-
-
-									if( oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) // assigning face color
-										ff.c = currentColor;
-
-									++numTriangles;
-									indexedFaces.push_back(ff);
-
-									//_END  ___ if  you are loading a GENERIC POLYGON mesh
-								}
-								else
-								{
-									//_BEGIN___ if  you are loading a  TRIMESH mesh
-									std::vector<std::vector<vcg::Point3f> > polygonVect(1); // it is a vector of polygon loops
-									polygonVect[0].resize(vertexesPerFace);
-									std::vector<int> indexVVect(vertexesPerFace);
-									std::vector<int> indexNVect(vertexesPerFace);
-									std::vector<int> indexTVect(vertexesPerFace);
-									std::vector<int> indexTriangulatedVect;
-
-									for(int pi=0;pi<vertexesPerFace;++pi)
-									{
-										SplitToken(tokens[pi+1], indexVVect[pi],indexNVect[pi],indexTVect[pi], inputMask);
-										if(QuadFlag) indexVVect[pi]++; // NOTE THAT THE STUPID QOBJ FORMAT IS ZERO INDEXED!!!!
-										GoodObjIndex(indexVVect[pi],numVertices);
-										GoodObjIndex(indexTVect[pi],oi.numTexCoords);
-										polygonVect[0][pi].Import(m.vert[indexVVect[pi]].cP());
-									}
-									if(vertexesPerFace>3)
-									   oi.mask |= Mask::IOM_BITPOLYGONAL;
-
-									if(vertexesPerFace<5)
-										InternalFanTessellator(polygonVect, indexTriangulatedVect);
-									else
-									{
-#ifdef __gl_h_
-										//qDebug("OK: using opengl tessellation for a polygon of %i verteces",vertexesPerFace);
-										vcg::glu_tesselator::tesselate<vcg::Point3f>(polygonVect, indexTriangulatedVect);
-#else
-										//qDebug("Warning: using fan tessellation for a polygon of %i verteces",vertexesPerFace);
-										InternalFanTessellator(polygonVect, indexTriangulatedVect);
-#endif
-									}
-									extraTriangles+=((indexTriangulatedVect.size()/3) -1);
-#ifdef QT_VERSION
-									if( int(indexTriangulatedVect.size()/3) != vertexesPerFace-2)
-									{
-										qDebug("Warning there is a degenerate poligon of %i verteces that was triangulated into %i triangles",vertexesPerFace,int(indexTriangulatedVect.size()/3));
-										for(size_t qq=0;qq<polygonVect[0].size();++qq)
-											qDebug("      (%f %f %f)",polygonVect[0][qq][0],polygonVect[0][qq][1],polygonVect[0][qq][2]);
-										for(size_t qq=0;qq<tokens.size();++qq) qDebug("<%s>",tokens[qq].c_str());
-									}
-#endif
-									//qDebug("Triangulated a face of %i vertexes into %i triangles",polygonVect[0].size(),indexTriangulatedVect.size());
-
-									for(size_t pi=0;pi<indexTriangulatedVect.size();pi+=3)
-									{
-										ff.set(3);
-										int locInd[3];
-										for(int iii=0;iii<3;++iii)
-										{
-											locInd[iii]=indexTriangulatedVect[pi+iii];
-											ff.v[iii]=indexVVect[ locInd[iii] ];
-											ff.t[iii]=indexTVect[ locInd[iii] ];
-										}
-
-										// Setting internal edges: only edges formed by consecutive edges are external.
-										for(int iii=0;iii<3;++iii)
-										{
-											if( (locInd[iii]+1)%vertexesPerFace == locInd[(iii+1)%3]) ff.edge[iii]=false;
-											else ff.edge[iii]=true;
-										}
-
-										if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD )
-										{ // verifying validity of texture coords indices
-											bool invalid = false;
-											for(int i=0;i<3;i++)
-												if(!GoodObjIndex(ff.t[i],oi.numTexCoords))
-												{
-													//return E_BAD_VERT_TEX_INDEX;
-													invalid = true;
-													break;
-												}
-												if (invalid) continue;
-												ff.tInd=materials[currentMaterialIdx].index;
-										}
-
-										// verifying validity of vertex indices
-										if ((ff.v[0] == ff.v[1]) || (ff.v[0] == ff.v[2]) || (ff.v[1] == ff.v[2]))
-											result = E_VERTICES_WITH_SAME_IDX_IN_FACE;
-
-										{
-											bool invalid = false;
-											for(int i=0;i<3;i++)
-												if(!GoodObjIndex(ff.v[i],numVertices))
-												{
-													//return E_BAD_VERT_INDEX;
-													invalid = true;
-													break;
-												}
-												if (invalid) continue;
-										}
-
-										// assigning face normal
-										if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL )
-										{   // verifying validity of vertex normal indices
-											bool invalid = false;
-											for(int i=0;i<3;i++)
-												if(!GoodObjIndex(ff.n[i],numVNormals))
-												{
-													//return E_BAD_VERT_NORMAL_INDEX;
-													invalid = true;
-													break;
-												}
-												if (invalid) continue;
-										}
-
-										// assigning face color
-										if( oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) ff.c = currentColor;
-
-										++numTriangles;
-										indexedFaces.push_back(ff);
-									}
-
-								}
-							}
-							else if (header.compare("mtllib")==0)	// material library
-							{
-								// obtain the name of the file containing materials library
-								std::string materialFileName = tokens[1];
-								if (!LoadMaterials( materialFileName.c_str(), materials, m.textures))
+								if (!LoadMaterials( ev.name.c_str(), materials, m.textures))
 									result = E_MATERIAL_FILE_NOT_FOUND;
+								if (materials.empty()) materials.push_back(defaultMaterial);
+								if (currentMaterialIdx >= short(materials.size())) currentMaterialIdx = 0;
 							}
-							else if (header.compare("usemtl")==0)	// material usage
+							else
 							{
-								std::string materialName = tokens[1];
 								bool found = false;
-								unsigned i = 0;
-								while (!found && (i < materials.size()))
-								{
-									std::string currentMaterialName = materials[i].materialName;
-									if (currentMaterialName == materialName)
+								for (unsigned i = 0; !found && i < materials.size(); ++i)
+									if (materials[i].materialName == ev.name)
 									{
 										currentMaterialIdx = i;
 										Material &material = materials[currentMaterialIdx];
@@ -541,94 +384,649 @@ namespace vcg {
 										currentColor= Color4b(r, g, b, alpha);
 										found = true;
 									}
-									++i;
-								}
-
 								if (!found)
 								{
 									currentMaterialIdx = 0;
 									result = E_MATERIAL_NOT_FOUND;
 								}
 							}
-							// we simply ignore other situations
-						} // end for each line...
-					} // end while stream not eof
-					assert((numTriangles +numVertices) == numVerticesPlusFaces+extraTriangles);
+							ev.state.color = currentColor;
+							ev.state.tInd = materials[currentMaterialIdx].index;
+						}
+					}
+
+					// Second pass: vertices are copied in the mesh and faces are resolved
+					// (and triangulated) chunk by chunk.
+					if ((cb != NULL) && !(*cb)(50, "Vertex Loading")) return E_ABORTED;
+					vcg::tri::Allocator<OpenMeshType>::AddVertices(m,totV);
+					std::vector<ObjTexCoord> texCoords(totT);
+					std::vector<CoordType> normals(totN);
+					const bool vertColor = ((oi.mask & vcg::tri::io::Mask::IOM_VERTCOLOR) != 0) && (HasPerVertexColor(m));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+					for (int ci = 0; ci < nChunks; ++ci)
+					{
+						ObjChunk &c = chunks[ci];
+						std::copy(c.vt.begin(), c.vt.end(), texCoords.begin()+c.tBase);
+						std::copy(c.vn.begin(), c.vn.end(), normals.begin()+c.nBase);
+						size_t ei = 0;
+						ObjState st = c.startState;
+						for (size_t i = 0; i < c.vp.size(); ++i)
+						{
+							VertexType &v = m.vert[c.vBase+i];
+							v.P() = c.vp[i];
+							if (vertColor)
+							{
+								while (ei < c.events.size() && c.events[ei].vertBefore <= int(i)) st = c.events[ei++].state;
+								v.C() = c.vcFlag[i] ? c.vc[i] : st.color;
+							}
+						}
+						std::vector<CoordType>().swap(c.vp);
+						std::vector<Color4b>().swap(c.vc);
+					}
+
+					// polygons are triangulated using the vertex positions, so all the vertices must be there
+					const bool polyMesh = OpenMeshType::FaceType::HasPolyInfo();
+					int bitPolygonal = 0;
+					int sameIdx = 0;
+					int criticalError = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:bitPolygonal,sameIdx,criticalError)
+#endif
+					for (int ci = 0; ci < nChunks; ++ci)
+					{
+						if (ResolveChunk(m, chunks[ci], oi, totV, totT, totN, polyMesh, bitPolygonal, sameIdx) != E_NOERROR)
+							++criticalError;
+					}
+					if (criticalError)
+					{
+						for (int ci = 0; ci < nChunks; ++ci)
+							if (chunks[ci].error != E_NOERROR) return chunks[ci].error;
+					}
+					if (bitPolygonal) oi.mask |= Mask::IOM_BITPOLYGONAL;
+					if (sameIdx) result = E_VERTICES_WITH_SAME_IDX_IN_FACE;
+
+					if ((cb != NULL) && !(*cb)(75, "Face Loading")) return E_ABORTED;
+					int numTriangles = 0;
+					for (int ci = 0; ci < nChunks; ++ci)
+					{
+						chunks[ci].fBase = numTriangles;
+						numTriangles += int(polyMesh ? chunks[ci].polys.size() : chunks[ci].tris.size());
+					}
 					vcg::tri::Allocator<OpenMeshType>::AddFaces(m,numTriangles);
 					//-------------------------------------------------------------------------------
 
 					// Now the final passes:
 					// First Pass to convert indexes into pointers for face to vert/norm/tex references
-					for(int i=0; i<numTriangles; ++i)
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+					for (int ci = 0; ci < nChunks; ++ci)
 					{
-						assert(m.face.size() == size_t(m.fn));
-						m.face[i].Alloc(indexedFaces[i].v.size()); // it does not do anything if it is a trimesh
+						ObjChunk &c = chunks[ci];
+						if (polyMesh)
+							for (size_t i = 0; i < c.polys.size(); ++i) FillFace(m, m.face[c.fBase+i], c.polys[i], oi, texCoords, normals);
+						else
+							for (size_t i = 0; i < c.tris.size(); ++i) FillFace(m, m.face[c.fBase+i], c.tris[i], oi, texCoords, normals);
+					}
 
-						for(unsigned int j=0;j<indexedFaces[i].v.size();++j)
+					// Per vertex texture coords and normals are written through the faces
+					// (the last face referring to a vertex wins), so this is done in order.
+					if ( (oi.mask & vcg::tri::io::Mask::IOM_VERTTEXCOORD) || (oi.mask & vcg::tri::io::Mask::IOM_VERTNORMAL) )
+					{
+						for (int ci = 0; ci < nChunks; ++ci)
 						{
-							m.face[i].V(j) = &(m.vert[indexedFaces[i].v[j]]);
+							ObjChunk &c = chunks[ci];
+							if (polyMesh)
+								for (size_t i = 0; i < c.polys.size(); ++i) FillFaceVertex(m.face[c.fBase+i], c.polys[i], oi, texCoords, normals);
+							else
+								for (size_t i = 0; i < c.tris.size(); ++i) FillFaceVertex(m.face[c.fBase+i], c.tris[i], oi, texCoords, normals);
+						}
+					}
 
-							if (((oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD) != 0) && (HasPerWedgeTexCoord(m)))
+					// final pass to manage the ZBrush PerVertex Color that are managed into comments
+					std::vector<Color4b> vertexColorVector;
+					for (int ci = 0; ci < nChunks; ++ci)
+					{
+						vertexColorVector.insert(vertexColorVector.end(), chunks[ci].mrgb.begin(), chunks[ci].mrgb.end());
+						MRGBLineCount() += chunks[ci].mrgbLines;
+					}
+					if(vertexColorVector.size()>0)
+					{
+						for(int i=0;i<m.vn && i<int(vertexColorVector.size());++i)
+						{
+							m.vert[i].C()=vertexColorVector[i];
+						}
+					}
+
+					// the file content is not needed anymore
+					std::vector<char>().swap(oi.buffer);
+					oi.bufferName.clear();
+					return result;
+				} // end of Open
+
+				/*!
+				* Resolve the face records of a chunk: relative indexes are made absolute,
+				* indexes are checked and polygons are triangulated (unless the mesh is polygonal).
+				* Returns a critical error code, or E_NOERROR.
+				*/
+				static int ResolveChunk(OpenMeshType &m, ObjChunk &c, const Info &oi,
+				                        int totV, int totT, int totN, bool polyMesh, int &bitPolygonal, int &sameIdx)
+				{
+					size_t ei = 0;
+					ObjState st = c.startState;
+					const int nf = int(c.faceStart.size())-1;
+					std::vector<int> indexVVect, indexNVect, indexTVect, indexTriangulatedVect;
+					std::vector<std::vector<vcg::Point3f> > polygonVect(1); // it is a vector of polygon loops
+					ObjIndexedFace ff;
+					for (int fi = 0; fi < nf; ++fi)
+					{
+						while (ei < c.events.size() && c.events[ei].faceBefore <= fi) st = c.events[ei++].state;
+						const int first = c.faceStart[fi];
+						const int vertexesPerFace = c.faceStart[fi+1]-first;
+						indexVVect.resize(vertexesPerFace);
+						indexNVect.resize(vertexesPerFace);
+						indexTVect.resize(vertexesPerFace);
+						for (int i = 0; i < vertexesPerFace; ++i)
+						{
+							const ObjCorner &oc = c.corners[first+i];
+							const unsigned char rel = c.cornerRel.empty() ? 0 : c.cornerRel[first+i];
+							indexVVect[i] = (rel & 1) ? oc.v + c.vBase : oc.v;
+							indexTVect[i] = (rel & 2) ? oc.t + c.tBase : oc.t;
+							indexNVect[i] = (rel & 4) ? oc.n + c.nBase : oc.n;
+						}
+
+						if( (vertexesPerFace>3) && polyMesh )
+						{
+							//_BEGIN___ if  you are loading a GENERIC POLYGON mesh
+							ff.set(vertexesPerFace);
+							ff.v = indexVVect; ff.n = indexNVect; ff.t = indexTVect;
+							if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD )
 							{
-								ObjTexCoord t = texCoords[indexedFaces[i].t[j]];
-								m.face[i].WT(j).u() = t.u;
-								m.face[i].WT(j).v() = t.v;
-								m.face[i].WT(j).n() = indexedFaces[i].tInd;
-							}
-							if ( oi.mask & vcg::tri::io::Mask::IOM_VERTTEXCOORD ) {
-								ObjTexCoord t = texCoords[indexedFaces[i].t[j]];
-								m.face[i].V(j)->T().u() = t.u;
-								m.face[i].V(j)->T().v() = t.v;
-								m.face[i].V(j)->T().n() = indexedFaces[i].tInd;
+								// verifying validity of texture coords indices
+								for(int i=0;i<vertexesPerFace;i++)
+									if(!GoodIndex(ff.t[i],totT)) { c.error = E_BAD_VERT_TEX_INDEX; return c.error; }
+								ff.tInd=st.tInd;
 							}
-							if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL )
+
+							// verifying validity of vertex indices
+							std::vector<int> tmp = ff.v;
+							std::sort(tmp.begin(),tmp.end());
+							if(std::unique(tmp.begin(),tmp.end()) != tmp.end())
+								sameIdx = 1;
+
+							for(int i=0;i<vertexesPerFace;i++)
+								if(!GoodIndex(ff.v[i],totV)) { c.error = E_BAD_VERT_INDEX; return c.error; }
+
+							if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL ) // assigning face normal
 							{
-								m.face[i].WN(j).Import(normals[indexedFaces[i].n[j]]);
+								// verifying validity of vertex normal indices
+								for(int i=0;i<vertexesPerFace;i++)
+									if(!GoodIndex(ff.n[i],totN)) { c.error = E_BAD_VERT_NORMAL_INDEX; return c.error; }
 							}
 
-							if ( oi.mask & vcg::tri::io::Mask::IOM_VERTNORMAL )
+							for(int i=0;i<vertexesPerFace;i++) ff.edge[i%3] = false;
+							if( oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) // assigning face color
+								ff.c = st.color;
+
+							c.polys.push_back(ff);
+							//_END  ___ if  you are loading a GENERIC POLYGON mesh
+							continue;
+						}
+
+						//_BEGIN___ if  you are loading a  TRIMESH mesh
+						if(vertexesPerFace>3)
+							bitPolygonal = 1;
+
+						// unlike the polygonal faces, a face with a bad vertex index is just skipped
+						// (its vertexes are needed to triangulate it)
+						bool invalid = false;
+						for(int i=0;i<vertexesPerFace;i++)
+							if(!GoodIndex(indexVVect[i],totV))
 							{
-								m.face[i].V(j)->N().Import(normals[indexedFaces[i].n[j]]);
+								invalid = true;
+								break;
 							}
+						if (invalid) continue;
 
-							// set faux edge flags according to internals faces
-							if (indexedFaces[i].edge[j]) m.face[i].SetF(j);
-							else m.face[i].ClearF(j);
+						indexTriangulatedVect.clear();
+						if(vertexesPerFace==3)
+						{
+							indexTriangulatedVect.push_back(0);
+							indexTriangulatedVect.push_back(1);
+							indexTriangulatedVect.push_back(2);
+						}
+						else
+						{
+							polygonVect[0].resize(vertexesPerFace);
+							for(int pi=0;pi<vertexesPerFace;++pi)
+								polygonVect[0][pi].Import(m.vert[indexVVect[pi]].cP());
+							if(vertexesPerFace<5)
+								InternalFanTessellator(polygonVect, indexTriangulatedVect);
+							else
+							{
+#ifdef __gl_h_
+#ifdef _OPENMP
+#pragma omp critical (obj_glu_tesselator)
+#endif
+								vcg::glu_tesselator::tesselate<vcg::Point3f>(polygonVect, indexTriangulatedVect);
+#else
+								InternalFanTessellator(polygonVect, indexTriangulatedVect);
+#endif
+							}
 						}
 
-						if (HasPerFaceNormal(m))
+						for(size_t pi=0;pi<indexTriangulatedVect.size();pi+=3)
 						{
-							if (((oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) != 0) && (HasPerFaceColor(m)))
+							ObjTriangle tri;
+							int locInd[3];
+							for(int iii=0;iii<3;++iii)
 							{
-								m.face[i].C() = indexedFaces[i].c;
+								locInd[iii]=indexTriangulatedVect[pi+iii];
+								tri.v[iii]=indexVVect[ locInd[iii] ];
+								tri.t[iii]=indexTVect[ locInd[iii] ];
+								tri.n[iii]=indexNVect[ locInd[iii] ];
 							}
+							tri.tInd = 0;
 
-							if (((oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL) != 0) && (HasPerWedgeNormal(m)))
+							// a triangle with a bad texture or normal index is skipped
+							for(int iii=0;iii<3;++iii)
+								if(((oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD) && !GoodIndex(tri.t[iii],totT)) ||
+								   ((oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL) && !GoodIndex(tri.n[iii],totN)))
+								{
+									invalid = true;
+									break;
+								}
+							if (invalid) { invalid = false; continue; }
+
+							// Setting internal edges: only edges formed by consecutive edges are external.
+							for(int iii=0;iii<3;++iii)
 							{
-								// face normal is computed as an average of wedge normals
-								m.face[i].N().Import(m.face[i].WN(0)+m.face[i].WN(1)+m.face[i].WN(2));
+								if( (locInd[iii]+1)%vertexesPerFace == locInd[(iii+1)%3]) tri.edge[iii]=false;
+								else tri.edge[iii]=true;
 							}
-							else
+
+							if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD )
+								tri.tInd=st.tInd;
+
+							if ((tri.v[0] == tri.v[1]) || (tri.v[0] == tri.v[2]) || (tri.v[1] == tri.v[2]))
+								sameIdx = 1;
+
+							// assigning face color
+							if( oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) tri.c = st.color;
+
+							if (polyMesh)
 							{
-								face::ComputeNormalizedNormal(m.face[i]);
+								ff.set(3);
+								for(int iii=0;iii<3;++iii) { ff.v[iii]=tri.v[iii]; ff.t[iii]=tri.t[iii]; ff.n[iii]=tri.n[iii]; ff.edge[iii]=tri.edge[iii]; }
+								ff.tInd=tri.tInd; ff.c=tri.c;
+								c.polys.push_back(ff);
 							}
+							else c.tris.push_back(tri);
 						}
+						//_END  ___ if  you are loading a  TRIMESH mesh
 					}
-					// final pass to manage the ZBrush PerVertex Color that are managed into comments
-					if(vertexColorVector.size()>0)
+					std::vector<ObjCorner>().swap(c.corners);
+					std::vector<unsigned char>().swap(c.cornerRel);
+					std::vector<int>().swap(c.faceStart);
+					return E_NOERROR;
+				}
+
+				/// Set the references and the per wedge / per face attributes of a face from its record
+				template <class FaceRecord>
+				static void FillFace(OpenMeshType &m, FaceType &f, const FaceRecord &r, const Info &oi,
+				                     const std::vector<ObjTexCoord> &texCoords, const std::vector<CoordType> &normals)
+				{
+					f.Alloc(r.Size()); // it does not do anything if it is a trimesh
+
+					for(int j=0;j<r.Size();++j)
 					{
-						//	  if(vertexColorVector.size()!=m.vn){
-						//		qDebug("Warning Read %i vertices and %i vertex colors",m.vn,vertexColorVector.size());
-						//		qDebug("line count %i x 64 = %i",MRGBLineCount(), MRGBLineCount()*64);
-						//	  }
-						for(int i=0;i<m.vn;++i)
+						f.V(j) = &(m.vert[r.v[j]]);
+
+						if (((oi.mask & vcg::tri::io::Mask::IOM_WEDGTEXCOORD) != 0) && (HasPerWedgeTexCoord(m)))
 						{
-							m.vert[i].C()=vertexColorVector[i];
+							ObjTexCoord t = texCoords[r.t[j]];
+							f.WT(j).u() = t.u;
+							f.WT(j).v() = t.v;
+							f.WT(j).n() = r.tInd;
+						}
+						if ( oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL )
+						{
+							f.WN(j).Import(normals[r.n[j]]);
+						}
+
+						// set faux edge flags according to internals faces
+						if (j<3)
+						{
+							if (r.edge[j]) f.SetF(j);
+							else f.ClearF(j);
 						}
 					}
 
-					return result;
-				} // end of Open
+					if (HasPerFaceNormal(m))
+					{
+						if (((oi.mask & vcg::tri::io::Mask::IOM_FACECOLOR) != 0) && (HasPerFaceColor(m)))
+						{
+							f.C() = r.c;
+						}
+
+						if (((oi.mask & vcg::tri::io::Mask::IOM_WEDGNORMAL) != 0) && (HasPerWedgeNormal(m)))
+						{
+							// face normal is computed as an average of wedge normals
+							f.N().Import(f.WN(0)+f.WN(1)+f.WN(2));
+						}
+						else
+						{
+							face::ComputeNormalizedNormal(f);
+						}
+					}
+				}
+
+				/// Per vertex texture coords and normals stored in the face records
+				template <class FaceRecord>
+				static void FillFaceVertex(FaceType &f, const FaceRecord &r, const Info &oi,
+				                           const std::vector<ObjTexCoord> &texCoords, const std::vector<CoordType> &normals)
+				{
+					for(int j=0;j<r.Size();++j)
+					{
+						if ( (oi.mask & vcg::tri::io::Mask::IOM_VERTTEXCOORD) && r.t[j]>=0 && r.t[j]<int(texCoords.size()) ) {
+							ObjTexCoord t = texCoords[r.t[j]];
+							f.V(j)->T().u() = t.u;
+							f.V(j)->T().v() = t.v;
+							f.V(j)->T().n() = r.tInd;
+						}
+						if ( (oi.mask & vcg::tri::io::Mask::IOM_VERTNORMAL) && r.n[j]>=0 && r.n[j]<int(normals.size()) )
+						{
+							f.V(j)->N().Import(normals[r.n[j]]);
+						}
+					}
+				}
+
+				static bool GoodIndex(int index, int count)
+				{
+					return index >= 0 && index < count;
+				}
+
+				/// Split the file content in (at most MaxChunks) pieces ending at line boundaries.
+				static void SplitBuffer(const std::vector<char> &buffer, std::vector<ObjChunk> &chunks)
+				{
+					const size_t ChunkSize = 1<<20;
+					const size_t MaxChunks = 1024;
+					const char *base = buffer.empty() ? 0 : &buffer[0];
+					const size_t size = buffer.size();
+					size_t n = std::max<size_t>(1, std::min(MaxChunks, size/ChunkSize));
+					chunks.resize(n);
+					size_t from = 0;
+					for (size_t i = 0; i < n; ++i)
+					{
+						size_t to = (i+1==n) ? size : std::max(from, size*(i+1)/n);
+						while (to < size && base[to-1] != '\n') ++to;
+						chunks[i].begin = base+from;
+						chunks[i].end = base+to;
+						from = to;
+					}
+				}
+
+				static bool IsBlank(char c) { return c==' ' || c=='\t' || c=='\r'; }
+
+				/// A line ending with a backslash continues on the next one: the backslash and
+				/// the line end are replaced by blanks, so that every record is on a single line
+				static void JoinContinuedLines(std::vector<char> &buffer)
+				{
+					if (buffer.empty()) return;
+					char *p = &buffer[0];
+					char *e = p+buffer.size();
+					while ((p = (char *) memchr(p, '\\', e-p)) != 0)
+					{
+						char *q = p+1;
+						if (q<e && *q=='\r') ++q;
+						if (q<e && *q=='\n') std::fill(p, q+1, ' ');
+						p = q;
+					}
+				}
+
+				/// Skip blanks and return the end of the next token
+				static const char *NextToken(const char *&p, const char *e)
+				{
+					while (p<e && IsBlank(*p)) ++p;
+					const char *q = p;
+					while (q<e && !IsBlank(*q)) ++q;
+					return q;
+				}
+
+				/*!
+				* Allocation free conversion of a decimal number. Numbers with more than 19
+				* significant digits, exponents out of the exactly representable range or
+				* unusual syntax fall back to strtod so the result is always the same of atof.
+				*/
+				static double ParseDouble(const char *s, const char *e)
+				{
+					static const double pow10[23] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+					                                  1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22 };
+					const char *p = s;
+					bool neg = false;
+					if (p<e && (*p=='-' || *p=='+')) { neg = (*p=='-'); ++p; }
+					unsigned long long mant = 0;
+					int digits = 0, exp10 = 0;
+					bool any = false, exact = true;
+					for (; p<e && *p>='0' && *p<='9'; ++p, any = true)
+					{
+						if (digits<19) { mant = mant*10 + (*p-'0'); if (mant) ++digits; }
+						else { ++exp10; if (*p!='0') exact = false; }
+					}
+					if (p<e && *p=='.')
+						for (++p; p<e && *p>='0' && *p<='9'; ++p, any = true)
+						{
+							if (digits<19) { mant = mant*10 + (*p-'0'); if (mant) ++digits; --exp10; }
+							else if (*p!='0') exact = false;
+						}
+					if (any && p<e && (*p=='e' || *p=='E'))
+					{
+						const char *q = p+1;
+						bool eneg = false;
+						if (q<e && (*q=='-' || *q=='+')) { eneg = (*q=='-'); ++q; }
+						if (q<e && *q>='0' && *q<='9')
+						{
+							int ev = 0;
+							for (; q<e && *q>='0' && *q<='9'; ++q) if (ev<10000) ev = ev*10 + (*q-'0');
+							exp10 += eneg ? -ev : ev;
+							p = q;
+						}
+					}
+					if (!any || !exact || p!=e || mant >= (1ULL<<53) || exp10 < -22 || exp10 > 22)
+					{
+						char buf[64];
+						if (size_t(e-s) >= sizeof(buf)) return atof(std::string(s,e).c_str());
+						memcpy(buf, s, e-s);
+						buf[e-s] = 0;
+						return atof(buf);
+					}
+					double v = double(mant);
+					v = (exp10 < 0) ? v / pow10[-exp10] : v * pow10[exp10];
+					return neg ? -v : v;
+				}
+
+				static int ParseInt(const char *p, const char *e)
+				{
+					bool neg = false;
+					if (p<e && (*p=='-' || *p=='+')) { neg = (*p=='-'); ++p; }
+					int v = 0;
+					for (; p<e && *p>='0' && *p<='9'; ++p) v = v*10 + (*p-'0');
+					return neg ? -v : v;
+				}
+
+				/// True if [p,e) is an integer, with an optional sign
+				static bool IsInt(const char *p, const char *e)
+				{
+					if (p<e && (*p=='-' || *p=='+')) ++p;
+					if (p==e) return false;
+					for (; p<e; ++p) if (*p<'0' || *p>'9') return false;
+					return true;
+				}
+
+				/// Same rules of SplitToken, on a token delimited by p and e.
+				/// Returns the error code of the first part (vertex, texture or normal index) that is not a number.
+				static int SplitToken(const char *p, const char *e, int & vId, int & nId, int & tId)
+				{
+					vId = nId = tId = 0;
+					const char *first = std::find(p, e, '/');
+					const char *second = (first == e) ? e : std::find(first+1, e, '/');
+					if (!IsInt(p, first)) return E_BAD_VERT_INDEX;
+					vId = ParseInt(p, first) - 1;
+					if (first != e && first+1 < second)
+					{
+						if (!IsInt(first+1, second)) return E_BAD_VERT_TEX_INDEX;
+						tId = ParseInt(first+1, second) - 1;
+					}
+					if (second != e && second+1 < e)
+					{
+						if (!IsInt(second+1, e)) return E_BAD_VERT_NORMAL_INDEX;
+						nId = ParseInt(second+1, e) - 1;
+					}
+					return E_NOERROR;
+				}
+
+				/// Convert an index read from the file into an absolute one or (for negative,
+				/// i.e. relative, indexes) into one relative to the beginning of the chunk.
+				static int ChunkIndex(int id, int localCount, unsigned char bit, unsigned char &rel)
+				{
+					if (id >= -1) return id; // -1 (i.e. a 0 in the file) is not a valid index
+					rel |= bit;
+					return localCount + id + 1;
+				}
+
+				/// Parse all the lines of a chunk
+				static void ParseChunk(ObjChunk &c, int mask, bool hasPerVertexColor)
+				{
+					const char *p = c.begin;
+					const char *tok[9];
+					const char *tokEnd[9];
+					while (p < c.end && c.error == E_NOERROR)
+					{
+						const char *lineEnd = std::find(p, c.end, '\n');
+						const char *lineBegin = p;
+						p = (lineEnd == c.end) ? lineEnd : lineEnd+1;
+
+						if (lineBegin < lineEnd && *lineBegin == '#')
+						{
+							// The following MRGB block contains ZBrush Vertex Color (Polypaint)
+							// and masking output as 4 hexadecimal values per vertex. The vertex color format is MMRRGGBB with up to 64 entries per MRGB line.
+							const size_t len = lineEnd-lineBegin;
+							if ((len >= 5) && lineBegin[1] == 'M' && lineBegin[2] == 'R' && lineBegin[3] == 'G' && lineBegin[4] == 'B')
+							{ // Parsing the polycolor of ZBrush
+								c.mrgbLines++;
+								Color4b cc(Color4b::Black);
+								for(size_t i=6;(i+7)<len;i+=8)
+								{
+									for(size_t j=1;j<4;j++)
+									{
+										char buf[3];
+										buf[0]=lineBegin[i+j*2+0];
+										buf[1]=lineBegin[i+j*2+1];
+										buf[2]=0;
+										char *pp;
+										cc[j-1]= (unsigned char) strtoul(buf,&pp,16);
+									}
+									c.mrgb.push_back(cc);
+								}
+							}
+							continue;
+						}
+
+						// tokenize (only the first few tokens are kept, the others are just counted)
+						const char *q = lineBegin;
+						int numTokens = 0;
+						for (;;)
+						{
+							const char *te = NextToken(q, lineEnd);
+							if (q == te) break;
+							if (numTokens < 9) { tok[numTokens] = q; tokEnd[numTokens] = te; }
+							++numTokens;
+							q = te;
+						}
+						if (numTokens == 0) continue;
+
+						const size_t hl = tokEnd[0]-tok[0];
+						const char h0 = tok[0][0];
+						const char h1 = (hl > 1) ? tok[0][1] : 0;
+						if (hl == 1 && h0 == 'v')	// vertex
+						{
+							if (numTokens < 4) { c.error = E_BAD_VERTEX_STATEMENT; return; }
+							c.vp.push_back(CoordType((ScalarType) ParseDouble(tok[1],tokEnd[1]),
+							                         (ScalarType) ParseDouble(tok[2],tokEnd[2]),
+							                         (ScalarType) ParseDouble(tok[3],tokEnd[3])));
+							if (((mask & vcg::tri::io::Mask::IOM_VERTCOLOR) == 0) || !hasPerVertexColor) continue;
+							Color4b col(Color4b::LightGray);
+							bool hasColor = false;
+							if (numTokens>=7)
+							{
+								ScalarType rf(ParseDouble(tok[4],tokEnd[4])), gf(ParseDouble(tok[5],tokEnd[5])), bf(ParseDouble(tok[6],tokEnd[6]));
+								ScalarType scaling = (rf<=1 && gf<=1 && bf<=1) ? 255. : 1;
+								unsigned char r			= (unsigned char) (rf * scaling);
+								unsigned char g			= (unsigned char) (gf * scaling);
+								unsigned char b			= (unsigned char) (bf * scaling);
+								unsigned char alpha = (unsigned char) ((numTokens>=8 ? (ScalarType) ParseDouble(tok[7],tokEnd[7]) : 1)  * scaling);
+								col = Color4b(r, g, b, alpha);
+								hasColor = true;
+							}
+							c.vc.push_back(col);
+							c.vcFlag.push_back(hasColor);
+						}
+						else if (hl == 2 && h0 == 'v' && h1 == 't')	// vertex texture coords
+						{
+							if (numTokens < 3) { c.error = E_BAD_VERT_TEX_STATEMENT; return; }
+							ObjTexCoord t;
+							t.u = static_cast<float>(ParseDouble(tok[1],tokEnd[1]));
+							t.v = static_cast<float>(ParseDouble(tok[2],tokEnd[2]));
+							c.vt.push_back(t);
+						}
+						else if (hl == 2 && h0 == 'v' && h1 == 'n')  // vertex normal
+						{
+							if (numTokens != 4) { c.error = E_BAD_VERT_NORMAL_STATEMENT; return; }
+							c.vn.push_back(CoordType((ScalarType) ParseDouble(tok[1],tokEnd[1]),
+							                         (ScalarType) ParseDouble(tok[2],tokEnd[2]),
+							                         (ScalarType) ParseDouble(tok[3],tokEnd[3])));
+						}
+						else if (hl == 1 && (h0 == 'f' || h0 == 'q'))  // face
+						{
+							// QOBJ format by Silva et al for simply storing quadrangular meshes.
+							const bool QuadFlag = (h0 == 'q');
+							if (numTokens < 4) { c.error = E_LESS_THAN_3VERTINFACE; return; }
+							if (c.faceStart.empty()) c.faceStart.push_back(0);
+							const char *fq = tok[1];
+							for (;;)
+							{
+								const char *te = NextToken(fq, lineEnd);
+								if (fq == te) break;
+								ObjCorner oc;
+								unsigned char rel = 0;
+								c.error = SplitToken(fq, te, oc.v, oc.n, oc.t);
+								if (c.error != E_NOERROR) return;
+								if (QuadFlag) oc.v++; // NOTE THAT THE STUPID QOBJ FORMAT IS ZERO INDEXED!!!!
+								oc.v = ChunkIndex(oc.v, int(c.vp.size()), 1, rel);
+								oc.t = ChunkIndex(oc.t, int(c.vt.size()), 2, rel);
+								oc.n = ChunkIndex(oc.n, int(c.vn.size()), 4, rel);
+								if (rel && !c.hasRel) { c.cornerRel.resize(c.corners.size(), 0); c.hasRel = true; }
+								if (c.hasRel) c.cornerRel.push_back(rel);
+								c.corners.push_back(oc);
+								fq = te;
+							}
+							c.faceStart.push_back(int(c.corners.size()));
+						}
+						else if ((hl == 6 && strncmp(tok[0],"mtllib",6)==0) || (hl == 6 && strncmp(tok[0],"usemtl",6)==0))
+						{
+							ObjStateEvent ev;
+							ev.isMtlLib = (h0 == 'm');
+							if (numTokens > 1) ev.name.assign(tok[1], tokEnd[1]);
+							ev.vertBefore = int(c.vp.size());
+							ev.faceBefore = c.faceStart.empty() ? 0 : int(c.faceStart.size())-1;
+							c.events.push_back(ev);
+						}
+						// we simply ignore other situations
+					}
+					if (c.faceStart.empty()) c.faceStart.push_back(0);
+				}
 
 
 				/*!
@@ -854,61 +1252,72 @@ namespace vcg {
 				* \param filename The name of the file to open
 				*	\param mask	A mask which will be filled according to type of data found in the object
 				* \param oi A structure which will be filled with infos about the object to be opened
+				*
+				* The whole file is read in oi.buffer, so that a following Open on the same file does
+				* not need to read it again; the lines are counted in parallel.
 				*/
 
 				static bool LoadMask(const char * filename, Info &oi)
 				{
-					std::ifstream stream(filename);
-					if (stream.fail()) return false;
+					FILE *fp = fopen(filename, "rb");
+					if (fp == NULL) return false;
 
 					// obtain length of file:
-					stream.seekg (0, std::ios::end);
-					int length = stream.tellg();
-					stream.seekg (0, std::ios::beg);
-
-					if (length == 0) return false;
-
-					bool bHasPerFaceColor		= false;
-					bool bHasNormals 				= false;
-					bool bHasPerVertexColor = false;
-
-					oi.numVertices=0;
-					oi.numFaces=0;
-					oi.numTexCoords=0;
-					oi.numNormals=0;
-					int lineCount=0;
-					int totRead=0;
-					std::string line;
-					while (!stream.eof())
+					fseek(fp, 0, SEEK_END);
+					long length = ftell(fp);
+					fseek(fp, 0, SEEK_SET);
+
+					if (length <= 0) { fclose(fp); return false; }
+
+					if(oi.cb) (*oi.cb)(0, "Loading mask...");
+					oi.buffer.resize(length);
+					size_t totRead = fread(&oi.buffer[0], 1, length, fp);
+					fclose(fp);
+					oi.buffer.resize(totRead);
+					oi.bufferName = filename;
+					JoinContinuedLines(oi.buffer);
+
+					std::vector<ObjChunk> chunks;
+					SplitBuffer(oi.buffer, chunks);
+					const int nChunks = int(chunks.size());
+
+					int numVertices = 0, numFaces = 0, numTexCoords = 0, numNormals = 0;
+					int bHasPerFaceColor = 0, bHasPerVertexColor = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:numVertices,numFaces,numTexCoords,numNormals,bHasPerFaceColor,bHasPerVertexColor)
+#endif
+					for (int ci = 0; ci < nChunks; ++ci)
 					{
-						lineCount++;
-						std::getline(stream, line);
-						totRead+=line.size();
-						if(oi.cb && (lineCount%1000)==0)
-							(*oi.cb)( (int)(100.0*(float(totRead))/float(length)), "Loading mask...");
-						if(line.size()>2)
+						const char *p = chunks[ci].begin;
+						const char *e = chunks[ci].end;
+						while (p < e)
 						{
-							if(line[0]=='v')
+							const char *lineEnd = std::find(p, e, '\n');
+							const char *line = p;
+							const size_t len = lineEnd - line;
+							p = (lineEnd == e) ? lineEnd : lineEnd+1;
+							// the records are recognized by their first token, as in ParseChunk
+							const char *h = line;
+							const size_t hl = NextToken(h, lineEnd) - h;
+							if(hl==1 && h[0]=='v')
 							{
-								if(line[1]==' ')
-								{
-									oi.numVertices++;
-									if(line.size()>=7)
-										bHasPerVertexColor = true;
-								}
-								if(line[1]=='t') oi.numTexCoords++;
-								if(line[1]=='n') {
-									oi.numNormals ++;
-									bHasNormals = true;
-								}
-							}
-							else {
-								if((line[0]=='f') || (line[0]=='q')) oi.numFaces++;
-								else
-									if(line[0]=='u' && line[1]=='s') bHasPerFaceColor = true; // there is a usematerial so add per face color
+								numVertices++;
+								if(len>=7)
+									bHasPerVertexColor = 1;
 							}
+							else if(hl==2 && h[0]=='v' && h[1]=='t') numTexCoords++;
+							else if(hl==2 && h[0]=='v' && h[1]=='n') numNormals++;
+							else if(hl==1 && (h[0]=='f' || h[0]=='q')) numFaces++;
+							else if(hl==6 && strncmp(h,"usemtl",6)==0) bHasPerFaceColor = 1; // there is a usematerial so add per face color
 						}
 					}
+					if(oi.cb) (*oi.cb)(100, "Loading mask...");
+
+					oi.numVertices=numVertices;
+					oi.numFaces=numFaces;
+					oi.numTexCoords=numTexCoords;
+					oi.numNormals=numNormals;
+					const bool bHasNormals = (numNormals > 0);
 					oi.mask = 0;
 					if (oi.numTexCoords)
 					{
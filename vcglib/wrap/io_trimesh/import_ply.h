@@ -328,6 +328,113 @@ static bool ErrorCritical(int err)
 }
 	
 
+/// Copy the data of a vertex record into the vertex v
+static void VertAuxToVertex(OpenMeshType &m, VertexType &v, const LoadPly_VertAux<ScalarType> &va, const PlyInfo &pi,
+                            bool hasIntensity, const std::vector<PropDescriptor> &VPV)
+{
+	v.P()[0] = va.p[0];
+	v.P()[1] = va.p[1];
+	v.P()[2] = va.p[2];
+
+	if( HasPerVertexFlags(m) &&  (pi.mask & Mask::IOM_VERTFLAGS) )
+		v.Flags() = va.flags;
+
+	if( pi.mask & Mask::IOM_VERTQUALITY )
+		v.Q() = (typename OpenMeshType::VertexType::QualityType)va.q;
+
+	if( pi.mask & Mask::IOM_VERTNORMAL )
+		{
+			v.N()[0]=va.n[0];
+			v.N()[1]=va.n[1];
+			v.N()[2]=va.n[2];
+		}
+
+	if( pi.mask & Mask::IOM_VERTTEXCOORD )
+		{
+			v.T().P().X() = va.u;
+			v.T().P().Y() = va.v;
+		}
+
+	if( pi.mask & Mask::IOM_VERTCOLOR )
+		{
+			if(hasIntensity)
+					v.C().SetGrayShade(va.intensity);
+			else
+				{
+					v.C()[0] = va.r;
+					v.C()[1] = va.g;
+					v.C()[2] = va.b;
+					v.C()[3] = 255;
+				}
+		}
+	if( pi.mask & Mask::IOM_VERTRADIUS )
+			v.R() = va.radius;
+
+	for(int k=0;k<pi.vdn;k++)
+		memcpy((char *)(&v) + pi.VertexData[k].offset1,
+						(char *)(&va) + VPV[k].offset1,
+						VPV[k].memtypesize());
+}
+
+/// Copy the per face attributes (everything but the vertex references) of a face record into the face f
+static void FaceAuxToFace(OpenMeshType &m, FaceType &f, const LoadPly_FaceAux &fa, const PlyInfo &pi, bool multit)
+{
+	if(HasPolyInfo(m)) f.Alloc(3);
+
+	if(HasPerFaceFlags(m) &&( pi.mask & Mask::IOM_FACEFLAGS) )
+	{
+		f.Flags() = fa.flags;
+	}
+
+	if( pi.mask & Mask::IOM_FACEQUALITY )
+	{
+		f.Q() = (typename OpenMeshType::FaceType::QualityType) fa.q;
+	}
+
+	if( pi.mask & Mask::IOM_FACECOLOR )
+	{
+		f.C()[0] = fa.r;
+		f.C()[1] = fa.g;
+		f.C()[2] = fa.b;
+		f.C()[3] = 255;
+	}
+
+	if( pi.mask & Mask::IOM_WEDGTEXCOORD )
+	{
+		for(int k=0;k<3;++k)
+		{
+			f.WT(k).u() = fa.texcoord[k*2+0];
+			f.WT(k).v() = fa.texcoord[k*2+1];
+			if(multit) f.WT(k).n() = fa.texcoordind;
+			else f.WT(k).n()=0; // safely intialize texture index
+		}
+	}
+
+	if( pi.mask & Mask::IOM_WEDGCOLOR )
+	{
+		if(FaceType::HasWedgeColor()){
+			for(int k=0;k<3;++k)
+			{
+				f.WC(k)[0] = (unsigned char)(fa.colors[k*3+0]*255);
+				f.WC(k)[1] = (unsigned char)(fa.colors[k*3+1]*255);
+				f.WC(k)[2] = (unsigned char)(fa.colors[k*3+2]*255);
+			}
+		}
+		if(HasPerFaceColor(m))	{
+				f.C()[0] = (unsigned char)((fa.colors[0*3+0]*255+fa.colors[1*3+0]*255+fa.colors[2*3+0]*255)/3.0f);
+				f.C()[1] = (unsigned char)((fa.colors[0*3+1]*255+fa.colors[1*3+1]*255+fa.colors[2*3+1]*255)/3.0f);
+				f.C()[2] = (unsigned char)((fa.colors[0*3+2]*255+fa.colors[1*3+2]*255+fa.colors[2*3+2]*255)/3.0f);
+		}
+	}
+}
+
+/// Read the j-th record of the element i either from the mapped file or sequentially.
+static int ReadRecord(vcg::ply::PlyFile &pf, bool mapped, int i, int j, void *mem)
+{
+	if(mapped) return pf.ReadMapped(pf.ElemBody(i)+size_t(j)*pf.ElemRecordSize(i),mem);
+	return pf.Read(mem);
+}
+
 /// Standard call for reading a mesh, returns 0 on success.
 static int Open( OpenMeshType &m, const char * filename, CallBackPos *cb=0)
 {
@@ -573,10 +680,24 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
   /**************************************************************/
   /* Main Reading Loop */
   /**************************************************************/
+  // Uncompressed binary files are memory mapped: elements whose records have
+  // a constant size are decoded directly from memory (vertices and faces in
+  // parallel); an element with variable sized records is read by the
+  // sequential reader, starting from its position in the file.
+  const bool fileMapped = (pf.MapBody()==0);
   m.Clear();
   for(int i=0;i<int(pf.elements.size());i++)
 	{
 		int n = pf.ElemNumber(i);
+		const bool mapped = fileMapped && pf.ElemRecordSize(i)!=0;
+		if(fileMapped && !mapped && n>0)
+		{
+			if(pf.SeekElement(i)==-1)
+			{
+				pi.status = PlyInfo::E_SHORTFILE;
+				return pi.status;
+			}
+		}
 
 		if( !strcmp( pf.ElemName(i),"camera" ) )
 		{
@@ -586,7 +707,7 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 
 			for(int j=0;j<n;++j)
 			{
-				if( pf.Read( (void *)&(ca) )==-1 )
+				if( ReadRecord(pf,mapped,i,j,(void *)&(ca))==-1 )
 				{
 					pi.status = PlyInfo::E_SHORTFILE;
 					return pi.status;
@@ -636,64 +757,44 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 
 			pf.SetCurElement(i);
       VertexIterator vi=Allocator<OpenMeshType>::AddVertices(m,n);
-			
-      for(j=0;j<n;++j)
+			const size_t vbase = vi - m.vert.begin();
+
+			if(mapped)
 			{
-				if(pi.cb && (j%1000)==0) pi.cb(j*50/n,"Vertex Loading");
-			  if( pf.Read( (void *)&(va) )==-1 )
+				const int BlockSize = 1<<18;
+				for(int b=0;b<n;b+=BlockSize)
 				{
-					pi.status = PlyInfo::E_SHORTFILE;
-					return pi.status;
-				}
-				
-				(*vi).P()[0] = va.p[0];
-				(*vi).P()[1] = va.p[1];
-				(*vi).P()[2] = va.p[2];
-
-				if( HasPerVertexFlags(m) &&  (pi.mask & Mask::IOM_VERTFLAGS) )
-					(*vi).Flags() = va.flags;
-
-				if( pi.mask & Mask::IOM_VERTQUALITY )
-					(*vi).Q() = (typename OpenMeshType::VertexType::QualityType)va.q;
-
-				if( pi.mask & Mask::IOM_VERTNORMAL )
+					if(pi.cb) pi.cb(int(b*50.0/n),"Vertex Loading");
+					const int e = std::min(n,b+BlockSize);
+#ifdef _OPENMP
+					#pragma omp parallel for schedule(static)
+#endif
+					for(j=b;j<e;++j)
 					{
-						(*vi).N()[0]=va.n[0];
-						(*vi).N()[1]=va.n[1];
-						(*vi).N()[2]=va.n[2];
+						LoadPly_VertAux<ScalarType> lva;
+						lva.flags = 42;
+						pf.ReadMapped(pf.ElemBody(i)+size_t(j)*pf.ElemRecordSize(i),(void *)&lva);
+						VertAuxToVertex(m,m.vert[vbase+j],lva,pi,hasIntensity,VPV);
 					}
-
-        if( pi.mask & Mask::IOM_VERTTEXCOORD )
-          {
-            (*vi).T().P().X() = va.u;
-            (*vi).T().P().Y() = va.v;
-          }
-				
-				if( pi.mask & Mask::IOM_VERTCOLOR )
+				}
+			}
+			else
+			{
+				for(j=0;j<n;++j)
+				{
+					if(pi.cb && (j%1000)==0) pi.cb(j*50/n,"Vertex Loading");
+					if( pf.Read( (void *)&(va) )==-1 )
 					{
-						if(hasIntensity)
-								(*vi).C().SetGrayShade(va.intensity);
-						else
-							{
-								(*vi).C()[0] = va.r;
-								(*vi).C()[1] = va.g;
-								(*vi).C()[2] = va.b;
-								(*vi).C()[3] = 255;
-							}
+						pi.status = PlyInfo::E_SHORTFILE;
+						return pi.status;
 					}
-				if( pi.mask & Mask::IOM_VERTRADIUS )
-						(*vi).R() = va.radius; 
-
-				
-				for(int k=0;k<pi.vdn;k++)	
-					memcpy((char *)(&*vi) + pi.VertexData[k].offset1,
-									(char *)(&va) + VPV[k].offset1, 
-									VPV[k].memtypesize());
-			++vi;
-      }
+					VertAuxToVertex(m,*vi,va,pi,hasIntensity,VPV);
+					++vi;
+				}
+			}
 
 			index.resize(n);
-			for(j=0,vi=m.vert.begin();j<n;++j,++vi)
+			for(j=0,vi=m.vert.begin()+vbase;j<n;++j,++vi)
 				index[j] = &*vi;
 		}
 		else if( !strcmp( pf.ElemName(i),"edge") && (n>0) )/******************** EDGE READING *******************************/
@@ -704,7 +805,7 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 		  for(int j=0;j<n;++j)
 		  {
 			  if(pi.cb && (j%1000)==0) pi.cb(50+j*50/n,"Edge Loading");
-			  if( pf.Read(&ea)==-1 )
+			  if( ReadRecord(pf,mapped,i,j,&ea)==-1 )
 			  {
 				  pi.status = PlyInfo::E_SHORTFILE;
 				  return pi.status;
@@ -723,15 +824,87 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 		{
 			int j;
 			
-      FaceIterator fi=Allocator<OpenMeshType>::AddFaces(m,n);
 			pf.SetCurElement(i);
 
+			// All the records of a mapped element have the same number of vertices,
+			// so the position of each resulting (fan triangulated) face is known in
+			// advance and the faces can be decoded in parallel.
+			int mappedSize=0;
+			if(mapped)
+			{
+				pf.ReadMapped(pf.ElemBody(i),&fa);
+				mappedSize=fa.size;
+			}
+			if(mappedSize>=3)
+			{
+				if(mappedSize!=3 && ( ( pi.mask & Mask::IOM_WEDGCOLOR ) || ( pi.mask & Mask::IOM_WEDGTEXCOORD ) ) )
+				{
+					pi.status = PlyInfo::E_NO_3VERTINFACE;
+					return pi.status;
+				}
+				const int nt = mappedSize-2;
+				FaceIterator fi=Allocator<OpenMeshType>::AddFaces(m,size_t(n)*nt);
+				const size_t fbase = fi - m.face.begin();
+				if(nt>1) pi.mask |= Mask::IOM_BITPOLYGONAL;
+
+				int badIndex=0;
+				const int BlockSize = 1<<18;
+				for(int b=0;b<n;b+=BlockSize)
+				{
+					if(pi.cb) pi.cb(50+int(b*50.0/n),"Face Loading");
+					const int e = std::min(n,b+BlockSize);
+#ifdef _OPENMP
+					#pragma omp parallel for schedule(static) reduction(+:badIndex)
+#endif
+					for(j=b;j<e;++j)
+					{
+						LoadPly_FaceAux lfa;
+						pf.ReadMapped(pf.ElemBody(i)+size_t(j)*pf.ElemRecordSize(i),&lfa);
+						int k;
+						for(k=0;k<mappedSize;++k)
+							if( lfa.v[k]<0 || lfa.v[k]>=m.vn ) break;
+						if(k<mappedSize) { ++badIndex; continue; }
+
+						FaceType &f = m.face[fbase+size_t(j)*nt];
+						FaceAuxToFace(m,f,lfa,pi,multit);
+						for(k=0;k<3;++k)
+							f.V(k) = index[ lfa.v[k] ];
+						if (mappedSize>3) f.SetF(2);
+						for(k=0;k<pi.fdn;k++)
+							memcpy((char *)(&f) + pi.FaceData[k].offset1,
+										 (char *)(&lfa) + FPV[k].offset1, FPV[k].memtypesize());
+
+						// fan triangulation, tagged as in the sequential reader
+						for(int qq=0;qq<mappedSize-3;++qq)
+						{
+							FaceType &ff = m.face[fbase+size_t(j)*nt+1+qq];
+							ff.V(0) = index[ lfa.v[0] ];
+							for(k=1;k<3;++k)
+								ff.V(k) = index[ lfa.v[1+qq+k] ];
+							ff.SetF(0);
+							ff.SetF(2);
+							for(k=0;k<pi.fdn;k++)
+								memcpy((char *)(&ff) + pi.FaceData[k].offset1,
+											 (char *)(&lfa) + FPV[k].offset1, FPV[k].memtypesize());
+						}
+					}
+				}
+				if(badIndex>0)
+				{
+					pi.status = PlyInfo::E_BAD_VERT_INDEX;
+					return pi.status;
+				}
+			}
+			else
+			{
+      FaceIterator fi=Allocator<OpenMeshType>::AddFaces(m,n);
+
 			for(j=0;j<n;++j)
 			{
 				int k;
 
 				if(pi.cb && (j%1000)==0) pi.cb(50+j*50/n,"Face Loading");
-				if( pf.Read(&fa)==-1 )
+				if( ReadRecord(pf,mapped,i,j,&fa)==-1 )
 				{
 					pi.status = PlyInfo::E_SHORTFILE;
 					return pi.status;
@@ -745,55 +918,8 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
           }
 				}
 				
-				if(HasPolyInfo(m)) (*fi).Alloc(3);
-
-				if(HasPerFaceFlags(m) &&( pi.mask & Mask::IOM_FACEFLAGS) )
-				{
-					(*fi).Flags() = fa.flags;
-				}
-
-				if( pi.mask & Mask::IOM_FACEQUALITY )
-				{
-					(*fi).Q() = (typename OpenMeshType::FaceType::QualityType) fa.q;
-				}
-
-				if( pi.mask & Mask::IOM_FACECOLOR )
-				{
-					(*fi).C()[0] = fa.r;
-					(*fi).C()[1] = fa.g;
-					(*fi).C()[2] = fa.b;
-					(*fi).C()[3] = 255;
-				}
-
-				if( pi.mask & Mask::IOM_WEDGTEXCOORD )
-				{
-					for(int k=0;k<3;++k)
-					{
-						(*fi).WT(k).u() = fa.texcoord[k*2+0];
-						(*fi).WT(k).v() = fa.texcoord[k*2+1];
-						if(multit) (*fi).WT(k).n() = fa.texcoordind;
-            else (*fi).WT(k).n()=0; // safely intialize texture index
-					}
-				}
+				FaceAuxToFace(m,*fi,fa,pi,multit);
 
-				if( pi.mask & Mask::IOM_WEDGCOLOR )
-				{
-					if(FaceType::HasWedgeColor()){
-						for(int k=0;k<3;++k)
-						{
-							(*fi).WC(k)[0] = (unsigned char)(fa.colors[k*3+0]*255);
-							(*fi).WC(k)[1] = (unsigned char)(fa.colors[k*3+1]*255);
-							(*fi).WC(k)[2] = (unsigned char)(fa.colors[k*3+2]*255);
-						}
-					}
-					//if(FaceType::HasFaceColor()){
-					//if(pi.mask & Mask::IOM_FACECOLOR){
-					if(HasPerFaceColor(m))	{
-							(*fi).C()[0] = (unsigned char)((fa.colors[0*3+0]*255+fa.colors[1*3+0]*255+fa.colors[2*3+0]*255)/3.0f);
-							(*fi).C()[1] = (unsigned char)((fa.colors[0*3+1]*255+fa.colors[1*3+1]*255+fa.colors[2*3+1]*255)/3.0f);
-							(*fi).C()[2] = (unsigned char)((fa.colors[0*3+2]*255+fa.colors[1*3+2]*255+fa.colors[2*3+2]*255)/3.0f);
-					}
-				}
         /// Now the temporary struct 'fa' is ready to be copied into the real face '*fi'
         /// This loop 
 				for(k=0;k<3;++k)
@@ -851,6 +977,7 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
         }
 
       }
+			}
 		}else if( !strcmp( pf.ElemName(i),"tristrips") )//////////////////// LETTURA TRISTRIP DI STANFORD
 		{ 
 			int j;
@@ -860,7 +987,7 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 			{
 				int k;
 				if(pi.cb && (j%1000)==0) pi.cb(50+j*50/n,"Tristrip Face Loading");
-				if( pf.Read(&tsa)==-1 )
+				if( ReadRecord(pf,mapped,i,j,&tsa)==-1 )
 				{
 					pi.status = PlyInfo::E_SHORTFILE;
 					return pi.status;
@@ -914,12 +1041,17 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 				//qDebug("Rows %i Cols %i",RangeGridRows,RangeGridCols);
 			}
 			int totPnt = RangeGridCols*RangeGridRows;
+			if(RangeGridCols<0 || RangeGridRows<0 || totPnt>n)
+			{
+				pi.status = PlyInfo::E_SHORTFILE;
+				return pi.status;
+			}
 			// standard reading;
 			pf.SetCurElement(i);
 			for(int j=0;j<totPnt;++j)
 			{
 				if(pi.cb && (j%1000)==0) pi.cb(50+j*50/totPnt,"RangeMap Face Loading");
-				if( pf.Read(&rga)==-1 )
+				if( ReadRecord(pf,mapped,i,j,&rga)==-1 )
 				{
 					//qDebug("Error after loading %i elements",j);
 					pi.status = PlyInfo::E_SHORTFILE;
@@ -930,7 +1062,14 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 					if(rga.num_pts == 0)
 						RangeGridAuxVec.push_back(-1);
 					else 
+					{
+						if(rga.pts[0]<0 || rga.pts[0]>=m.vn)
+						{
+							pi.status = PlyInfo::E_BAD_VERT_INDEX;
+							return pi.status;
+						}
 						RangeGridAuxVec.push_back(rga.pts[0]);
+					}
 				}
 			} 
 			//qDebug("Completed the reading of %i indexes",RangeGridAuxVec.size());
@@ -941,6 +1080,7 @@ static int Open( OpenMeshType &m, const char * filename, PlyInfo &pi )
 				// Skippaggio elementi non gestiti
 			int n = pf.ElemNumber(i);
 			pf.SetCurElement(i);
+			if(fileMapped) continue; // nothing to read, the next element is located by its offset
 
 			for(int j=0;j<n;j++)
 			{
@@ -24,6 +24,9 @@
 #ifndef __VCGLIB_IMPORT_STL
 #define __VCGLIB_IMPORT_STL
 #include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
 #include <wrap/callback.h>
 #include <vcg/space/color4.h>
 
@@ -217,6 +220,42 @@ static int OpenBinary( OpenMeshType &m, const char * filename, int &loadMask, Ca
   }
 
 
+  /// Read the triangles of a binary stl file in chunks without building a mesh, for files that do not fit in memory:
+  /// on each chunk it calls sink.AddTriangles(const Point3f *p, int triNum), with the three vertices of each triangle in p
+  /// (e.g. the sink can be a tri::ClusteringStream).
+  template <class SinkType>
+  static int ReadBinaryTriangles(const char * filename, SinkType &sink, CallBackPos *cb=0)
+  {
+    FILE *fp = fopen(filename, "rb");
+    if(fp == NULL)
+      return E_CANTOPEN;
+
+    int facenum=0;
+    fseek(fp, STL_LABEL_SIZE, SEEK_SET);
+    fread(&facenum, sizeof(int), 1, fp);
+
+    // each facet is the normal, the three vertices and a short attribute
+    const int facetSize=4*sizeof(Point3f)+sizeof(unsigned short);
+    const int chunkSize=1<<16;
+    std::vector<char> buf(size_t(chunkSize)*facetSize);
+    std::vector<Point3f> tri(3*chunkSize);
+    for(int start=0;start<facenum;start+=chunkSize)
+    {
+      const int n=std::min(chunkSize,facenum-start);
+      if(fread(&buf[0],facetSize,n,fp)!=size_t(n))
+      {
+        fclose(fp);
+        return E_UNESPECTEDEOF;
+      }
+      for(int i=0;i<n;++i)
+        memcpy(&tri[3*i],&buf[size_t(i)*facetSize+sizeof(Point3f)],3*sizeof(Point3f));
+      sink.AddTriangles(&tri[0],n);
+      if(cb) cb(int(100.0*(start+n)/facenum),"STL Mesh Reading");
+    }
+    fclose(fp);
+    return E_NOERROR;
+  }
+
   static int OpenAscii( OpenMeshType &m, const char * filename, CallBackPos *cb=0)
   {
     FILE *fp;
@@ -0,0 +1,128 @@
+/****************************************************************************
+* VCGLib                                                            o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+#ifndef __VCGLIB_PLY_BLOCK_SOURCE
+#define __VCGLIB_PLY_BLOCK_SOURCE
+
+#include <string.h>
+#include <wrap/io_trimesh/import_ply.h>
+
+namespace vcg {
+namespace tri {
+namespace io {
+
+/** A memory mapped binary ply file seen as a source of faces for
+  QuadricBlockSimplification (see tri_edge_collapse_quadric_block.h).
+  Vertices and faces are decoded on request directly from the mapped file,
+  so the mesh is never loaded in memory; only the vertex positions are read.
+  Open fails if the file is ascii or compressed, or if its faces are not
+  all triangles (the records must have a fixed size to be randomly accessed).
+  */
+template <class OpenMeshType>
+class PlyBlockSource
+{
+public:
+  typedef ImporterPLY<OpenMeshType> Importer;
+  typedef typename OpenMeshType::ScalarType ScalarType;
+  typedef typename OpenMeshType::CoordType CoordType;
+  typedef typename Importer::LoadPly_FaceAux FaceAux;
+  typedef typename Importer::template LoadPly_VertAux<ScalarType> VertAux;
+
+  PlyBlockSource():vertElem(-1),faceElem(-1),vertBody(0),faceBody(0),vertRec(0),faceRec(0),vn(0),fn(0){}
+  ~PlyBlockSource(){ pf.UnmapBody(); }
+
+  bool Open(const char *filename)
+  {
+    if(pf.Open(filename,vcg::ply::PlyFile::MODE_READ)==-1) return false;
+    if( pf.AddToRead(Importer::VertDesc(0))==-1 && pf.AddToRead(Importer::VertDesc(22)) ) return false;
+    if( pf.AddToRead(Importer::VertDesc(1))==-1 && pf.AddToRead(Importer::VertDesc(23)) ) return false;
+    if( pf.AddToRead(Importer::VertDesc(2))==-1 && pf.AddToRead(Importer::VertDesc(24)) ) return false;
+    if( pf.AddToRead(Importer::FaceDesc(0))==-1 )
+    {
+      int ii;
+      for(ii=_FACEDESC_FIRST_;ii< _FACEDESC_LAST_;++ii)
+        if( pf.AddToRead(Importer::FaceDesc(ii))!=-1 ) break;
+      if(ii==_FACEDESC_LAST_) return false;
+    }
+    if(pf.MapBody()!=0) return false;
+
+    for(int i=0;i<int(pf.elements.size());++i)
+    {
+      if(pf.elements[i].name=="vertex") vertElem=i;
+      if(pf.elements[i].name=="face") faceElem=i;
+    }
+    if(vertElem<0 || faceElem<0) return false;
+    vertBody=pf.ElemBody(vertElem); vertRec=pf.ElemRecordSize(vertElem);
+    faceBody=pf.ElemBody(faceElem); faceRec=pf.ElemRecordSize(faceElem);
+    if(vertBody==0 || faceBody==0 || vertRec==0 || faceRec==0) return false;
+    vn=pf.ElemNumber(vertElem);
+    fn=pf.ElemNumber(faceElem);
+
+    // a constant record size means that all the faces have as many vertices as the first one
+    if(fn>0)
+    {
+      FaceAux fa;
+      fa.size=0;
+      pf.ReadMapped(faceElem,faceBody,&fa);
+      if(fa.size!=3) return false;
+    }
+    return true;
+  }
+
+  int VN() const { return vn; }
+  int FN() const { return fn; }
+
+  CoordType GetVert(int i) const
+  {
+    VertAux va;
+    pf.ReadMapped(vertElem,vertBody+size_t(i)*vertRec,&va);
+    return CoordType(va.p[0],va.p[1],va.p[2]);
+  }
+
+  bool GetFace(int i, int v[3]) const
+  {
+    FaceAux fa;
+    pf.ReadMapped(faceElem,faceBody+size_t(i)*faceRec,&fa);
+    for(int j=0;j<3;++j)
+    {
+      if(fa.v[j]<0 || fa.v[j]>=vn) return false;
+      v[j]=fa.v[j];
+    }
+    return true;
+  }
+
+  template <class VertexType> void ImportVert(int i, VertexType &v) const { v.P().Import(GetVert(i)); }
+  template <class FaceType> void ImportFace(int , FaceType &) const {}
+  template <class BlockMeshType> void InitBlock(BlockMeshType &) const {}
+
+protected:
+  vcg::ply::PlyFile pf;
+  int vertElem,faceElem;
+  const char *vertBody,*faceBody;
+  size_t vertRec,faceRec;
+  int vn,fn;
+};
+
+} // end namespace io
+} // end namespace tri
+} // end namespace vcg
+#endif
@@ -47,6 +47,13 @@ of Greg Turk and on the work of Claudio Rocchini
 
 #ifdef WIN32
 #include <direct.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include <fcntl.h>
@@ -948,6 +955,10 @@ PlyFile::PlyFile( void )
 	format		= F_UNSPECIFIED;
 	cure		= 0;
 	ReadCB		= 0;
+	bodyoffset	= 0;
+	mapbase		= 0;
+	mapsize		= 0;
+	maphandle	= 0;
 	InitSBuffer();
 }
 
@@ -971,6 +982,7 @@ int PlyFile::Open( const char * filename, int mode )
 
 void PlyFile::Destroy( void )
 {
+	UnmapBody();
 	if(gzfp!=0)
 	{
 		pb_fclose(gzfp);
@@ -1013,6 +1025,7 @@ int PlyFile::OpenRead( const char * filename )
 		error = E_CANTOPEN;
 		goto error;
 	}
+	this->filename = filename;
 
   header.clear();
   header.reserve(1536);
@@ -1124,6 +1137,7 @@ int PlyFile::OpenRead( const char * filename )
 		}
 		else if( !strcmp(token,ENDHEADER) )
 		{
+			bodyoffset = size_t(ftell(gzfp));
 			break;
 		}
 		else if( !strcmp(token,ELEMENT) )
@@ -3609,6 +3623,290 @@ int ReadAscii( XFILE * fp, const PlyProperty * pr, void * mem, int /*fmt*/ )
 }
 
 
+	// *** Memory mapped reading ***
+
+	// Legge dalla memoria un valore di tipo tf, scambiando i byte se necessario
+
+static inline double GetScalarM( const char * src, const int tf, const int fmt )
+{
+  char		ch;
+  short	sh;
+  int		in;
+  uchar	uc;
+  ushort	us;
+  uint		ui;
+  float	fl;
+  double	dd;
+
+#ifdef LITTLE_MACHINE
+	const bool swap = (fmt==F_BINBIG);
+#else
+	const bool swap = (fmt==F_BINLITTLE);
+#endif
+
+	switch(tf)
+	{
+	case T_CHAR:	memcpy(&ch,src,1); return ch;
+	case T_UCHAR:	memcpy(&uc,src,1); return uc;
+		// swapping is done on the unsigned types only, to avoid aliasing problems
+	case T_SHORT:	memcpy(&us,src,2); if(swap) SwapShort(&us); memcpy(&sh,&us,2); return sh;
+	case T_USHORT:	memcpy(&us,src,2); if(swap) SwapShort(&us); return us;
+	case T_INT:		memcpy(&ui,src,4); if(swap) SwapInt(&ui); memcpy(&in,&ui,4); return in;
+	case T_UINT:	memcpy(&ui,src,4); if(swap) SwapInt(&ui); return ui;
+	case T_FLOAT:	memcpy(&ui,src,4); if(swap) SwapInt(&ui); memcpy(&fl,&ui,4); return fl;
+	case T_DOUBLE:	memcpy(&dd,src,8); if(swap) SwapDouble(&dd); return dd;
+	default: assert(0); return 0;
+	}
+}
+
+	// Copia un valore di tipo tf in memoria col tipo tm.
+	// Il caso piu' comune (stesso tipo, nessuno swap) e' una semplice copia.
+
+static inline void CopyScalarM( const char * src, void * mem, const int tf, const int tm, const int fmt )
+{
+#ifdef LITTLE_MACHINE
+	if(tf==tm && fmt==F_BINLITTLE)
+#else
+	if(tf==tm && fmt==F_BINBIG)
+#endif
+	{
+		memcpy(mem,src,TypeSize[tf]);
+		return;
+	}
+
+	double v = GetScalarM(src,tf,fmt);
+	switch(tm)
+	{
+	case T_CHAR:	*(char   *)mem = (char  )v; break;
+	case T_SHORT:	*(short  *)mem = (short )v; break;
+	case T_INT:		*(int    *)mem = (int   )v; break;
+	case T_UCHAR:	*(uchar  *)mem = (uchar )v; break;
+	case T_USHORT:	*(ushort *)mem = (ushort)v; break;
+	case T_UINT:	*(uint   *)mem = (uint  )v; break;
+	case T_FLOAT:	*(float  *)mem = (float )v; break;
+	case T_DOUBLE:	*(double *)mem = (double)v; break;
+	default: assert(0);
+	}
+}
+
+int PlyFile::MapBody()
+{
+	UnmapBody();
+	if(format!=F_BINLITTLE && format!=F_BINBIG) return -1;
+	if(filename.empty() || bodyoffset==0) return -1;
+
+#ifdef WIN32
+	HANDLE fh = CreateFileA(filename.c_str(),GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,0);
+	if(fh==INVALID_HANDLE_VALUE) return -1;
+	LARGE_INTEGER sz;
+	if(!GetFileSizeEx(fh,&sz) || sz.QuadPart==0 || (unsigned long long)sz.QuadPart > (unsigned long long)(size_t(-1)))
+	{
+		CloseHandle(fh);
+		return -1;
+	}
+	HANDLE mh = CreateFileMappingA(fh,0,PAGE_READONLY,0,0,0);
+	CloseHandle(fh);
+	if(mh==0) return -1;
+	void * p = MapViewOfFile(mh,FILE_MAP_READ,0,0,0);
+	if(p==0)
+	{
+		CloseHandle(mh);
+		return -1;
+	}
+	maphandle = (void *)mh;
+	mapsize = size_t(sz.QuadPart);
+#else
+	int fd = open(filename.c_str(),O_RDONLY);
+	if(fd==-1) return -1;
+	struct stat st;
+	if(fstat(fd,&st)==-1 || st.st_size==0 || (unsigned long long)st.st_size > (unsigned long long)(size_t(-1)))
+	{
+		close(fd);
+		return -1;
+	}
+	void * p = mmap(0,size_t(st.st_size),PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(p==MAP_FAILED) return -1;
+	mapsize = size_t(st.st_size);
+#endif
+	mapbase = (char *)p;
+
+		// Calcolo del layout degli elementi: un elemento ha record di
+		// dimensione costante se tutte le sue liste hanno sempre la stessa
+		// lunghezza del primo record. Gli elementi con record di dimensione
+		// variabile (o senza record) vengono solo percorsi per trovare
+		// l'inizio del successivo: si leggono in modo sequenziale.
+	recsize.assign(elements.size(),0);
+	elemoffset.assign(elements.size(),0);
+	size_t pos = bodyoffset;
+	for(size_t i=0;i<elements.size();++i)
+	{
+		const PlyElement & e = elements[i];
+		if(pos==0) break;
+		elemoffset[i] = pos;
+		if(e.number<=0) continue;
+
+			// dimensione del primo record e posizione dei contatori delle liste
+		std::vector<size_t> countpos;
+		std::vector<size_t> countsize;
+		size_t rs = 0;
+		bool ok = true;
+		for(size_t j=0;j<e.props.size();++j)
+		{
+			const PlyProperty & pr = e.props[j];
+			if(pr.islist)
+			{
+				if(pos+rs+TypeSize[pr.tipoindex] > mapsize) { ok = false; break; }
+				double n = GetScalarM(mapbase+pos+rs,pr.tipoindex,format);
+				if(n<0) { ok = false; break; }
+				countpos.push_back(rs);
+				countsize.push_back(TypeSize[pr.tipoindex]);
+				rs += TypeSize[pr.tipoindex] + size_t(n)*TypeSize[pr.tipo];
+			}
+			else rs += TypeSize[pr.tipo];
+		}
+		if(ok && (rs==0 || pos + rs*size_t(e.number) > mapsize)) ok = false;
+
+			// controllo che tutti i contatori delle liste coincidano con il primo record
+		if(ok && !countpos.empty())
+		{
+			const char * base = mapbase+pos;
+			const int n = e.number;
+			int bad = 0;
+#ifdef _OPENMP
+			#pragma omp parallel for reduction(+:bad)
+#endif
+			for(int k=1;k<n;++k)
+			{
+				const char * rec = base + size_t(k)*rs;
+				for(size_t c=0;c<countpos.size();++c)
+					if(memcmp(rec+countpos[c],base+countpos[c],countsize[c])!=0) ++bad;
+			}
+			if(bad) ok = false;
+		}
+		if(ok)
+		{
+			recsize[i] = rs;
+			pos += rs*size_t(e.number);
+		}
+		else pos = SkipMapped(int(i),pos);
+	}
+	return 0;
+}
+
+	// Percorre i record (di dimensione variabile) dell'elemento e a partire
+	// da pos; restituisce la posizione del primo byte successivo, 0 se il
+	// file finisce prima.
+size_t PlyFile::SkipMapped( int e, size_t pos ) const
+{
+	const PlyElement & el = elements[e];
+	for(int k=0;k<el.number;++k)
+		for(size_t j=0;j<el.props.size();++j)
+		{
+			const PlyProperty & pr = el.props[j];
+			size_t sz = TypeSize[pr.tipo];
+			if(pr.islist)
+			{
+				if(pos+TypeSize[pr.tipoindex] > mapsize) return 0;
+				double n = GetScalarM(mapbase+pos,pr.tipoindex,format);
+				if(n<0) return 0;
+				pos += TypeSize[pr.tipoindex];
+				sz = size_t(n)*TypeSize[pr.tipo];
+			}
+			if(pos+sz > mapsize) return 0;
+			pos += sz;
+		}
+	return pos;
+}
+
+void PlyFile::UnmapBody()
+{
+	if(mapbase==0) return;
+#ifdef WIN32
+	UnmapViewOfFile(mapbase);
+	CloseHandle((HANDLE)maphandle);
+#else
+	munmap(mapbase,mapsize);
+#endif
+	mapbase = 0;
+	mapsize = 0;
+	maphandle = 0;
+	recsize.clear();
+	elemoffset.clear();
+}
+
+size_t PlyFile::ElemRecordSize( int i ) const
+{
+	if(mapbase==0 || i<0 || i>=int(recsize.size())) return 0;
+	return recsize[i];
+}
+
+const char * PlyFile::ElemBody( int i ) const
+{
+	if(mapbase==0 || i<0 || i>=int(elemoffset.size()) || elemoffset[i]==0) return 0;
+	return mapbase + elemoffset[i];
+}
+
+int PlyFile::ReadMapped( const char * rec, void * mem ) const
+{
+	assert(cure);
+	return ReadMapped(int(cure-&(elements[0])),rec,mem);
+}
+
+int PlyFile::ReadMapped( int e, const char * rec, void * mem ) const
+{
+	assert(e>=0 && e<int(elements.size()));
+	assert(mapbase);
+
+	const PlyElement * el = &(elements[e]);
+	vector<PlyProperty>::const_iterator i;
+	for(i=el->props.begin();i!=el->props.end();++i)
+	{
+		if(i->islist)
+		{
+			int n = int(GetScalarM(rec,i->tipoindex,format));
+			rec += TypeSize[i->tipoindex];
+			if(i->bestored)
+			{
+				char * store;
+				StoreInt( ((char *)mem)+i->desc.offset2, i->desc.memtype2, n);
+				if(i->desc.alloclist)
+				{
+					store = (char *)calloc(n,TypeSize[i->desc.memtype1]);
+					assert(store);
+					*(char **)(((char *)mem)+i->desc.offset1) = store;
+				}
+				else
+					store = ((char *)mem)+i->desc.offset1;
+
+				for(int k=0;k<n;++k)
+					CopyScalarM(rec+k*TypeSize[i->tipo], store+k*TypeSize[i->desc.memtype1],
+						i->desc.stotype1, i->desc.memtype1, format);
+			}
+			rec += n*TypeSize[i->tipo];
+		}
+		else
+		{
+			if(i->bestored)
+				CopyScalarM(rec, ((char *)mem)+i->desc.offset1, i->desc.stotype1, i->desc.memtype1, format);
+			rec += TypeSize[i->tipo];
+		}
+	}
+	return 0;
+}
+
+int PlyFile::SeekElement( int i )
+{
+	const char * body = ElemBody(i);
+	if(body==0 || gzfp==0) return -1;
+	size_t offset = size_t(body-mapbase);
+#ifdef _MSC_VER
+	return _fseeki64(gzfp,(__int64)offset,SEEK_SET)==0 ? 0 : -1;
+#else
+	return fseeko(gzfp,(off_t)offset,SEEK_SET)==0 ? 0 : -1;
+#endif
+}
+
 	// Finally! the main function
 
 int PlyFile::Read( void * mem )
@@ -295,6 +295,31 @@ public:
 		// Lettura du un elemento
 	int Read( void * mem );
 
+		// Fast path for uncompressed binary files: the whole file is memory
+		// mapped and the layout of each element is computed once from the header.
+		// Elements whose records have a constant size (no lists, or lists that
+		// always have the same length) can then be decoded in any order and
+		// from many threads at once with ReadMapped.
+		// Returns -1 if the file is ascii or if it cannot be mapped.
+	int MapBody();
+	void UnmapBody();
+	inline bool IsMapped() const { return mapbase!=0; }
+		// Size in bytes of a record of element i, 0 if not constant (or if the element is empty).
+	size_t ElemRecordSize( int i ) const;
+		// Pointer to the first record of element i, 0 if it cannot be located
+		// (i.e. the file is shorter than the header says). The elements with
+		// records of variable size are located too, but must be read with Read.
+	const char * ElemBody( int i ) const;
+		// Decode a single record of the current element (see SetCurElement)
+		// stored at rec. It does not modify the PlyFile so it is thread safe.
+	int ReadMapped( const char * rec, void * mem ) const;
+		// As above but for the records of element e: different elements can
+		// be decoded at the same time without touching the current element.
+	int ReadMapped( int e, const char * rec, void * mem ) const;
+		// Move the sequential reader to the first record of element i,
+		// so that Read can continue after some elements were read with ReadMapped.
+	int SeekElement( int i );
+
   std::vector<PlyElement>   elements;	// Vettore degli elementi
 	std::vector<std::string>  comments;	// Vettore dei commenti
 	static const char * typenames[9];
@@ -313,6 +338,16 @@ protected:
 
 	PlyElement * cure;			// Elemento da leggere
 
+	std::string filename;		// Nome del file aperto (usato da MapBody)
+	size_t bodyoffset;			// Posizione del primo byte dopo l'header
+	char * mapbase;				// Inizio del file mappato in memoria
+	size_t mapsize;				// Dimensione della mappatura
+	void * maphandle;			// Handle della mappatura (solo win32)
+	std::vector<size_t> recsize;	// Dimensione dei record di ogni elemento (0 se variabile)
+	std::vector<size_t> elemoffset;	// Offset di ogni elemento nel file (0 se non noto)
+		// Posizione successiva ai record di dimensione variabile dell'elemento e
+	size_t SkipMapped( int e, size_t pos ) const;
+
 		// Callback di lettura: vale ReadBin o ReadAcii
 	int (* ReadCB)( GZFILE fp, const PlyProperty * r, void * mem, int fmt );
 
@@ -0,0 +1,438 @@
+#ifndef MT_THREAD_POOL_H
+#define MT_THREAD_POOL_H
+
+#include "base.h"
+#include "mutex.h"
+#include "condition.h"
+#include "scoped_mutex_lock.h"
+#include "util.h"
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include <pthread.h>
+
+/*
+  A work stealing thread pool with parallel_for, parallel_reduce and task groups.
+
+  Each worker has its own deque of tasks: it pushes and pops the tasks at the back,
+  and when it is empty it steals the oldest tasks from the front of the other deques.
+  Threads that are not workers of the pool push their tasks in a further shared deque.
+  A thread waiting for a task group executes the queued tasks meanwhile, so tasks can
+  safely spawn and wait other tasks.
+
+  The pool used by parallel_for and parallel_reduce is a process wide one, with
+  thread_count() threads (the caller included). The count can be changed with
+  set_thread_count() (see util.h), when no parallel work is running: the pool is
+  recreated at its next use.
+
+  Example:
+
+    struct ScaleVert
+    {
+      ScaleVert(MeshType &_m, float _s):m(_m),s(_s){}
+      void operator()(int i) const { m.vert[i].P()*=s; }
+      MeshType &m; float s;
+    };
+    mt::parallel_for(0,int(m.vert.size()),ScaleVert(m,2.0f));
+*/
+
+namespace mt
+{
+
+class task
+{
+	public:
+
+		virtual ~task(void)
+		{
+			;
+		}
+
+		virtual void run(void) = 0;
+};
+
+class thread_pool;
+
+/// A set of tasks whose completion can be waited; the tasks are owned by the caller.
+class task_group
+{
+	MT_PREVENT_COPY(task_group)
+
+	public:
+
+		typedef task_group this_type;
+		typedef void       base_type;
+
+		inline task_group(thread_pool & p);
+		inline task_group(void);
+
+		~task_group(void)
+		{
+			this->wait();
+		}
+
+		inline void run(task * t);
+		inline void wait(void);
+
+	private:
+
+		friend class thread_pool;
+
+		thread_pool & pool;
+		int pending; // protected by the mutex of the pool
+};
+
+class thread_pool
+{
+	MT_PREVENT_COPY(thread_pool)
+
+	public:
+
+		typedef thread_pool this_type;
+		typedef void        base_type;
+
+		/// A pool with threadNum threads, the calling thread included (so threadNum-1 workers).
+		thread_pool(int threadNum) : queued(0), stopping(false)
+		{
+			threadNum = std::max(1, threadNum);
+			pthread_key_create(&(this->key), 0);
+			for (int i=0; i<threadNum; ++i) this->queues.push_back(new task_queue());
+			this->workers.resize(threadNum-1);
+			for (int i=0; i<threadNum-1; ++i)
+			{
+				this->workers[i].pool  = this;
+				this->workers[i].index = i;
+				pthread_create(&(this->workers[i].tid), 0, this_type::worker_func, reinterpret_cast<void *>(&(this->workers[i])));
+			}
+		}
+
+		~thread_pool(void)
+		{
+			{
+				scoped_mutex_lock lock(this->m);
+				this->stopping = true;
+				this->c.broadcast();
+			}
+			for (size_t i=0; i<this->workers.size(); ++i) pthread_join(this->workers[i].tid, 0);
+			for (size_t i=0; i<this->queues.size(); ++i) delete this->queues[i];
+			pthread_key_delete(this->key);
+		}
+
+		int thread_count(void) const
+		{
+			return int(this->queues.size());
+		}
+
+	private:
+
+		friend class task_group;
+
+		struct item
+		{
+			task       * t;
+			task_group * g;
+		};
+
+		struct task_queue
+		{
+			mutex             m;
+			std::deque<item>  q;
+		};
+
+		struct worker
+		{
+			thread_pool * pool;
+			int           index;
+			pthread_t     tid;
+		};
+
+		static void * worker_func(void * param)
+		{
+			worker * w = reinterpret_cast<worker *>(param);
+			w->pool->worker_loop(w->index);
+			return 0;
+		}
+
+		// the deque of the calling thread: its own for the workers, the shared one for the others
+		int self(void) const
+		{
+			void * v = pthread_getspecific(this->key);
+			if (v == 0) return int(this->queues.size()) - 1;
+			return int(reinterpret_cast<size_t>(v)) - 1;
+		}
+
+		void submit(task * t, task_group * g)
+		{
+			item it;
+			it.t = t;
+			it.g = g;
+			task_queue & tq = *(this->queues[this->self()]);
+			{
+				scoped_mutex_lock lock(this->m);
+				++(g->pending);
+			}
+			{
+				scoped_mutex_lock lock(tq.m);
+				tq.q.push_back(it);
+			}
+			scoped_mutex_lock lock(this->m);
+			++(this->queued);
+			this->c.signal();
+		}
+
+		// take a task: the newest one of its own deque, otherwise the oldest one of the others
+		bool pop(int s, item & it)
+		{
+			const int n = int(this->queues.size());
+			bool found = false;
+			for (int k=0; k<n && !found; ++k)
+			{
+				task_queue & tq = *(this->queues[(s + k) % n]);
+				scoped_mutex_lock lock(tq.m);
+				if (tq.q.empty()) continue;
+				if (k == 0) { it = tq.q.back();  tq.q.pop_back();  }
+				else        { it = tq.q.front(); tq.q.pop_front(); }
+				found = true;
+			}
+			if (found)
+			{
+				scoped_mutex_lock lock(this->m);
+				--(this->queued);
+			}
+			return found;
+		}
+
+		void execute(item & it)
+		{
+			it.t->run();
+			scoped_mutex_lock lock(this->m);
+			if (--(it.g->pending) == 0) this->c.broadcast();
+		}
+
+		bool run_one(void)
+		{
+			item it;
+			if (!this->pop(this->self(), it)) return false;
+			this->execute(it);
+			return true;
+		}
+
+		void wait(task_group & g)
+		{
+			for (;;)
+			{
+				{
+					scoped_mutex_lock lock(this->m);
+					if (g.pending == 0) return;
+				}
+				if (this->run_one()) continue;
+				scoped_mutex_lock lock(this->m);
+				while (g.pending > 0 && this->queued == 0) this->c.wait(this->m);
+			}
+		}
+
+		void worker_loop(int index)
+		{
+			pthread_setspecific(this->key, reinterpret_cast<void *>(size_t(index + 1)));
+			for (;;)
+			{
+				if (this->run_one()) continue;
+				scoped_mutex_lock lock(this->m);
+				while (this->queued == 0 && !this->stopping) this->c.wait(this->m);
+				if (this->queued == 0 && this->stopping) return;
+			}
+		}
+
+		std::vector<task_queue *> queues;
+		std::vector<worker>       workers;
+		pthread_key_t key;
+		mutex     m;
+		condition c;
+		int  queued;
+		bool stopping;
+};
+
+inline thread_pool * & default_pool_ptr(void)
+{
+	static thread_pool * p = 0;
+	return p;
+}
+
+/// The pool used by parallel_for and parallel_reduce, created at the first use
+/// and recreated when the thread count set with set_thread_count() changes.
+inline thread_pool & default_pool(void)
+{
+	static mutex poolMutex;
+	scoped_mutex_lock lock(poolMutex);
+	thread_pool * & p = default_pool_ptr();
+	const int n = (thread_count_setting() > 0) ? thread_count_setting() : hardware_concurrency();
+	if ((p != 0) && (p->thread_count() != n))
+	{
+		delete p;
+		p = 0;
+	}
+	if (p == 0) p = new thread_pool(n);
+	return *p;
+}
+
+inline int thread_count(void)
+{
+	return default_pool().thread_count();
+}
+
+task_group::task_group(thread_pool & p) : pool(p), pending(0)
+{
+	;
+}
+
+task_group::task_group(void) : pool(default_pool()), pending(0)
+{
+	;
+}
+
+void task_group::run(task * t)
+{
+	this->pool.submit(t, this);
+}
+
+void task_group::wait(void)
+{
+	this->pool.wait(*this);
+}
+
+namespace detail
+{
+
+template <class Body>
+class for_task : public task
+{
+	public:
+
+		for_task(const Body & b) : body(&b), begin(0), end(0)
+		{
+			;
+		}
+
+		void run(void)
+		{
+			for (int i=this->begin; i<this->end; ++i) (*(this->body))(i);
+		}
+
+		const Body * body;
+		int begin, end;
+};
+
+template <class T, class Body>
+class reduce_task : public task
+{
+	public:
+
+		reduce_task(const Body & b, const T & identity) : body(&b), begin(0), end(0), value(identity)
+		{
+			;
+		}
+
+		void run(void)
+		{
+			for (int i=this->begin; i<this->end; ++i) (*(this->body))(i, this->value);
+		}
+
+		const Body * body;
+		int begin, end;
+		T value;
+};
+
+template <class Container, class Body>
+class element_body
+{
+	public:
+
+		element_body(Container & _c, const Body & _b) : c(_c), b(_b)
+		{
+			;
+		}
+
+		void operator () (int i) const
+		{
+			this->b(this->c[i]);
+		}
+
+		Container & c;
+		const Body & b;
+};
+
+}
+
+/// Call body(i) for each i in [begin,end), splitting the range in chunks of at least grain indexes.
+/// Body must have a "void operator()(int i) const".
+template <class Body>
+void parallel_for(int begin, int end, const Body & body, int grain = 0)
+{
+	const int n = end - begin;
+	if (n <= 0) return;
+	thread_pool & pool = default_pool();
+	const int threadNum = pool.thread_count();
+	if (grain <= 0) grain = std::max(1, n / (8 * threadNum));
+	if (threadNum == 1 || n <= grain)
+	{
+		for (int i=begin; i<end; ++i) body(i);
+		return;
+	}
+	const int chunkNum = (n + grain - 1) / grain;
+	std::vector<detail::for_task<Body> > tasks(chunkNum, detail::for_task<Body>(body));
+	task_group g(pool);
+	for (int k=0; k<chunkNum; ++k)
+	{
+		tasks[k].begin = begin + k * grain;
+		tasks[k].end   = std::min(end, tasks[k].begin + grain);
+		g.run(&tasks[k]);
+	}
+	g.wait();
+}
+
+/// Call body(c[i]) for each element of a random access container (e.g. the vertex or face vector of a vcg mesh);
+/// the deleted elements are not skipped. Body must have a "void operator()(Container::value_type &) const".
+template <class Container, class Body>
+void parallel_for_each(Container & c, const Body & body, int grain = 0)
+{
+	parallel_for(0, int(c.size()), detail::element_body<Container, Body>(c, body), grain);
+}
+
+/// Reduce the range [begin,end): each chunk of grain indexes starts from identity and
+/// accumulates with body(i,value); then the chunk values are combined in order with body.join(value,other).
+/// The chunks do not depend on the number of threads, so neither does the result (even for floating point sums).
+/// Body must have "void operator()(int i, T & value) const" and "void join(T & value, const T & other) const".
+template <class T, class Body>
+T parallel_reduce(int begin, int end, const T & identity, const Body & body, int grain = 0)
+{
+	const int n = end - begin;
+	if (n <= 0) return identity;
+	if (grain <= 0) grain = std::max(1024, n / 256);
+	const int chunkNum = (n + grain - 1) / grain;
+	std::vector<detail::reduce_task<T, Body> > tasks(chunkNum, detail::reduce_task<T, Body>(body, identity));
+	for (int k=0; k<chunkNum; ++k)
+	{
+		tasks[k].begin = begin + k * grain;
+		tasks[k].end   = std::min(end, tasks[k].begin + grain);
+	}
+	thread_pool & pool = default_pool();
+	if (pool.thread_count() == 1 || chunkNum == 1)
+	{
+		for (int k=0; k<chunkNum; ++k) tasks[k].run();
+	}
+	else
+	{
+		task_group g(pool);
+		for (int k=0; k<chunkNum; ++k) g.run(&tasks[k]);
+		g.wait();
+	}
+	T value = tasks[0].value;
+	for (int k=1; k<chunkNum; ++k) body.join(value, tasks[k].value);
+	return value;
+}
+
+}
+
+#endif // MT_THREAD_POOL_H
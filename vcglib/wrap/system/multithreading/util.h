@@ -12,6 +12,10 @@
 //#error "mt utils.h : unrecognized environment."
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace mt
 {
 
@@ -36,6 +40,37 @@ inline void sleep_ms(unsigned int msecs)
 #endif
 }
 
+/// Number of processors of the machine.
+inline int hardware_concurrency(void)
+{
+#if (defined(_MSC_VER) || defined(__MINGW32__))
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	const int n = int(si.dwNumberOfProcessors);
+#else
+	const int n = int(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+	return (n > 0) ? n : 1;
+}
+
+/// The process wide thread count requested with set_thread_count(); 0 means one thread for each processor.
+inline int & thread_count_setting(void)
+{
+	static int n = 0;
+	return n;
+}
+
+/// Set the number of threads used by the parallel algorithms (0 means all the processors):
+/// the default thread pool (see thread_pool.h) and, if OpenMP is enabled, the OpenMP parallel regions.
+/// It must not be called while some parallel work is running.
+inline void set_thread_count(int n)
+{
+	thread_count_setting() = (n > 0) ? n : 0;
+#ifdef _OPENMP
+	omp_set_num_threads((n > 0) ? n : hardware_concurrency());
+#endif
+}
+
 }
 
 #endif // MT_UTIL_H